@@ -47,10 +47,8 @@
 #include <string.h>
 #include <stdio.h>
 
-// the maximum payload transferred by block we accumulate per transfer
-#ifndef MAX_BLOCK_SIZE
-#define MAX_BLOCK_SIZE 4096
-#endif
+// the Size1 or Size2 option of a peer is only trusted for that many blocks, the buffer grows as the next ones arrive
+#define BLOCK_SIZE_HINT_BLOCKS 16
 
     
 bool prv_matchBlock1 (block_data_identifier_t identifier, lwm2m_block_data_t * blockData)
@@ -68,7 +66,7 @@ bool prv_matchBlock2 (block_data_identifier_t identifier, lwm2m_block_data_t * b
 }
 
 bool (* prv_get_matcher(block_type_t blockType)) (block_data_identifier_t, lwm2m_block_data_t *) {
-    if (blockType == BLOCK_1)
+    if (blockType == BLOCK_1 || blockType == BLOCK_2_CACHE)
 {
         return &prv_matchBlock1;
     }
@@ -85,7 +83,8 @@ lwm2m_block_data_t * find_block_data(lwm2m_block_data_t * blockDataHead,
     bool (* match) (block_data_identifier_t, lwm2m_block_data_t *) = prv_get_matcher(blockType);
     lwm2m_block_data_t * blockData = blockDataHead;
     
-    while(blockData != NULL && !match(identifier, blockData))
+    // the identifiers of the different block types do not compare
+    while(blockData != NULL && (blockData->blockType != blockType || !match(identifier, blockData)))
     {
         blockData = blockData->next;
 }
@@ -102,10 +101,11 @@ lwm2m_block_data_t * prv_block_insert(lwm2m_block_data_t ** pBlockDataHead, bloc
 {
     lwm2m_block_data_t * blockData = (lwm2m_block_data_t *) lwm2m_malloc(sizeof(lwm2m_block_data_t));
     if (NULL == blockData) return NULL;
+    memset(blockData, 0, sizeof(lwm2m_block_data_t));
     blockData->next = *pBlockDataHead;
     blockData->blockType = blockType;
     blockData->identifier = identifier;
-    if (blockType == BLOCK_1) {
+    if (blockType == BLOCK_1 || blockType == BLOCK_2_CACHE) {
         blockData->identifier.uri = lwm2m_strdup(identifier.uri);
     }
     *pBlockDataHead = blockData;
@@ -113,17 +113,9 @@ lwm2m_block_data_t * prv_block_insert(lwm2m_block_data_t ** pBlockDataHead, bloc
 }
 
 static
-void prv_block_data_delete(lwm2m_block_data_t ** pBlockDataHead,
-                                           block_data_identifier_t identifier,
-                                           block_type_t blockType
-                                           )
+void prv_block_data_remove(lwm2m_block_data_t ** pBlockDataHead,
+                           lwm2m_block_data_t * removed)
 {
-    lwm2m_block_data_t * removed = find_block_data(*pBlockDataHead, identifier, blockType);
-    
-    if (removed == NULL) {
-        return;
-    }
-
     if (removed == *pBlockDataHead) {
         *pBlockDataHead = (*pBlockDataHead)->next;
     } else {
@@ -141,6 +133,21 @@ void prv_block_data_delete(lwm2m_block_data_t ** pBlockDataHead,
     free_block_data(removed);
 }
 
+static
+void prv_block_data_delete(lwm2m_block_data_t ** pBlockDataHead,
+                                           block_data_identifier_t identifier,
+                                           block_type_t blockType
+                                           )
+{
+    lwm2m_block_data_t * removed = find_block_data(*pBlockDataHead, identifier, blockType);
+    
+    if (removed == NULL) {
+        return;
+    }
+
+    prv_block_data_remove(pBlockDataHead, removed);
+}
+
 #ifdef LWM2M_RAW_BLOCK1_REQUESTS
 static
 uint8_t prv_coap_raw_block_handler(lwm2m_block_data_t ** pBlockDataHead,
@@ -198,6 +205,90 @@ uint8_t prv_coap_raw_block_handler(lwm2m_block_data_t ** pBlockDataHead,
 }
 #endif
 
+// size of the buffers of the other transfers of the peer
+static
+size_t prv_block_others_size(lwm2m_block_data_t * blockDataHead,
+                             lwm2m_block_data_t * blockData)
+{
+    lwm2m_block_data_t * target;
+    size_t size = 0;
+
+    for (target = blockDataHead; target != NULL; target = target->next)
+    {
+        if (target != blockData) size += target->blockBufferCapacity;
+    }
+    return size;
+}
+
+// complete transfers are only kept to answer retransmissions of their last block
+static
+void prv_block_release_complete(lwm2m_block_data_t ** pBlockDataHead,
+                                lwm2m_block_data_t * blockData)
+{
+    lwm2m_block_data_t ** targetP = pBlockDataHead;
+
+    while (*targetP != NULL)
+    {
+        lwm2m_block_data_t * target = *targetP;
+
+        if (target != blockData && target->complete)
+        {
+            *targetP = target->next;
+            free_block_data(target);
+        }
+        else
+        {
+            targetP = &target->next;
+        }
+    }
+}
+
+/*
+ * Makes room for size bytes in the buffer of blockData. The buffer grows
+ * geometrically so a transfer is copied a bounded number of times, whatever
+ * its number of blocks. maxSize, if not 0, caps the buffers of all the
+ * transfers of the peer.
+ */
+static
+uint8_t prv_block_reserve(lwm2m_block_data_t ** pBlockDataHead,
+                          lwm2m_block_data_t * blockData,
+                          size_t size,
+                          size_t maxSize)
+{
+    size_t others;
+    size_t capacity;
+    uint8_t * buf;
+
+    if (size <= blockData->blockBufferCapacity) return NO_ERROR;
+
+    others = prv_block_others_size(*pBlockDataHead, blockData);
+    if (maxSize != 0 && (others > maxSize || size > maxSize - others))
+    {
+        prv_block_release_complete(pBlockDataHead, blockData);
+        others = prv_block_others_size(*pBlockDataHead, blockData);
+        if (others > maxSize || size > maxSize - others)
+        {
+            return COAP_413_ENTITY_TOO_LARGE;
+        }
+    }
+
+    capacity = blockData->blockBufferCapacity * 2;
+    if (capacity < size) capacity = size;
+    if (maxSize != 0 && capacity > maxSize - others) capacity = maxSize - others;
+
+    buf = (uint8_t *) lwm2m_malloc(capacity);
+    if (buf == NULL) return COAP_500_INTERNAL_SERVER_ERROR;
+    if (blockData->blockBufferSize != 0)
+    {
+        memcpy(buf, blockData->blockBuffer, blockData->blockBufferSize);
+    }
+    lwm2m_free(blockData->blockBuffer);
+    blockData->blockBuffer = buf;
+    blockData->blockBufferCapacity = capacity;
+
+    return NO_ERROR;
+}
+
 static
 uint8_t prv_coap_block_handler(lwm2m_block_data_t ** pBlockDataHead,
                                block_data_identifier_t identifier,
@@ -207,17 +298,23 @@ uint8_t prv_coap_block_handler(lwm2m_block_data_t ** pBlockDataHead,
                                uint16_t blockSize,
                                uint32_t blockNum,
                                bool blockMore,
+                               uint32_t totalSize,
+                               size_t maxSize,
                                uint8_t ** outputBuffer,
                                size_t * outputLength)
 {
     lwm2m_block_data_t * blockData = find_block_data(*pBlockDataHead, identifier, blockType);
-    
+    uint8_t result;
+
     // manage new block transfer
     if (blockNum == 0)
     {
+        size_t expected = length;
+
         if (blockData == NULL)
         {
             blockData = prv_block_insert(pBlockDataHead, identifier, blockType);
+            if (blockData == NULL) return COAP_500_INTERNAL_SERVER_ERROR;
         }
         else
         {
@@ -225,13 +322,30 @@ uint8_t prv_coap_block_handler(lwm2m_block_data_t ** pBlockDataHead,
             lwm2m_free(blockData->blockBuffer);
             blockData->blockBuffer = NULL;
             blockData->blockBufferSize = 0;
+            blockData->blockBufferCapacity = 0;
+            blockData->complete = false;
+            blockData->streamed = false;
         }
 
-        uint8_t * buf = (uint8_t *) lwm2m_malloc(length);
-        if(buf == NULL){
-            return COAP_500_INTERNAL_SERVER_ERROR;
+        // the Size1 or Size2 option announces the size of the whole transfer
+        if (blockMore && totalSize > length)
+        {
+            expected = totalSize;
+            // refused at once above the maximum, a hint bounded to a few blocks otherwise
+            if ((maxSize == 0 || expected <= maxSize)
+             && expected > (size_t)blockSize * BLOCK_SIZE_HINT_BLOCKS)
+            {
+                expected = (size_t)blockSize * BLOCK_SIZE_HINT_BLOCKS;
+                if (expected < length) expected = length;
+            }
+        }
+
+        result = prv_block_reserve(pBlockDataHead, blockData, expected, maxSize);
+        if (result != NO_ERROR)
+        {
+            prv_block_data_delete(pBlockDataHead, identifier, blockType);
+            return result;
         }
-        blockData->blockBuffer = buf;
         blockData->blockBufferSize = length;
 
         // write new block in buffer
@@ -254,25 +368,23 @@ uint8_t prv_coap_block_handler(lwm2m_block_data_t ** pBlockDataHead,
         // If this is a retransmission, we already did that.
        if (blockNum == blockData->blockNum +1)
        {
-          uint8_t * oldBuffer = blockData->blockBuffer;
-          size_t oldSize = blockData->blockBufferSize;
-
-          if (blockData->blockBufferSize != blockSize * blockNum)
+          if (blockData->blockBufferSize != (size_t)blockSize * blockNum)
           {
               // we don't receive block in right order
               // TODO should we clean block1 data for this server ?
               return COAP_408_REQ_ENTITY_INCOMPLETE;
           }
 
-          // re-alloc new buffer
-          blockData->blockBufferSize = oldSize+length;
-          blockData->blockBuffer = (uint8_t *) lwm2m_malloc(blockData->blockBufferSize);
-          if (NULL == blockData->blockBuffer) return COAP_500_INTERNAL_SERVER_ERROR; //TODO: should we clean up
-          memcpy(blockData->blockBuffer, oldBuffer, oldSize);
-          lwm2m_free(oldBuffer);
+          result = prv_block_reserve(pBlockDataHead, blockData, blockData->blockBufferSize + length, maxSize);
+          if (result != NO_ERROR)
+          {
+              prv_block_data_delete(pBlockDataHead, identifier, blockType);
+              return result;
+          }
 
           // write new block in buffer
-          memcpy(blockData->blockBuffer + oldSize, buffer, length);
+          memcpy(blockData->blockBuffer + blockData->blockBufferSize, buffer, length);
+          blockData->blockBufferSize += length;
           blockData->blockNum = blockNum;
        }
     }
@@ -286,6 +398,7 @@ uint8_t prv_coap_block_handler(lwm2m_block_data_t ** pBlockDataHead,
     {
         // buffer is full, set output parameter
         // we don't free it to be able to send retransmission
+        blockData->complete = true;
         *outputLength = blockData->blockBufferSize;
         *outputBuffer = blockData->blockBuffer;
 
@@ -300,6 +413,15 @@ lwm2m_block_data_t * block1_create(lwm2m_block_data_t ** pBlockDataHead, char *u
     return prv_block_insert(pBlockDataHead, identifier, BLOCK_1);
 }
 
+lwm2m_block_data_t * block1_find(lwm2m_block_data_t * blockDataHead,
+                                 const char * uri)
+{
+    block_data_identifier_t identifier;
+    identifier.uri = (char *) uri;
+
+    return find_block_data(blockDataHead, identifier, BLOCK_1);
+}
+
 void block1_delete(lwm2m_block_data_t ** pBlockDataHead,
                    char * uri)
 {
@@ -320,18 +442,83 @@ uint8_t coap_block1_handler (lwm2m_block_data_t ** pBlockDataHead,
                             uint16_t blockSize,
                             uint32_t blockNum,
                             bool blockMore,
+                            uint32_t totalSize,
+                            size_t maxSize,
                             uint8_t ** outputBuffer,
                             size_t * outputLength)
 {
     block_data_identifier_t identifier;
     identifier.uri = (char *) uri;
 #ifdef LWM2M_RAW_BLOCK1_REQUESTS
+    // nothing is buffered
+    (void)totalSize;
+    (void)maxSize;
     return prv_coap_raw_block_handler(pBlockDataHead, identifier, mid, BLOCK_1, buffer, length, blockSize, blockNum, blockMore);
 #else
-    return prv_coap_block_handler(pBlockDataHead, identifier, BLOCK_1, buffer, length, blockSize, blockNum, blockMore, outputBuffer, outputLength);
+    return prv_coap_block_handler(pBlockDataHead, identifier, BLOCK_1, buffer, length, blockSize, blockNum, blockMore, totalSize, maxSize, outputBuffer, outputLength);
 #endif
 }
 
+#ifndef LWM2M_RAW_BLOCK1_REQUESTS
+/*
+ * Tracks a block1 transfer whose blocks are handed over as they arrive instead
+ * of being buffered. Only the number of bytes received is kept.
+ */
+uint8_t coap_block1_stream_handler(lwm2m_block_data_t ** pBlockDataHead,
+                                   const char * uri,
+                                   size_t length,
+                                   uint16_t blockSize,
+                                   uint32_t blockNum,
+                                   bool blockMore,
+                                   lwm2m_block_data_t ** blockDataP)
+{
+    block_data_identifier_t identifier;
+    lwm2m_block_data_t * blockData;
+
+    identifier.uri = (char *) uri;
+    blockData = find_block_data(*pBlockDataHead, identifier, BLOCK_1);
+
+    if (blockNum == 0)
+    {
+        if (blockData == NULL)
+        {
+            blockData = prv_block_insert(pBlockDataHead, identifier, BLOCK_1);
+            if (blockData == NULL) return COAP_500_INTERNAL_SERVER_ERROR;
+        }
+        else
+        {
+            // a new transfer replaces the previous one
+            lwm2m_free(blockData->blockBuffer);
+            blockData->blockBuffer = NULL;
+            blockData->blockBufferSize = 0;
+            blockData->blockBufferCapacity = 0;
+        }
+    }
+    else
+    {
+        if (blockData == NULL) return COAP_408_REQ_ENTITY_INCOMPLETE;
+
+        if (blockNum <= blockData->blockNum) return COAP_RETRANSMISSION;
+
+        if (blockNum != blockData->blockNum + 1
+         || blockData->complete
+         || blockData->blockBufferSize != (size_t)blockSize * blockNum)
+        {
+            prv_block_data_delete(pBlockDataHead, identifier, BLOCK_1);
+            return COAP_408_REQ_ENTITY_INCOMPLETE;
+        }
+    }
+
+    blockData->blockBufferSize += length;
+    blockData->blockNum = blockNum;
+    blockData->complete = !blockMore;
+    blockData->streamed = true;
+    *blockDataP = blockData;
+
+    return NO_ERROR;
+}
+#endif
+
 lwm2m_block_data_t * block2_create(lwm2m_block_data_t ** pBlockDataHead, uint16_t mid)
 {
     block_data_identifier_t identifier;
@@ -367,24 +554,106 @@ uint8_t coap_block2_handler(lwm2m_block_data_t ** pBlockDataHead,
                             uint16_t blockSize,
                             uint32_t blockNum,
                             bool blockMore,
+                            uint32_t totalSize,
+                            size_t maxSize,
                             uint8_t ** outputBuffer,
                             size_t * outputLength)
 {
     block_data_identifier_t identifier;
     identifier.mid = mid;
 
-    return prv_coap_block_handler(pBlockDataHead, identifier, BLOCK_2, buffer, length, blockSize, blockNum, blockMore, outputBuffer, outputLength);
+    return prv_coap_block_handler(pBlockDataHead, identifier, BLOCK_2, buffer, length, blockSize, blockNum, blockMore, totalSize, maxSize, outputBuffer, outputLength);
+}
+
+#ifdef LWM2M_CLIENT_MODE
+/*
+ * A server reading a representation larger than a block gets it block by
+ * block, each block in its own request. The serialized representation is kept
+ * between these requests instead of being read and serialized again for each
+ * block. A server has at most one cached representation, found by its URI and
+ * the Accept option of the request. It expires when no block was requested
+ * for some time and is dropped when the next read of the server finds it
+ * expired or when its last block is sent.
+ */
+static lwm2m_block_data_t * prv_block2_cache_get(lwm2m_block_data_t * blockDataHead)
+{
+    while (blockDataHead != NULL && blockDataHead->blockType != BLOCK_2_CACHE)
+    {
+        blockDataHead = blockDataHead->next;
+    }
+
+    return blockDataHead;
+}
+
+lwm2m_block_data_t * block2_cache_find(lwm2m_block_data_t ** pBlockDataHead,
+                                       const char * uri,
+                                       uint16_t accept,
+                                       time_t currentTime)
+{
+    lwm2m_block_data_t * blockData = prv_block2_cache_get(*pBlockDataHead);
+
+    if (blockData == NULL) return NULL;
+
+    if (blockData->expiry <= currentTime)
+    {
+        prv_block_data_remove(pBlockDataHead, blockData);
+        return NULL;
+    }
+    if (blockData->accept != accept || strcmp(blockData->identifier.uri, uri) != 0) return NULL;
+
+    blockData->expiry = currentTime + LWM2M_BLOCK2_CACHE_LIFETIME;
+    return blockData;
+}
+
+lwm2m_block_data_t * block2_cache_store(lwm2m_block_data_t ** pBlockDataHead,
+                                        const char * uri,
+                                        uint16_t accept,
+                                        uint16_t format,
+                                        uint8_t * buffer,
+                                        size_t length,
+                                        uint32_t etag,
+                                        time_t currentTime)
+{
+    block_data_identifier_t identifier;
+    lwm2m_block_data_t * blockData;
+
+    block2_cache_delete(pBlockDataHead);
+
+    identifier.uri = (char *) uri;
+    blockData = prv_block_insert(pBlockDataHead, identifier, BLOCK_2_CACHE);
+    if (blockData == NULL) return NULL;
+    if (blockData->identifier.uri == NULL)
+    {
+        prv_block_data_remove(pBlockDataHead, blockData);
+        return NULL;
+    }
+
+    blockData->blockBuffer = buffer;
+    blockData->blockBufferSize = length;
+    blockData->blockBufferCapacity = length;
+    blockData->complete = true;
+    blockData->expiry = currentTime + LWM2M_BLOCK2_CACHE_LIFETIME;
+    blockData->etag = etag;
+    blockData->accept = accept;
+    blockData->format = format;
+
+    return blockData;
 }
 
+void block2_cache_delete(lwm2m_block_data_t ** pBlockDataHead)
+{
+    lwm2m_block_data_t * blockData = prv_block2_cache_get(*pBlockDataHead);
+
+    if (blockData != NULL) prv_block_data_remove(pBlockDataHead, blockData);
+}
+#endif
 
 void free_block_data(lwm2m_block_data_t * blockData)
 {
     if (blockData != NULL)
     {
-#ifndef LWM2M_RAW_BLOCK1_REQUESTS
         lwm2m_free(blockData->blockBuffer);
-#endif
-        if (blockData->blockType == BLOCK_1)
+        if (blockData->blockType == BLOCK_1 || blockData->blockType == BLOCK_2_CACHE)
         {
             lwm2m_free(blockData->identifier.uri);
         }
@@ -65,9 +65,6 @@
 /*- Variables -----------------------------------------------------------------------*/
 /*-----------------------------------------------------------------------------------*/
 static uint16_t current_mid = 0;
-
-coap_status_t coap_error_code = NO_ERROR;
-const char *coap_error_message = "";
 /*-----------------------------------------------------------------------------------*/
 /*- LOCAL HELP FUNCTIONS ------------------------------------------------------------*/
 /*-----------------------------------------------------------------------------------*/
@@ -262,6 +259,7 @@ coap_add_multi_option(multi_option_t **dst, uint8_t *option, size_t option_len,
   if (opt)
   {
     opt->next = NULL;
+    opt->is_pooled = 0;
     opt->len = (uint8_t)option_len;
     if (is_static)
     {
@@ -296,10 +294,36 @@ coap_add_multi_option(multi_option_t **dst, uint8_t *option, size_t option_len,
   }
 }
 
+/* parsed options are not copied and, as long as the pool of the packet lasts, not allocated */
+static void
+coap_parse_multi_option(coap_packet_t *coap_pkt, multi_option_t **dst, uint8_t *option, size_t option_len)
+{
+  multi_option_t *opt;
+
+  if (coap_pkt->option_pool_used >= COAP_MAX_PARSED_OPTIONS)
+  {
+    coap_add_multi_option(dst, option, option_len, 1);
+    return;
+  }
+
+  opt = &coap_pkt->option_pool[coap_pkt->option_pool_used++];
+  opt->next = NULL;
+  opt->is_static = 1;
+  opt->is_pooled = 1;
+  opt->len = (uint8_t)option_len;
+  opt->data = option;
+
+  while (*dst)
+  {
+    dst = &(*dst)->next;
+  }
+  *dst = opt;
+}
+
 void
 free_multi_option(multi_option_t *dst)
 {
-  if (dst)
+  while (dst)
   {
     multi_option_t *n = dst->next;
     dst->next = NULL;
@@ -307,8 +331,11 @@ free_multi_option(multi_option_t *dst)
     {
         lwm2m_free(dst->data);
     }
-    lwm2m_free(dst);
-    free_multi_option(n);
+    if (dst->is_pooled == 0)
+    {
+        lwm2m_free(dst);
+    }
+    dst = n;
   }
 }
 
@@ -403,7 +430,10 @@ char * coap_get_packet_uri_as_string(coap_packet_t * packet)
     }
     
     strcpy(output, "//");
-    strncat(output, (char *)packet->uri_host, packet->uri_host_len);
+    if (packet->uri_host_len)
+    {
+        strncat(output, (char *)packet->uri_host, packet->uri_host_len);
+    }
     if (1 > path_len)
     {
         strcat(output, "/");
@@ -494,6 +524,7 @@ coap_free_header(void *packet)
     coap_pkt->uri_path = NULL;
     coap_pkt->uri_query = NULL;
     coap_pkt->location_path = NULL;
+    coap_pkt->option_pool_used = 0;
 }
 
 /*-----------------------------------------------------------------------------------*/
@@ -595,6 +626,11 @@ size_t coap_serialize_get_size(void *packet)
     {
         length += COAP_MAX_OPTION_HEADER_LEN + coap_pkt->proxy_uri_len;
     }
+    if (IS_OPTION(coap_pkt, COAP_OPTION_SIZE1))
+    {
+        // can be stored in extended fields
+        length += COAP_MAX_OPTION_HEADER_LEN;
+    }
 
     if (coap_pkt->payload_len)
     {
@@ -662,6 +698,7 @@ coap_serialize_message(void *packet, uint8_t *buffer)
   COAP_SERIALIZE_BLOCK_OPTION(  COAP_OPTION_BLOCK1,         block1, "Block1")
   COAP_SERIALIZE_INT_OPTION(    COAP_OPTION_SIZE,           size, "Size")
   COAP_SERIALIZE_STRING_OPTION( COAP_OPTION_PROXY_URI,      proxy_uri, '\0', "Proxy-Uri")
+  COAP_SERIALIZE_INT_OPTION(    COAP_OPTION_SIZE1,          size1, "Size1")
 
   PRINTF("-Done serializing at %p----\n", option);
 
@@ -674,10 +711,9 @@ coap_serialize_message(void *packet, uint8_t *buffer)
   {
     *option = 0xFF;
     ++option;
+    memmove(option, coap_pkt->payload, coap_pkt->payload_len);
   }
 
-  memmove(option, coap_pkt->payload, coap_pkt->payload_len);
-
   PRINTF("-Done %u B (header len %u, payload len %u)-\n", coap_pkt->payload_len + option - buffer, option - buffer, coap_pkt->payload_len);
 
   PRINTF("Dump [0x%02X %02X %02X %02X  %02X %02X %02X %02X]\n",
@@ -719,7 +755,7 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
 
   if (coap_pkt->version != 1)
   {
-    coap_error_message = "CoAP version must be 1";
+    coap_pkt->error_message = "CoAP version must be 1";
     return BAD_REQUEST_4_00;
   }
 
@@ -859,18 +895,18 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
       case COAP_OPTION_URI_PATH:
         /* coap_merge_multi_option() operates in-place on the IPBUF, but final packet field should be const string -> cast to string */
         // coap_merge_multi_option( (char **) &(coap_pkt->uri_path), &(coap_pkt->uri_path_len), current_option, option_length, 0);
-        coap_add_multi_option( &(coap_pkt->uri_path), current_option, option_length, 1);
+        coap_parse_multi_option(coap_pkt, &(coap_pkt->uri_path), current_option, option_length);
         PRINTF("Uri-Path [%.*s]\n", option_length, current_option);
         break;
       case COAP_OPTION_URI_QUERY:
         /* coap_merge_multi_option() operates in-place on the IPBUF, but final packet field should be const string -> cast to string */
         // coap_merge_multi_option( (char **) &(coap_pkt->uri_query), &(coap_pkt->uri_query_len), current_option, option_length, '&');
-        coap_add_multi_option( &(coap_pkt->uri_query), current_option, option_length, 1);
+        coap_parse_multi_option(coap_pkt, &(coap_pkt->uri_query), current_option, option_length);
         PRINTF("Uri-Query [%.*s]\n", option_length, current_option);
         break;
 
       case COAP_OPTION_LOCATION_PATH:
-        coap_add_multi_option( &(coap_pkt->location_path), current_option, option_length, 1);
+        coap_parse_multi_option(coap_pkt, &(coap_pkt->location_path), current_option, option_length);
         break;
       case COAP_OPTION_LOCATION_QUERY:
         /* coap_merge_multi_option() operates in-place on the IPBUF, but final packet field should be const string -> cast to string */
@@ -884,7 +920,7 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
         coap_pkt->proxy_uri_len = option_length;
         /*TODO length > 270 not implemented (actually not required) */
         PRINTF("Proxy-Uri NOT IMPLEMENTED [%.*s]\n", coap_pkt->proxy_uri_len, coap_pkt->proxy_uri);
-        coap_error_message = "This is a constrained server (Contiki)";
+        coap_pkt->error_message = "This is a constrained server (Contiki)";
         return PROXYING_NOT_SUPPORTED_5_05;
 
       case COAP_OPTION_OBSERVE:
@@ -911,12 +947,16 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
         coap_pkt->size = coap_parse_int_option(current_option, option_length);
         PRINTF("Size [%lu]\n", coap_pkt->size);
         break;
+      case COAP_OPTION_SIZE1:
+        coap_pkt->size1 = coap_parse_int_option(current_option, option_length);
+        PRINTF("Size1 [%lu]\n", coap_pkt->size1);
+        break;
       default:
         PRINTF("unknown (%u)\n", option_number);
         /* Check if critical (odd) */
         if (option_number & 1)
         {
-          coap_error_message = "Unsupported critical option";
+          coap_pkt->error_message = "Unsupported critical option";
           coap_free_header(coap_pkt);
           return BAD_OPTION_4_02;
         }
@@ -1496,6 +1536,27 @@ coap_set_header_size(void *packet, uint32_t size)
   SET_OPTION(coap_pkt, COAP_OPTION_SIZE);
   return 1;
 }
+
+int
+coap_get_header_size1(void *packet, uint32_t *size)
+{
+  coap_packet_t *const coap_pkt = (coap_packet_t *) packet;
+
+  if (!IS_OPTION(coap_pkt, COAP_OPTION_SIZE1)) return 0;
+
+  *size = coap_pkt->size1;
+  return 1;
+}
+
+int
+coap_set_header_size1(void *packet, uint32_t size)
+{
+  coap_packet_t *const coap_pkt = (coap_packet_t *) packet;
+
+  coap_pkt->size1 = size;
+  SET_OPTION(coap_pkt, COAP_OPTION_SIZE1);
+  return 1;
+}
 /*-----------------------------------------------------------------------------------*/
 /*- PAYLOAD -------------------------------------------------------------------------*/
 /*-----------------------------------------------------------------------------------*/
@@ -1519,7 +1580,7 @@ coap_set_payload(void *packet, const void *payload, size_t length)
   coap_packet_t *const coap_pkt = (coap_packet_t *) packet;
 
   coap_pkt->payload = (uint8_t *) payload;
-  coap_pkt->payload_len = (uint16_t)(length);
+  coap_pkt->payload_len = (uint32_t)(length);
 
   return coap_pkt->payload_len;
 }
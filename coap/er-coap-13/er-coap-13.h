@@ -61,6 +61,9 @@
 #define COAP_ETAG_LEN                        8 /* The maximum number of bytes for the ETag */
 #define COAP_TOKEN_LEN                       8 /* The maximum number of bytes for the Token */
 #define COAP_MAX_ACCEPT_NUM                  2 /* The maximum number of accept preferences to parse/store */
+#ifndef COAP_MAX_PARSED_OPTIONS
+#define COAP_MAX_PARSED_OPTIONS              8 /* The number of Uri-Path, Uri-Query and Location-Path options parsed without allocation */
+#endif
 
 #define COAP_MAX_OPTION_HEADER_LEN           5
 
@@ -158,8 +161,9 @@ typedef enum {
   COAP_OPTION_LOCATION_QUERY = 20, /* 1-270 B */
   COAP_OPTION_BLOCK2 = 23,        /* 1-3 B */
   COAP_OPTION_BLOCK1 = 27,        /* 1-3 B */
-  COAP_OPTION_SIZE = 28,          /* 0-4 B */
+  COAP_OPTION_SIZE = 28,          /* 0-4 B */ /* Size2 in RFC 7959 */
   COAP_OPTION_PROXY_URI = 35,     /* 1-270 B */
+  COAP_OPTION_SIZE1 = 60,         /* 0-4 B */
   OPTION_MAX_VALUE = 0xFFFF
 } coap_option_t;
 
@@ -193,6 +197,7 @@ typedef enum {
 typedef struct _multi_option_t {
   struct _multi_option_t *next;
   uint8_t is_static;
+  uint8_t is_pooled; /* the node belongs to the option_pool of a parsed packet */
   uint8_t len;
   uint8_t *data;
 } multi_option_t;
@@ -206,7 +211,7 @@ typedef struct {
   uint8_t code;
   uint16_t mid;
 
-  uint8_t options[COAP_OPTION_PROXY_URI / OPTION_MAP_SIZE + 1]; /* Bitmap to check if option is set */
+  uint8_t options[COAP_OPTION_SIZE1 / OPTION_MAP_SIZE + 1]; /* Bitmap to check if option is set */
 
   coap_content_type_t content_type; /* Parse options once and store; allows setting options in random order  */
   uint32_t max_age;
@@ -237,12 +242,17 @@ typedef struct {
   uint16_t block1_size;
   uint32_t block1_offset;
   uint32_t size;
+  uint32_t size1;
   multi_option_t *uri_query;
   uint8_t if_none_match;
 
-  uint16_t payload_len;
+  uint32_t payload_len;
   uint8_t *payload;
 
+  const char *error_message; /* human-readable payload of the error returned by coap_parse_message() */
+
+  uint8_t option_pool_used;
+  multi_option_t option_pool[COAP_MAX_PARSED_OPTIONS]; /* list nodes of the parsed options, their data stays in the datagram */
 } coap_packet_t;
 
 /* Option format serialization*/
@@ -301,9 +311,6 @@ typedef struct {
       current_number = number; \
     }
 
-/* To store error code and human-readable payload */
-extern const char *coap_error_message;
-
 uint16_t coap_get_mid(void);
 
 void coap_init_message(void *packet, coap_message_type_t type, uint8_t code, uint16_t mid);
@@ -383,6 +390,9 @@ int coap_get_header_block(void *packet, uint32_t *num, uint8_t *more, uint16_t *
 int coap_get_header_size(void *packet, uint32_t *size);
 int coap_set_header_size(void *packet, uint32_t size);
 
+int coap_get_header_size1(void *packet, uint32_t *size);
+int coap_set_header_size1(void *packet, uint32_t size);
+
 int coap_get_payload(void *packet, const uint8_t **payload);
 int coap_set_payload(void *packet, const void *payload, size_t length);
 
@@ -109,11 +109,131 @@ Contains code snippets which are:
 
 
 /*
- * Modulo mask (+1 and +0.5 for rounding) for a random number to get the tick number for the random
- * retransmission time between COAP_RESPONSE_TIMEOUT and COAP_RESPONSE_TIMEOUT*COAP_RESPONSE_RANDOM_FACTOR.
+ * The initial retransmission timeout is a random duration between COAP_RESPONSE_TIMEOUT and
+ * COAP_RESPONSE_TIMEOUT * COAP_ACK_RANDOM_FACTOR (RFC 7252 section 4.2) so that transactions
+ * started together do not retransmit in lockstep.
  */
-#define COAP_RESPONSE_TIMEOUT_TICKS         (CLOCK_SECOND * COAP_RESPONSE_TIMEOUT)
-#define COAP_RESPONSE_TIMEOUT_BACKOFF_MASK  ((CLOCK_SECOND * COAP_RESPONSE_TIMEOUT * (COAP_RESPONSE_RANDOM_FACTOR - 1)) + 1.5)
+#define COAP_RESPONSE_TIMEOUT_MS            (COAP_RESPONSE_TIMEOUT * 1000)
+#define COAP_RESPONSE_TIMEOUT_RANDOM_MS     ((uint32_t)(COAP_RESPONSE_TIMEOUT_MS * (COAP_ACK_RANDOM_FACTOR - 1)))
+
+typedef struct
+{
+    void * sessionH;
+    uint16_t mID;
+    bool pendingOnly;
+} transaction_mid_key_t;
+
+typedef struct
+{
+    void * sessionH;
+    uint8_t * token;
+    uint8_t tokenLen;
+} transaction_token_key_t;
+
+/*
+ * Only requests carrying a token can be finished by a separate response,
+ * they are the only ones indexed by token.
+ */
+static bool prv_hasToken(lwm2m_transaction_t * transacP)
+{
+    coap_packet_t * transactionMessage = (coap_packet_t *) transacP->message;
+
+    return COAP_DELETE >= transactionMessage->code
+        && IS_OPTION(transactionMessage, COAP_OPTION_TOKEN);
+}
+
+static uint32_t prv_hashMid(uint16_t mID)
+{
+    // message IDs are allocated per context, the peer is checked on match
+    return index_hashInteger(mID);
+}
+
+static uint32_t prv_hashToken(const uint8_t * token,
+                              size_t tokenLen)
+{
+    return index_hashBytes(token, tokenLen);
+}
+
+static bool prv_matchMid(const void * item,
+                         const void * key,
+                         void * userData)
+{
+    const lwm2m_transaction_t * transacP = (const lwm2m_transaction_t *)item;
+    const transaction_mid_key_t * keyP = (const transaction_mid_key_t *)key;
+
+    return transacP->mID == keyP->mID
+        && (!keyP->pendingOnly || !transacP->ack_received)
+        && lwm2m_session_is_equal(keyP->sessionH, transacP->peerH, userData);
+}
+
+static bool prv_matchToken(const void * item,
+                           const void * key,
+                           void * userData)
+{
+    const lwm2m_transaction_t * transacP = (const lwm2m_transaction_t *)item;
+    const transaction_token_key_t * keyP = (const transaction_token_key_t *)key;
+    const coap_packet_t * transactionMessage = (const coap_packet_t *) transacP->message;
+
+    return transactionMessage->token_len == keyP->tokenLen
+        && memcmp(transactionMessage->token, keyP->token, keyP->tokenLen) == 0
+        && lwm2m_session_is_equal(keyP->sessionH, transacP->peerH, userData);
+}
+
+static lwm2m_transaction_t * prv_findByMid(lwm2m_context_t * contextP,
+                                           void * sessionH,
+                                           uint16_t mID,
+                                           bool pendingOnly)
+{
+    transaction_mid_key_t key;
+    lwm2m_transaction_t * transacP;
+
+    key.sessionH = sessionH;
+    key.mID = mID;
+    key.pendingOnly = pendingOnly;
+
+    transacP = (lwm2m_transaction_t *)index_find(&contextP->transactionMidIndex, prv_hashMid(mID), prv_matchMid, &key, contextP->userData);
+    if (transacP == NULL && contextP->transactionUnindexed != 0)
+    {
+        for (transacP = contextP->transactionList ; transacP != NULL ; transacP = transacP->next)
+        {
+            if (prv_matchMid(transacP, &key, contextP->userData)) break;
+        }
+    }
+
+    return transacP;
+}
+
+static lwm2m_transaction_t * prv_findByToken(lwm2m_context_t * contextP,
+                                             void * sessionH,
+                                             coap_packet_t * message)
+{
+    transaction_token_key_t key;
+    lwm2m_transaction_t * transacP;
+
+    key.sessionH = sessionH;
+    key.tokenLen = (uint8_t)coap_get_header_token(message, &key.token);
+
+    transacP = (lwm2m_transaction_t *)index_find(&contextP->transactionTokenIndex, prv_hashToken(key.token, key.tokenLen), prv_matchToken, &key, contextP->userData);
+    if (transacP == NULL && contextP->transactionUnindexed != 0)
+    {
+        for (transacP = contextP->transactionList ; transacP != NULL ; transacP = transacP->next)
+        {
+            if (prv_hasToken(transacP) && prv_matchToken(transacP, &key, contextP->userData)) break;
+        }
+    }
+
+    return transacP;
+}
+
+static void prv_retransmit(lwm2m_context_t * contextP,
+                           void * userData,
+                           time_t currentTime)
+{
+    (void)currentTime;
+
+    // this also expires the transaction once all retransmissions are done
+    (void)transaction_send(contextP, (lwm2m_transaction_t *)userData);
+}
 
 static int prv_checkFinished(lwm2m_transaction_t * transacP,
                              coap_packet_t * receivedMessage)
@@ -174,6 +294,9 @@ lwm2m_transaction_t * transaction_new(void * sessionH,
 
     transacP->mID = mID;
 
+    transacP->timer.callback = prv_retransmit;
+    transacP->timer.userData = transacP;
+
     if (altPath != NULL)
     {
         // TODO: Support multi-segment alternative path
@@ -262,11 +385,95 @@ void transaction_free(lwm2m_transaction_t * transacP)
     lwm2m_free(transacP);
 }
 
+void transaction_add(lwm2m_context_t * contextP,
+                     lwm2m_transaction_t * transacP)
+{
+#ifdef LWM2M_CLIENT_MODE
+    lwm2m_server_t * serverP;
+#endif
+
+    LOG_ARG("Entering. transaction=%p", transacP);
+
+    transacP->prev = NULL;
+    transacP->next = contextP->transactionList;
+    if (transacP->next != NULL) transacP->next->prev = transacP;
+    contextP->transactionList = transacP;
+
+#ifdef LWM2M_CLIENT_MODE
+    // the queue mode tells from this count if the server still exchanges with the client
+    serverP = utils_findServer(contextP, transacP->peerH);
+    if (serverP != NULL) serverP->transactionCount++;
+#endif
+
+    if (!index_add(&contextP->transactionMidIndex, prv_hashMid(transacP->mID), transacP))
+    {
+        LOG("Failed to index transaction");
+        contextP->transactionUnindexed++;
+    }
+    else if (prv_hasToken(transacP))
+    {
+        coap_packet_t * transactionMessage = (coap_packet_t *) transacP->message;
+
+        if (!index_add(&contextP->transactionTokenIndex, prv_hashToken(transactionMessage->token, transactionMessage->token_len), transacP))
+        {
+            // keep the transaction either fully indexed or not at all
+            LOG("Failed to index transaction");
+            index_remove(&contextP->transactionMidIndex, prv_hashMid(transacP->mID), transacP);
+            contextP->transactionUnindexed++;
+        }
+    }
+
+    // a transaction not sent yet is due immediately
+    scheduler_addMs(contextP, &transacP->timer, transacP->retrans_time);
+}
+
+lwm2m_transaction_t * transaction_find(lwm2m_context_t * contextP,
+                                       void * sessionH,
+                                       uint16_t mID)
+{
+    return prv_findByMid(contextP, sessionH, mID, false);
+}
+
 void transaction_remove(lwm2m_context_t * contextP,
                         lwm2m_transaction_t * transacP)
 {
     LOG_ARG("Entering. transaction=%p", transacP);
-    contextP->transactionList = (lwm2m_transaction_t *) LWM2M_LIST_RM(contextP->transactionList, transacP->mID, NULL);
+
+    scheduler_remove(contextP, &transacP->timer);
+
+    if (index_remove(&contextP->transactionMidIndex, prv_hashMid(transacP->mID), transacP))
+    {
+        if (prv_hasToken(transacP))
+        {
+            coap_packet_t * transactionMessage = (coap_packet_t *) transacP->message;
+
+            index_remove(&contextP->transactionTokenIndex, prv_hashToken(transactionMessage->token, transactionMessage->token_len), transacP);
+        }
+    }
+    else if (contextP->transactionUnindexed != 0)
+    {
+        contextP->transactionUnindexed--;
+    }
+
+#ifdef LWM2M_CLIENT_MODE
+    if (transacP->prev != NULL || contextP->transactionList == transacP)
+    {
+        lwm2m_server_t * serverP = utils_findServer(contextP, transacP->peerH);
+
+        if (serverP != NULL && serverP->transactionCount != 0) serverP->transactionCount--;
+    }
+#endif
+
+    if (transacP->prev != NULL)
+    {
+        transacP->prev->next = transacP->next;
+    }
+    else if (contextP->transactionList == transacP)
+    {
+        contextP->transactionList = transacP->next;
+    }
+    if (transacP->next != NULL) transacP->next->prev = transacP->prev;
+
     transaction_free(transacP);
 }
 
@@ -275,80 +482,73 @@ bool transaction_handleResponse(lwm2m_context_t * contextP,
                                  coap_packet_t * message,
                                  coap_packet_t * response)
 {
-    bool found = false;
     bool reset = false;
-    lwm2m_transaction_t * transacP;
+    lwm2m_transaction_t * transacP = NULL;
 
     LOG("Entering");
-    transacP = contextP->transactionList;
 
-    while (NULL != transacP)
+    if ((COAP_TYPE_ACK == message->type) || (COAP_TYPE_RST == message->type))
     {
-        if (lwm2m_session_is_equal(fromSessionH, transacP->peerH, contextP->userData) == true)
+        transacP = prv_findByMid(contextP, fromSessionH, message->mid, true);
+        if (transacP != NULL)
         {
-            if (!transacP->ack_received)
-            {
-                if ((COAP_TYPE_ACK == message->type) || (COAP_TYPE_RST == message->type))
-                {
-                    if (transacP->mID == message->mid)
-                    {
-                        found = true;
-                        transacP->ack_received = true;
-                        reset = COAP_TYPE_RST == message->type;
-                    }
-                }
-            }
+            transacP->ack_received = true;
+            reset = COAP_TYPE_RST == message->type;
+        }
+    }
+    if (transacP == NULL)
+    {
+        // a separate response finishes the request carrying the same token
+        transacP = prv_findByToken(contextP, fromSessionH, message);
+        if (transacP == NULL) return false;
+    }
 
-            if (reset || prv_checkFinished(transacP, message))
+    if (reset || prv_checkFinished(transacP, message))
+    {
+        // HACK: If a message is sent from the monitor callback,
+        // it will arrive before the registration ACK.
+        // So we resend transaction that were denied for authentication reason.
+        if (!reset)
+        {
+            if (COAP_TYPE_CON == message->type && NULL != response)
             {
-                // HACK: If a message is sent from the monitor callback,
-                // it will arrive before the registration ACK.
-                // So we resend transaction that were denied for authentication reason.
-                if (!reset)
-                {
-                    if (COAP_TYPE_CON == message->type && NULL != response)
-                    {
-                        coap_init_message(response, COAP_TYPE_ACK, 0, message->mid);
-                        message_send(contextP, response, fromSessionH);
-                    }
-
-                    if ((COAP_401_UNAUTHORIZED == message->code) && (COAP_MAX_RETRANSMIT > transacP->retrans_counter))
-                    {
-                        transacP->ack_received = false;
-                        transacP->retrans_time += COAP_RESPONSE_TIMEOUT;
-                        return true;
-                    }
-                }
-                if (transacP->callback != NULL)
-                {
-                    transacP->callback(contextP, transacP, message);
-                }
-                transaction_remove(contextP, transacP);
-                return true;
+                coap_init_message(response, COAP_TYPE_ACK, 0, message->mid);
+                message_send(contextP, response, fromSessionH);
             }
-            // if we found our guy, exit
-            if (found)
+
+            if ((COAP_401_UNAUTHORIZED == message->code) && (COAP_MAX_RETRANSMIT > transacP->retrans_counter))
             {
-                time_t tv_sec = lwm2m_gettime();
-                if (0 <= tv_sec)
-                {
-                    transacP->retrans_time = tv_sec;
-                }
-                if (transacP->response_timeout)
-                {
-                    transacP->retrans_time += transacP->response_timeout;
-                }
-                else
-                {
-                    transacP->retrans_time += COAP_RESPONSE_TIMEOUT * transacP->retrans_counter;
-                }
+                transacP->ack_received = false;
+                transacP->retrans_time += COAP_RESPONSE_TIMEOUT_MS;
+                scheduler_addMs(contextP, &transacP->timer, transacP->retrans_time);
                 return true;
             }
         }
-
-        transacP = transacP->next;
+        if (transacP->callback != NULL)
+        {
+            transacP->callback(contextP, transacP, message);
+        }
+        transaction_remove(contextP, transacP);
+    }
+    else
+    {
+        // empty ACK, wait for the separate response
+        int64_t tv_msec = scheduler_getTimeMs();
+        if (0 <= tv_msec)
+        {
+            transacP->retrans_time = tv_msec;
+        }
+        if (transacP->response_timeout)
+        {
+            transacP->retrans_time += (int64_t)transacP->response_timeout * 1000;
+        }
+        else
+        {
+            transacP->retrans_time += (int64_t)COAP_RESPONSE_TIMEOUT_MS * transacP->retrans_counter;
+        }
+        scheduler_addMs(contextP, &transacP->timer, transacP->retrans_time);
     }
-    return false;
+    return true;
 }
 
 int transaction_send(lwm2m_context_t * contextP,
@@ -386,14 +586,15 @@ int transaction_send(lwm2m_context_t * contextP,
 
     if (!transacP->ack_received)
     {
-        long unsigned timeout = 0;
+        int64_t timeout = 0;
 
         if (0 == transacP->retrans_counter)
         {
-            time_t tv_sec = lwm2m_gettime();
-            if (0 <= tv_sec)
+            int64_t tv_msec = scheduler_getTimeMs();
+            if (0 <= tv_msec)
             {
-                transacP->retrans_time = tv_sec + COAP_RESPONSE_TIMEOUT;
+                transacP->ack_timeout = COAP_RESPONSE_TIMEOUT_MS + (uint32_t)rand() % (COAP_RESPONSE_TIMEOUT_RANDOM_MS + 1);
+                transacP->retrans_time = tv_msec + transacP->ack_timeout;
                 transacP->retrans_counter = 1;
             }
             else
@@ -403,7 +604,8 @@ int transaction_send(lwm2m_context_t * contextP,
         }
         else
         {
-            timeout = COAP_RESPONSE_TIMEOUT << (transacP->retrans_counter - 1);
+            // the timeout doubles at each retransmission
+            timeout = (int64_t)transacP->ack_timeout << (transacP->retrans_counter - 1);
         }
 
         if (COAP_MAX_RETRANSMIT + 1 >= transacP->retrans_counter)
@@ -427,6 +629,7 @@ int transaction_send(lwm2m_context_t * contextP,
         goto error;
     }
 
+    scheduler_addMs(contextP, &transacP->timer, transacP->retrans_time);
     return 0;
 error:
     if (transacP->callback)
@@ -438,59 +641,14 @@ error:
     return -1;
 }
 
-void transaction_step(lwm2m_context_t * contextP,
-                      time_t currentTime,
-                      time_t * timeoutP)
-{
-    lwm2m_transaction_t * transacP;
-
-    LOG("Entering");
-    transacP = contextP->transactionList;
-    while (transacP != NULL)
-    {
-        // transaction_send() may remove transaction from the linked list
-        lwm2m_transaction_t * nextP = transacP->next;
-        int removed = 0;
-
-        if (transacP->retrans_time <= currentTime)
-        {
-            removed = transaction_send(contextP, transacP);
-        }
-
-        if (0 == removed)
-        {
-            time_t interval;
-
-            if (transacP->retrans_time > currentTime)
-            {
-                interval = transacP->retrans_time - currentTime;
-            }
-            else
-            {
-                interval = 1;
-            }
-
-            if (*timeoutP > interval)
-            {
-                *timeoutP = interval;
-            }
-        }
-        else
-        {
-            *timeoutP = 1;
-        }
-
-        transacP = nextP;
-    }
-}
-
-void transaction_set_payload(lwm2m_transaction_t * transaction, uint8_t * buffer, int length)
+void transaction_set_payload(lwm2m_context_t * contextP, lwm2m_transaction_t * transaction, uint8_t * buffer, int length)
 {
     transaction->payload = buffer;
     transaction->payload_len = length;
-    const uint16_t lwm2m_coap_block_size = lwm2m_get_coap_block_size();
+    const uint16_t lwm2m_coap_block_size = contextP->coapBlockSize;
     if (length > lwm2m_coap_block_size) {
         coap_set_header_block1(transaction->message, 0, true, lwm2m_coap_block_size);
+        coap_set_header_size1(transaction->message, length);
     }
 
     coap_set_payload(transaction->message, buffer, MIN(length, lwm2m_coap_block_size));
@@ -498,7 +656,7 @@ void transaction_set_payload(lwm2m_transaction_t * transaction, uint8_t * buffer
 
 bool transaction_free_userData(lwm2m_context_t * context, lwm2m_transaction_t * transaction)
 {
-    lwm2m_transaction_t * target = context->transactionList;
+    lwm2m_transaction_t * target = transaction->userDataShared ? context->transactionList : NULL;
     while (target != NULL){
         if (target->userData == transaction->userData && target != transaction) return false;
         target = target->next;
@@ -95,8 +95,7 @@ static void prv_requestBootstrap(lwm2m_context_t * context,
     query_length += res;
 
 #ifndef LWM2M_VERSION_1_0
-    // TODO Add SenML CBOR as a preferred content type when supported.
-#if defined(LWM2M_SUPPORT_SENML_JSON) || defined(LWM2M_SUPPORT_TLV)
+#if defined(LWM2M_SUPPORT_SENML_CBOR) || defined(LWM2M_SUPPORT_SENML_JSON) || defined(LWM2M_SUPPORT_TLV)
     res = utils_stringCopy(query + query_length, PRV_QUERY_BUFFER_LENGTH - query_length, QUERY_DELIMITER QUERY_PCT);
     if (res < 0)
     {
@@ -104,7 +103,9 @@ static void prv_requestBootstrap(lwm2m_context_t * context,
         return;
     }
     query_length += res;
-#if defined(LWM2M_SUPPORT_SENML_JSON)
+#if defined(LWM2M_SUPPORT_SENML_CBOR)
+    res = utils_stringCopy(query + query_length, PRV_QUERY_BUFFER_LENGTH - query_length, REG_ATTR_CONTENT_SENML_CBOR);
+#elif defined(LWM2M_SUPPORT_SENML_JSON)
     res = utils_stringCopy(query + query_length, PRV_QUERY_BUFFER_LENGTH - query_length, REG_ATTR_CONTENT_SENML_JSON);
 #elif defined(LWM2M_SUPPORT_TLV)
     res = utils_stringCopy(query + query_length, PRV_QUERY_BUFFER_LENGTH - query_length, REG_ATTR_CONTENT_TLV);
@@ -145,7 +146,7 @@ static void prv_requestBootstrap(lwm2m_context_t * context,
         coap_set_header_uri_query(transaction->message, query);
         transaction->callback = prv_handleBootstrapReply;
         transaction->userData = (void *)bootstrapServer;
-        context->transactionList = (lwm2m_transaction_t *)LWM2M_LIST_ADD(context->transactionList, transaction);
+        transaction_add(context, transaction);
         if (transaction_send(context, transaction) == 0)
         {
             LOG("CI bootstrap requested to BS server");
@@ -1083,6 +1084,14 @@ uint8_t bootstrap_handleRequest(lwm2m_context_t * contextP,
 #ifdef LWM2M_SUPPORT_SENML_JSON
         case LWM2M_CONTENT_SENML_JSON:
             break;
+#endif
+#ifdef LWM2M_SUPPORT_SENML_CBOR
+        case LWM2M_CONTENT_SENML_CBOR:
+            break;
+#endif
+#ifdef LWM2M_SUPPORT_LWM2M_CBOR
+        case LWM2M_CONTENT_LWM2M_CBOR:
+            break;
 #endif
         default:
 #ifdef LWM2M_SUPPORT_TLV
@@ -1199,7 +1208,7 @@ int lwm2m_bootstrap_delete(lwm2m_context_t * contextP,
     transaction->callback = prv_resultCallback;
     transaction->userData = (void *)dataP;
 
-    contextP->transactionList = (lwm2m_transaction_t *)LWM2M_LIST_ADD(contextP->transactionList, transaction);
+    transaction_add(contextP, transaction);
 
     return transaction_send(contextP, transaction);
 }
@@ -1227,7 +1236,7 @@ int lwm2m_bootstrap_write(lwm2m_context_t * contextP,
 
     coap_set_header_content_type(transaction->message, format);
 
-    transaction_set_payload(transaction, buffer, length);
+    transaction_set_payload(contextP, transaction, buffer, length);
 
     dataP = (bs_data_t *)lwm2m_malloc(sizeof(bs_data_t));
     if (dataP == NULL)
@@ -1242,7 +1251,7 @@ int lwm2m_bootstrap_write(lwm2m_context_t * contextP,
     transaction->callback = prv_resultCallback;
     transaction->userData = (void *)dataP;
 
-    contextP->transactionList = (lwm2m_transaction_t *)LWM2M_LIST_ADD(contextP->transactionList, transaction);
+    transaction_add(contextP, transaction);
 
     return transaction_send(contextP, transaction);
 }
@@ -1272,7 +1281,7 @@ int lwm2m_bootstrap_finish(lwm2m_context_t * contextP,
     transaction->callback = prv_resultCallback;
     transaction->userData = (void *)dataP;
 
-    contextP->transactionList = (lwm2m_transaction_t *)LWM2M_LIST_ADD(contextP->transactionList, transaction);
+    transaction_add(contextP, transaction);
 
     return transaction_send(contextP, transaction);
 }
@@ -1309,7 +1318,7 @@ int lwm2m_bootstrap_discover(lwm2m_context_t * contextP, void * sessionH, lwm2m_
     transaction->callback = prv_resultCallback;
     transaction->userData = (void *)dataP;
 
-    contextP->transactionList = (lwm2m_transaction_t *)LWM2M_LIST_ADD(contextP->transactionList, transaction);
+    transaction_add(contextP, transaction);
 
     return transaction_send(contextP, transaction);
 }
@@ -1353,7 +1362,7 @@ int lwm2m_bootstrap_read(lwm2m_context_t * contextP, void * sessionH, lwm2m_uri_
     transaction->callback = prv_resultCallback;
     transaction->userData = (void *)dataP;
 
-    contextP->transactionList = (lwm2m_transaction_t *)LWM2M_LIST_ADD(contextP->transactionList, transaction);
+    transaction_add(contextP, transaction);
 
     return transaction_send(contextP, transaction);
 }
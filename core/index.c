@@ -0,0 +1,204 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+/*
+ * Hash index
+ *
+ * An open addressing hash table (linear probing, backward shift deletion)
+ * storing pointers to items owned by the caller. The index only stores the
+ * hash of the key of an item; the caller provides a match function to
+ * compare the actual keys, so several items may share the same hash.
+ */
+
+#include "internals.h"
+
+#define PRV_INDEX_MIN_CAPACITY 16
+
+#define PRV_FNV_OFFSET_BASIS 2166136261u
+#define PRV_FNV_PRIME        16777619u
+
+uint32_t index_hashBytes(const uint8_t * data,
+                         size_t length)
+{
+    uint32_t hash = PRV_FNV_OFFSET_BASIS;
+    size_t i;
+
+    for (i = 0 ; i < length ; i++)
+    {
+        hash ^= data[i];
+        hash *= PRV_FNV_PRIME;
+    }
+
+    return hash;
+}
+
+uint32_t index_hashString(const char * str)
+{
+    uint32_t hash = PRV_FNV_OFFSET_BASIS;
+
+    while (*str != 0)
+    {
+        hash ^= (uint8_t)*str;
+        hash *= PRV_FNV_PRIME;
+        str++;
+    }
+
+    return hash;
+}
+
+uint32_t index_hashInteger(uint32_t value)
+{
+    // finalizer of MurmurHash3, spreads consecutive values over all buckets
+    value ^= value >> 16;
+    value *= 0x85ebca6bu;
+    value ^= value >> 13;
+    value *= 0xc2b2ae35u;
+    value ^= value >> 16;
+
+    return value;
+}
+
+static bool prv_resize(lwm2m_index_t * indexP,
+                       size_t capacity)
+{
+    lwm2m_index_entry_t * entries;
+    size_t i;
+
+    entries = (lwm2m_index_entry_t *)lwm2m_malloc(capacity * sizeof(lwm2m_index_entry_t));
+    if (entries == NULL) return false;
+    memset(entries, 0, capacity * sizeof(lwm2m_index_entry_t));
+
+    for (i = 0 ; i < indexP->capacity ; i++)
+    {
+        if (indexP->entries[i].item != NULL)
+        {
+            size_t slot = indexP->entries[i].hash & (capacity - 1);
+
+            while (entries[slot].item != NULL)
+            {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            entries[slot] = indexP->entries[i];
+        }
+    }
+
+    if (indexP->entries != NULL) lwm2m_free(indexP->entries);
+    indexP->entries = entries;
+    indexP->capacity = capacity;
+
+    return true;
+}
+
+bool index_add(lwm2m_index_t * indexP,
+               uint32_t hash,
+               void * item)
+{
+    size_t slot;
+
+    if (item == NULL) return false;
+
+    // keep the load factor below 3/4
+    if ((indexP->count + 1) * 4 > indexP->capacity * 3)
+    {
+        size_t capacity = indexP->capacity == 0 ? PRV_INDEX_MIN_CAPACITY : indexP->capacity * 2;
+
+        if (!prv_resize(indexP, capacity))
+        {
+            // an overloaded index is still usable as long as one slot is free
+            if (indexP->count + 1 >= indexP->capacity) return false;
+        }
+    }
+
+    slot = hash & (indexP->capacity - 1);
+    while (indexP->entries[slot].item != NULL)
+    {
+        slot = (slot + 1) & (indexP->capacity - 1);
+    }
+    indexP->entries[slot].hash = hash;
+    indexP->entries[slot].item = item;
+    indexP->count++;
+
+    return true;
+}
+
+bool index_remove(lwm2m_index_t * indexP,
+                  uint32_t hash,
+                  void * item)
+{
+    size_t slot;
+    size_t next;
+
+    if (indexP->count == 0) return false;
+
+    slot = hash & (indexP->capacity - 1);
+    while (indexP->entries[slot].item != item)
+    {
+        if (indexP->entries[slot].item == NULL) return false;
+        slot = (slot + 1) & (indexP->capacity - 1);
+    }
+
+    // shift back the following entries of the cluster which would not be reachable anymore
+    next = (slot + 1) & (indexP->capacity - 1);
+    while (indexP->entries[next].item != NULL)
+    {
+        size_t home = indexP->entries[next].hash & (indexP->capacity - 1);
+
+        if (((next - home) & (indexP->capacity - 1)) >= ((next - slot) & (indexP->capacity - 1)))
+        {
+            indexP->entries[slot] = indexP->entries[next];
+            slot = next;
+        }
+        next = (next + 1) & (indexP->capacity - 1);
+    }
+    indexP->entries[slot].hash = 0;
+    indexP->entries[slot].item = NULL;
+    indexP->count--;
+
+    return true;
+}
+
+void * index_find(lwm2m_index_t * indexP,
+                  uint32_t hash,
+                  index_match_callback_t matchFunc,
+                  const void * key,
+                  void * userData)
+{
+    size_t slot;
+
+    if (indexP->count == 0) return NULL;
+
+    slot = hash & (indexP->capacity - 1);
+    while (indexP->entries[slot].item != NULL)
+    {
+        if (indexP->entries[slot].hash == hash
+         && (matchFunc == NULL || matchFunc(indexP->entries[slot].item, key, userData)))
+        {
+            return indexP->entries[slot].item;
+        }
+        slot = (slot + 1) & (indexP->capacity - 1);
+    }
+
+    return NULL;
+}
+
+void index_clear(lwm2m_index_t * indexP)
+{
+    if (indexP->entries != NULL) lwm2m_free(indexP->entries);
+    indexP->entries = NULL;
+    indexP->capacity = 0;
+    indexP->count = 0;
+}
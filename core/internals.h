@@ -114,7 +114,9 @@
 ((M) == LWM2M_CONTENT_TLV ? "LWM2M_CONTENT_TLV" :                \
 ((M) == LWM2M_CONTENT_JSON ? "LWM2M_CONTENT_JSON" :              \
 ((M) == LWM2M_CONTENT_SENML_JSON ? "LWM2M_CONTENT_SENML_JSON" :  \
-"Unknown"))))))
+((M) == LWM2M_CONTENT_SENML_CBOR ? "LWM2M_CONTENT_SENML_CBOR" :  \
+((M) == LWM2M_CONTENT_LWM2M_CBOR ? "LWM2M_CONTENT_LWM2M_CBOR" :  \
+"Unknown"))))))))
 #define STR_STATE(S)                                \
 ((S) == STATE_INITIAL ? "STATE_INITIAL" :      \
 ((S) == STATE_BOOTSTRAP_REQUIRED ? "STATE_BOOTSTRAP_REQUIRED" :      \
@@ -132,7 +134,46 @@
 
 #define LWM2M_DEFAULT_LIFETIME  86400
 
-#ifdef LWM2M_SUPPORT_SENML_JSON
+// default maximal size of the block-wise transfers buffered per peer, 0 for no limit
+#ifndef LWM2M_MAX_BLOCK_TRANSFER_SIZE
+#define LWM2M_MAX_BLOCK_TRANSFER_SIZE 0
+#endif
+
+// CON notifications a client keeps in flight to a server, NSTART in RFC 7252
+#ifndef LWM2M_NSTART
+#define LWM2M_NSTART 1
+#endif
+
+// seconds a server in queue mode reaches the client after their last exchange, MAX_TRANSMIT_WAIT in RFC 7252
+#ifndef LWM2M_QUEUE_MODE_TIMEOUT
+#define LWM2M_QUEUE_MODE_TIMEOUT ((time_t)COAP_MAX_TRANSMIT_WAIT)
+#endif
+
+// notifications kept for a sleeping server in queue mode, the oldest are dropped first
+#ifndef LWM2M_QUEUE_MODE_MAX_NOTIFICATIONS
+#define LWM2M_QUEUE_MODE_MAX_NOTIFICATIONS 16
+#endif
+
+// seconds a client keeps a read response sent block-wise after the last block requested
+#ifndef LWM2M_BLOCK2_CACHE_LIFETIME
+#define LWM2M_BLOCK2_CACHE_LIFETIME 30
+#endif
+
+#ifdef LWM2M_DATA_ARENA
+// storage class of the arena in use, each thread uses its own. Can be defined empty on single threaded platforms.
+#ifndef LWM2M_THREAD_LOCAL
+#define LWM2M_THREAD_LOCAL _Thread_local
+#endif
+// size of the first chunk allocated by an arena
+#ifndef LWM2M_DATA_ARENA_CHUNK_SIZE
+#define LWM2M_DATA_ARENA_CHUNK_SIZE 1024
+#endif
+#endif
+
+#ifdef LWM2M_SUPPORT_SENML_CBOR
+#define REG_LWM2M_RESOURCE_TYPE     ">;rt=\"oma.lwm2m\";ct=112,"
+#define REG_LWM2M_RESOURCE_TYPE_LEN 23
+#elif defined(LWM2M_SUPPORT_SENML_JSON)
 #define REG_LWM2M_RESOURCE_TYPE     ">;rt=\"oma.lwm2m\";ct=110,"
 #define REG_LWM2M_RESOURCE_TYPE_LEN 23
 #elif defined(LWM2M_SUPPORT_JSON)
@@ -206,6 +247,8 @@
 #define REG_ATTR_CONTENT_JSON_OLD_LEN    4
 #define REG_ATTR_CONTENT_SENML_JSON      "110"
 #define REG_ATTR_CONTENT_SENML_JSON_LEN  3
+#define REG_ATTR_CONTENT_SENML_CBOR      "112"
+#define REG_ATTR_CONTENT_SENML_CBOR_LEN  3
 
 #define ATTR_SERVER_ID_STR       "ep="
 #define ATTR_SERVER_ID_LEN       3
@@ -295,6 +338,8 @@ typedef enum
     LWM2M_REQUEST_TYPE_DELETE_ALL
 } lwm2m_request_type_t;
 
+typedef bool (*index_match_callback_t)(const void * item, const void * key, void * userData);
+
 // defined in uri.c
 lwm2m_request_type_t uri_decode(char * altPath, multi_option_t *uriPath, uint8_t code, lwm2m_uri_t *uriP);
 int uri_getNumber(uint8_t * uriString, size_t uriLength);
@@ -310,6 +355,9 @@ uint8_t object_execute(lwm2m_context_t * contextP, lwm2m_uri_t * uriP, uint8_t *
 uint8_t object_raw_block1_write(lwm2m_context_t * contextP, lwm2m_uri_t * uriP, lwm2m_media_type_t format, uint8_t * buffer, size_t length, uint32_t block_num, uint8_t block_more);
 uint8_t object_raw_block1_create(lwm2m_context_t * contextP, lwm2m_uri_t * uriP, lwm2m_media_type_t format, uint8_t * buffer, size_t length, uint32_t block_num, uint8_t block_more);
 uint8_t object_raw_block1_execute(lwm2m_context_t * contextP, lwm2m_uri_t * uriP, uint8_t * buffer, size_t length, uint32_t block_num, uint8_t block_more);
+#else
+bool object_isBlock1Streamed(lwm2m_context_t * contextP, lwm2m_server_t * serverP, lwm2m_uri_t * uriP, coap_packet_t * message);
+uint8_t object_block1_write(lwm2m_context_t * contextP, lwm2m_server_t * serverP, lwm2m_uri_t * uriP, lwm2m_media_type_t format, coap_packet_t * message);
 #endif
 uint8_t object_delete(lwm2m_context_t * contextP, lwm2m_uri_t * uriP);
 uint8_t object_discover(lwm2m_context_t * contextP, lwm2m_uri_t * uriP, lwm2m_server_t * serverP, uint8_t ** bufferP, size_t * lengthP);
@@ -321,15 +369,33 @@ int object_getServers(lwm2m_context_t * contextP, bool checkOnly);
 uint8_t object_createInstance(lwm2m_context_t * contextP, lwm2m_uri_t * uriP, lwm2m_data_t * dataP);
 uint8_t object_writeInstance(lwm2m_context_t * contextP, lwm2m_uri_t * uriP, lwm2m_data_t * dataP);
 
+// defined in index.c
+uint32_t index_hashBytes(const uint8_t * data, size_t length);
+uint32_t index_hashString(const char * str);
+uint32_t index_hashInteger(uint32_t value);
+bool index_add(lwm2m_index_t * indexP, uint32_t hash, void * item);
+bool index_remove(lwm2m_index_t * indexP, uint32_t hash, void * item);
+void * index_find(lwm2m_index_t * indexP, uint32_t hash, index_match_callback_t matchFunc, const void * key, void * userData);
+void index_clear(lwm2m_index_t * indexP);
+
+// defined in scheduler.c
+int64_t scheduler_getTimeMs(void);
+void scheduler_add(lwm2m_context_t * contextP, lwm2m_timer_t * timerP, time_t deadline);
+void scheduler_addMs(lwm2m_context_t * contextP, lwm2m_timer_t * timerP, int64_t deadline);
+void scheduler_remove(lwm2m_context_t * contextP, lwm2m_timer_t * timerP);
+void scheduler_step(lwm2m_context_t * contextP, time_t currentTime, int64_t currentTimeMs, int64_t * timeoutP);
+void scheduler_clear(lwm2m_context_t * contextP);
+
 // defined in transaction.c
 lwm2m_transaction_t * transaction_new(void * sessionH, coap_method_t method, char * altPath, lwm2m_uri_t * uriP, uint16_t mID, uint8_t token_len, uint8_t* token);
 int transaction_send(lwm2m_context_t * contextP, lwm2m_transaction_t * transacP);
 void transaction_free(lwm2m_transaction_t * transacP);
+void transaction_add(lwm2m_context_t * contextP, lwm2m_transaction_t * transacP);
+lwm2m_transaction_t * transaction_find(lwm2m_context_t * contextP, void * sessionH, uint16_t mID);
 void transaction_remove(lwm2m_context_t * contextP, lwm2m_transaction_t * transacP);
 bool transaction_handleResponse(lwm2m_context_t * contextP, void * fromSessionH, coap_packet_t * message, coap_packet_t * response);
-void transaction_step(lwm2m_context_t * contextP, time_t currentTime, time_t * timeoutP);
 bool transaction_free_userData(lwm2m_context_t * context, lwm2m_transaction_t * transaction);
-void transaction_set_payload(lwm2m_transaction_t * transaction, uint8_t * buffer, int length);
+void transaction_set_payload(lwm2m_context_t * contextP, lwm2m_transaction_t * transaction, uint8_t * buffer, int length);
 
 // defined in management.c
 uint8_t dm_handleRequest(lwm2m_context_t * contextP, lwm2m_uri_t * uriP, lwm2m_server_t * serverP, coap_packet_t * message, coap_packet_t * response);
@@ -338,23 +404,39 @@ uint8_t dm_handleRequest(lwm2m_context_t * contextP, lwm2m_uri_t * uriP, lwm2m_s
 uint8_t observe_handleRequest(lwm2m_context_t * contextP, lwm2m_uri_t * uriP, lwm2m_server_t * serverP, int size, lwm2m_data_t * dataP, coap_packet_t * message, coap_packet_t * response);
 void observe_cancel(lwm2m_context_t * contextP, uint16_t mid, void * fromSessionH);
 uint8_t observe_setParameters(lwm2m_context_t * contextP, lwm2m_uri_t * uriP, lwm2m_server_t * serverP, lwm2m_attributes_t * attrP);
-void observe_step(lwm2m_context_t * contextP, time_t currentTime, time_t * timeoutP);
 void observe_clear(lwm2m_context_t * contextP, lwm2m_uri_t * uriP);
+void observe_step(lwm2m_context_t * contextP, time_t currentTime, time_t * timeoutP);
 bool observe_handleNotify(lwm2m_context_t * contextP, void * fromSessionH, coap_packet_t * message, coap_packet_t * response);
 void observe_remove(lwm2m_observation_t * observationP);
 lwm2m_observed_t * observe_findByUri(lwm2m_context_t * contextP, lwm2m_uri_t * uriP);
+void observe_clearTree(lwm2m_context_t * contextP);
+void observe_sendQueue(lwm2m_context_t * contextP, lwm2m_server_t * serverP);
+void observe_clearQueue(lwm2m_server_t * serverP);
 void applyObservationCallback(lwm2m_observation_t * observation, int status, block_info_t * block_info, lwm2m_media_type_t format, uint8_t * data, int dataLength);
 
 // defined in registration.c
 uint8_t registration_handleRequest(lwm2m_context_t * contextP, lwm2m_uri_t * uriP, void * fromSessionH, coap_packet_t * message, coap_packet_t * response);
 void registration_deregister(lwm2m_context_t * contextP, lwm2m_server_t * serverP);
 void registration_freeClient(lwm2m_client_t * clientP);
+void registration_scheduleExpiry(lwm2m_context_t * contextP, lwm2m_client_t * clientP);
 uint8_t registration_start(lwm2m_context_t * contextP, bool restartFailed);
 void registration_step(lwm2m_context_t * contextP, time_t currentTime, time_t * timeoutP);
 lwm2m_status_t registration_getStatus(lwm2m_context_t * contextP);
+void registration_keepAwake(lwm2m_server_t * serverP, time_t currentTime);
 
 // defined in packet.c
 uint8_t message_send(lwm2m_context_t * contextP, coap_packet_t * message, void * sessionH);
+// serializes the data as the payload of a notification directly in the transmit buffer and returns its length or -1.
+// formatP is updated as in lwm2m_data_serialize(). The payload stays there for message_send_notification().
+int message_serialize_notification(lwm2m_context_t * contextP, lwm2m_uri_t * uriP, int size, lwm2m_data_t * dataP, lwm2m_media_type_t * formatP);
+// sends the payload serialized last by message_serialize_notification() in a NON 2.05 notification. Only the header is
+// written, in front of the payload: it is sent as many times as there are watchers using the same format.
+uint8_t message_send_notification(lwm2m_context_t * contextP, void * sessionH, uint16_t mid, const uint8_t * token, size_t tokenLen, uint32_t observe, lwm2m_media_type_t format, size_t length);
+// same as message_send_notification() for a CON notification: returns a transaction holding the datagram, to be added
+// with transaction_add() and sent with transaction_send().
+lwm2m_transaction_t * message_new_notification(lwm2m_context_t * contextP, void * sessionH, uint16_t mid, const uint8_t * token, size_t tokenLen, uint32_t observe, lwm2m_media_type_t format, size_t length);
+// same as message_send_notification() for a sleeping server in queue mode: returns a copy of the datagram to send later.
+lwm2m_queued_notification_t * message_copy_notification(lwm2m_context_t * contextP, bool confirmable, const uint8_t * token, size_t tokenLen, uint32_t observe, lwm2m_media_type_t format, size_t length);
 
 // defined in bootstrap.c
 void bootstrap_step(lwm2m_context_t * contextP, time_t currentTime, time_t* timeoutP);
@@ -365,30 +447,123 @@ uint8_t bootstrap_handleRequest(lwm2m_context_t * contextP, lwm2m_uri_t * uriP,
 void bootstrap_start(lwm2m_context_t * contextP);
 lwm2m_status_t bootstrap_getStatus(lwm2m_context_t * contextP);
 
+// defined in data.c
+// lwm2m_malloc() and lwm2m_free() for the lwm2m_data_t arrays, their values and the parsing buffers
+#ifdef LWM2M_DATA_ARENA
+void * data_malloc(size_t size);
+void data_free(void * p);
+#else
+#define data_malloc(S) lwm2m_malloc(S)
+#define data_free(P) lwm2m_free(P)
+#endif
+
 #ifdef LWM2M_SUPPORT_TLV
 // defined in tlv.c
 int tlv_parse(const uint8_t * buffer, size_t bufferLen, lwm2m_data_t ** dataP);
 int tlv_serialize(bool isResourceInstance, int size, lwm2m_data_t * dataP, uint8_t ** bufferP);
+// returns the length of the TLV, only written if it fits in length
+int tlv_serializeInto(bool isResourceInstance, int size, lwm2m_data_t * dataP, uint8_t * buffer, size_t length);
+// returns the length of the header of a Resource with Value, 0 if buffer does not start with one
+int tlv_decodeResourceHeader(const uint8_t * buffer, size_t bufferLen, uint16_t * idP, size_t * valueLengthP);
 #endif
 
 // defined in json.c
 #ifdef LWM2M_SUPPORT_JSON
 int json_parse(lwm2m_uri_t * uriP, const uint8_t * buffer, size_t bufferLen, lwm2m_data_t ** dataP);
 int json_serialize(lwm2m_uri_t * uriP, int size, lwm2m_data_t * tlvP, uint8_t ** bufferP);
+int json_serializeInto(lwm2m_uri_t * uriP, int size, lwm2m_data_t * tlvP, uint8_t * buffer, size_t length);
 #endif
 
 // defined in senml_json.c
 #ifdef LWM2M_SUPPORT_SENML_JSON
 int senml_json_parse(const lwm2m_uri_t * uriP, const uint8_t * buffer, size_t bufferLen, lwm2m_data_t ** dataP);
 int senml_json_serialize(const lwm2m_uri_t * uriP, int size, const lwm2m_data_t * tlvP, uint8_t ** bufferP);
+int senml_json_serializeInto(const lwm2m_uri_t * uriP, int size, const lwm2m_data_t * tlvP, uint8_t * buffer, size_t length);
+#endif
+
+// defined in senml_cbor.c
+#ifdef LWM2M_SUPPORT_SENML_CBOR
+int senml_cbor_parse(const lwm2m_uri_t * uriP, const uint8_t * buffer, size_t bufferLen, lwm2m_data_t ** dataP);
+int senml_cbor_serialize(const lwm2m_uri_t * uriP, int size, const lwm2m_data_t * tlvP, uint8_t ** bufferP);
+int senml_cbor_serializeInto(const lwm2m_uri_t * uriP, int size, const lwm2m_data_t * tlvP, uint8_t * buffer, size_t length);
+#endif
+
+// defined in lwm2m_cbor.c
+#ifdef LWM2M_SUPPORT_LWM2M_CBOR
+int lwm2m_cbor_parse(const lwm2m_uri_t * uriP, const uint8_t * buffer, size_t bufferLen, lwm2m_data_t ** dataP);
+int lwm2m_cbor_serialize(const lwm2m_uri_t * uriP, int size, const lwm2m_data_t * tlvP, uint8_t ** bufferP);
+int lwm2m_cbor_serializeInto(const lwm2m_uri_t * uriP, int size, const lwm2m_data_t * tlvP, uint8_t * buffer, size_t length);
+#endif
+
+// defined in senml_common.c
+#if defined(LWM2M_SUPPORT_SENML_JSON) || defined(LWM2M_SUPPORT_SENML_CBOR) || defined(LWM2M_SUPPORT_LWM2M_CBOR)
+typedef struct
+{
+    uint16_t        ids[4];
+    lwm2m_data_t    value; /* Any buffer will be within the parsed data */
+    time_t          time;
+} senml_record_t;
+
+// converts the strings and opaque values of a record, their encoding depends on the format
+typedef bool (*senml_convertBuffer_t)(const senml_record_t * recordP, lwm2m_data_t * targetP);
+
+int senml_applyBase(senml_record_t * recordP, const char * baseUri, const uint8_t * name, size_t nameLength, time_t baseTime, const lwm2m_data_t * baseValue);
+int senml_convertRecords(const lwm2m_uri_t * uriP, const senml_record_t * recordArray, int count, senml_convertBuffer_t convertBuffer, lwm2m_data_t ** dataP);
+#if defined(LWM2M_SUPPORT_SENML_CBOR) || defined(LWM2M_SUPPORT_LWM2M_CBOR)
+// senml_convertBuffer_t copying the strings and opaque values as they are
+bool senml_copyBuffer(const senml_record_t * recordP, lwm2m_data_t * targetP);
+#endif
+#endif
+
+// defined in cbor_common.c
+#if defined(LWM2M_SUPPORT_SENML_CBOR) || defined(LWM2M_SUPPORT_LWM2M_CBOR)
+typedef enum
+{
+    CBOR_TYPE_UNSIGNED_INTEGER = 0,
+    CBOR_TYPE_NEGATIVE_INTEGER = 1,
+    CBOR_TYPE_BYTE_STRING = 2,
+    CBOR_TYPE_TEXT_STRING = 3,
+    CBOR_TYPE_ARRAY = 4,
+    CBOR_TYPE_MAP = 5,
+    CBOR_TYPE_TAG = 6,
+    CBOR_TYPE_SIMPLE = 7,
+    CBOR_TYPE_FLOAT = 8      // major type 7 with a half, single or double precision value
+} cbor_type_t;
+
+#define CBOR_SIMPLE_FALSE   20
+#define CBOR_SIMPLE_TRUE    21
+#define CBOR_SIMPLE_NULL    22
+
+typedef struct
+{
+    cbor_type_t     type;
+    uint64_t        value;   // integer, simple value, length of strings, count of array items or map pairs
+    double          asFloat;
+    const uint8_t * buffer;  // content of strings
+} cbor_item_t;
+
+// the cbor_put functions return the encoded length, 0 if it does not fit in length
+size_t cbor_putHeader(uint8_t * buffer, size_t length, cbor_type_t type, uint64_t value);
+size_t cbor_putInt(uint8_t * buffer, size_t length, int64_t value);
+size_t cbor_putFloat(uint8_t * buffer, size_t length, double value);
+size_t cbor_putString(uint8_t * buffer, size_t length, cbor_type_t type, const uint8_t * data, size_t dataLength);
+// returns the length of the item header, including the content of strings, or -1
+int cbor_getItem(const uint8_t * buffer, size_t bufferLen, cbor_item_t * itemP);
+// returns the length of the item including all its nested items, or -1
+int cbor_skipItem(const uint8_t * buffer, size_t bufferLen);
+bool cbor_decodeNumber(const cbor_item_t * itemP, lwm2m_data_t * dataP);
 #endif
 
 // defined in json_common.c
-#if defined(LWM2M_SUPPORT_JSON) || defined(LWM2M_SUPPORT_SENML_JSON)
+#if defined(LWM2M_SUPPORT_JSON) || defined(LWM2M_SUPPORT_SENML_JSON) || defined(LWM2M_SUPPORT_SENML_CBOR) || defined(LWM2M_SUPPORT_LWM2M_CBOR)
 size_t json_skipSpace(const uint8_t * buffer,size_t bufferLen);
-int json_split(const uint8_t * buffer, size_t bufferLen, size_t * tokenStartP, size_t * tokenLenP, size_t * valueStartP, size_t * valueLenP);
-int json_itemLength(const uint8_t * buffer, size_t bufferLen);
-int json_countItems(const uint8_t * buffer, size_t bufferLen);
+// length of the string starting at buffer, quotes included, or -1 if it is not terminated
+int json_stringLength(const uint8_t * buffer, size_t bufferLen);
+// reads the "token": value member at *indexP and the separator after it
+// returns 1 if other members follow, 0 at the end of the object and -1 on error
+int json_nextMember(const uint8_t * buffer, size_t bufferLen, size_t * indexP, size_t * tokenStartP, size_t * tokenLenP, size_t * valueStartP, size_t * valueLenP);
+// doubles the capacity of the array, returns NULL and leaves it untouched on failure
+void * json_growArray(void * array, size_t count, size_t itemSize, size_t * capacityP);
 int json_convertNumeric(const uint8_t *value, size_t valueLen, lwm2m_data_t *targetP);
 int json_convertTime(const uint8_t *valueStart, size_t valueLen, time_t *t);
 size_t json_unescapeString(uint8_t *dst, const uint8_t *src, size_t len);
@@ -404,16 +579,26 @@ int json_findAndCheckData(const lwm2m_uri_t * uriP, uri_depth_t baseLevel, size_
 int discover_serialize(lwm2m_context_t * contextP, lwm2m_uri_t * uriP, lwm2m_server_t * serverP, int size, lwm2m_data_t * dataP, uint8_t ** bufferP);
 
 // defined in block.c
+// totalSize is the value of the Size1 or Size2 option, 0 if absent. maxSize caps the buffers of the peer, 0 for no limit.
 #ifdef LWM2M_RAW_BLOCK1_REQUESTS
-uint8_t coap_block1_handler(lwm2m_block_data_t ** blockData, const char * uri, uint16_t mid, uint8_t * buffer, size_t length, uint16_t blockSize, uint32_t blockNum, bool blockMore, uint8_t ** outputBuffer, size_t * outputLength);
+uint8_t coap_block1_handler(lwm2m_block_data_t ** blockData, const char * uri, uint16_t mid, uint8_t * buffer, size_t length, uint16_t blockSize, uint32_t blockNum, bool blockMore, uint32_t totalSize, size_t maxSize, uint8_t ** outputBuffer, size_t * outputLength);
 #else
-uint8_t coap_block1_handler(lwm2m_block_data_t ** blockData, const char * uri, uint8_t * buffer, size_t length, uint16_t blockSize, uint32_t blockNum, bool blockMore, uint8_t ** outputBuffer, size_t * outputLength);
+uint8_t coap_block1_handler(lwm2m_block_data_t ** blockData, const char * uri, uint8_t * buffer, size_t length, uint16_t blockSize, uint32_t blockNum, bool blockMore, uint32_t totalSize, size_t maxSize, uint8_t ** outputBuffer, size_t * outputLength);
 #endif
+lwm2m_block_data_t * block1_find(lwm2m_block_data_t * blockDataHead, const char * uri);
 void block1_delete(lwm2m_block_data_t ** pBlockDataHead, char * uri);
-uint8_t coap_block2_handler(lwm2m_block_data_t ** blockData, uint16_t mid, uint8_t * buffer, size_t length, uint16_t blockSize, uint32_t blockNum, bool blockMore, uint8_t ** outputBuffer, size_t * outputLength);
+#ifndef LWM2M_RAW_BLOCK1_REQUESTS
+uint8_t coap_block1_stream_handler(lwm2m_block_data_t ** pBlockDataHead, const char * uri, size_t length, uint16_t blockSize, uint32_t blockNum, bool blockMore, lwm2m_block_data_t ** blockDataP);
+#endif
+uint8_t coap_block2_handler(lwm2m_block_data_t ** blockData, uint16_t mid, uint8_t * buffer, size_t length, uint16_t blockSize, uint32_t blockNum, bool blockMore, uint32_t totalSize, size_t maxSize, uint8_t ** outputBuffer, size_t * outputLength);
 void coap_block2_set_expected_mid(lwm2m_block_data_t *blockDataHead, uint16_t currentMid, uint16_t expectedMid);
 void free_block_data(lwm2m_block_data_t * blockData);
 void block2_delete(lwm2m_block_data_t ** pBlockDataHead, uint16_t mid);
+#ifdef LWM2M_CLIENT_MODE
+lwm2m_block_data_t * block2_cache_find(lwm2m_block_data_t ** pBlockDataHead, const char * uri, uint16_t accept, time_t currentTime);
+lwm2m_block_data_t * block2_cache_store(lwm2m_block_data_t ** pBlockDataHead, const char * uri, uint16_t accept, uint16_t format, uint8_t * buffer, size_t length, uint32_t etag, time_t currentTime);
+void block2_cache_delete(lwm2m_block_data_t ** pBlockDataHead);
+#endif
 
 // defined in utils.c
 lwm2m_data_type_t utils_depthToDatatype(uri_depth_t depth);
@@ -452,6 +637,10 @@ lwm2m_server_t * utils_findServer(lwm2m_context_t * contextP, void * fromSession
 lwm2m_server_t * utils_findBootstrapServer(lwm2m_context_t * contextP, void * fromSessionH);
 #else
 lwm2m_client_t * utils_findClient(lwm2m_context_t * contextP, void * fromSessionH);
+lwm2m_client_t * utils_findClientByName(lwm2m_context_t * contextP, const char * name);
+lwm2m_client_t * utils_findClientById(lwm2m_context_t * contextP, uint16_t clientID);
+bool utils_indexClient(lwm2m_context_t * contextP, lwm2m_client_t * clientP);
+void utils_unindexClient(lwm2m_context_t * contextP, lwm2m_client_t * clientP);
 #endif
 
 #endif
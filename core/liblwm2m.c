@@ -68,8 +68,15 @@ lwm2m_context_t * lwm2m_init(void * userData)
     {
         memset(contextP, 0, sizeof(lwm2m_context_t));
         contextP->userData = userData;
-        srand((int)lwm2m_gettime());
+        contextP->coapBlockSize = lwm2m_get_coap_block_size();
+        contextP->maxBlockTransferSize = LWM2M_MAX_BLOCK_TRANSFER_SIZE;
+        contextP->schedulerTime = lwm2m_gettime();
+        contextP->schedulerTimeMs = scheduler_getTimeMs();
+        srand((int)contextP->schedulerTime);
         contextP->nextMID = rand();
+#ifdef LWM2M_CLIENT_MODE
+        contextP->nextETag = (uint32_t)rand();
+#endif
     }
 
     return contextP;
@@ -109,6 +116,7 @@ static void prv_deleteServer(lwm2m_server_t * serverP, void *userData)
         serverP->blockData = serverP->blockData->next;
         free_block_data(targetP);
     }
+    observe_clearQueue(serverP);
     
     lwm2m_free(serverP);
 }
@@ -172,6 +180,8 @@ static void prv_deleteObservedList(lwm2m_context_t * contextP)
 
         lwm2m_free(targetP);
     }
+    contextP->observedDirtyList = NULL;
+    observe_clearTree(contextP);
 }
 #endif
 
@@ -187,6 +197,9 @@ void prv_deleteTransactionList(lwm2m_context_t * context)
         context->transactionList = context->transactionList->next;
         transaction_free(transaction);
     }
+    index_clear(&context->transactionMidIndex);
+    index_clear(&context->transactionTokenIndex);
+    context->transactionUnindexed = 0;
 }
 
 void lwm2m_close(lwm2m_context_t * contextP)
@@ -195,6 +208,7 @@ void lwm2m_close(lwm2m_context_t * contextP)
 
     LOG("Entering <lwm2m_close>");
     lwm2m_deregister(contextP);
+    scheduler_clear(contextP);
     prv_deleteServerList(contextP);
     prv_deleteBootstrapServerList(contextP);
     prv_deleteObservedList(contextP);
@@ -207,10 +221,14 @@ void lwm2m_close(lwm2m_context_t * contextP)
     {
         lwm2m_free(contextP->altPath);
     }
+#ifdef LWM2M_DATA_ARENA
+    lwm2m_data_arena_close(&contextP->dataArena);
+#endif
 
 #endif
 
 #ifdef LWM2M_SERVER_MODE
+    scheduler_clear(contextP);
     while (NULL != contextP->clientList)
     {
         lwm2m_client_t * clientP;
@@ -220,9 +238,20 @@ void lwm2m_close(lwm2m_context_t * contextP)
 
         registration_freeClient(clientP);
     }
+#endif
+#if defined(LWM2M_SERVER_MODE) || defined(LWM2M_BOOTSTRAP_SERVER_MODE)
+    index_clear(&contextP->clientIdIndex);
+    index_clear(&contextP->clientNameIndex);
+#ifdef LWM2M_SESSION_HASH
+    index_clear(&contextP->clientSessionIndex);
+#endif
 #endif
 
     prv_deleteTransactionList(contextP);
+    if (contextP->sendBuffer != NULL)
+    {
+        lwm2m_free(contextP->sendBuffer);
+    }
     lwm2m_free(contextP);
 }
 
@@ -393,15 +422,20 @@ int lwm2m_remove_object(lwm2m_context_t * contextP,
 #endif
 
 
-int lwm2m_step(lwm2m_context_t * contextP,
-               time_t * timeoutP)
+static int prv_step(lwm2m_context_t * contextP,
+                    time_t * timeoutP,
+                    int64_t * timeoutMsP)
 {
     time_t tv_sec;
+    int64_t tv_msec;
     LOG("Entering <lwm2m_step>");
 
-    LOG_ARG("timeoutP: %d", (int) *timeoutP);
+    LOG_ARG("timeoutMsP: %ld", (long) *timeoutMsP);
+    // seconds first, see scheduler_add()
     tv_sec = lwm2m_gettime();
     if (tv_sec < 0) return COAP_500_INTERNAL_SERVER_ERROR;
+    tv_msec = scheduler_getTimeMs();
+    if (tv_msec < 0) return COAP_500_INTERNAL_SERVER_ERROR;
 
 #ifdef LWM2M_CLIENT_MODE
     LOG_ARG("State: %s", STR_STATE(contextP->state));
@@ -501,14 +535,43 @@ next_step:
     }
 
     observe_step(contextP, tv_sec, timeoutP);
+    registration_step(contextP, tv_sec, timeoutP);
 #endif
 
-    registration_step(contextP, tv_sec, timeoutP);
-    transaction_step(contextP, tv_sec, timeoutP);
+    // retransmissions, client lifetimes and observation periods
+    scheduler_step(contextP, tv_sec, tv_msec, timeoutMsP);
+    // merge the timeout of the client steps, which only work in seconds
+    if (*timeoutMsP > (int64_t)*timeoutP * 1000) *timeoutMsP = (int64_t)*timeoutP * 1000;
 
-    LOG_ARG("Final timeoutP: %d", (int) *timeoutP);
+    LOG_ARG("Final timeoutMsP: %ld", (long) *timeoutMsP);
 #ifdef LWM2M_CLIENT_MODE
     LOG_ARG("Final state: %s", STR_STATE(contextP->state));
 #endif
     return 0;
 }
+
+int lwm2m_step(lwm2m_context_t * contextP,
+               time_t * timeoutP)
+{
+    int64_t timeoutMs;
+    int result;
+
+    timeoutMs = (int64_t)*timeoutP * 1000;
+    result = prv_step(contextP, timeoutP, &timeoutMs);
+    // round up so that the next step does not happen before the next deadline
+    if (*timeoutP > (timeoutMs + 999) / 1000) *timeoutP = (time_t)((timeoutMs + 999) / 1000);
+
+    return result;
+}
+
+int lwm2m_step_ms(lwm2m_context_t * contextP,
+                  int64_t * timeoutP)
+{
+    time_t timeout;
+    int result;
+
+    timeout = (time_t)((*timeoutP + 999) / 1000);
+    result = prv_step(contextP, &timeout, timeoutP);
+
+    return result;
+}
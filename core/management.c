@@ -299,6 +299,13 @@ uint8_t dm_handleRequest(lwm2m_context_t * contextP,
                 }
                 break;
             }
+#else
+            if (IS_OPTION(message, COAP_OPTION_BLOCK1)
+             && object_isBlock1Streamed(contextP, serverP, uriP, message))
+            {
+                result = object_block1_write(contextP, serverP, uriP, format, message);
+                break;
+            }
 #endif
             if (!LWM2M_URI_IS_SET_INSTANCE(uriP))
             {
@@ -355,6 +362,13 @@ uint8_t dm_handleRequest(lwm2m_context_t * contextP,
                 result = object_raw_block1_write(contextP, uriP, format, message->payload, message->payload_len, message->block1_num, message->block1_more);
                 break;
             }
+#else
+            if (IS_OPTION(message, COAP_OPTION_BLOCK1)
+             && object_isBlock1Streamed(contextP, serverP, uriP, message))
+            {
+                result = object_block1_write(contextP, serverP, uriP, format, message);
+                break;
+            }
 #endif
             if (IS_OPTION(message, COAP_OPTION_URI_QUERY))
             {
@@ -505,7 +519,7 @@ static int prv_makeOperation(lwm2m_context_t * contextP,
     lwm2m_transaction_t * transaction;
     dm_data_t * dataP;
 
-    clientP = (lwm2m_client_t *)lwm2m_list_find((lwm2m_list_t *)contextP->clientList, clientID);
+    clientP = utils_findClientById(contextP, clientID);
     if (clientP == NULL) return COAP_404_NOT_FOUND;
 
     transaction = transaction_new(clientP->sessionH, method, clientP->altPath, uriP, contextP->nextMID++, 4, NULL);
@@ -521,7 +535,7 @@ static int prv_makeOperation(lwm2m_context_t * contextP,
         
         // TODO: Take care of fragmentation
  
-        transaction_set_payload(transaction, buffer, length);
+        transaction_set_payload(contextP, transaction, buffer, length);
     }
 
     if (callback != NULL)
@@ -541,7 +555,7 @@ static int prv_makeOperation(lwm2m_context_t * contextP,
         transaction->userData = (void *)dataP;
     }
 
-    contextP->transactionList = (lwm2m_transaction_t *)LWM2M_LIST_ADD(contextP->transactionList, transaction);
+    transaction_add(contextP, transaction);
 
     return transaction_send(contextP, transaction);
 }
@@ -558,7 +572,7 @@ int prv_lwm2m_dm_read(lwm2m_context_t * contextP,
     LOG_ARG("clientID: %d", clientID);
     LOG_URI(uriP);
 
-    clientP = (lwm2m_client_t *)lwm2m_list_find((lwm2m_list_t *)contextP->clientList, clientID);
+    clientP = utils_findClientById(contextP, clientID);
     if (clientP == NULL) return COAP_404_NOT_FOUND;
 
     return prv_makeOperation(contextP, clientID, uriP,
@@ -672,7 +686,7 @@ int prv_lwm2m_dm_create(lwm2m_context_t * contextP,
         return COAP_400_BAD_REQUEST;
     }
 
-    clientP = (lwm2m_client_t *)LWM2M_LIST_FIND(contextP->clientList, clientID);
+    clientP = utils_findClientById(contextP, clientID);
     if (clientP == NULL) return COAP_404_NOT_FOUND;
 
     format = clientP->format;
@@ -749,7 +763,7 @@ int lwm2m_dm_write_attributes(lwm2m_context_t * contextP,
     if (ATTR_FLAG_NUMERIC == (attrP->toSet & ATTR_FLAG_NUMERIC)
      && (attrP->lessThan + 2 * attrP->step >= attrP->greaterThan)) return COAP_400_BAD_REQUEST;
 
-    clientP = (lwm2m_client_t *)lwm2m_list_find((lwm2m_list_t *)contextP->clientList, clientID);
+    clientP = utils_findClientById(contextP, clientID);
     if (clientP == NULL) return COAP_404_NOT_FOUND;
 
     transaction = transaction_new(clientP->sessionH, COAP_PUT, clientP->altPath, uriP, contextP->nextMID++, 4, NULL);
@@ -862,7 +876,7 @@ int lwm2m_dm_write_attributes(lwm2m_context_t * contextP,
         SET_OPTION(coap_pkt, COAP_OPTION_URI_QUERY);
     }
 
-    contextP->transactionList = (lwm2m_transaction_t *)LWM2M_LIST_ADD(contextP->transactionList, transaction);
+    transaction_add(contextP, transaction);
 
     return transaction_send(contextP, transaction);
 }
@@ -879,7 +893,7 @@ int lwm2m_dm_discover(lwm2m_context_t * contextP,
 
     LOG_ARG("clientID: %d", clientID);
     LOG_URI(uriP);
-    clientP = (lwm2m_client_t *)lwm2m_list_find((lwm2m_list_t *)contextP->clientList, clientID);
+    clientP = utils_findClientById(contextP, clientID);
     if (clientP == NULL) return COAP_404_NOT_FOUND;
 
     transaction = transaction_new(clientP->sessionH, COAP_GET, clientP->altPath, uriP, contextP->nextMID++, 4, NULL);
@@ -904,7 +918,7 @@ int lwm2m_dm_discover(lwm2m_context_t * contextP,
         transaction->userData = (void *)dataP;
     }
 
-    contextP->transactionList = (lwm2m_transaction_t *)LWM2M_LIST_ADD(contextP->transactionList, transaction);
+    transaction_add(contextP, transaction);
 
     return transaction_send(contextP, transaction);
 }
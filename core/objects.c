@@ -107,6 +107,29 @@ static int prv_getMandatoryInfo(lwm2m_context_t *contextP,
     return 0;
 }
 
+// the optional Default Notification Mode resource, NON when absent
+static bool prv_getConfirmNotifications(lwm2m_context_t * contextP,
+                                        lwm2m_object_t * objectP,
+                                        uint16_t instanceID)
+{
+    lwm2m_data_t * dataP;
+    int size;
+    int64_t value;
+    bool result;
+
+    size = 1;
+    dataP = lwm2m_data_new(size);
+    if (dataP == NULL) return false;
+    dataP->id = LWM2M_SERVER_NOTIFICATION_MODE_ID;
+
+    result = objectP->readFunc(contextP, instanceID, &size, &dataP, objectP) == COAP_205_CONTENT
+          && 1 == lwm2m_data_decode_int(dataP, &value)
+          && value == 1;
+    lwm2m_data_free(size, dataP);
+
+    return result;
+}
+
 uint8_t object_checkReadable(lwm2m_context_t * contextP,
                              lwm2m_uri_t * uriP,
                              lwm2m_attributes_t * attrP)
@@ -605,6 +628,168 @@ uint8_t object_raw_block1_create(lwm2m_context_t * contextP,
 
     return result;
 }
+#else
+bool object_isBlock1Streamed(lwm2m_context_t * contextP,
+                             lwm2m_server_t * serverP,
+                             lwm2m_uri_t * uriP,
+                             coap_packet_t * message)
+{
+    lwm2m_object_t * targetP;
+    lwm2m_media_type_t format = LWM2M_CONTENT_TLV;
+
+    if (!LWM2M_URI_IS_SET_RESOURCE(uriP)) return false;
+#ifndef LWM2M_VERSION_1_0
+    if (LWM2M_URI_IS_SET_RESOURCE_INSTANCE(uriP)) return false;
+#endif
+    if (IS_OPTION(message, COAP_OPTION_URI_QUERY)) return false;
+
+    switch (message->code)
+    {
+    case COAP_PUT:
+        break;
+    case COAP_POST:
+        // without a content format, this is an execute
+        if (!IS_OPTION(message, COAP_OPTION_CONTENT_TYPE)) return false;
+        break;
+    default:
+        return false;
+    }
+
+    if (IS_OPTION(message, COAP_OPTION_CONTENT_TYPE))
+    {
+        format = utils_convertMediaType(message->content_type);
+    }
+    switch (format)
+    {
+#ifdef LWM2M_SUPPORT_TLV
+    case LWM2M_CONTENT_TLV:
+#ifdef LWM2M_OLD_CONTENT_FORMAT_SUPPORT
+    case LWM2M_CONTENT_TLV_OLD:
+#endif
+#endif
+    case LWM2M_CONTENT_OPAQUE:
+        break;
+    default:
+        return false;
+    }
+
+    targetP = (lwm2m_object_t *)LWM2M_LIST_FIND(contextP->objectList, uriP->objectId);
+    if (NULL == targetP || NULL == targetP->blockWriteFunc) return false;
+
+    if (message->block1_num != 0)
+    {
+        lwm2m_block_data_t * blockData;
+        char * uri;
+
+        // the next blocks follow the way chosen for the first one
+        uri = coap_get_packet_uri_as_string(message);
+        if (uri == NULL) return false;
+        blockData = block1_find(serverP->blockData, uri);
+        lwm2m_free(uri);
+        return NULL != blockData && blockData->streamed;
+    }
+
+#ifdef LWM2M_SUPPORT_TLV
+    if (format != LWM2M_CONTENT_OPAQUE)
+    {
+        uint16_t id;
+        size_t valueLength;
+
+        // only a single resource is streamed, multiple resources and resource instances go to writeFunc
+        return 0 != tlv_decodeResourceHeader(message->payload, message->payload_len, &id, &valueLength);
+    }
+#endif
+    return true;
+}
+
+uint8_t object_block1_write(lwm2m_context_t * contextP,
+                            lwm2m_server_t * serverP,
+                            lwm2m_uri_t * uriP,
+                            lwm2m_media_type_t format,
+                            coap_packet_t * message)
+{
+    lwm2m_object_t * targetP;
+    lwm2m_block_data_t * blockData = NULL;
+    uint8_t * buffer = message->payload;
+    size_t length = message->payload_len;
+    size_t offset;
+    char * uri;
+    uint8_t result;
+
+    LOG_URI(uriP);
+    targetP = (lwm2m_object_t *)LWM2M_LIST_FIND(contextP->objectList, uriP->objectId);
+    if (NULL == targetP) return COAP_404_NOT_FOUND;
+    if (NULL == targetP->blockWriteFunc) return COAP_405_METHOD_NOT_ALLOWED;
+    if (NULL == lwm2m_list_find(targetP->instanceList, uriP->instanceId)) return COAP_404_NOT_FOUND;
+
+    uri = coap_get_packet_uri_as_string(message);
+    if (uri == NULL) return COAP_500_INTERNAL_SERVER_ERROR;
+
+    result = coap_block1_stream_handler(&serverP->blockData, uri, length, message->block1_size, message->block1_num, message->block1_more, &blockData);
+    if (result == COAP_RETRANSMISSION)
+    {
+        // this block was already handed over
+        lwm2m_free(uri);
+        return message->block1_more ? COAP_231_CONTINUE : COAP_204_CHANGED;
+    }
+
+    if (result == NO_ERROR && message->block1_num == 0)
+    {
+        blockData->valueOffset = 0;
+        blockData->valueLength = SIZE_MAX;
+#ifdef LWM2M_SUPPORT_TLV
+        if (format != LWM2M_CONTENT_OPAQUE)
+        {
+            uint16_t id;
+            int headerLength;
+
+            // the first block starts with the header of the resource, giving the length of its value
+            headerLength = tlv_decodeResourceHeader(buffer, length, &id, &blockData->valueLength);
+            if (headerLength == 0 || id != uriP->resourceId)
+            {
+                result = COAP_400_BAD_REQUEST;
+            }
+            else
+            {
+                buffer += headerLength;
+                length -= headerLength;
+            }
+        }
+#endif
+    }
+
+    if (result == NO_ERROR)
+    {
+        if (length > blockData->valueLength - blockData->valueOffset
+         || (!message->block1_more
+          && blockData->valueLength != SIZE_MAX
+          && blockData->valueOffset + length != blockData->valueLength))
+        {
+            result = COAP_400_BAD_REQUEST;
+        }
+        else
+        {
+            offset = blockData->valueOffset;
+            blockData->valueOffset += length;
+            result = targetP->blockWriteFunc(contextP, uriP, offset, buffer, length, !message->block1_more, targetP);
+        }
+    }
+
+    if (result == COAP_204_CHANGED || result == NO_ERROR)
+    {
+        result = message->block1_more ? COAP_231_CONTINUE : COAP_204_CHANGED;
+    }
+    else
+    {
+        // the object gets a chunk at offset 0 if the transfer restarts
+        block1_delete(&serverP->blockData, uri);
+    }
+    lwm2m_free(uri);
+
+    LOG_ARG("result: %u.%02u", (result & 0xFF) >> 5, (result & 0x1F));
+
+    return result;
+}
 #endif
 
 
@@ -1185,6 +1370,9 @@ int object_getServers(lwm2m_context_t * contextP, bool checkOnly)
                     }
                     else
                     {
+                        targetP->confirmNotifications = prv_getConfirmNotifications(contextP,
+                                                                                    serverObjP,
+                                                                                    serverInstP->id);
                         contextP->serverList = (lwm2m_server_t*)LWM2M_LIST_ADD(contextP->serverList, targetP);
                     }
                 }
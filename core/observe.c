@@ -54,25 +54,217 @@
 
 
 #ifdef LWM2M_CLIENT_MODE
-static lwm2m_observed_t * prv_findObserved(lwm2m_context_t * contextP,
-                                           lwm2m_uri_t * uriP)
+static void prv_stepObserved(lwm2m_context_t * contextP, void * userData, time_t currentTime);
+
+// Check the watchers of an observed URI at the next lwm2m_step()
+static void prv_markDirty(lwm2m_context_t * contextP,
+                          lwm2m_observed_t * observedP)
 {
-    lwm2m_observed_t * targetP;
+    if (observedP->dirty) return;
 
-    targetP = contextP->observedList;
-    while (targetP != NULL
-        && ((LWM2M_URI_IS_SET_OBJECT(uriP) && targetP->uri.objectId != uriP->objectId)
-         || (LWM2M_URI_IS_SET_INSTANCE(uriP) && targetP->uri.instanceId != uriP->instanceId)
-         || (LWM2M_URI_IS_SET_RESOURCE(uriP) && targetP->uri.resourceId != uriP->resourceId)
+    observedP->dirty = true;
+    observedP->nextDirty = contextP->observedDirtyList;
+    contextP->observedDirtyList = observedP;
+}
+
+static void prv_unmarkDirty(lwm2m_context_t * contextP,
+                            lwm2m_observed_t * observedP)
+{
+    lwm2m_observed_t ** dirtyP;
+
+    if (!observedP->dirty) return;
+
+    for (dirtyP = &contextP->observedDirtyList ; *dirtyP != NULL ; dirtyP = &(*dirtyP)->nextDirty)
+    {
+        if (*dirtyP == observedP)
+        {
+            *dirtyP = observedP->nextDirty;
+            break;
+        }
+    }
+    observedP->nextDirty = NULL;
+    observedP->dirty = false;
+}
+
+// Path of an URI in lwm2m_context_t::observedTree, returns its depth
+static int prv_uriToPath(lwm2m_uri_t * uriP,
+                         uint16_t * path)
+{
+    int depth = 0;
+
+    if (!LWM2M_URI_IS_SET_OBJECT(uriP)) return depth;
+    path[depth++] = uriP->objectId;
+    if (!LWM2M_URI_IS_SET_INSTANCE(uriP)) return depth;
+    path[depth++] = uriP->instanceId;
+    if (!LWM2M_URI_IS_SET_RESOURCE(uriP)) return depth;
+    path[depth++] = uriP->resourceId;
 #ifndef LWM2M_VERSION_1_0
-         || (LWM2M_URI_IS_SET_RESOURCE_INSTANCE(uriP) && targetP->uri.resourceInstanceId != uriP->resourceInstanceId)
+    if (!LWM2M_URI_IS_SET_RESOURCE_INSTANCE(uriP)) return depth;
+    path[depth++] = uriP->resourceInstanceId;
 #endif
-           ))
+
+    return depth;
+}
+
+// Index of the child with this ID, or where to insert it
+static uint32_t prv_findChildIndex(lwm2m_observed_node_t * nodeP,
+                                   uint16_t id)
+{
+    uint32_t low = 0;
+    uint32_t high = nodeP->childCount;
+
+    while (low < high)
     {
-        targetP = targetP->next;
+        uint32_t middle = low + (high - low) / 2;
+
+        if (nodeP->children[middle]->id < id)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
     }
 
-    return targetP;
+    return low;
+}
+
+static lwm2m_observed_node_t * prv_findChild(lwm2m_observed_node_t * nodeP,
+                                             uint16_t id)
+{
+    uint32_t index = prv_findChildIndex(nodeP, id);
+
+    if (index < nodeP->childCount && nodeP->children[index]->id == id) return nodeP->children[index];
+
+    return NULL;
+}
+
+static lwm2m_observed_node_t * prv_getChild(lwm2m_observed_node_t * nodeP,
+                                            uint16_t id)
+{
+    uint32_t index = prv_findChildIndex(nodeP, id);
+    lwm2m_observed_node_t * childP;
+
+    if (index < nodeP->childCount && nodeP->children[index]->id == id) return nodeP->children[index];
+
+    if (nodeP->childCount == nodeP->childCapacity)
+    {
+        uint32_t capacity = nodeP->childCapacity == 0 ? 4 : 2 * nodeP->childCapacity;
+        lwm2m_observed_node_t ** childrenP;
+
+        childrenP = (lwm2m_observed_node_t **)lwm2m_malloc(capacity * sizeof(lwm2m_observed_node_t *));
+        if (childrenP == NULL) return NULL;
+        if (nodeP->childCount != 0)
+        {
+            memcpy(childrenP, nodeP->children, nodeP->childCount * sizeof(lwm2m_observed_node_t *));
+        }
+        lwm2m_free(nodeP->children);
+        nodeP->children = childrenP;
+        nodeP->childCapacity = capacity;
+    }
+
+    childP = (lwm2m_observed_node_t *)lwm2m_malloc(sizeof(lwm2m_observed_node_t));
+    if (childP == NULL) return NULL;
+    memset(childP, 0, sizeof(lwm2m_observed_node_t));
+    childP->parent = nodeP;
+    childP->id = id;
+
+    memmove(nodeP->children + index + 1, nodeP->children + index, (nodeP->childCount - index) * sizeof(lwm2m_observed_node_t *));
+    nodeP->children[index] = childP;
+    nodeP->childCount++;
+
+    return childP;
+}
+
+// Frees the nodes left without observation nor children, from nodeP up to the root
+static void prv_pruneNode(lwm2m_observed_node_t * nodeP)
+{
+    while (nodeP->parent != NULL
+        && nodeP->observedP == NULL
+        && nodeP->childCount == 0)
+    {
+        lwm2m_observed_node_t * parentP = nodeP->parent;
+        uint32_t index = prv_findChildIndex(parentP, nodeP->id);
+
+        parentP->childCount--;
+        memmove(parentP->children + index, parentP->children + index + 1, (parentP->childCount - index) * sizeof(lwm2m_observed_node_t *));
+        lwm2m_free(nodeP->children);
+        lwm2m_free(nodeP);
+        nodeP = parentP;
+    }
+    if (nodeP->childCount == 0)
+    {
+        lwm2m_free(nodeP->children);
+        nodeP->children = NULL;
+        nodeP->childCapacity = 0;
+    }
+}
+
+static void prv_freeNodes(lwm2m_observed_node_t * nodeP)
+{
+    uint32_t i;
+
+    for (i = 0; i < nodeP->childCount; i++)
+    {
+        prv_freeNodes(nodeP->children[i]);
+        lwm2m_free(nodeP->children[i]);
+    }
+    lwm2m_free(nodeP->children);
+    nodeP->children = NULL;
+    nodeP->childCount = 0;
+    nodeP->childCapacity = 0;
+}
+
+static lwm2m_observed_t * prv_findObserved(lwm2m_context_t * contextP,
+                                           lwm2m_uri_t * uriP)
+{
+    lwm2m_observed_node_t * nodeP;
+    uint16_t path[4];
+    int depth;
+    int i;
+
+    depth = prv_uriToPath(uriP, path);
+    nodeP = &contextP->observedTree;
+    for (i = 0; i < depth && nodeP != NULL; i++)
+    {
+        nodeP = prv_findChild(nodeP, path[i]);
+    }
+
+    return nodeP == NULL ? NULL : nodeP->observedP;
+}
+
+// Adds a new observation to the list and the tree
+static bool prv_linkObserved(lwm2m_context_t * contextP,
+                             lwm2m_observed_t * observedP)
+{
+    lwm2m_observed_node_t * nodeP;
+    uint16_t path[4];
+    int depth;
+    int i;
+
+    depth = prv_uriToPath(&observedP->uri, path);
+    if (depth == 0) return false;
+
+    nodeP = &contextP->observedTree;
+    for (i = 0; i < depth; i++)
+    {
+        lwm2m_observed_node_t * childP = prv_getChild(nodeP, path[i]);
+
+        if (childP == NULL)
+        {
+            prv_pruneNode(nodeP);
+            return false;
+        }
+        nodeP = childP;
+    }
+    nodeP->observedP = observedP;
+    observedP->node = nodeP;
+
+    observedP->next = contextP->observedList;
+    contextP->observedList = observedP;
+
+    return true;
 }
 
 static void prv_unlinkObserved(lwm2m_context_t * contextP,
@@ -97,6 +289,10 @@ static void prv_unlinkObserved(lwm2m_context_t * contextP,
             parentP->next = parentP->next->next;
         }
     }
+
+    observedP->node->observedP = NULL;
+    prv_pruneNode(observedP->node);
+    observedP->node = NULL;
 }
 
 static lwm2m_watcher_t * prv_findWatcher(lwm2m_observed_t * observedP,
@@ -114,6 +310,255 @@ static lwm2m_watcher_t * prv_findWatcher(lwm2m_observed_t * observedP,
     return targetP;
 }
 
+// A CON notification waits while the server has LWM2M_NSTART of them in flight or while the previous notification of
+// the same watcher is not acknowledged. It is then sent with the value of the URI at that time.
+static bool prv_isCongested(lwm2m_watcher_t * watcherP)
+{
+    return watcherP->server->confirmNotifications
+        && (watcherP->transaction != NULL || watcherP->server->notificationsInFlight >= LWM2M_NSTART);
+}
+
+// a congested watcher is checked again by prv_resumeNotifications()
+static void prv_deferNotification(lwm2m_watcher_t * watcherP)
+{
+    if (watcherP->deferred) return;
+
+    watcherP->deferred = true;
+    watcherP->nextDeferred = watcherP->server->deferredList;
+    watcherP->server->deferredList = watcherP;
+}
+
+// checks again at the next step the URIs whose notifications to a server were deferred
+static void prv_resumeNotifications(lwm2m_context_t * contextP,
+                                    lwm2m_server_t * serverP)
+{
+    lwm2m_watcher_t * watcherP;
+
+    watcherP = serverP->deferredList;
+    serverP->deferredList = NULL;
+    while (watcherP != NULL)
+    {
+        lwm2m_watcher_t * nextP = watcherP->nextDeferred;
+
+        watcherP->nextDeferred = NULL;
+        watcherP->deferred = false;
+        if (watcherP->active == true)
+        {
+            scheduler_add(contextP, &watcherP->observed->timer, contextP->schedulerTime);
+        }
+        watcherP = nextP;
+    }
+}
+
+static void prv_notificationCallback(lwm2m_context_t * contextP,
+                                     lwm2m_transaction_t * transacP,
+                                     void * message)
+{
+    lwm2m_watcher_t * watcherP = (lwm2m_watcher_t *)transacP->userData;
+
+    watcherP->transaction = NULL;
+    watcherP->server->notificationsInFlight--;
+    if (message == NULL)
+    {
+        // RFC 7641: a server not acknowledging a CON notification is no longer an observer
+        LOG("CON notification expired");
+        watcherP->active = false;
+        watcherP->update = false;
+    }
+    // a reset cancelled the observation in handle_reset() before
+
+    prv_resumeNotifications(contextP, watcherP->server);
+}
+
+static void prv_sendConfirmable(lwm2m_context_t * contextP,
+                                lwm2m_watcher_t * watcherP,
+                                lwm2m_media_type_t format,
+                                size_t length)
+{
+    lwm2m_transaction_t * transacP;
+
+    transacP = message_new_notification(contextP, watcherP->server->sessionH, watcherP->lastMid,
+                                        watcherP->token, watcherP->tokenLen, watcherP->counter++, format, length);
+    if (transacP == NULL) return;
+
+    transacP->callback = prv_notificationCallback;
+    transacP->userData = watcherP;
+    watcherP->transaction = transacP;
+    watcherP->server->notificationsInFlight++;
+    transaction_add(contextP, transacP);
+    (void)transaction_send(contextP, transacP);
+}
+
+// keeps a notification for a sleeping server in queue mode, dropping the oldest one when the queue is full
+static void prv_queueNotification(lwm2m_context_t * contextP,
+                                  lwm2m_watcher_t * watcherP,
+                                  lwm2m_media_type_t format,
+                                  size_t length)
+{
+    lwm2m_server_t * serverP = watcherP->server;
+    lwm2m_queued_notification_t * queuedP;
+    lwm2m_queued_notification_t ** lastP;
+
+    queuedP = message_copy_notification(contextP, serverP->confirmNotifications, watcherP->token, watcherP->tokenLen,
+                                        watcherP->counter++, format, length);
+    if (queuedP == NULL) return;
+    queuedP->watcher = watcherP;
+
+    if (serverP->notificationQueueCount >= LWM2M_QUEUE_MODE_MAX_NOTIFICATIONS)
+    {
+        lwm2m_queued_notification_t * oldestP = serverP->notificationQueue;
+
+        LOG("Notification queue full, dropping the oldest");
+        serverP->notificationQueue = oldestP->next;
+        serverP->notificationQueueCount--;
+        lwm2m_free(oldestP->buffer);
+        lwm2m_free(oldestP);
+    }
+    for (lastP = &serverP->notificationQueue ; *lastP != NULL ; lastP = &(*lastP)->next);
+    *lastP = queuedP;
+    serverP->notificationQueueCount++;
+}
+
+static void prv_queuedCallback(lwm2m_context_t * contextP,
+                               lwm2m_transaction_t * transacP,
+                               void * message)
+{
+    lwm2m_watcher_t * watcherP = (lwm2m_watcher_t *)transacP->userData;
+
+    watcherP->server->notificationsInFlight--;
+    if (message == NULL)
+    {
+        // RFC 7641: a server not acknowledging a CON notification is no longer an observer
+        LOG("Queued CON notification expired");
+        watcherP->active = false;
+        watcherP->update = false;
+    }
+
+    prv_resumeNotifications(contextP, watcherP->server);
+}
+
+// forgets the notifications in flight or queued of a watcher about to be freed
+static void prv_dropNotification(lwm2m_context_t * contextP,
+                                 lwm2m_watcher_t * watcherP)
+{
+    lwm2m_queued_notification_t ** queuedP;
+    lwm2m_transaction_t * transacP;
+    bool dropped = false;
+
+    if (watcherP->deferred)
+    {
+        lwm2m_watcher_t ** deferredP;
+
+        deferredP = &watcherP->server->deferredList;
+        while (*deferredP != watcherP) deferredP = &(*deferredP)->nextDeferred;
+        *deferredP = watcherP->nextDeferred;
+        watcherP->deferred = false;
+    }
+
+    queuedP = &watcherP->server->notificationQueue;
+    while (*queuedP != NULL)
+    {
+        if ((*queuedP)->watcher == watcherP)
+        {
+            lwm2m_queued_notification_t * targetP = *queuedP;
+
+            *queuedP = targetP->next;
+            watcherP->server->notificationQueueCount--;
+            lwm2m_free(targetP->buffer);
+            lwm2m_free(targetP);
+        }
+        else
+        {
+            queuedP = &(*queuedP)->next;
+        }
+    }
+
+    if (watcherP->server->notificationsInFlight == 0) return;
+
+    // the queued notifications sent at once are not tracked by watcherP->transaction
+    transacP = contextP->transactionList;
+    while (transacP != NULL)
+    {
+        lwm2m_transaction_t * nextP = transacP->next;
+
+        if (transacP->callback == prv_queuedCallback && transacP->userData == watcherP)
+        {
+            transaction_remove(contextP, transacP);
+            watcherP->server->notificationsInFlight--;
+            dropped = true;
+        }
+        transacP = nextP;
+    }
+    if (watcherP->transaction != NULL)
+    {
+        transaction_remove(contextP, watcherP->transaction);
+        watcherP->transaction = NULL;
+        watcherP->server->notificationsInFlight--;
+        dropped = true;
+    }
+    if (dropped) prv_resumeNotifications(contextP, watcherP->server);
+}
+
+void observe_sendQueue(lwm2m_context_t * contextP,
+                       lwm2m_server_t * serverP)
+{
+    lwm2m_queued_notification_t * queuedP;
+
+    LOG_ARG("%d notifications queued", serverP->notificationQueueCount);
+
+    queuedP = serverP->notificationQueue;
+    serverP->notificationQueue = NULL;
+    serverP->notificationQueueCount = 0;
+    while (queuedP != NULL)
+    {
+        lwm2m_queued_notification_t * nextP = queuedP->next;
+        uint16_t mid = contextP->nextMID++;
+
+        queuedP->buffer[2] = (uint8_t)(mid >> 8);
+        queuedP->buffer[3] = (uint8_t)mid;
+        // a reset cancels the observation
+        queuedP->watcher->lastMid = mid;
+        if (queuedP->confirmable)
+        {
+            lwm2m_transaction_t * transacP;
+
+            transacP = transaction_new(serverP->sessionH, (coap_method_t)COAP_205_CONTENT, NULL, NULL, mid, 0, NULL);
+            if (transacP != NULL)
+            {
+                // sent as is by transaction_send()
+                transacP->buffer = queuedP->buffer;
+                transacP->buffer_len = (uint16_t)queuedP->length;
+                queuedP->buffer = NULL;
+                transacP->callback = prv_queuedCallback;
+                transacP->userData = queuedP->watcher;
+                serverP->notificationsInFlight++;
+                transaction_add(contextP, transacP);
+                (void)transaction_send(contextP, transacP);
+            }
+        }
+        else
+        {
+            (void)lwm2m_buffer_send(serverP->sessionH, queuedP->buffer, queuedP->length, contextP->userData);
+        }
+        if (queuedP->buffer != NULL) lwm2m_free(queuedP->buffer);
+        lwm2m_free(queuedP);
+        queuedP = nextP;
+    }
+}
+
+void observe_clearQueue(lwm2m_server_t * serverP)
+{
+    while (serverP->notificationQueue != NULL)
+    {
+        lwm2m_queued_notification_t * queuedP = serverP->notificationQueue;
+
+        serverP->notificationQueue = queuedP->next;
+        lwm2m_free(queuedP->buffer);
+        lwm2m_free(queuedP);
+    }
+    serverP->notificationQueueCount = 0;
+}
+
 static lwm2m_watcher_t * prv_getWatcher(lwm2m_context_t * contextP,
                                         lwm2m_uri_t * uriP,
                                         lwm2m_server_t * serverP)
@@ -132,8 +577,13 @@ static lwm2m_watcher_t * prv_getWatcher(lwm2m_context_t * contextP,
         allocatedObserver = true;
         memset(observedP, 0, sizeof(lwm2m_observed_t));
         memcpy(&(observedP->uri), uriP, sizeof(lwm2m_uri_t));
-        observedP->next = contextP->observedList;
-        contextP->observedList = observedP;
+        observedP->timer.callback = prv_stepObserved;
+        observedP->timer.userData = observedP;
+        if (!prv_linkObserved(contextP, observedP))
+        {
+            lwm2m_free(observedP);
+            return NULL;
+        }
     }
 
     watcherP = prv_findWatcher(observedP, serverP);
@@ -144,6 +594,7 @@ static lwm2m_watcher_t * prv_getWatcher(lwm2m_context_t * contextP,
         {
             if (allocatedObserver == true)
             {
+                prv_unlinkObserved(contextP, observedP);
                 lwm2m_free(observedP);
             }
             return NULL;
@@ -151,6 +602,7 @@ static lwm2m_watcher_t * prv_getWatcher(lwm2m_context_t * contextP,
         memset(watcherP, 0, sizeof(lwm2m_watcher_t));
         watcherP->active = false;
         watcherP->server = serverP;
+        watcherP->observed = observedP;
         watcherP->next = observedP->watcherList;
         observedP->watcherList = watcherP;
     }
@@ -193,6 +645,7 @@ uint8_t observe_handleRequest(lwm2m_context_t * contextP,
         watcherP->lastTime = lwm2m_gettime();
         watcherP->lastMid = response->mid;
         watcherP->format = (lwm2m_media_type_t)response->content_type;
+        prv_markDirty(contextP, prv_findObserved(contextP, uriP));
 
         valueP = dataP;
 #ifndef LWM2M_VERSION_1_0
@@ -282,10 +735,13 @@ void observe_cancel(lwm2m_context_t * contextP,
         }
         if (targetP != NULL)
         {
+            prv_dropNotification(contextP, targetP);
             if (targetP->parameters != NULL) lwm2m_free(targetP->parameters);
             lwm2m_free(targetP);
             if (observedP->watcherList == NULL)
             {
+                scheduler_remove(contextP, &observedP->timer);
+                prv_unmarkDirty(contextP, observedP);
                 prv_unlinkObserved(contextP, observedP);
                 lwm2m_free(observedP);
             }
@@ -315,10 +771,13 @@ void observe_clear(lwm2m_context_t * contextP,
 
             for (watcherP = observedP->watcherList; watcherP != NULL; watcherP = watcherP->next)
             {
+                prv_dropNotification(contextP, watcherP);
                 if (watcherP->parameters != NULL) lwm2m_free(watcherP->parameters);
             }
             LWM2M_LIST_FREE(observedP->watcherList);
 
+            scheduler_remove(contextP, &observedP->timer);
+            prv_unmarkDirty(contextP, observedP);
             prv_unlinkObserved(contextP, observedP);
             lwm2m_free(observedP);
 
@@ -427,6 +886,8 @@ uint8_t observe_setParameters(lwm2m_context_t * contextP,
     LOG_ARG("Final toSet: %08X, minPeriod: %d, maxPeriod: %d, greaterThan: %f, lessThan: %f, step: %f",
             watcherP->parameters->toSet, watcherP->parameters->minPeriod, watcherP->parameters->maxPeriod, watcherP->parameters->greaterThan, watcherP->parameters->lessThan, watcherP->parameters->step);
 
+    prv_markDirty(contextP, prv_findObserved(contextP, uriP));
+
     return COAP_204_CHANGED;
 }
 
@@ -436,415 +897,515 @@ lwm2m_observed_t * observe_findByUri(lwm2m_context_t * contextP,
     lwm2m_observed_t * targetP;
 
     LOG_URI(uriP);
-    targetP = contextP->observedList;
-    while (targetP != NULL)
+    targetP = prv_findObserved(contextP, uriP);
+    if (targetP != NULL)
     {
-        if (targetP->uri.objectId == uriP->objectId)
-        {
-            if ((!LWM2M_URI_IS_SET_INSTANCE(uriP) && !LWM2M_URI_IS_SET_INSTANCE(&(targetP->uri)))
-             || (LWM2M_URI_IS_SET_INSTANCE(uriP) && LWM2M_URI_IS_SET_INSTANCE(&(targetP->uri)) && (uriP->instanceId == targetP->uri.instanceId)))
-             {
-                 if ((!LWM2M_URI_IS_SET_RESOURCE(uriP) && !LWM2M_URI_IS_SET_RESOURCE(&(targetP->uri)))
-                     || (LWM2M_URI_IS_SET_RESOURCE(uriP) && LWM2M_URI_IS_SET_RESOURCE(&(targetP->uri)) && (uriP->resourceId == targetP->uri.resourceId)))
-                 {
-#ifndef LWM2M_VERSION_1_0
-                     if ((!LWM2M_URI_IS_SET_RESOURCE_INSTANCE(uriP) && !LWM2M_URI_IS_SET_RESOURCE_INSTANCE(&(targetP->uri)))
-                      || (LWM2M_URI_IS_SET_RESOURCE_INSTANCE(uriP) && LWM2M_URI_IS_SET_RESOURCE_INSTANCE(&(targetP->uri)) && (uriP->resourceInstanceId == targetP->uri.resourceInstanceId)))
-#endif
-                     {
-                         LOG_ARG("Found one with%s observers.", targetP->watcherList ? "" : " no");
-                         LOG_URI(&(targetP->uri));
-                         return targetP;
-                     }
-                 }
-             }
-        }
-        targetP = targetP->next;
+        LOG_ARG("Found one with%s observers.", targetP->watcherList ? "" : " no");
+        LOG_URI(&(targetP->uri));
+        return targetP;
     }
 
     LOG("Found nothing");
     return NULL;
 }
 
+void observe_clearTree(lwm2m_context_t * contextP)
+{
+    prv_freeNodes(&contextP->observedTree);
+}
+
+static void prv_valueChanged(lwm2m_context_t * contextP,
+                             lwm2m_observed_t * targetP)
+{
+    lwm2m_watcher_t * watcherP;
+
+    LOG("Found an observation");
+    LOG_URI(&(targetP->uri));
+
+    for (watcherP = targetP->watcherList ; watcherP != NULL ; watcherP = watcherP->next)
+    {
+        if (watcherP->active == true)
+        {
+            LOG("Tagging a watcher");
+            watcherP->update = true;
+        }
+    }
+    prv_markDirty(contextP, targetP);
+}
+
+static void prv_childrenChanged(lwm2m_context_t * contextP,
+                                lwm2m_observed_node_t * nodeP)
+{
+    uint32_t i;
+
+    for (i = 0; i < nodeP->childCount; i++)
+    {
+        if (nodeP->children[i]->observedP != NULL) prv_valueChanged(contextP, nodeP->children[i]->observedP);
+        prv_childrenChanged(contextP, nodeP->children[i]);
+    }
+}
+
 void lwm2m_resource_value_changed(lwm2m_context_t * contextP,
                                   lwm2m_uri_t * uriP)
 {
-    lwm2m_observed_t * targetP;
+    lwm2m_observed_node_t * nodeP;
+    uint16_t path[4];
+    int depth;
+    int i;
 
     LOG_URI(uriP);
-    targetP = contextP->observedList;
-    while (targetP != NULL)
+    depth = prv_uriToPath(uriP, path);
+    if (depth == 0) return;
+
+    // the observations of the URI and of its parents
+    nodeP = &contextP->observedTree;
+    for (i = 0; i < depth; i++)
     {
-        if (targetP->uri.objectId == uriP->objectId)
-        {
-            if (!LWM2M_URI_IS_SET_INSTANCE(uriP)
-             || !LWM2M_URI_IS_SET_INSTANCE(&targetP->uri)
-             || uriP->instanceId == targetP->uri.instanceId)
-            {
-                if (!LWM2M_URI_IS_SET_RESOURCE(uriP)
-                 || !LWM2M_URI_IS_SET_RESOURCE(&targetP->uri)
-                 || uriP->resourceId == targetP->uri.resourceId)
-                {
-#ifndef LWM2M_VERSION_1_0
-                    if (!LWM2M_URI_IS_SET_RESOURCE_INSTANCE(uriP)
-                     || !LWM2M_URI_IS_SET_RESOURCE_INSTANCE(&targetP->uri)
-                     || uriP->resourceInstanceId == targetP->uri.resourceInstanceId)
-#endif
-                    {
-                        lwm2m_watcher_t * watcherP;
+        nodeP = prv_findChild(nodeP, path[i]);
+        if (nodeP == NULL) return;
+        if (nodeP->observedP != NULL) prv_valueChanged(contextP, nodeP->observedP);
+    }
 
-                        LOG("Found an observation");
-                        LOG_URI(&(targetP->uri));
+    // and the ones below it
+    prv_childrenChanged(contextP, nodeP);
+}
 
-                        for (watcherP = targetP->watcherList ; watcherP != NULL ; watcherP = watcherP->next)
-                        {
-                            if (watcherP->active == true)
-                            {
-                                LOG("Tagging a watcher");
-                                watcherP->update = true;
-                            }
-                        }
-                    }
-                }
-            }
-        }
-        targetP = targetP->next;
+// Tell if a watcher may notify now, before reading the value
+static bool prv_mayNotify(lwm2m_watcher_t * watcherP,
+                          time_t currentTime)
+{
+    if (watcherP->active == false) return false;
+
+    if (prv_isCongested(watcherP))
+    {
+        prv_deferNotification(watcherP);
+        return false;
+    }
+
+    if (watcherP->parameters != NULL
+     && (watcherP->parameters->toSet & LWM2M_ATTR_FLAG_MAX_PERIOD) != 0
+     && watcherP->lastTime + watcherP->parameters->maxPeriod <= currentTime)
+    {
+        return true;
     }
+
+    if (watcherP->update == false) return false;
+
+    if (watcherP->parameters != NULL
+     && (watcherP->parameters->toSet & LWM2M_ATTR_FLAG_MIN_PERIOD) != 0
+     && watcherP->lastTime + watcherP->parameters->minPeriod > currentTime)
+    {
+        return false;
+    }
+
+    return true;
 }
 
-void observe_step(lwm2m_context_t * contextP,
-                  time_t currentTime,
-                  time_t * timeoutP)
+static void prv_stepObserved(lwm2m_context_t * contextP,
+                             void * userData,
+                             time_t currentTime)
 {
-    lwm2m_observed_t * targetP;
+    lwm2m_observed_t * targetP = (lwm2m_observed_t *)userData;
+    lwm2m_watcher_t * watcherP;
+    lwm2m_data_t * dataP = NULL;
+    lwm2m_data_type_t dataType = LWM2M_TYPE_UNDEFINED;
+    int size = 0;
+    double floatValue = 0;
+    int64_t integerValue = 0;
+    uint64_t unsignedValue = 0;
+    bool storeValue = false;
+    time_t nextTime;
+    bool hasNext;
+#ifdef LWM2M_DATA_ARENA
+    lwm2m_data_arena_t * previousArenaP;
+#endif
 
-    LOG("Entering");
-    for (targetP = contextP->observedList ; targetP != NULL ; targetP = targetP->next)
+    // TODO: handle resource instances
+
+    LOG_URI(&(targetP->uri));
+
+#ifdef LWM2M_DATA_ARENA
+    previousArenaP = lwm2m_data_arena_use(&contextP->dataArena);
+#endif
+
+    // only read the value when a watcher may use it
+    for (watcherP = targetP->watcherList ; watcherP != NULL ; watcherP = watcherP->next)
     {
-        lwm2m_watcher_t * watcherP;
-        uint8_t * buffer = NULL;
-        size_t length = 0;
-        lwm2m_data_t * dataP = NULL;
-        lwm2m_data_type_t dataType = LWM2M_TYPE_UNDEFINED;
-        int size = 0;
-        double floatValue = 0;
-        int64_t integerValue = 0;
-        uint64_t unsignedValue = 0;
-        bool storeValue = false;
-        coap_packet_t message[1];
-        time_t interval;
-
-        // TODO: handle resource instances
+        if (prv_mayNotify(watcherP, currentTime)) break;
+    }
+    if (watcherP == NULL) goto schedule;
 
-        LOG_URI(&(targetP->uri));
-        if (LWM2M_URI_IS_SET_RESOURCE(&targetP->uri))
-        {
-            lwm2m_data_t *valueP;
+    // read once, serialized once per format of the watchers to notify
+    if (COAP_205_CONTENT != object_readData(contextP, &targetP->uri, &size, &dataP)) goto schedule;
+    if (LWM2M_URI_IS_SET_RESOURCE(&targetP->uri))
+    {
+        lwm2m_data_t *valueP;
 
-            if (COAP_205_CONTENT != object_readData(contextP, &targetP->uri, &size, &dataP)) continue;
-            valueP = dataP;
+        valueP = dataP;
 #ifndef LWM2M_VERSION_1_0
-            if (LWM2M_URI_IS_SET_RESOURCE_INSTANCE(&targetP->uri)
-             && dataP->type == LWM2M_TYPE_MULTIPLE_RESOURCE
-             && dataP->value.asChildren.count == 1)
+        if (LWM2M_URI_IS_SET_RESOURCE_INSTANCE(&targetP->uri)
+         && dataP->type == LWM2M_TYPE_MULTIPLE_RESOURCE
+         && dataP->value.asChildren.count == 1)
+        {
+            valueP = dataP->value.asChildren.array;
+        }
+#endif
+        dataType = valueP->type;
+        switch (dataType)
+        {
+        case LWM2M_TYPE_INTEGER:
+            if (1 != lwm2m_data_decode_int(valueP, &integerValue))
             {
-                valueP = dataP->value.asChildren.array;
+                goto schedule;
             }
-#endif
-            dataType = valueP->type;
-            switch (dataType)
+            storeValue = true;
+            break;
+        case LWM2M_TYPE_UNSIGNED_INTEGER:
+            if (1 != lwm2m_data_decode_uint(valueP, &unsignedValue))
             {
-            case LWM2M_TYPE_INTEGER:
-                if (1 != lwm2m_data_decode_int(valueP, &integerValue))
-                {
-                    lwm2m_data_free(size, dataP);
-                    continue;
-                }
-                storeValue = true;
-                break;
-            case LWM2M_TYPE_UNSIGNED_INTEGER:
-                if (1 != lwm2m_data_decode_uint(valueP, &unsignedValue))
-                {
-                    lwm2m_data_free(size, dataP);
-                    continue;
-                }
-                storeValue = true;
-                break;
-            case LWM2M_TYPE_FLOAT:
-                if (1 != lwm2m_data_decode_float(valueP, &floatValue))
-                {
-                    lwm2m_data_free(size, dataP);
-                    continue;
-                }
-                storeValue = true;
-                break;
-            default:
-                break;
+                goto schedule;
+            }
+            storeValue = true;
+            break;
+        case LWM2M_TYPE_FLOAT:
+            if (1 != lwm2m_data_decode_float(valueP, &floatValue))
+            {
+                goto schedule;
             }
+            storeValue = true;
+            break;
+        default:
+            break;
+        }
+    }
+    for (watcherP = targetP->watcherList ; watcherP != NULL ; watcherP = watcherP->next)
+    {
+        if (watcherP->active == true && prv_isCongested(watcherP))
+        {
+            // a pending change stays flagged in watcherP->update
+            prv_deferNotification(watcherP);
+            continue;
         }
-        for (watcherP = targetP->watcherList ; watcherP != NULL ; watcherP = watcherP->next)
+        if (watcherP->active == true)
         {
-            if (watcherP->active == true)
+            bool notify = false;
+
+            if (watcherP->update == true)
             {
-                bool notify = false;
+                // value changed, should we notify the server ?
 
-                if (watcherP->update == true)
+                if (watcherP->parameters == NULL || watcherP->parameters->toSet == 0)
                 {
-                    // value changed, should we notify the server ?
-
-                    if (watcherP->parameters == NULL || watcherP->parameters->toSet == 0)
-                    {
-                        // no conditions
-                        notify = true;
-                        LOG("Notify with no conditions");
-                        LOG_URI(&(targetP->uri));
-                    }
+                    // no conditions
+                    notify = true;
+                    LOG("Notify with no conditions");
+                    LOG_URI(&(targetP->uri));
+                }
 
-                    if (notify == false
-                     && watcherP->parameters != NULL
-                     && (watcherP->parameters->toSet & ATTR_FLAG_NUMERIC) != 0)
+                if (notify == false
+                 && watcherP->parameters != NULL
+                 && (watcherP->parameters->toSet & ATTR_FLAG_NUMERIC) != 0)
+                {
+                    if ((watcherP->parameters->toSet & LWM2M_ATTR_FLAG_LESS_THAN) != 0)
                     {
-                        if ((watcherP->parameters->toSet & LWM2M_ATTR_FLAG_LESS_THAN) != 0)
+                        LOG("Checking lower threshold");
+                        // Did we cross the lower threshold ?
+                        switch (dataType)
                         {
-                            LOG("Checking lower threshold");
-                            // Did we cross the lower threshold ?
-                            switch (dataType)
+                        case LWM2M_TYPE_INTEGER:
+                            if ((integerValue < watcherP->parameters->lessThan
+                              && watcherP->lastValue.asInteger > watcherP->parameters->lessThan)
+                             || (integerValue > watcherP->parameters->lessThan
+                              && watcherP->lastValue.asInteger < watcherP->parameters->lessThan))
                             {
-                            case LWM2M_TYPE_INTEGER:
-                                if ((integerValue < watcherP->parameters->lessThan
-                                  && watcherP->lastValue.asInteger > watcherP->parameters->lessThan)
-                                 || (integerValue > watcherP->parameters->lessThan
-                                  && watcherP->lastValue.asInteger < watcherP->parameters->lessThan))
-                                {
-                                    LOG("Notify on lower threshold crossing");
-                                    notify = true;
-                                }
-                                break;
-                            case LWM2M_TYPE_UNSIGNED_INTEGER:
-                                if ((unsignedValue < watcherP->parameters->lessThan
-                                  && watcherP->lastValue.asUnsigned > watcherP->parameters->lessThan)
-                                 || (unsignedValue > watcherP->parameters->lessThan
-                                  && watcherP->lastValue.asUnsigned < watcherP->parameters->lessThan))
-                                {
-                                    LOG("Notify on lower threshold crossing");
-                                    notify = true;
-                                }
-                                break;
-                            case LWM2M_TYPE_FLOAT:
-                                if ((floatValue < watcherP->parameters->lessThan
-                                  && watcherP->lastValue.asFloat > watcherP->parameters->lessThan)
-                                 || (floatValue > watcherP->parameters->lessThan
-                                  && watcherP->lastValue.asFloat < watcherP->parameters->lessThan))
-                                {
-                                    LOG("Notify on lower threshold crossing");
-                                    notify = true;
-                                }
-                                break;
-                            default:
-                                break;
+                                LOG("Notify on lower threshold crossing");
+                                notify = true;
                             }
-                        }
-                        if ((watcherP->parameters->toSet & LWM2M_ATTR_FLAG_GREATER_THAN) != 0)
-                        {
-                            LOG("Checking upper threshold");
-                            // Did we cross the upper threshold ?
-                            switch (dataType)
+                            break;
+                        case LWM2M_TYPE_UNSIGNED_INTEGER:
+                            if ((unsignedValue < watcherP->parameters->lessThan
+                              && watcherP->lastValue.asUnsigned > watcherP->parameters->lessThan)
+                             || (unsignedValue > watcherP->parameters->lessThan
+                              && watcherP->lastValue.asUnsigned < watcherP->parameters->lessThan))
+                            {
+                                LOG("Notify on lower threshold crossing");
+                                notify = true;
+                            }
+                            break;
+                        case LWM2M_TYPE_FLOAT:
+                            if ((floatValue < watcherP->parameters->lessThan
+                              && watcherP->lastValue.asFloat > watcherP->parameters->lessThan)
+                             || (floatValue > watcherP->parameters->lessThan
+                              && watcherP->lastValue.asFloat < watcherP->parameters->lessThan))
                             {
-                            case LWM2M_TYPE_INTEGER:
-                                if ((integerValue < watcherP->parameters->greaterThan
-                                  && watcherP->lastValue.asInteger > watcherP->parameters->greaterThan)
-                                 || (integerValue > watcherP->parameters->greaterThan
-                                  && watcherP->lastValue.asInteger < watcherP->parameters->greaterThan))
-                                {
-                                    LOG("Notify on lower upper crossing");
-                                    notify = true;
-                                }
-                                break;
-                            case LWM2M_TYPE_UNSIGNED_INTEGER:
-                                if ((unsignedValue < watcherP->parameters->greaterThan
-                                  && watcherP->lastValue.asUnsigned > watcherP->parameters->greaterThan)
-                                 || (unsignedValue > watcherP->parameters->greaterThan
-                                  && watcherP->lastValue.asUnsigned < watcherP->parameters->greaterThan))
-                                {
-                                    LOG("Notify on lower upper crossing");
-                                    notify = true;
-                                }
-                                break;
-                            case LWM2M_TYPE_FLOAT:
-                                if ((floatValue < watcherP->parameters->greaterThan
-                                  && watcherP->lastValue.asFloat > watcherP->parameters->greaterThan)
-                                 || (floatValue > watcherP->parameters->greaterThan
-                                  && watcherP->lastValue.asFloat < watcherP->parameters->greaterThan))
-                                {
-                                    LOG("Notify on lower upper crossing");
-                                    notify = true;
-                                }
-                                break;
-                            default:
-                                break;
+                                LOG("Notify on lower threshold crossing");
+                                notify = true;
                             }
+                            break;
+                        default:
+                            break;
                         }
-                        if ((watcherP->parameters->toSet & LWM2M_ATTR_FLAG_STEP) != 0)
+                    }
+                    if ((watcherP->parameters->toSet & LWM2M_ATTR_FLAG_GREATER_THAN) != 0)
+                    {
+                        LOG("Checking upper threshold");
+                        // Did we cross the upper threshold ?
+                        switch (dataType)
                         {
-                            LOG("Checking step");
-
-                            switch (dataType)
+                        case LWM2M_TYPE_INTEGER:
+                            if ((integerValue < watcherP->parameters->greaterThan
+                              && watcherP->lastValue.asInteger > watcherP->parameters->greaterThan)
+                             || (integerValue > watcherP->parameters->greaterThan
+                              && watcherP->lastValue.asInteger < watcherP->parameters->greaterThan))
                             {
-                            case LWM2M_TYPE_INTEGER:
-                            {
-                                int64_t diff;
-
-                                diff = integerValue - watcherP->lastValue.asInteger;
-                                if ((diff < 0 && (0 - diff) >= watcherP->parameters->step)
-                                 || (diff >= 0 && diff >= watcherP->parameters->step))
-                                {
-                                    LOG("Notify on step condition");
-                                    notify = true;
-                                }
+                                LOG("Notify on lower upper crossing");
+                                notify = true;
                             }
-                                break;
-                            case LWM2M_TYPE_UNSIGNED_INTEGER:
+                            break;
+                        case LWM2M_TYPE_UNSIGNED_INTEGER:
+                            if ((unsignedValue < watcherP->parameters->greaterThan
+                              && watcherP->lastValue.asUnsigned > watcherP->parameters->greaterThan)
+                             || (unsignedValue > watcherP->parameters->greaterThan
+                              && watcherP->lastValue.asUnsigned < watcherP->parameters->greaterThan))
                             {
-                                uint64_t diff;
-
-                                if (unsignedValue >= watcherP->lastValue.asUnsigned)
-                                {
-                                    diff = unsignedValue - watcherP->lastValue.asUnsigned;
-                                }
-                                else
-                                {
-                                    diff = watcherP->lastValue.asUnsigned - unsignedValue;
-                                }
-                                if (diff >= watcherP->parameters->step)
-                                {
-                                    LOG("Notify on step condition");
-                                    notify = true;
-                                }
+                                LOG("Notify on lower upper crossing");
+                                notify = true;
                             }
-                                break;
-                            case LWM2M_TYPE_FLOAT:
+                            break;
+                        case LWM2M_TYPE_FLOAT:
+                            if ((floatValue < watcherP->parameters->greaterThan
+                              && watcherP->lastValue.asFloat > watcherP->parameters->greaterThan)
+                             || (floatValue > watcherP->parameters->greaterThan
+                              && watcherP->lastValue.asFloat < watcherP->parameters->greaterThan))
                             {
-                                double diff;
-
-                                diff = floatValue - watcherP->lastValue.asFloat;
-                                if ((diff < 0 && (0 - diff) >= watcherP->parameters->step)
-                                 || (diff >= 0 && diff >= watcherP->parameters->step))
-                                {
-                                    LOG("Notify on step condition");
-                                    notify = true;
-                                }
-                            }
-                                break;
-                            default:
-                                break;
+                                LOG("Notify on lower upper crossing");
+                                notify = true;
                             }
+                            break;
+                        default:
+                            break;
                         }
                     }
-
-                    if (watcherP->parameters != NULL
-                     && (watcherP->parameters->toSet & LWM2M_ATTR_FLAG_MIN_PERIOD) != 0)
+                    if ((watcherP->parameters->toSet & LWM2M_ATTR_FLAG_STEP) != 0)
                     {
-                        LOG_ARG("Checking minimal period (%d s)", watcherP->parameters->minPeriod);
+                        LOG("Checking step");
 
-                        if (watcherP->lastTime + watcherP->parameters->minPeriod > currentTime)
+                        switch (dataType)
                         {
-                            // Minimum Period did not elapse yet
-                            interval = watcherP->lastTime + watcherP->parameters->minPeriod - currentTime;
-                            if (*timeoutP > interval) *timeoutP = interval;
-                            notify = false;
-                        }
-                        else
+                        case LWM2M_TYPE_INTEGER:
                         {
-                            LOG("Notify on minimal period");
-                            notify = true;
-                        }
-                    }
-                }
-
-                // Is the Maximum Period reached ?
-                if (notify == false
-                 && watcherP->parameters != NULL
-                 && (watcherP->parameters->toSet & LWM2M_ATTR_FLAG_MAX_PERIOD) != 0)
-                {
-                    LOG_ARG("Checking maximal period (%d s)", watcherP->parameters->maxPeriod);
-
-                    if (watcherP->lastTime + watcherP->parameters->maxPeriod <= currentTime)
-                    {
-                        LOG("Notify on maximal period");
-                        notify = true;
-                    }
-                }
+                            int64_t diff;
 
-                if (notify == true)
-                {
-                    if (buffer == NULL)
-                    {
-                        if (dataP != NULL)
+                            diff = integerValue - watcherP->lastValue.asInteger;
+                            if ((diff < 0 && (0 - diff) >= watcherP->parameters->step)
+                             || (diff >= 0 && diff >= watcherP->parameters->step))
+                            {
+                                LOG("Notify on step condition");
+                                notify = true;
+                            }
+                        }
+                            break;
+                        case LWM2M_TYPE_UNSIGNED_INTEGER:
                         {
-                            int res;
+                            uint64_t diff;
 
-                            res = lwm2m_data_serialize(&targetP->uri, size, dataP, &(watcherP->format), &buffer);
-                            if (res < 0)
+                            if (unsignedValue >= watcherP->lastValue.asUnsigned)
                             {
-                                break;
+                                diff = unsignedValue - watcherP->lastValue.asUnsigned;
                             }
                             else
                             {
-                                length = (size_t)res;
+                                diff = watcherP->lastValue.asUnsigned - unsignedValue;
+                            }
+                            if (diff >= watcherP->parameters->step)
+                            {
+                                LOG("Notify on step condition");
+                                notify = true;
                             }
-
                         }
-                        else
+                            break;
+                        case LWM2M_TYPE_FLOAT:
                         {
-                            if (COAP_205_CONTENT != object_read(contextP, &targetP->uri, NULL, 0, &(watcherP->format), &buffer, &length))
+                            double diff;
+
+                            diff = floatValue - watcherP->lastValue.asFloat;
+                            if ((diff < 0 && (0 - diff) >= watcherP->parameters->step)
+                             || (diff >= 0 && diff >= watcherP->parameters->step))
                             {
-                                buffer = NULL;
-                                break;
+                                LOG("Notify on step condition");
+                                notify = true;
                             }
                         }
-                        coap_init_message(message, COAP_TYPE_NON, COAP_205_CONTENT, 0);
-                        coap_set_header_content_type(message, watcherP->format);
-                        coap_set_payload(message, buffer, length);
+                            break;
+                        default:
+                            break;
+                        }
                     }
-                    watcherP->lastTime = currentTime;
-                    watcherP->lastMid = contextP->nextMID++;
-                    message->mid = watcherP->lastMid;
-                    coap_set_header_token(message, watcherP->token, watcherP->tokenLen);
-                    coap_set_header_observe(message, watcherP->counter++);
-                    (void)message_send(contextP, message, watcherP->server->sessionH);
-                    watcherP->update = false;
                 }
 
-                // Store this value
-                if (notify == true && storeValue == true)
+                if (watcherP->parameters != NULL
+                 && (watcherP->parameters->toSet & LWM2M_ATTR_FLAG_MIN_PERIOD) != 0)
                 {
-                    switch (dataType)
+                    LOG_ARG("Checking minimal period (%d s)", watcherP->parameters->minPeriod);
+
+                    if (watcherP->lastTime + watcherP->parameters->minPeriod > currentTime)
                     {
-                    case LWM2M_TYPE_INTEGER:
-                        watcherP->lastValue.asInteger = integerValue;
-                        break;
-                    case LWM2M_TYPE_UNSIGNED_INTEGER:
-                        watcherP->lastValue.asUnsigned = unsignedValue;
-                        break;
-                    case LWM2M_TYPE_FLOAT:
-                        watcherP->lastValue.asFloat = floatValue;
-                        break;
-                    default:
-                        break;
+                        // Minimum Period did not elapse yet
+                        notify = false;
+                    }
+                    else
+                    {
+                        LOG("Notify on minimal period");
+                        notify = true;
                     }
                 }
+            }
+
+            // Is the Maximum Period reached ?
+            if (notify == false
+             && watcherP->parameters != NULL
+             && (watcherP->parameters->toSet & LWM2M_ATTR_FLAG_MAX_PERIOD) != 0)
+            {
+                LOG_ARG("Checking maximal period (%d s)", watcherP->parameters->maxPeriod);
+
+                if (watcherP->lastTime + watcherP->parameters->maxPeriod <= currentTime)
+                {
+                    LOG("Notify on maximal period");
+                    notify = true;
+                }
+            }
+
+            if (notify == true)
+            {
+                watcherP->lastTime = currentTime;
+                watcherP->update = false;
+                watcherP->notify = true;
+            }
 
-                if (watcherP->parameters != NULL && (watcherP->parameters->toSet & LWM2M_ATTR_FLAG_MAX_PERIOD) != 0)
+            // Store this value
+            if (notify == true && storeValue == true)
+            {
+                switch (dataType)
                 {
-                    // update timers
-                    interval = watcherP->lastTime + watcherP->parameters->maxPeriod - currentTime;
-                    if (*timeoutP > interval) *timeoutP = interval;
+                case LWM2M_TYPE_INTEGER:
+                    watcherP->lastValue.asInteger = integerValue;
+                    break;
+                case LWM2M_TYPE_UNSIGNED_INTEGER:
+                    watcherP->lastValue.asUnsigned = unsignedValue;
+                    break;
+                case LWM2M_TYPE_FLOAT:
+                    watcherP->lastValue.asFloat = floatValue;
+                    break;
+                default:
+                    break;
                 }
             }
+
+        }
+    }
+
+    // each format is serialized once in the transmit buffer and sent to all the watchers using it
+    for (watcherP = targetP->watcherList ; watcherP != NULL ; watcherP = watcherP->next)
+    {
+        lwm2m_watcher_t * otherP;
+        lwm2m_media_type_t requested;
+        lwm2m_media_type_t format;
+        int length;
+
+        if (watcherP->notify == false) continue;
+
+        requested = watcherP->format;
+        format = requested;
+        length = message_serialize_notification(contextP, &targetP->uri, size, dataP, &format);
+        for (otherP = watcherP ; otherP != NULL ; otherP = otherP->next)
+        {
+            if (otherP->notify == false || otherP->format != requested) continue;
+
+            otherP->notify = false;
+            if (length < 0) continue;
+            otherP->format = format;
+            if (otherP->server->queueSleeping)
+            {
+                prv_queueNotification(contextP, otherP, format, (size_t)length);
+                continue;
+            }
+            otherP->lastMid = contextP->nextMID++;
+            if (otherP->server->confirmNotifications)
+            {
+                prv_sendConfirmable(contextP, otherP, format, (size_t)length);
+            }
+            else
+            {
+                (void)message_send_notification(contextP, otherP->server->sessionH, otherP->lastMid,
+                                                otherP->token, otherP->tokenLen, otherP->counter++, format,
+                                                (size_t)length);
+            }
+            registration_keepAwake(otherP->server, currentTime);
+        }
+    }
+
+schedule:
+    if (dataP != NULL) lwm2m_data_free(size, dataP);
+#ifdef LWM2M_DATA_ARENA
+    lwm2m_data_arena_use(previousArenaP);
+    if (previousArenaP != &contextP->dataArena) lwm2m_data_arena_reset(&contextP->dataArena);
+#endif
+
+    // wake up again at the next minimal period of a pending change or at the next maximal period
+    nextTime = 0;
+    hasNext = false;
+    for (watcherP = targetP->watcherList ; watcherP != NULL ; watcherP = watcherP->next)
+    {
+        if (watcherP->active == true && prv_isCongested(watcherP))
+        {
+            // woken up by prv_resumeNotifications() instead
+            prv_deferNotification(watcherP);
+        }
+        else if (watcherP->active == true && watcherP->parameters != NULL)
+        {
+            if ((watcherP->parameters->toSet & LWM2M_ATTR_FLAG_MAX_PERIOD) != 0
+             && (!hasNext || watcherP->lastTime + watcherP->parameters->maxPeriod < nextTime))
+            {
+                nextTime = watcherP->lastTime + watcherP->parameters->maxPeriod;
+                hasNext = true;
+            }
+            if (watcherP->update == true
+             && (watcherP->parameters->toSet & LWM2M_ATTR_FLAG_MIN_PERIOD) != 0
+             && (!hasNext || watcherP->lastTime + watcherP->parameters->minPeriod < nextTime))
+            {
+                nextTime = watcherP->lastTime + watcherP->parameters->minPeriod;
+                hasNext = true;
+            }
         }
-        if (dataP != NULL) lwm2m_data_free(size, dataP);
-        if (buffer != NULL) lwm2m_free(buffer);
     }
+    if (hasNext)
+    {
+        scheduler_add(contextP, &targetP->timer, nextTime);
+    }
+}
+
+void observe_step(lwm2m_context_t * contextP,
+                  time_t currentTime,
+                  time_t * timeoutP)
+{
+    lwm2m_observed_t * dirtyList;
+
+    LOG("Entering");
+
+    // URIs marked while checking the watchers wait for the next step
+    dirtyList = contextP->observedDirtyList;
+    contextP->observedDirtyList = NULL;
+    while (dirtyList != NULL)
+    {
+        lwm2m_observed_t * targetP = dirtyList;
+
+        dirtyList = targetP->nextDirty;
+        targetP->nextDirty = NULL;
+        targetP->dirty = false;
+        prv_stepObserved(contextP, targetP, currentTime);
+    }
+
+    if (contextP->observedDirtyList != NULL) *timeoutP = 0;
 }
 
 #endif
@@ -909,8 +1470,7 @@ static void prv_obsRequestCallback(lwm2m_context_t * contextP,
 
     (void)contextP; /* unused */
 
-    clientP = (lwm2m_client_t *)lwm2m_list_find((lwm2m_list_t *)observationData->contextP->clientList,
-                                                observationData->client);
+    clientP = utils_findClientById(observationData->contextP, observationData->client);
     if (clientP == NULL) {
         // No client matching this notification, inform request callback with an error code.
         observationData->callback(contextP, observationData->client, &observationData->uri,
@@ -1032,8 +1592,7 @@ static void prv_obsCancelRequestCallback(lwm2m_context_t * contextP,
 
     (void)contextP; /* unused */
 
-    lwm2m_client_t *clientP =
-        (lwm2m_client_t *)lwm2m_list_find((lwm2m_list_t *)cancelP->contextP->clientList, cancelP->client);
+    lwm2m_client_t *clientP = utils_findClientById(cancelP->contextP, cancelP->client);
     if (clientP == NULL)
     {
         cancelP->callbackP(contextP, cancelP->client, &cancelP->uri,
@@ -1123,7 +1682,7 @@ int prv_lwm2m_observe(lwm2m_context_t * contextP,
 
     if (!LWM2M_URI_IS_SET_INSTANCE(uriP) && LWM2M_URI_IS_SET_RESOURCE(uriP)) return COAP_400_BAD_REQUEST;
 
-    clientP = (lwm2m_client_t *)lwm2m_list_find((lwm2m_list_t *)contextP->clientList, clientID);
+    clientP = utils_findClientById(contextP, clientID);
     if (clientP == NULL) return COAP_404_NOT_FOUND;
 
     observationP = prv_findObservationByURI(clientP, uriP);
@@ -1168,7 +1727,7 @@ int prv_lwm2m_observe(lwm2m_context_t * contextP,
     transactionP->callback = prv_obsRequestCallback;
     transactionP->userData = (void *)observationData;
 
-    contextP->transactionList = (lwm2m_transaction_t *)LWM2M_LIST_ADD(contextP->transactionList, transactionP);
+    transaction_add(contextP, transactionP);
 
     // update the user latest intention
     if(observationP) observationP->status = STATE_REG_PENDING;
@@ -1209,7 +1768,7 @@ int prv_lwm2m_observe_cancel(lwm2m_context_t * contextP,
     LOG_ARG("clientID: %d", clientID);
     LOG_URI(uriP);
 
-    clientP = (lwm2m_client_t *)lwm2m_list_find((lwm2m_list_t *)contextP->clientList, clientID);
+    clientP = utils_findClientById(contextP, clientID);
     if (clientP == NULL) return COAP_404_NOT_FOUND;
 
     observationP = prv_findObservationByURI(clientP, uriP);
@@ -1252,7 +1811,7 @@ int prv_lwm2m_observe_cancel(lwm2m_context_t * contextP,
         transactionP->callback = prv_obsCancelRequestCallback;
         transactionP->userData = (void *)cancelP;
 
-        contextP->transactionList = (lwm2m_transaction_t *)LWM2M_LIST_ADD(contextP->transactionList, transactionP);
+        transaction_add(contextP, transactionP);
 
         observationP->status = STATE_DEREG_PENDING;
 
@@ -1311,7 +1870,7 @@ bool observe_handleNotify(lwm2m_context_t * contextP,
     clientID = (tokenP[0] << 8) | tokenP[1];
     obsID = (tokenP[2] << 8) | tokenP[3];
 
-    clientP = (lwm2m_client_t *)lwm2m_list_find((lwm2m_list_t *)contextP->clientList, clientID);
+    clientP = utils_findClientById(contextP, clientID);
     if (clientP == NULL) return false;
 
     observationP = (lwm2m_observation_t *)lwm2m_list_find((lwm2m_list_t *)clientP->observationList, obsID);
@@ -125,6 +125,22 @@ bool lwm2m_set_coap_block_size(const uint16_t coap_block_size_arg) {
 
 uint16_t lwm2m_get_coap_block_size() { return coap_block_size; }
 
+bool lwm2m_context_set_coap_block_size(lwm2m_context_t * contextP, const uint16_t coap_block_size_arg) {
+    if (validate_block_size(coap_block_size_arg)) {
+        contextP->coapBlockSize = coap_block_size_arg;
+        return true;
+    }
+    return false;
+}
+
+uint16_t lwm2m_context_get_coap_block_size(lwm2m_context_t * contextP) { return contextP->coapBlockSize; }
+
+void lwm2m_context_set_max_block_transfer_size(lwm2m_context_t * contextP, size_t size) {
+    contextP->maxBlockTransferSize = size;
+}
+
+size_t lwm2m_context_get_max_block_transfer_size(lwm2m_context_t * contextP) { return contextP->maxBlockTransferSize; }
+
 static void handle_reset(lwm2m_context_t * contextP,
                          void * fromSessionH,
                          coap_packet_t * message)
@@ -135,6 +151,75 @@ static void handle_reset(lwm2m_context_t * contextP,
 #endif
 }
 
+#if defined(LWM2M_CLIENT_MODE) && !defined(LWM2M_RAW_BLOCK1_REQUESTS)
+// the blocks of a streamed write are not buffered but handed over to the object by dm_handleRequest()
+static bool prv_isBlock1Streamed(lwm2m_context_t * contextP,
+                                 void * fromSessionH,
+                                 coap_packet_t * message)
+{
+    lwm2m_server_t * serverP;
+    lwm2m_uri_t uri;
+
+    serverP = utils_findServer(contextP, fromSessionH);
+    if (NULL == serverP) return false;
+    if (LWM2M_REQUEST_TYPE_DM != uri_decode(contextP->altPath, message->uri_path, message->code, &uri)) return false;
+
+    return object_isBlock1Streamed(contextP, serverP, &uri, message);
+}
+#endif
+
+#ifdef LWM2M_CLIENT_MODE
+// the Accept option of a read is part of the key of its cached representation
+static uint16_t prv_readAccept(coap_packet_t * message)
+{
+    return message->accept_num == 0 ? UINT16_MAX : message->accept[0];
+}
+
+// answers the next blocks of a read from the representation cached for the server, returns NULL if not cached
+static lwm2m_block_data_t * prv_getCachedRead(lwm2m_server_t * serverP,
+                                              coap_packet_t * message,
+                                              coap_packet_t * response)
+{
+    lwm2m_block_data_t * cacheP;
+    char * uri;
+
+    // the first block reads the representation again
+    if (!IS_OPTION(message, COAP_OPTION_BLOCK2) || message->block2_num == 0) return NULL;
+    if (IS_OPTION(message, COAP_OPTION_OBSERVE)) return NULL;
+
+    uri = coap_get_packet_uri_as_string(message);
+    if (uri == NULL) return NULL;
+    cacheP = block2_cache_find(&serverP->blockData, uri, prv_readAccept(message), lwm2m_gettime());
+    lwm2m_free(uri);
+    if (cacheP == NULL) return NULL;
+
+    LOG_ARG("Blockwise: block %u served from the cached representation", message->block2_num);
+    coap_set_header_content_type(response, cacheP->format);
+    coap_set_payload(response, cacheP->blockBuffer, cacheP->blockBufferSize);
+    return cacheP;
+}
+
+// keeps the representation of a read whose response does not fit in one block, returns NULL on failure
+static lwm2m_block_data_t * prv_cacheRead(lwm2m_context_t * contextP,
+                                          lwm2m_server_t * serverP,
+                                          coap_packet_t * message,
+                                          coap_packet_t * response,
+                                          uint8_t * payload,
+                                          size_t length)
+{
+    lwm2m_block_data_t * cacheP;
+    char * uri;
+
+    uri = coap_get_packet_uri_as_string(message);
+    if (uri == NULL) return NULL;
+    cacheP = block2_cache_store(&serverP->blockData, uri, prv_readAccept(message), (uint16_t)response->content_type,
+                                payload, length, contextP->nextETag++, lwm2m_gettime());
+    lwm2m_free(uri);
+
+    return cacheP;
+}
+#endif
+
 static uint8_t handle_request(lwm2m_context_t * contextP,
                               void * fromSessionH,
                               coap_packet_t * message,
@@ -219,113 +304,115 @@ static uint8_t handle_request(lwm2m_context_t * contextP,
     return result;
 }
 
-static lwm2m_transaction_t * prv_get_transaction(lwm2m_context_t * contextP, void * sessionH, uint16_t mid)
+static void prv_copy_multi_option(multi_option_t ** dstP, multi_option_t * srcP)
 {
-    lwm2m_transaction_t * transaction;
-
-    transaction = contextP->transactionList;
-    while (transaction != NULL
-           && lwm2m_session_is_equal(sessionH, transaction->peerH, contextP->userData) == false
-           && transaction->mID != mid)
+    // the parsed options live in the option pool of the parsed packet, the clone gets its own
+    for ( ; srcP != NULL ; srcP = srcP->next)
     {
-        transaction = transaction->next;
+        coap_add_multi_option(dstP, srcP->data, srcP->len, 0);
     }
-    return transaction;
 }
 
 // limited clone of transaction to be used by block transfers
+// The string options point in the buffer of the transaction, the clone must be sent before it is freed.
 static lwm2m_transaction_t * prv_create_next_block_transaction(lwm2m_transaction_t * transaction, uint16_t nextMID){
-    static coap_packet_t message[1];
+    coap_packet_t message[1];
+    coap_packet_t * cloneMessage;
     if (0 != coap_parse_message(message, transaction->buffer, transaction->buffer_len)){
         return NULL;
     }
 
     lwm2m_transaction_t * clone = transaction_new(transaction->peerH, (coap_method_t) message->code, NULL, NULL, nextMID, message->token_len, message->token);
-    if (clone == NULL) return NULL;
+    if (clone == NULL)
+    {
+        coap_free_header(message);
+        return NULL;
+    }
+    cloneMessage = (coap_packet_t *)clone->message;
 
-    coap_set_header_content_type(clone->message, message->type);
+    coap_set_header_content_type(cloneMessage, message->type);
 
-    if (message->proxy_uri != NULL)
+    if (IS_OPTION(message, COAP_OPTION_PROXY_URI))
     {
-        char  str[message->proxy_uri_len + 1];
-        str[message->proxy_uri_len] = '\0';
-        memcpy(str, message->proxy_uri, message->proxy_uri_len);
-        coap_set_header_proxy_uri(clone->message, str);
+        cloneMessage->proxy_uri = message->proxy_uri;
+        cloneMessage->proxy_uri_len = message->proxy_uri_len;
+        SET_OPTION(cloneMessage, COAP_OPTION_PROXY_URI);
     }
 
     if (IS_OPTION(message, COAP_OPTION_ETAG))
     {
-        coap_set_header_etag(clone->message, message->etag, message->etag_len);
+        coap_set_header_etag(cloneMessage, message->etag, message->etag_len);
     }
 
-    if (message->uri_host != NULL)
+    if (IS_OPTION(message, COAP_OPTION_URI_HOST))
     {
-        char  str[message->uri_host_len + 1];
-        str[message->uri_host_len] = '\0';
-        memcpy(str, message->uri_host, message->uri_host_len);
-        coap_set_header_uri_host(clone->message, str);
+        cloneMessage->uri_host = message->uri_host;
+        cloneMessage->uri_host_len = message->uri_host_len;
+        SET_OPTION(cloneMessage, COAP_OPTION_URI_HOST);
     }
 
     if (IS_OPTION(message, COAP_OPTION_URI_PORT))
     {
-        coap_set_header_uri_port(clone->message, message->uri_port);
+        coap_set_header_uri_port(cloneMessage, message->uri_port);
     }
 
     if(IS_OPTION(message, COAP_OPTION_LOCATION_PATH))
     {
-        ((coap_packet_t *)clone->message)->location_path = message->location_path;
-        SET_OPTION((coap_packet_t *)clone->message, COAP_OPTION_LOCATION_PATH);
+        prv_copy_multi_option(&cloneMessage->location_path, message->location_path);
+        SET_OPTION(cloneMessage, COAP_OPTION_LOCATION_PATH);
     }
     
-    if (message->location_query != NULL)
+    if (IS_OPTION(message, COAP_OPTION_LOCATION_QUERY))
     {
-        char  str[message->location_query_len + 1];
-        str[message->location_query_len] = '\0';
-        memcpy(str, message->location_query, message->location_query_len);
-        coap_set_header_location_query(clone->message, str);
+        cloneMessage->location_query = message->location_query;
+        cloneMessage->location_query_len = message->location_query_len;
+        SET_OPTION(cloneMessage, COAP_OPTION_LOCATION_QUERY);
     }
 
     if(IS_OPTION(message, COAP_OPTION_CONTENT_TYPE))
     {
-        ((coap_packet_t *)clone->message)->content_type = message->content_type;
-        SET_OPTION((coap_packet_t *)clone->message, COAP_OPTION_CONTENT_TYPE);
+        cloneMessage->content_type = message->content_type;
+        SET_OPTION(cloneMessage, COAP_OPTION_CONTENT_TYPE);
     }
   
     if(IS_OPTION(message, COAP_OPTION_URI_PATH))
     {
-        ((coap_packet_t *)clone->message)->uri_path = message->uri_path;
-        SET_OPTION((coap_packet_t *)clone->message, COAP_OPTION_URI_PATH);
+        prv_copy_multi_option(&cloneMessage->uri_path, message->uri_path);
+        SET_OPTION(cloneMessage, COAP_OPTION_URI_PATH);
     }
 
     if (IS_OPTION(message, COAP_OPTION_OBSERVE))
     {
-        coap_set_header_observe(clone->message, message->observe);
+        coap_set_header_observe(cloneMessage, message->observe);
     }
     
     for (int i = 0; i < message->accept_num; i++) {
-        coap_set_header_accept(clone->message, message->accept[i]);
+        coap_set_header_accept(cloneMessage, message->accept[i]);
     }
 
     if (IS_OPTION(message, COAP_OPTION_IF_MATCH))
     {
-        coap_set_header_if_match(clone->message, message->if_match, message->if_match_len);
+        coap_set_header_if_match(cloneMessage, message->if_match, message->if_match_len);
     }
 
     if(IS_OPTION(message, COAP_OPTION_URI_QUERY))
     {
-        ((coap_packet_t *)clone->message)->uri_query = message->uri_query;
-        SET_OPTION((coap_packet_t *)clone->message, COAP_OPTION_URI_QUERY);
+        prv_copy_multi_option(&cloneMessage->uri_query, message->uri_query);
+        SET_OPTION(cloneMessage, COAP_OPTION_URI_QUERY);
     }
 
     if (IS_OPTION(message, COAP_OPTION_IF_NONE_MATCH))
     {
-        coap_set_header_if_none_match(clone->message);
+        coap_set_header_if_none_match(cloneMessage);
     }
+    coap_free_header(message);
     
     clone->payload = transaction->payload;
     clone->payload_len = transaction->payload_len;
     clone->callback = transaction->callback;
     clone->userData = transaction->userData;
+    clone->userDataShared = true;
+    transaction->userDataShared = true;
     return clone;
 }
 static int prv_send_new_block1(lwm2m_context_t * contextP, lwm2m_transaction_t * previous, uint32_t block_num, uint16_t block_size)
@@ -338,9 +425,10 @@ static int prv_send_new_block1(lwm2m_context_t * contextP, lwm2m_transaction_t *
     if (next == NULL) return COAP_500_INTERNAL_SERVER_ERROR;
 
     coap_set_header_block1(next->message, block_num, (block_num + 1) * block_size < next->payload_len, block_size);
+    if (block_num == 0) coap_set_header_size1(next->message, next->payload_len);
     coap_set_payload(next->message, next->payload + block_num * block_size , MIN(block_size, next->payload_len - block_num * block_size));
 
-    contextP->transactionList = (lwm2m_transaction_t *)LWM2M_LIST_ADD(contextP->transactionList, next);
+    transaction_add(contextP, next);
     return transaction_send(contextP, next);
 }
 
@@ -350,7 +438,7 @@ static int prv_send_next_block1(lwm2m_context_t * contextP, void * sessionH, uin
     coap_packet_t * message;
     uint32_t block_num;
     
-    transaction = prv_get_transaction(contextP, sessionH, mid);
+    transaction = transaction_find(contextP, sessionH, mid);
     if(transaction == NULL) return COAP_500_INTERNAL_SERVER_ERROR;
 
     message = (coap_packet_t *) transaction->message;
@@ -374,13 +462,14 @@ static int prv_change_to_block1(lwm2m_context_t * contextP, void * sessionH, uin
     lwm2m_transaction_t * transaction;
     uint16_t block_size = 16;
     
-    transaction = prv_get_transaction(contextP, sessionH, mid);
+    transaction = transaction_find(contextP, sessionH, mid);
+    if(transaction == NULL) return COAP_500_INTERNAL_SERVER_ERROR;
 
     for (int n = 1; 16 << n <= (int)size ; n++) {
         block_size = 16 << n;
     }
 
-    block_size = MIN(block_size, lwm2m_get_coap_block_size());
+    block_size = MIN(block_size, contextP->coapBlockSize);
 
     return prv_send_new_block1(contextP, transaction, 0, block_size);
 }
@@ -392,7 +481,7 @@ static int prv_retry_block1(lwm2m_context_t * contextP, void * sessionH, uint16_
     coap_packet_t * message;
     uint32_t block_num;
     
-    transaction = prv_get_transaction(contextP, sessionH, mid);
+    transaction = transaction_find(contextP, sessionH, mid);
     if(transaction == NULL) return COAP_500_INTERNAL_SERVER_ERROR;
 
     message = (coap_packet_t *) transaction->message;
@@ -425,7 +514,7 @@ static int prv_send_get_block2(lwm2m_context_t * contextP,
     uint16_t nextMID;
     
     // get current transaction
-    transaction = prv_get_transaction(contextP, sessionH, currentMID);
+    transaction = transaction_find(contextP, sessionH, currentMID);
     if(transaction == NULL) return COAP_500_INTERNAL_SERVER_ERROR;
 
     // Are we retrying something that already is a block 2 request?
@@ -438,12 +527,12 @@ static int prv_send_get_block2(lwm2m_context_t * contextP,
     if (next == NULL) return COAP_500_INTERNAL_SERVER_ERROR;
 
     // set block2 header
-    coap_set_header_block2(next->message, block2_num, 0, MIN(block2_size, lwm2m_get_coap_block_size()));
+    coap_set_header_block2(next->message, block2_num, 0, MIN(block2_size, contextP->coapBlockSize));
 
     //  update block2data to nect expected mid
     coap_block2_set_expected_mid(blockDataHead, currentMID, nextMID);
 
-    contextP->transactionList = (lwm2m_transaction_t *)LWM2M_LIST_ADD(contextP->transactionList, next);
+    transaction_add(contextP, next);
     return transaction_send(contextP, next);
 }
 
@@ -469,21 +558,36 @@ void lwm2m_handle_packet(lwm2m_context_t * contextP,
                          void * fromSessionH)
 {
     uint8_t coap_error_code = NO_ERROR;
-    static coap_packet_t message[1];
-    static coap_packet_t response[1];
+    coap_packet_t message[1];
+    coap_packet_t response[1];
+#ifdef LWM2M_CLIENT_MODE
+    lwm2m_server_t * fromServerP;
+#endif
 
     LOG("Entering");
     coap_error_code = coap_parse_message(message, buffer, (uint16_t)length);
     if (coap_error_code == NO_ERROR)
     {
+#ifdef LWM2M_CLIENT_MODE
+        // a server in queue mode can reach the client for a while after any exchange
+        fromServerP = utils_findServer(contextP, fromSessionH);
+        if (fromServerP != NULL) registration_keepAwake(fromServerP, lwm2m_gettime());
+#endif
         LOG_ARG("Parsed: ver %u, type %u, tkl %u, code %u.%.2u, mid %u, Content type: %d",
                 message->version, message->type, message->token_len, message->code >> 5, message->code & 0x1F, message->mid, message->content_type);
-        LOG_ARG("Payload: %.*s", message->payload_len, STR_NULL2EMPTY(message->payload));
+        LOG_ARG("Payload: %.*s", (int)message->payload_len, STR_NULL2EMPTY(message->payload));
         if (message->code >= COAP_GET && message->code <= COAP_DELETE)
         {
             uint32_t block_num = 0;
-            uint16_t block_size = lwm2m_get_coap_block_size();
+            uint16_t block_size = contextP->coapBlockSize;
             uint32_t block_offset = 0;
+#ifdef LWM2M_CLIENT_MODE
+            lwm2m_server_t * serverP = NULL;
+            lwm2m_block_data_t * cacheP = NULL;
+
+            // large reads are sent block-wise from a cached representation
+            if (message->code == COAP_GET) serverP = fromServerP;
+#endif
 
             /* prepare response */
             if (message->type == COAP_TYPE_CON)
@@ -503,16 +607,16 @@ void lwm2m_handle_packet(lwm2m_context_t * contextP,
                 coap_set_header_token(response, message->token, message->token_len);
             }
 
-            if (message->payload_len > lwm2m_get_coap_block_size()) {
+            if (message->payload_len > contextP->coapBlockSize) {
                 coap_error_code = COAP_413_ENTITY_TOO_LARGE;
 
                 if (IS_OPTION(message, COAP_OPTION_BLOCK1)){
                     uint32_t block1_num;
                     uint8_t  block1_more;
                     coap_get_header_block1(message, &block1_num, &block1_more, NULL, NULL);
-                    coap_set_header_block1(response, block1_num, block1_more, lwm2m_get_coap_block_size());
+                    coap_set_header_block1(response, block1_num, block1_more, contextP->coapBlockSize);
                 } else {
-                    coap_set_header_block1(response, 0, 1, lwm2m_get_coap_block_size());
+                    coap_set_header_block1(response, 0, 1, contextP->coapBlockSize);
                 }
             } else if (IS_OPTION(message, COAP_OPTION_BLOCK1)) {
 #ifdef LWM2M_CLIENT_MODE
@@ -542,6 +646,18 @@ void lwm2m_handle_packet(lwm2m_context_t * contextP,
                         peerP->sessionH = fromSessionH;
                         peerP->internalID = lwm2m_list_newId((lwm2m_list_t *)contextP->clientList);
                         contextP->clientList = (lwm2m_client_t *)LWM2M_LIST_ADD(contextP->clientList, peerP);
+                        if (!utils_indexClient(contextP, peerP))
+                        {
+                            contextP->clientList = (lwm2m_client_t *)LWM2M_LIST_RM(contextP->clientList, peerP->internalID, NULL);
+                            lwm2m_free(peerP);
+                            peerP = NULL;
+                        }
+#ifdef LWM2M_SERVER_MODE
+                        else
+                        {
+                            registration_scheduleExpiry(contextP, peerP);
+                        }
+#endif
                     }
                 }
 #endif
@@ -560,29 +676,37 @@ void lwm2m_handle_packet(lwm2m_context_t * contextP,
                     // parse block1 header
                     coap_get_header_block1(message, &block1_num, &block1_more, &block1_size, NULL);
                     LOG_ARG("Blockwise: block1 request NUM %u (SZX %u/ SZX Max%u) MORE %u", block1_num, block1_size,
-                            lwm2m_get_coap_block_size(), block1_more);
+                            contextP->coapBlockSize, block1_more);
+
+                    uint32_t size1 = 0;
+                    coap_get_header_size1(message, &size1);
 
                     char * uri = coap_get_packet_uri_as_string(message);
                     if (uri == NULL){
                         coap_error_code = COAP_500_INTERNAL_SERVER_ERROR;
+#if defined(LWM2M_CLIENT_MODE) && !defined(LWM2M_RAW_BLOCK1_REQUESTS)
+                    } else if (prv_isBlock1Streamed(contextP, fromSessionH, message)) {
+                        coap_error_code = NO_ERROR;
+                        lwm2m_free(uri);
+#endif
                     } else {
                     // handle block 1
 #ifdef LWM2M_RAW_BLOCK1_REQUESTS
-                        coap_error_code = coap_block1_handler(&peerP->blockData, uri, message->mid, message->payload, message->payload_len, block1_size, block1_num, block1_more, &complete_buffer, &complete_buffer_size);
+                        coap_error_code = coap_block1_handler(&peerP->blockData, uri, message->mid, message->payload, message->payload_len, block1_size, block1_num, block1_more, size1, contextP->maxBlockTransferSize, &complete_buffer, &complete_buffer_size);
 #else
-                        coap_error_code = coap_block1_handler(&peerP->blockData, uri, message->payload, message->payload_len, block1_size, block1_num, block1_more, &complete_buffer, &complete_buffer_size);
+                        coap_error_code = coap_block1_handler(&peerP->blockData, uri, message->payload, message->payload_len, block1_size, block1_num, block1_more, size1, contextP->maxBlockTransferSize, &complete_buffer, &complete_buffer_size);
 #endif
                         lwm2m_free(uri);
                     }
 #ifndef LWM2M_RAW_BLOCK1_REQUESTS
                     // if payload is complete, replace it in the coap message.
-                    if (coap_error_code == NO_ERROR)
+                    if (coap_error_code == NO_ERROR && complete_buffer != NULL)
                     {
                         message->payload = complete_buffer;
                         message->payload_len = complete_buffer_size;
                     }
 #endif
-                    block1_size = MIN(block1_size, lwm2m_get_coap_block_size());
+                    block1_size = MIN(block1_size, contextP->coapBlockSize);
                     coap_set_header_block1(response, block1_num, block1_more, block1_size);
                 }
             }
@@ -592,20 +716,38 @@ void lwm2m_handle_packet(lwm2m_context_t * contextP,
             if (coap_error_code == NO_ERROR)
 #endif
             {
-                coap_error_code = handle_request(contextP, fromSessionH, message, response);
+#ifdef LWM2M_CLIENT_MODE
+                if (serverP != NULL) cacheP = prv_getCachedRead(serverP, message, response);
+                if (cacheP == NULL)
+#endif
+                {
+#if defined(LWM2M_CLIENT_MODE) && defined(LWM2M_DATA_ARENA)
+                    lwm2m_data_arena_t * previousArenaP = lwm2m_data_arena_use(&contextP->dataArena);
+
+                    coap_error_code = handle_request(contextP, fromSessionH, message, response);
+                    lwm2m_data_arena_use(previousArenaP);
+                    // the response payload is not in the arena
+                    if (previousArenaP != &contextP->dataArena) lwm2m_data_arena_reset(&contextP->dataArena);
+#else
+                    coap_error_code = handle_request(contextP, fromSessionH, message, response);
+#endif
+                }
             }
             if (coap_error_code == NO_ERROR)
             {
                 /* Save original payload pointer for later freeing. Payload in response may be updated. */
                 uint8_t *payload = response->payload;
+#ifdef LWM2M_CLIENT_MODE
+                size_t payloadLength = response->payload_len;
+#endif
                 if ( IS_OPTION(message, COAP_OPTION_BLOCK2) )
                 {
                     /* get offset for blockwise transfers */
                     if (coap_get_header_block2(message, &block_num, NULL, &block_size, &block_offset))
                     {
                         LOG_ARG("Blockwise: block request %u (%u/%u) @ %u bytes", block_num, block_size,
-                                lwm2m_get_coap_block_size(), block_offset);
-                        block_size = MIN(block_size, lwm2m_get_coap_block_size());
+                                contextP->coapBlockSize, block_offset);
+                        block_size = MIN(block_size, contextP->coapBlockSize);
                     }
 
                     if (block_offset >= response->payload_len)
@@ -617,17 +759,51 @@ void lwm2m_handle_packet(lwm2m_context_t * contextP,
                     }
                     else
                     {
+                        // announce the size of the whole transfer so the peer can allocate it at once
+                        if (block_num == 0) coap_set_header_size(response, response->payload_len);
                         coap_set_header_block2(response, block_num, response->payload_len - block_offset > block_size, block_size);
                         coap_set_payload(response, response->payload+block_offset, MIN(response->payload_len - block_offset, block_size));
                     } /* if (valid offset) */
-                } else if (response->payload_len > lwm2m_get_coap_block_size()) {
-                    coap_set_header_block2(response, 0, response->payload_len > lwm2m_get_coap_block_size(),
-                                           lwm2m_get_coap_block_size());
-                    coap_set_payload(response, response->payload, lwm2m_get_coap_block_size());
+                } else if (response->payload_len > contextP->coapBlockSize) {
+                    coap_set_header_size(response, response->payload_len);
+                    coap_set_header_block2(response, 0, response->payload_len > contextP->coapBlockSize,
+                                           contextP->coapBlockSize);
+                    coap_set_payload(response, response->payload, contextP->coapBlockSize);
                 }
+#ifdef LWM2M_CLIENT_MODE
+                if (serverP != NULL && response->code == COAP_205_CONTENT && IS_OPTION(response, COAP_OPTION_BLOCK2))
+                {
+                    if (cacheP == NULL && response->block2_more)
+                    {
+                        cacheP = prv_cacheRead(contextP, serverP, message, response, payload, payloadLength);
+                    }
+                    if (cacheP != NULL)
+                    {
+                        // lets the server check that all the blocks come from the same representation
+                        uint8_t etag[4];
+
+                        etag[0] = (uint8_t)(cacheP->etag >> 24);
+                        etag[1] = (uint8_t)(cacheP->etag >> 16);
+                        etag[2] = (uint8_t)(cacheP->etag >> 8);
+                        etag[3] = (uint8_t)cacheP->etag;
+                        coap_set_header_etag(response, etag, sizeof(etag));
+                    }
+                }
+#endif
 
                 coap_error_code = message_send(contextP, response, fromSessionH);
 
+#ifdef LWM2M_CLIENT_MODE
+                if (cacheP != NULL)
+                {
+                    // the payload belongs to the cache, dropped once its last block is sent
+                    payload = NULL;
+                    if (!IS_OPTION(response, COAP_OPTION_BLOCK2) || !response->block2_more)
+                    {
+                        block2_cache_delete(&serverP->blockData);
+                    }
+                }
+#endif
                 lwm2m_free(payload);
                 response->payload = NULL;
                 response->payload_len = 0;
@@ -661,7 +837,7 @@ void lwm2m_handle_packet(lwm2m_context_t * contextP,
             {
             case COAP_TYPE_NON:
             case COAP_TYPE_CON:
-                if (message->payload_len > lwm2m_get_coap_block_size()) {
+                if (message->payload_len > contextP->coapBlockSize) {
 #ifdef LWM2M_CLIENT_MODE
                     // get server
                     lwm2m_server_t * peerP;
@@ -680,7 +856,7 @@ void lwm2m_handle_packet(lwm2m_context_t * contextP,
                     {
                         // retry as a block2 request
                         prv_send_get_block2(contextP, fromSessionH, peerP->blockData, message->mid, 0,
-                                            lwm2m_get_coap_block_size());
+                                            contextP->coapBlockSize);
                     }
                     transaction_handleResponse(contextP, fromSessionH, message, NULL);
                 } else {
@@ -697,7 +873,7 @@ void lwm2m_handle_packet(lwm2m_context_t * contextP,
                     if (!done && message->type == COAP_TYPE_CON )
                     {
                         coap_init_message(response, COAP_TYPE_ACK, 0, message->mid);
-                        if (message->payload_len > lwm2m_get_coap_block_size()) {
+                        if (message->payload_len > contextP->coapBlockSize) {
                             coap_set_status_code(response, COAP_413_ENTITY_TOO_LARGE);
                         }
                         coap_error_code = message_send(contextP, response, fromSessionH);
@@ -712,7 +888,7 @@ void lwm2m_handle_packet(lwm2m_context_t * contextP,
                 break;
 
             case COAP_TYPE_ACK:
-                if (message->payload_len > lwm2m_get_coap_block_size()) {
+                if (message->payload_len > contextP->coapBlockSize) {
 #ifdef LWM2M_CLIENT_MODE
                     // get server
                     lwm2m_server_t * peerP;
@@ -731,7 +907,7 @@ void lwm2m_handle_packet(lwm2m_context_t * contextP,
                     {
                         // retry as a block2 request
                         prv_send_get_block2(contextP, fromSessionH, peerP->blockData, message->mid, 0,
-                                            lwm2m_get_coap_block_size());
+                                            contextP->coapBlockSize);
                     }
                     transaction_handleResponse(contextP, fromSessionH, message, NULL);
                 } else if (IS_OPTION(message, COAP_OPTION_BLOCK1)) {
@@ -786,10 +962,13 @@ void lwm2m_handle_packet(lwm2m_context_t * contextP,
                         // parse block2 header
                         coap_get_header_block2(message, &block2_num, &block2_more, &block2_size, NULL);
                         LOG_ARG("Blockwise: block2 response NUM %u (SZX %u/ SZX Max%u) MORE %u", block2_num,
-                                block2_size, lwm2m_get_coap_block_size(), block2_more);
+                                block2_size, contextP->coapBlockSize, block2_more);
+
+                        uint32_t size2 = 0;
+                        coap_get_header_size(message, &size2);
 
                         // handle block 2
-                        coap_error_code = coap_block2_handler(&peerP->blockData, message->mid, message->payload, message->payload_len, block2_size, block2_num, block2_more, &complete_buffer, &complete_buffer_size);
+                        coap_error_code = coap_block2_handler(&peerP->blockData, message->mid, message->payload, message->payload_len, block2_size, block2_num, block2_more, size2, contextP->maxBlockTransferSize, &complete_buffer, &complete_buffer_size);
 
                         // if payload is complete, replace it in the coap message.
                         if (coap_error_code == NO_ERROR)
@@ -811,7 +990,8 @@ void lwm2m_handle_packet(lwm2m_context_t * contextP,
                     All our responses are piggyback so this must be the result of request being too large (not a separate CON)
                     switch to a block1 request.
                     */
-                    prv_change_to_block1(contextP, fromSessionH, message->mid, message->size);
+                    // the maximal size is in Size1 (RFC 7959), older peers used the Size option
+                    prv_change_to_block1(contextP, fromSessionH, message->mid, IS_OPTION(message, COAP_OPTION_SIZE1) ? message->size1 : message->size);
                     transaction_handleResponse(contextP, fromSessionH, message, NULL);
                 } else {
                     transaction_handleResponse(contextP, fromSessionH, message, NULL);
@@ -831,7 +1011,9 @@ void lwm2m_handle_packet(lwm2m_context_t * contextP,
 
     if (coap_error_code != NO_ERROR && coap_error_code != COAP_IGNORE)
     {
-        LOG_ARG("ERROR %u: %s", coap_error_code, STR_NULL2EMPTY(coap_error_message));
+        const char * errorMessage = message->error_message != NULL ? message->error_message : "";
+
+        LOG_ARG("ERROR %u: %s", coap_error_code, errorMessage);
 
         /* Set to sendable error code. */
         if (coap_error_code >= 192)
@@ -840,17 +1022,34 @@ void lwm2m_handle_packet(lwm2m_context_t * contextP,
         }
         /* Reuse input buffer for error message. */
         coap_init_message(message, COAP_TYPE_ACK, coap_error_code, message->mid);
-        coap_set_payload(message, coap_error_message, strlen(coap_error_message));
+        coap_set_payload(message, errorMessage, strlen(errorMessage));
         message_send(contextP, message, fromSessionH);
     }
 }
 
 
+// returns the transmit buffer of the context, grown to at least length bytes
+static uint8_t * prv_getSendBuffer(lwm2m_context_t * contextP,
+                                   size_t length)
+{
+    if (length > contextP->sendBufferSize)
+    {
+        uint8_t * bufferP;
+
+        bufferP = (uint8_t *)lwm2m_malloc(length);
+        if (bufferP == NULL) return NULL;
+        if (contextP->sendBuffer != NULL) lwm2m_free(contextP->sendBuffer);
+        contextP->sendBuffer = bufferP;
+        contextP->sendBufferSize = length;
+    }
+
+    return contextP->sendBuffer;
+}
+
 uint8_t message_send(lwm2m_context_t * contextP,
                      coap_packet_t * message,
                      void * sessionH)
 {
-    uint8_t result = COAP_500_INTERNAL_SERVER_ERROR;
     uint8_t * pktBuffer;
     size_t pktBufferLen = 0;
     size_t allocLen;
@@ -860,18 +1059,193 @@ uint8_t message_send(lwm2m_context_t * contextP,
     LOG_ARG("Size to allocate: %d", allocLen);
     if (allocLen == 0) return COAP_500_INTERNAL_SERVER_ERROR;
 
-    pktBuffer = (uint8_t *)lwm2m_malloc(allocLen);
-    if (pktBuffer != NULL)
+    pktBuffer = prv_getSendBuffer(contextP, allocLen);
+    if (pktBuffer == NULL) return COAP_500_INTERNAL_SERVER_ERROR;
+
+    pktBufferLen = coap_serialize_message(message, pktBuffer);
+    LOG_ARG("coap_serialize_message() returned %d", pktBufferLen);
+    if (0 == pktBufferLen) return COAP_500_INTERNAL_SERVER_ERROR;
+
+    return lwm2m_buffer_send(sessionH, pktBuffer, pktBufferLen, contextP->userData);
+}
+
+// Room kept in front of a notification payload for its header: the fixed header, the token, the Observe option (up to
+// three bytes of value), the Content-Format option (up to two bytes of value) and the payload marker.
+#define NOTIFY_HEADER_MAX_LEN (COAP_HEADER_LEN + COAP_TOKEN_LEN + 4 + 3 + 1)
+
+// writes an option holding an unsigned integer on the fewest bytes and returns its length
+static size_t prv_writeUintOption(uint8_t * buffer,
+                                  uint8_t delta,
+                                  uint32_t value)
+{
+    size_t length;
+    size_t i;
+
+    length = 0;
+    while (length < 4 && (value >> (8 * length)) != 0)
     {
-        pktBufferLen = coap_serialize_message(message, pktBuffer);
-        LOG_ARG("coap_serialize_message() returned %d", pktBufferLen);
-        if (0 != pktBufferLen)
-        {
-            result = lwm2m_buffer_send(sessionH, pktBuffer, pktBufferLen, contextP->userData);
-        }
-        lwm2m_free(pktBuffer);
+        length++;
+    }
+    buffer[0] = (uint8_t)((delta << 4) | length);
+    for (i = 0 ; i < length ; i++)
+    {
+        buffer[1 + i] = (uint8_t)(value >> (8 * (length - 1 - i)));
     }
 
-    return result;
+    return 1 + length;
+}
+
+int message_serialize_notification(lwm2m_context_t * contextP,
+                                   lwm2m_uri_t * uriP,
+                                   int size,
+                                   lwm2m_data_t * dataP,
+                                   lwm2m_media_type_t * formatP)
+{
+    uint8_t * pktBuffer;
+    int res;
+
+    LOG("Entering");
+
+    pktBuffer = prv_getSendBuffer(contextP, NOTIFY_HEADER_MAX_LEN + contextP->coapBlockSize);
+    if (pktBuffer == NULL) return -1;
+
+    res = lwm2m_data_serialize_into(uriP, size, dataP, formatP, pktBuffer + NOTIFY_HEADER_MAX_LEN,
+                                    contextP->sendBufferSize - NOTIFY_HEADER_MAX_LEN);
+    if (res > 0 && (size_t)res > contextP->sendBufferSize - NOTIFY_HEADER_MAX_LEN)
+    {
+        pktBuffer = prv_getSendBuffer(contextP, NOTIFY_HEADER_MAX_LEN + res);
+        if (pktBuffer == NULL) return -1;
+        res = lwm2m_data_serialize_into(uriP, size, dataP, formatP, pktBuffer + NOTIFY_HEADER_MAX_LEN,
+                                        contextP->sendBufferSize - NOTIFY_HEADER_MAX_LEN);
+    }
+    LOG_ARG("lwm2m_data_serialize_into() returned %d", res);
+    if (res < 0 || res > UINT16_MAX) return -1;
+
+    return res;
+}
+
+// writes the header of a notification in front of the payload serialized last by message_serialize_notification()
+// and returns the start of the datagram
+static uint8_t * prv_writeNotificationHeader(lwm2m_context_t * contextP,
+                                             coap_message_type_t type,
+                                             uint16_t mid,
+                                             const uint8_t * token,
+                                             size_t tokenLen,
+                                             uint32_t observe,
+                                             lwm2m_media_type_t format,
+                                             size_t length,
+                                             size_t * datagramLenP)
+{
+    uint8_t header[NOTIFY_HEADER_MAX_LEN];
+    size_t headerLen;
+    uint8_t * pktBuffer;
+
+    LOG_ARG("type: %d, mid: %u, observe: %u, length: %d", type, mid, observe, length);
+    if (contextP->sendBuffer == NULL || tokenLen > COAP_TOKEN_LEN) return NULL;
+
+    header[0] = (uint8_t)((1 << COAP_HEADER_VERSION_POSITION)
+                        | (type << COAP_HEADER_TYPE_POSITION)
+                        | tokenLen);
+    header[1] = COAP_205_CONTENT;
+    header[2] = (uint8_t)(mid >> 8);
+    header[3] = (uint8_t)mid;
+    memcpy(header + COAP_HEADER_LEN, token, tokenLen);
+    headerLen = COAP_HEADER_LEN + tokenLen;
+    headerLen += prv_writeUintOption(header + headerLen, COAP_OPTION_OBSERVE, observe & 0xFFFFFF);
+    headerLen += prv_writeUintOption(header + headerLen,
+                                     COAP_OPTION_CONTENT_TYPE - COAP_OPTION_OBSERVE,
+                                     (uint16_t)format);
+    if (length > 0) header[headerLen++] = 0xFF;
+
+    pktBuffer = contextP->sendBuffer + NOTIFY_HEADER_MAX_LEN - headerLen;
+    memcpy(pktBuffer, header, headerLen);
+    *datagramLenP = headerLen + length;
+
+    return pktBuffer;
+}
+
+uint8_t message_send_notification(lwm2m_context_t * contextP,
+                                  void * sessionH,
+                                  uint16_t mid,
+                                  const uint8_t * token,
+                                  size_t tokenLen,
+                                  uint32_t observe,
+                                  lwm2m_media_type_t format,
+                                  size_t length)
+{
+    uint8_t * pktBuffer;
+    size_t pktBufferLen;
+
+    pktBuffer = prv_writeNotificationHeader(contextP, COAP_TYPE_NON, mid, token, tokenLen, observe, format, length,
+                                            &pktBufferLen);
+    if (pktBuffer == NULL) return COAP_500_INTERNAL_SERVER_ERROR;
+
+    return lwm2m_buffer_send(sessionH, pktBuffer, pktBufferLen, contextP->userData);
 }
 
+lwm2m_transaction_t * message_new_notification(lwm2m_context_t * contextP,
+                                               void * sessionH,
+                                               uint16_t mid,
+                                               const uint8_t * token,
+                                               size_t tokenLen,
+                                               uint32_t observe,
+                                               lwm2m_media_type_t format,
+                                               size_t length)
+{
+    lwm2m_transaction_t * transacP;
+    uint8_t * pktBuffer;
+    size_t pktBufferLen;
+
+    pktBuffer = prv_writeNotificationHeader(contextP, COAP_TYPE_CON, mid, token, tokenLen, observe, format, length,
+                                            &pktBufferLen);
+    if (pktBuffer == NULL || pktBufferLen > UINT16_MAX) return NULL;
+
+    // The token is only in the datagram: the server acknowledges the notification, it does not answer it.
+    transacP = transaction_new(sessionH, (coap_method_t)COAP_205_CONTENT, NULL, NULL, mid, 0, NULL);
+    if (transacP == NULL) return NULL;
+
+    // sent as is by transaction_send()
+    transacP->buffer = (uint8_t *)lwm2m_malloc(pktBufferLen);
+    if (transacP->buffer == NULL)
+    {
+        transaction_free(transacP);
+        return NULL;
+    }
+    memcpy(transacP->buffer, pktBuffer, pktBufferLen);
+    transacP->buffer_len = (uint16_t)pktBufferLen;
+
+    return transacP;
+}
+
+
+lwm2m_queued_notification_t * message_copy_notification(lwm2m_context_t * contextP,
+                                                        bool confirmable,
+                                                        const uint8_t * token,
+                                                        size_t tokenLen,
+                                                        uint32_t observe,
+                                                        lwm2m_media_type_t format,
+                                                        size_t length)
+{
+    lwm2m_queued_notification_t * queuedP;
+    uint8_t * pktBuffer;
+    size_t pktBufferLen;
+
+    pktBuffer = prv_writeNotificationHeader(contextP, confirmable ? COAP_TYPE_CON : COAP_TYPE_NON, 0, token, tokenLen,
+                                            observe, format, length, &pktBufferLen);
+    if (pktBuffer == NULL || pktBufferLen > UINT16_MAX) return NULL;
+
+    queuedP = (lwm2m_queued_notification_t *)lwm2m_malloc(sizeof(lwm2m_queued_notification_t));
+    if (queuedP == NULL) return NULL;
+    memset(queuedP, 0, sizeof(lwm2m_queued_notification_t));
+    queuedP->buffer = (uint8_t *)lwm2m_malloc(pktBufferLen);
+    if (queuedP->buffer == NULL)
+    {
+        lwm2m_free(queuedP);
+        return NULL;
+    }
+    memcpy(queuedP->buffer, pktBuffer, pktBufferLen);
+    queuedP->length = pktBufferLen;
+    queuedP->confirmable = confirmable;
+
+    return queuedP;
+}
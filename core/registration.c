@@ -785,7 +785,7 @@ static uint8_t prv_register(lwm2m_context_t * contextP,
     coap_set_header_uri_query(transaction->message, query);
     coap_set_header_content_type(transaction->message, LWM2M_CONTENT_LINK);
 
-    transaction_set_payload(transaction, payload, payload_length);
+    transaction_set_payload(contextP, transaction, payload, payload_length);
 
     registration_data_t * dataP = (registration_data_t *) lwm2m_malloc(sizeof(registration_data_t));
     if (dataP == NULL){
@@ -801,7 +801,7 @@ static uint8_t prv_register(lwm2m_context_t * contextP,
     transaction->callback = prv_handleRegistrationReply;
     transaction->userData = (void *) dataP;
 
-    contextP->transactionList = (lwm2m_transaction_t *)LWM2M_LIST_ADD(contextP->transactionList, transaction);
+    transaction_add(contextP, transaction);
     if (transaction_send(contextP, transaction) != 0)
     {
         return COAP_503_SERVICE_UNAVAILABLE;
@@ -894,7 +894,7 @@ static int prv_updateRegistration(lwm2m_context_t * contextP,
             lwm2m_free(payload);
             return COAP_500_INTERNAL_SERVER_ERROR;
         }
-        transaction_set_payload(transaction, payload, payload_length);
+        transaction_set_payload(contextP, transaction, payload, payload_length);
     }
 
     registration_data_t * dataP = (registration_data_t *) lwm2m_malloc(sizeof(registration_data_t));
@@ -909,15 +909,85 @@ static int prv_updateRegistration(lwm2m_context_t * contextP,
     transaction->callback = prv_handleRegistrationUpdateReply;
     transaction->userData = (void *) dataP;
 
-    contextP->transactionList = (lwm2m_transaction_t *)LWM2M_LIST_ADD(contextP->transactionList, transaction);
+    transaction_add(contextP, transaction);
 
     if (transaction_send(contextP, transaction) == 0) {
         server->status = STATE_REG_UPDATE_PENDING;
+        registration_keepAwake(server, lwm2m_gettime());
+        if (server->queueSleeping)
+        {
+            // the server may reach the client until the update is acknowledged
+            server->queueSleeping = false;
+            observe_sendQueue(contextP, server);
+        }
     }
     
     return COAP_NO_ERROR;
 }
 
+void registration_keepAwake(lwm2m_server_t * serverP,
+                            time_t currentTime)
+{
+    serverP->queueAwakeUntil = currentTime + LWM2M_QUEUE_MODE_TIMEOUT;
+}
+
+// wakes up the servers in queue mode with a registration update followed by their queued notifications
+int lwm2m_queue_flush(lwm2m_context_t * contextP)
+{
+    lwm2m_server_t * targetP;
+    int result = COAP_NO_ERROR;
+
+    LOG_ARG("State: %s", STR_STATE(contextP->state));
+
+    for (targetP = contextP->serverList ; targetP != NULL && result == COAP_NO_ERROR ; targetP = targetP->next)
+    {
+        if (!targetP->queueSleeping) continue;
+
+        switch (targetP->status)
+        {
+        case STATE_REGISTERED:
+        case STATE_REG_UPDATE_NEEDED:
+            result = prv_updateRegistration(contextP, targetP, false);
+            break;
+
+        case STATE_REG_FULL_UPDATE_NEEDED:
+            result = prv_updateRegistration(contextP, targetP, true);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    return result;
+}
+
+void lwm2m_set_queue_callback(lwm2m_context_t * contextP,
+                              lwm2m_queue_callback_t callback,
+                              void * userData)
+{
+    LOG("Entering");
+    contextP->queueCallback = callback;
+    contextP->queueUserData = userData;
+}
+
+// a server in queue mode cannot reach the client once it is idle for LWM2M_QUEUE_MODE_TIMEOUT
+static bool prv_isIdle(lwm2m_server_t * serverP,
+                       time_t currentTime,
+                       time_t * timeoutP)
+{
+    if (currentTime < serverP->queueAwakeUntil)
+    {
+        if (serverP->queueAwakeUntil - currentTime < *timeoutP)
+        {
+            *timeoutP = serverP->queueAwakeUntil - currentTime;
+        }
+        return false;
+    }
+
+    return serverP->transactionCount == 0;
+}
+
 // update the registration of a given server
 int lwm2m_update_registration(lwm2m_context_t * contextP,
                               uint16_t shortServerID,
@@ -1161,7 +1231,7 @@ void registration_deregister(lwm2m_context_t * contextP,
     transaction->callback = prv_handleDeregistrationReply;
     transaction->userData = (void *) serverP;
 
-    contextP->transactionList = (lwm2m_transaction_t *)LWM2M_LIST_ADD(contextP->transactionList, transaction);
+    transaction_add(contextP, transaction);
     if (transaction_send(contextP, transaction) == 0)
     {
         serverP->status = STATE_DEREG_PENDING;
@@ -1424,6 +1494,11 @@ static int prv_parseLinkAttributes(uint8_t * data,
             {
                 *format = LWM2M_CONTENT_SENML_JSON;
             }
+            else if (valueLength == REG_ATTR_CONTENT_SENML_CBOR_LEN
+             && 0 == lwm2m_strncmp(REG_ATTR_CONTENT_SENML_CBOR, (char*)data + index + valueStart, valueLength))
+            {
+                *format = LWM2M_CONTENT_SENML_CBOR;
+            }
             else
             {
                 return 0;
@@ -1694,20 +1769,6 @@ error:
     return NULL;
 }
 
-static lwm2m_client_t * prv_getClientByName(lwm2m_context_t * contextP,
-                                            char * name)
-{
-    lwm2m_client_t * targetP;
-
-    targetP = contextP->clientList;
-    while (targetP != NULL && (targetP->name == NULL || strcmp(name, targetP->name) != 0))
-    {
-        targetP = targetP->next;
-    }
-
-    return targetP;
-}
-
 void registration_freeClient(lwm2m_client_t * clientP)
 {
     LOG("Entering");
@@ -1734,6 +1795,33 @@ void registration_freeClient(lwm2m_client_t * clientP)
     lwm2m_free(clientP);
 }
 
+static void prv_lifetimeExpired(lwm2m_context_t * contextP,
+                                void * userData,
+                                time_t currentTime)
+{
+    lwm2m_client_t * clientP = (lwm2m_client_t *)userData;
+
+    (void)currentTime;
+
+    LOG_ARG("Client %d lifetime expired", clientP->internalID);
+    utils_unindexClient(contextP, clientP);
+    contextP->clientList = (lwm2m_client_t *)LWM2M_LIST_RM(contextP->clientList, clientP->internalID, NULL);
+    if (contextP->monitorCallback != NULL)
+    {
+        contextP->monitorCallback(contextP, clientP->internalID, NULL, COAP_202_DELETED, NULL, LWM2M_CONTENT_TEXT, NULL, 0, contextP->monitorUserData);
+    }
+    registration_freeClient(clientP);
+}
+
+// This must be called after changing the endOfLife of a client.
+void registration_scheduleExpiry(lwm2m_context_t * contextP,
+                                 lwm2m_client_t * clientP)
+{
+    clientP->lifetimeTimer.callback = prv_lifetimeExpired;
+    clientP->lifetimeTimer.userData = clientP;
+    scheduler_add(contextP, &clientP->lifetimeTimer, clientP->endOfLife);
+}
+
 static int prv_getLocationString(uint16_t id,
                                  char location[MAX_LOCATION_LENGTH])
 {
@@ -1835,7 +1923,7 @@ uint8_t  registration_handleRequest(lwm2m_context_t * contextP,
                 lifetime = LWM2M_DEFAULT_LIFETIME;
             }
 
-            clientP = prv_getClientByName(contextP, name);
+            clientP = utils_findClientByName(contextP, name);
             if (IS_OPTION(message, COAP_OPTION_BLOCK1))
             {
                 if(clientP == NULL)
@@ -1845,6 +1933,8 @@ uint8_t  registration_handleRequest(lwm2m_context_t * contextP,
                 else
                 {
                     lwm2m_client_t * tmpClientP = utils_findClient(contextP, fromSessionH);
+                    utils_unindexClient(contextP, tmpClientP);
+                    scheduler_remove(contextP, &tmpClientP->lifetimeTimer);
                     contextP->clientList = (lwm2m_client_t *)LWM2M_LIST_RM(contextP->clientList, tmpClientP->internalID, &tmpClientP);
                     registration_freeClient(tmpClientP);
                 }
@@ -1852,6 +1942,8 @@ uint8_t  registration_handleRequest(lwm2m_context_t * contextP,
             if (clientP != NULL)
             {
                 // we reset this registration
+                utils_unindexClient(contextP, clientP);
+                scheduler_remove(contextP, &clientP->lifetimeTimer);
                 lwm2m_free(clientP->name);
                 if (clientP->msisdn != NULL) lwm2m_free(clientP->msisdn);
                 if (clientP->altPath != NULL) lwm2m_free(clientP->altPath);
@@ -1884,13 +1976,19 @@ uint8_t  registration_handleRequest(lwm2m_context_t * contextP,
             clientP->objectList = objects;
             clientP->sessionH = fromSessionH;
 
-            if (prv_getLocationString(clientP->internalID, location) == 0)
+            if (!utils_indexClient(contextP, clientP))
             {
+                contextP->clientList = (lwm2m_client_t *)LWM2M_LIST_RM(contextP->clientList, clientP->internalID, NULL);
                 registration_freeClient(clientP);
                 return COAP_500_INTERNAL_SERVER_ERROR;
             }
-            if (coap_set_header_location_path(response, location) == 0)
+            registration_scheduleExpiry(contextP, clientP);
+            if (prv_getLocationString(clientP->internalID, location) == 0
+             || coap_set_header_location_path(response, location) == 0)
             {
+                utils_unindexClient(contextP, clientP);
+                scheduler_remove(contextP, &clientP->lifetimeTimer);
+                contextP->clientList = (lwm2m_client_t *)LWM2M_LIST_RM(contextP->clientList, clientP->internalID, NULL);
                 registration_freeClient(clientP);
                 return COAP_500_INTERNAL_SERVER_ERROR;
             }
@@ -1906,7 +2004,7 @@ uint8_t  registration_handleRequest(lwm2m_context_t * contextP,
             // Registration update
             if (LWM2M_URI_IS_SET_INSTANCE(uriP)) return COAP_400_BAD_REQUEST;
 
-            clientP = (lwm2m_client_t *)lwm2m_list_find((lwm2m_list_t *)contextP->clientList, uriP->objectId);
+            clientP = utils_findClientById(contextP, uriP->objectId);
             if (clientP == NULL) return COAP_404_NOT_FOUND;
 
             // Endpoint client name MUST NOT be present
@@ -1931,7 +2029,18 @@ uint8_t  registration_handleRequest(lwm2m_context_t * contextP,
                 clientP->lifetime = lifetime;
             }
             // client IP address, port or MSISDN may have changed
-            clientP->sessionH = fromSessionH;
+            if (clientP->sessionH != fromSessionH)
+            {
+                utils_unindexClient(contextP, clientP);
+                scheduler_remove(contextP, &clientP->lifetimeTimer);
+                clientP->sessionH = fromSessionH;
+                if (!utils_indexClient(contextP, clientP))
+                {
+                    contextP->clientList = (lwm2m_client_t *)LWM2M_LIST_RM(contextP->clientList, clientP->internalID, NULL);
+                    registration_freeClient(clientP);
+                    return COAP_500_INTERNAL_SERVER_ERROR;
+                }
+            }
 
             if (objects != NULL)
             {
@@ -1988,6 +2097,7 @@ uint8_t  registration_handleRequest(lwm2m_context_t * contextP,
             }
 
             clientP->endOfLife = tv_sec + clientP->lifetime;
+            registration_scheduleExpiry(contextP, clientP);
 
             if (contextP->monitorCallback != NULL)
             {
@@ -2005,8 +2115,11 @@ uint8_t  registration_handleRequest(lwm2m_context_t * contextP,
         if (!LWM2M_URI_IS_SET_OBJECT(uriP)) return COAP_400_BAD_REQUEST;
         if (LWM2M_URI_IS_SET_INSTANCE(uriP)) return COAP_400_BAD_REQUEST;
 
-        contextP->clientList = (lwm2m_client_t *)LWM2M_LIST_RM(contextP->clientList, uriP->objectId, &clientP);
+        clientP = utils_findClientById(contextP, uriP->objectId);
         if (clientP == NULL) return COAP_400_BAD_REQUEST;
+        utils_unindexClient(contextP, clientP);
+        scheduler_remove(contextP, &clientP->lifetimeTimer);
+        contextP->clientList = (lwm2m_client_t *)LWM2M_LIST_RM(contextP->clientList, clientP->internalID, NULL);
         if (contextP->monitorCallback != NULL)
         {
             contextP->monitorCallback(contextP, clientP->internalID, NULL, COAP_202_DELETED, NULL, LWM2M_CONTENT_TEXT, NULL, 0, contextP->monitorUserData);
@@ -2035,12 +2148,13 @@ void lwm2m_set_monitoring_callback(lwm2m_context_t * contextP,
 
 // for each server update the registration if needed
 // for each client check if the registration expired
+#ifdef LWM2M_CLIENT_MODE
 void registration_step(lwm2m_context_t * contextP,
                        time_t currentTime,
                        time_t * timeoutP)
 {
-#ifdef LWM2M_CLIENT_MODE
     lwm2m_server_t * targetP = contextP->serverList;
+    bool fellAsleep = false;
 
     LOG_ARG("State: %s", STR_STATE(contextP->state));
 
@@ -2084,9 +2198,20 @@ void registration_step(lwm2m_context_t * contextP,
                 LOG_ARG("%d Updating registration", targetP->shortID);
                 prv_updateRegistration(contextP, targetP, false);
             }
-            else if (interval < *timeoutP)
+            else
             {
-                *timeoutP = interval;
+                if (interval < *timeoutP)
+                {
+                    *timeoutP = interval;
+                }
+                if ((targetP->binding & BINDING_Q) != 0
+                 && !targetP->queueSleeping
+                 && prv_isIdle(targetP, currentTime, timeoutP))
+                {
+                    LOG_ARG("%d Server can no longer reach the client", targetP->shortID);
+                    targetP->queueSleeping = true;
+                    fellAsleep = true;
+                }
             }
         }
         break;
@@ -2104,6 +2229,8 @@ void registration_step(lwm2m_context_t * contextP,
             {
                 lwm2m_close_connection(targetP->sessionH, contextP->userData);
                 targetP->sessionH = NULL;
+                // the transactions left with the closed connection are no longer found from the server
+                targetP->transactionCount = 0;
             }
             break;
 
@@ -2113,40 +2240,16 @@ void registration_step(lwm2m_context_t * contextP,
         targetP = targetP->next;
     }
 
-#endif
-#ifdef LWM2M_SERVER_MODE
-    lwm2m_client_t * clientP;
-
-    LOG("Entering");
-    // monitor clients lifetime
-    clientP = contextP->clientList;
-    while (clientP != NULL)
+    if (fellAsleep
+     && contextP->state == STATE_READY
+     && contextP->queueCallback != NULL)
     {
-        lwm2m_client_t * nextP = clientP->next;
-
-        if (clientP->endOfLife <= currentTime)
-        {
-            contextP->clientList = (lwm2m_client_t *)LWM2M_LIST_RM(contextP->clientList, clientP->internalID, NULL);
-            if (contextP->monitorCallback != NULL)
-            {
-                contextP->monitorCallback(contextP, clientP->internalID, NULL, COAP_202_DELETED, NULL, LWM2M_CONTENT_TEXT, NULL, 0, contextP->monitorUserData);
-            }
-            registration_freeClient(clientP);
-        }
-        else
+        for (targetP = contextP->serverList ; targetP != NULL && targetP->queueSleeping ; targetP = targetP->next);
+        if (targetP == NULL)
         {
-            time_t interval;
-
-            interval = clientP->endOfLife - currentTime;
-
-            if (*timeoutP > interval)
-            {
-                *timeoutP = interval;
-            }
+            contextP->queueCallback(contextP, contextP->queueUserData);
         }
-        clientP = nextP;
     }
-#endif
-
 }
+#endif
 
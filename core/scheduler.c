@@ -0,0 +1,205 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+/*
+ * Deadline scheduler
+ *
+ * Timers are embedded in the objects they belong to (transactions, clients,
+ * observed URIs) and kept in a pairing heap ordered by deadline. Scheduling
+ * never allocates memory so it can not fail, and lwm2m_step() only touches
+ * the timers which are due.
+ *
+ * Deadlines are kept in milliseconds. Without LWM2M_WITH_MS_CLOCK, the
+ * millisecond clock is derived from lwm2m_gettime().
+ */
+
+#include "internals.h"
+
+// Make second a child of first, or the opposite. Both must be roots.
+static lwm2m_timer_t * prv_meld(lwm2m_timer_t * first,
+                                lwm2m_timer_t * second)
+{
+    lwm2m_timer_t * tmpP;
+
+    if (first == NULL) return second;
+    if (second == NULL) return first;
+
+    if (second->deadline < first->deadline)
+    {
+        tmpP = first;
+        first = second;
+        second = tmpP;
+    }
+
+    second->prev = first;
+    second->sibling = first->child;
+    if (first->child != NULL) first->child->prev = second;
+    first->child = second;
+
+    return first;
+}
+
+// Two pass pairing of a list of siblings into a single heap
+static lwm2m_timer_t * prv_mergePairs(lwm2m_timer_t * firstP)
+{
+    lwm2m_timer_t * pairsP = NULL;
+    lwm2m_timer_t * resultP = NULL;
+
+    // first pass, left to right: meld the siblings two by two and stack the results
+    while (firstP != NULL)
+    {
+        lwm2m_timer_t * secondP = firstP->sibling;
+        lwm2m_timer_t * nextP = NULL;
+
+        firstP->prev = NULL;
+        firstP->sibling = NULL;
+        if (secondP != NULL)
+        {
+            nextP = secondP->sibling;
+            secondP->prev = NULL;
+            secondP->sibling = NULL;
+        }
+
+        firstP = prv_meld(firstP, secondP);
+        firstP->sibling = pairsP;
+        pairsP = firstP;
+
+        firstP = nextP;
+    }
+
+    // second pass, right to left: meld the stacked pairs together
+    while (pairsP != NULL)
+    {
+        lwm2m_timer_t * nextP = pairsP->sibling;
+
+        pairsP->sibling = NULL;
+        resultP = prv_meld(resultP, pairsP);
+        pairsP = nextP;
+    }
+
+    return resultP;
+}
+
+int64_t scheduler_getTimeMs(void)
+{
+#ifdef LWM2M_WITH_MS_CLOCK
+    return lwm2m_gettime_ms();
+#else
+    time_t tv_sec = lwm2m_gettime();
+
+    if (tv_sec < 0) return -1;
+    return (int64_t)tv_sec * 1000;
+#endif
+}
+
+void scheduler_add(lwm2m_context_t * contextP,
+                   lwm2m_timer_t * timerP,
+                   time_t deadline)
+{
+    // Both clocks were sampled at the last step, seconds first. A deadline in seconds converted
+    // against them expires at most one second late but never early.
+    scheduler_addMs(contextP, timerP, contextP->schedulerTimeMs + ((int64_t)deadline - contextP->schedulerTime) * 1000);
+}
+
+void scheduler_addMs(lwm2m_context_t * contextP,
+                     lwm2m_timer_t * timerP,
+                     int64_t deadline)
+{
+    if (timerP->scheduled) scheduler_remove(contextP, timerP);
+
+    // a timer set again by a callback of scheduler_step() waits for the next step
+    if (contextP->schedulerRunning && deadline <= contextP->schedulerTimeMs)
+    {
+        deadline = contextP->schedulerTimeMs + 1;
+    }
+
+    timerP->deadline = deadline;
+    timerP->child = NULL;
+    timerP->sibling = NULL;
+    timerP->prev = NULL;
+    timerP->scheduled = true;
+
+    contextP->timerHeap = prv_meld(contextP->timerHeap, timerP);
+}
+
+void scheduler_remove(lwm2m_context_t * contextP,
+                      lwm2m_timer_t * timerP)
+{
+    if (!timerP->scheduled) return;
+
+    if (timerP == contextP->timerHeap)
+    {
+        contextP->timerHeap = prv_mergePairs(timerP->child);
+    }
+    else
+    {
+        // prev is either the parent of the timer or its previous sibling
+        if (timerP->prev->child == timerP)
+        {
+            timerP->prev->child = timerP->sibling;
+        }
+        else
+        {
+            timerP->prev->sibling = timerP->sibling;
+        }
+        if (timerP->sibling != NULL) timerP->sibling->prev = timerP->prev;
+
+        contextP->timerHeap = prv_meld(contextP->timerHeap, prv_mergePairs(timerP->child));
+    }
+
+    timerP->child = NULL;
+    timerP->sibling = NULL;
+    timerP->prev = NULL;
+    timerP->scheduled = false;
+}
+
+void scheduler_step(lwm2m_context_t * contextP,
+                    time_t currentTime,
+                    int64_t currentTimeMs,
+                    int64_t * timeoutP)
+{
+    LOG("Entering");
+
+    contextP->schedulerRunning = true;
+    contextP->schedulerTime = currentTime;
+    contextP->schedulerTimeMs = currentTimeMs;
+
+    while (contextP->timerHeap != NULL
+        && contextP->timerHeap->deadline <= currentTimeMs)
+    {
+        lwm2m_timer_t * timerP = contextP->timerHeap;
+
+        scheduler_remove(contextP, timerP);
+        // the callback may free the object holding the timer
+        timerP->callback(contextP, timerP->userData, currentTime);
+    }
+
+    contextP->schedulerRunning = false;
+
+    if (contextP->timerHeap != NULL)
+    {
+        int64_t interval = contextP->timerHeap->deadline - currentTimeMs;
+
+        if (*timeoutP > interval) *timeoutP = interval;
+    }
+}
+
+void scheduler_clear(lwm2m_context_t * contextP)
+{
+    // the timers are owned by the objects holding them
+    contextP->timerHeap = NULL;
+}
@@ -57,11 +57,222 @@
 #include <float.h>
 
 
+#define PRV_CACHED_POWER_MIN_EXP  -300
+#define PRV_CACHED_POWER_EXP_STEP 8
+
+typedef struct
+{
+    uint64_t f;
+    int16_t  e;
+    int16_t  k;
+} float_cached_power_t;
+
+/* Normalized 64 bit approximations of 10^k, for k from -300 to 324 in steps
+ * of 8, used both to print and to parse floats */
+static const float_cached_power_t cachedPowers[] =
+{
+    { 0xAB70FE17C79AC6CA, -1060, -300 },
+    { 0xFF77B1FCBEBCDC4F, -1034, -292 },
+    { 0xBE5691EF416BD60C, -1007, -284 },
+    { 0x8DD01FAD907FFC3C,  -980, -276 },
+    { 0xD3515C2831559A83,  -954, -268 },
+    { 0x9D71AC8FADA6C9B5,  -927, -260 },
+    { 0xEA9C227723EE8BCB,  -901, -252 },
+    { 0xAECC49914078536D,  -874, -244 },
+    { 0x823C12795DB6CE57,  -847, -236 },
+    { 0xC21094364DFB5637,  -821, -228 },
+    { 0x9096EA6F3848984F,  -794, -220 },
+    { 0xD77485CB25823AC7,  -768, -212 },
+    { 0xA086CFCD97BF97F4,  -741, -204 },
+    { 0xEF340A98172AACE5,  -715, -196 },
+    { 0xB23867FB2A35B28E,  -688, -188 },
+    { 0x84C8D4DFD2C63F3B,  -661, -180 },
+    { 0xC5DD44271AD3CDBA,  -635, -172 },
+    { 0x936B9FCEBB25C996,  -608, -164 },
+    { 0xDBAC6C247D62A584,  -582, -156 },
+    { 0xA3AB66580D5FDAF6,  -555, -148 },
+    { 0xF3E2F893DEC3F126,  -529, -140 },
+    { 0xB5B5ADA8AAFF80B8,  -502, -132 },
+    { 0x87625F056C7C4A8B,  -475, -124 },
+    { 0xC9BCFF6034C13053,  -449, -116 },
+    { 0x964E858C91BA2655,  -422, -108 },
+    { 0xDFF9772470297EBD,  -396, -100 },
+    { 0xA6DFBD9FB8E5B88F,  -369,  -92 },
+    { 0xF8A95FCF88747D94,  -343,  -84 },
+    { 0xB94470938FA89BCF,  -316,  -76 },
+    { 0x8A08F0F8BF0F156B,  -289,  -68 },
+    { 0xCDB02555653131B6,  -263,  -60 },
+    { 0x993FE2C6D07B7FAC,  -236,  -52 },
+    { 0xE45C10C42A2B3B06,  -210,  -44 },
+    { 0xAA242499697392D3,  -183,  -36 },
+    { 0xFD87B5F28300CA0E,  -157,  -28 },
+    { 0xBCE5086492111AEB,  -130,  -20 },
+    { 0x8CBCCC096F5088CC,  -103,  -12 },
+    { 0xD1B71758E219652C,   -77,   -4 },
+    { 0x9C40000000000000,   -50,    4 },
+    { 0xE8D4A51000000000,   -24,   12 },
+    { 0xAD78EBC5AC620000,     3,   20 },
+    { 0x813F3978F8940984,    30,   28 },
+    { 0xC097CE7BC90715B3,    56,   36 },
+    { 0x8F7E32CE7BEA5C70,    83,   44 },
+    { 0xD5D238A4ABE98068,   109,   52 },
+    { 0x9F4F2726179A2245,   136,   60 },
+    { 0xED63A231D4C4FB27,   162,   68 },
+    { 0xB0DE65388CC8ADA8,   189,   76 },
+    { 0x83C7088E1AAB65DB,   216,   84 },
+    { 0xC45D1DF942711D9A,   242,   92 },
+    { 0x924D692CA61BE758,   269,  100 },
+    { 0xDA01EE641A708DEA,   295,  108 },
+    { 0xA26DA3999AEF774A,   322,  116 },
+    { 0xF209787BB47D6B85,   348,  124 },
+    { 0xB454E4A179DD1877,   375,  132 },
+    { 0x865B86925B9BC5C2,   402,  140 },
+    { 0xC83553C5C8965D3D,   428,  148 },
+    { 0x952AB45CFA97A0B3,   455,  156 },
+    { 0xDE469FBD99A05FE3,   481,  164 },
+    { 0xA59BC234DB398C25,   508,  172 },
+    { 0xF6C69A72A3989F5C,   534,  180 },
+    { 0xB7DCBF5354E9BECE,   561,  188 },
+    { 0x88FCF317F22241E2,   588,  196 },
+    { 0xCC20CE9BD35C78A5,   614,  204 },
+    { 0x98165AF37B2153DF,   641,  212 },
+    { 0xE2A0B5DC971F303A,   667,  220 },
+    { 0xA8D9D1535CE3B396,   694,  228 },
+    { 0xFB9B7CD9A4A7443C,   720,  236 },
+    { 0xBB764C4CA7A44410,   747,  244 },
+    { 0x8BAB8EEFB6409C1A,   774,  252 },
+    { 0xD01FEF10A657842C,   800,  260 },
+    { 0x9B10A4E5E9913129,   827,  268 },
+    { 0xE7109BFBA19C0C9D,   853,  276 },
+    { 0xAC2820D9623BF429,   880,  284 },
+    { 0x80444B5E7AA7CF85,   907,  292 },
+    { 0xBF21E44003ACDD2D,   933,  300 },
+    { 0x8E679C2F5E44FF8F,   960,  308 },
+    { 0xD433179D9C8CB841,   986,  316 },
+    { 0x9E19DB92B4E31BA9,  1013,  324 },
+};
+
+/* Powers of ten exactly representable in a double */
+static const double exactPowers[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* Mantissas of up to 19 digits always fit in 64 bits */
+#define PRV_MAX_MANTISSA_DIGITS 19
+
+#define PRV_SWAR_ZEROS 0x3030303030303030ULL
+
+/* Returns the high 64 bits of x * y and stores the low ones in lowP */
+static uint64_t prv_multiply64(uint64_t x,
+                               uint64_t y,
+                               uint64_t * lowP)
+{
+    uint64_t xHi = x >> 32;
+    uint64_t xLo = x & 0xFFFFFFFF;
+    uint64_t yHi = y >> 32;
+    uint64_t yLo = y & 0xFFFFFFFF;
+    uint64_t loLo = xLo * yLo;
+    uint64_t loHi = xLo * yHi;
+    uint64_t hiLo = xHi * yLo;
+    uint64_t middle;
+
+    middle = (loLo >> 32) + (loHi & 0xFFFFFFFF) + (hiLo & 0xFFFFFFFF);
+    *lowP = (middle << 32) | (loLo & 0xFFFFFFFF);
+    return xHi * yHi + (loHi >> 32) + (hiLo >> 32) + (middle >> 32);
+}
+
+static int prv_leadingZeros(uint64_t value)
+{
+    int count = 0;
+    int shift;
+
+    /* Binary search of the highest set bit, value is never 0 */
+    for (shift = 32; shift > 0; shift /= 2)
+    {
+        if ((value >> (64 - shift)) == 0)
+        {
+            value <<= shift;
+            count += shift;
+        }
+    }
+    return count;
+}
+
+/* Reads eight bytes with the first one in the lowest bits, whatever the endianness */
+static uint64_t prv_readWord(const uint8_t * buffer)
+{
+    return (uint64_t)buffer[0]
+         | ((uint64_t)buffer[1] << 8)
+         | ((uint64_t)buffer[2] << 16)
+         | ((uint64_t)buffer[3] << 24)
+         | ((uint64_t)buffer[4] << 32)
+         | ((uint64_t)buffer[5] << 40)
+         | ((uint64_t)buffer[6] << 48)
+         | ((uint64_t)buffer[7] << 56);
+}
+
+/* Converts eight ASCII digits at once, or returns false if one is not a digit */
+static bool prv_parseEightDigits(const uint8_t * buffer,
+                                 uint32_t * valueP)
+{
+    uint64_t word = prv_readWord(buffer);
+    uint64_t digits = word - PRV_SWAR_ZEROS;
+
+    /* A byte is a digit when it is 0x3X and 0x3X + 6 does not carry into 0x40 */
+    if (((word & 0xF0F0F0F0F0F0F0F0ULL)
+       | (((word + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) != 0x3333333333333333ULL)
+    {
+        return false;
+    }
+
+    /* Combine pairs of digits, then pairs of pairs, then the two halves */
+    digits = (digits * 10) + (digits >> 8);
+    digits = (((digits & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)))
+            + (((digits >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+    *valueP = (uint32_t)digits;
+
+    return true;
+}
+
+/* Parses a string made only of digits, failing on overflow */
+static int prv_textToUInt(const uint8_t * buffer,
+                          int length,
+                          uint64_t * dataP)
+{
+    uint64_t result = 0;
+    int i = 0;
+    uint32_t eight;
+
+    if (length <= 0) return 0;
+
+    /* Sixteen digits can never overflow */
+    while (i + 8 <= length && i + 8 <= 16 && prv_parseEightDigits(buffer + i, &eight))
+    {
+        result = result * 100000000 + eight;
+        i += 8;
+    }
+    while (i < length)
+    {
+        unsigned digit = (unsigned)buffer[i] - '0';
+
+        if (digit > 9) return 0;
+        if (result > (UINT64_MAX - digit) / 10) return 0;
+        result = result * 10 + digit;
+        i++;
+    }
+
+    *dataP = result;
+
+    return 1;
+}
+
 int utils_textToInt(const uint8_t * buffer,
                     int length,
                     int64_t * dataP)
 {
-    uint64_t result = 0;
+    uint64_t result;
     int sign = 1;
     int i = 0;
 
@@ -73,20 +284,7 @@ int utils_textToInt(const uint8_t * buffer,
         i = 1;
     }
 
-    while (i < length)
-    {
-        if ('0' <= buffer[i] && buffer[i] <= '9')
-        {
-            if (result > (UINT64_MAX / 10)) return 0;
-            result *= 10;
-            result += buffer[i] - '0';
-        }
-        else
-        {
-            return 0;
-        }
-        i++;
-    }
+    if (!prv_textToUInt(buffer + i, length - i, &result)) return 0;
 
     if (result > INT64_MAX + (uint64_t)(sign == -1 ? 1 : 0)) return 0;
 
@@ -106,29 +304,204 @@ int utils_textToUInt(const uint8_t * buffer,
                      int length,
                      uint64_t * dataP)
 {
-    uint64_t result = 0;
-    int i = 0;
+    return prv_textToUInt(buffer, length, dataP);
+}
 
-    if (0 == length) return 0;
+/* Computes mantissa * 10^exponent correctly rounded, or returns false when
+ * it cannot decide quickly. */
+static bool prv_decimalToDouble(uint64_t mantissa,
+                                int exponent,
+                                double * dataP)
+{
+    const float_cached_power_t * powerP;
+    uint64_t powerF;
+    int powerE;
+    uint64_t high;
+    uint64_t low;
+    int shift;
+    int binaryExponent;
+    uint64_t bits;
+    unsigned remainder;
+
+    if (mantissa == 0)
+    {
+        *dataP = 0;
+        return true;
+    }
 
-    while (i < length)
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    /* Clinger's fast path: both operands are exact, so is the single rounding */
+    if (mantissa <= ((uint64_t)1 << 53)
+     && exponent >= -22 && exponent <= 22)
     {
-        if ('0' <= buffer[i] && buffer[i] <= '9')
+        if (exponent < 0)
         {
-            if (result > (UINT64_MAX / 10)) return 0;
-            result *= 10;
-            result += buffer[i] - '0';
+            *dataP = (double)mantissa / exactPowers[-exponent];
         }
         else
         {
-            return 0;
+            *dataP = (double)mantissa * exactPowers[exponent];
         }
+        return true;
+    }
+#endif
+
+    /* Eisel-Lemire: multiply by a 64 bit approximation of 10^exponent and
+     * round, unless the error bound leaves the rounding undecided. Subnormals
+     * and overflows are left to the slow path too. */
+    if (exponent < PRV_CACHED_POWER_MIN_EXP || exponent > 308) return false;
+    powerP = cachedPowers + (exponent - PRV_CACHED_POWER_MIN_EXP) / PRV_CACHED_POWER_EXP_STEP;
+    powerF = powerP->f;
+    powerE = powerP->e;
+    if (exponent != powerP->k)
+    {
+        /* Times an exact 10^1 to 10^7 */
+        high = prv_multiply64(powerF, (uint64_t)exactPowers[exponent - powerP->k], &low);
+        shift = prv_leadingZeros(high);
+        powerF = (high << shift) | (low >> (64 - shift));
+        powerE += 64 - shift;
+    }
+
+    shift = prv_leadingZeros(mantissa);
+    high = prv_multiply64(mantissa << shift, powerF, &low);
+    binaryExponent = powerE - shift + 64;
+    if ((high >> 63) == 0)
+    {
+        high = (high << 1) | (low >> 63);
+        binaryExponent--;
+    }
+
+    /* high approximates the value within 8 units. 53 bits are kept, the
+     * other 11 decide the rounding. */
+    remainder = (unsigned)(high & 0x7FF);
+    if (remainder >= 0x400 - 8 && remainder <= 0x400 + 8) return false;
+    high >>= 11;
+    binaryExponent += 11;
+    if (remainder > 0x400)
+    {
+        high++;
+        if (high == ((uint64_t)1 << 53))
+        {
+            high >>= 1;
+            binaryExponent++;
+        }
+    }
+
+    /* Biased exponent of the double, whose implicit bit is bit 52 */
+    binaryExponent += 52 + 1023;
+    if (binaryExponent <= 0 || binaryExponent >= 0x7FF) return false;
+
+    bits = ((uint64_t)binaryExponent << 52) | (high & (((uint64_t)1 << 52) - 1));
+    memcpy(dataP, &bits, sizeof(bits));
+
+    return true;
+}
+
+/* Parses the longest decimal number at the start of the buffer. Returns
+ * false when it is not a plain decimal number or it cannot be converted
+ * quickly, leaving it to strtod(). */
+static bool prv_parseFloat(const uint8_t * buffer,
+                           int length,
+                           bool allowExponential,
+                           double * dataP)
+{
+    uint64_t mantissa = 0;
+    int significant = 0;
+    int exponent = 0;
+    int digits = 0;
+    bool negative = false;
+    int i = 0;
+    uint32_t eight;
+
+    while (i < length && isspace(buffer[i])) i++;
+    if (i < length && (buffer[i] == '-' || buffer[i] == '+'))
+    {
+        negative = buffer[i] == '-';
         i++;
     }
+    /* Hexadecimal floats */
+    if (i + 1 < length && buffer[i] == '0' && (buffer[i + 1] == 'x' || buffer[i + 1] == 'X')) return false;
 
-    *dataP = result;
+    while (i < length && buffer[i] == '0')
+    {
+        i++;
+        digits++;
+    }
+    while (i + 8 <= length && significant + 8 <= PRV_MAX_MANTISSA_DIGITS && prv_parseEightDigits(buffer + i, &eight))
+    {
+        mantissa = mantissa * 100000000 + eight;
+        significant += 8;
+        digits += 8;
+        i += 8;
+    }
+    while (i < length && buffer[i] >= '0' && buffer[i] <= '9')
+    {
+        if (significant == PRV_MAX_MANTISSA_DIGITS) return false;
+        mantissa = mantissa * 10 + (buffer[i] - '0');
+        if (mantissa != 0) significant++;
+        digits++;
+        i++;
+    }
 
-    return 1;
+    if (i < length && buffer[i] == '.')
+    {
+        i++;
+        if (mantissa == 0)
+        {
+            while (i < length && buffer[i] == '0')
+            {
+                i++;
+                digits++;
+                exponent--;
+            }
+        }
+        while (i + 8 <= length && significant + 8 <= PRV_MAX_MANTISSA_DIGITS && prv_parseEightDigits(buffer + i, &eight))
+        {
+            mantissa = mantissa * 100000000 + eight;
+            significant += 8;
+            digits += 8;
+            exponent -= 8;
+            i += 8;
+        }
+        while (i < length && buffer[i] >= '0' && buffer[i] <= '9')
+        {
+            if (significant == PRV_MAX_MANTISSA_DIGITS) return false;
+            mantissa = mantissa * 10 + (buffer[i] - '0');
+            if (mantissa != 0) significant++;
+            digits++;
+            exponent--;
+            i++;
+        }
+    }
+    if (digits == 0) return false;
+
+    if (allowExponential && i + 1 < length && (buffer[i] == 'e' || buffer[i] == 'E'))
+    {
+        int j = i + 1;
+        bool negativeExponent = false;
+        int value = 0;
+
+        if (buffer[j] == '-' || buffer[j] == '+')
+        {
+            negativeExponent = buffer[j] == '-';
+            j++;
+        }
+        /* Without digits the 'e' is not part of the number */
+        if (j < length && buffer[j] >= '0' && buffer[j] <= '9')
+        {
+            while (j < length && buffer[j] >= '0' && buffer[j] <= '9')
+            {
+                if (value < 100000) value = value * 10 + (buffer[j] - '0');
+                j++;
+            }
+            exponent += negativeExponent ? -value : value;
+        }
+    }
+
+    if (!prv_decimalToDouble(mantissa, exponent, dataP)) return false;
+    if (negative) *dataP = -*dataP;
+
+    return true;
 }
 
 int utils_textToFloat(const uint8_t * buffer,
@@ -142,6 +515,15 @@ int utils_textToFloat(const uint8_t * buffer,
         return 0;
     }
 
+    if (!allowExponential && (memchr(buffer, 'e', length) != NULL || memchr(buffer, 'E', length) != NULL)) {
+        return 0;
+    }
+
+    if (prv_parseFloat(buffer, length, allowExponential, dataP)) {
+        return 1;
+    }
+
+    /* Special values, hexadecimal floats, long mantissas and undecided roundings */
     char *const buffer_c_str = lwm2m_malloc(length + 1);
     char *tailptr;
 
@@ -152,10 +534,6 @@ int utils_textToFloat(const uint8_t * buffer,
     memcpy(buffer_c_str, buffer, length);
     buffer_c_str[length] = '\0';
 
-    if (!allowExponential && (strchr(buffer_c_str, 'e') != NULL || strchr(buffer_c_str, 'E') != NULL)) {
-        goto out;
-    }
-
     *dataP = strtod(buffer_c_str, &tailptr);
 
     if (tailptr == buffer_c_str) {
@@ -264,286 +642,402 @@ size_t utils_uintToText(uint64_t data,
     return result;
 }
 
-size_t utils_floatToText(double data,
-                         uint8_t * string,
-                         size_t length,
-                         bool allowExponential)
+/* Shortest round-trip conversion of doubles to decimal digits, using the
+ * Grisu2 algorithm from Florian Loitsch, "Printing Floating-Point Numbers
+ * Quickly and Accurately with Integers" (PLDI 2010). The digits always read
+ * back to the same double. */
+
+#define PRV_FLOAT_MAX_DIGITS 17
+
+/* Grisu2 keeps the scaled boundaries in [2^PRV_GRISU_ALPHA, 2^PRV_GRISU_GAMMA]
+ * so that the integral part of the digit generation fits in 32 bits. */
+#define PRV_GRISU_ALPHA -60
+#define PRV_GRISU_GAMMA -32
+
+typedef struct
 {
-    uint64_t intPart;
-    double decPart;
-    double noiseFloor;
-    double roundCheck;
-    size_t res;
-    size_t head = 0;
-    int zeros = 0; /* positive for trailing, negative for leading */
-    uint8_t expLen = 0;
-    int precisionFactor = 1; /* Adjusts for inaccuracies caused by power of 10 operations. */
-    unsigned digits;
+    uint64_t f;
+    int      e;
+} float_diyfp_t;
 
-    if (!length || !string) return 0;
 
-    if (data < 0)
-    {
-        string[head++] = '-';
-        data = -data;
-    }
+static void prv_diyfpMultiply(float_diyfp_t * xP,
+                              const float_cached_power_t * yP)
+{
+    uint64_t low;
 
-    /* Handle special cases */
-    if (data < DBL_MIN)
-    {
-        /* Intentionally not distinguishing between +0.0 and -0.0. */
-        if (length < 3) return 0;
-        string[0] = '0';
-        string[1] = '.';
-        string[2] = '0';
-        if (length > 3) string[3] = '\0';
-        return 3;
-    }
-    else if (data > DBL_MAX )
+    /* Keep the upper 64 bits of the 128 bit product, rounded */
+    xP->f = prv_multiply64(xP->f, yP->f, &low) + (low >> 63);
+    xP->e = xP->e + yP->e + 64;
+}
+
+static void prv_diyfpNormalize(float_diyfp_t * xP)
+{
+    int shift = prv_leadingZeros(xP->f);
+
+    xP->f <<= shift;
+    xP->e -= shift;
+}
+
+static const float_cached_power_t * prv_getCachedPower(int e)
+{
+    /* Smallest k with 10^k * 2^e >= 2^PRV_GRISU_ALPHA, 78913 / 2^18 being log10(2) */
+    int f = PRV_GRISU_ALPHA - e - 1;
+    int k = (f * 78913) / (1 << 18) + (f > 0 ? 1 : 0);
+    int index = (k - PRV_CACHED_POWER_MIN_EXP + PRV_CACHED_POWER_EXP_STEP - 1) / PRV_CACHED_POWER_EXP_STEP;
+
+    return cachedPowers + index;
+}
+
+/* Moves the last digit down while the result stays inside the boundaries and gets closer to the exact value */
+static void prv_grisuRound(char * digits,
+                           int count,
+                           uint64_t distance,
+                           uint64_t delta,
+                           uint64_t rest,
+                           uint64_t tenK)
+{
+    while (rest < distance
+        && delta - rest >= tenK
+        && (rest + tenK < distance || distance - rest > rest + tenK - distance))
     {
-        /* Note that this is not valid for JSON. */
-        if (length < 3 + head) return 0;
-        string[head++] = 'i';
-        string[head++] = 'n';
-        string[head++] = 'f';
-        if (length > head) string[head] = '\0';
-        return head;
+        digits[count - 1]--;
+        rest += tenK;
     }
-    else if (isnan(data))
+}
+
+/* Generates the shortest digits of a value between low and high. Returns the
+ * number of digits and adds the position of the last digit to exponentP. */
+static int prv_grisuGenerate(char * digits,
+                             int * exponentP,
+                             const float_diyfp_t * lowP,
+                             const float_diyfp_t * valueP,
+                             const float_diyfp_t * highP)
+{
+    uint64_t delta = highP->f - lowP->f;
+    uint64_t distance = highP->f - valueP->f;
+    int shift = -highP->e;
+    uint64_t mask = ((uint64_t)1 << shift) - 1;
+    uint32_t intPart = (uint32_t)(highP->f >> shift);
+    uint64_t fracPart = highP->f & mask;
+    uint32_t divisor;
+    int remaining;
+    int count = 0;
+
+    /* Number of digits of the integral part */
+    remaining = 1;
+    divisor = 1;
+    while (remaining < 10 && intPart / divisor >= 10)
     {
-        /* NaN */
-        /* Note that this is not valid for JSON. */
-        if (length < 3 + head) return 0;
-        string[head++] = 'n';
-        string[head++] = 'a';
-        string[head++] = 'n';
-        if (length > head) string[head] = '\0';
-        return head;
+        divisor *= 10;
+        remaining++;
     }
 
-    /* Scale to usable range. Assumes DBL_DIG is 15 (IEEE 754 double) */
-    if (data > 1e15)
+    while (remaining > 0)
     {
-        while (data > 1e100)
-        {
-            data *= 1e-100;
-            zeros += 100;
-            precisionFactor++;
-        }
-        if (allowExponential)
-        {
-            /* Take data down below 10 so only 1 digit before the decimal point */
-            while (data > 1e10)
-            {
-                data *= 1e-10;
-                zeros += 10;
-                precisionFactor++;
-            }
-            while (data > 10)
-            {
-                data *= 0.1;
-                zeros += 1;
-                precisionFactor++;
-            }
-            if (zeros >= 100)
-            {
-                expLen = 4;
-            }
-            else if(zeros >= 10)
-            {
-                expLen = 3;
-            }
-            else
-            {
-                expLen = 2;
-            }
-        }
-        else
+        uint64_t rest;
+
+        digits[count++] = (char)('0' + intPart / divisor);
+        intPart %= divisor;
+        remaining--;
+
+        rest = ((uint64_t)intPart << shift) + fracPart;
+        if (rest <= delta)
         {
-            /* Take data down to 15 significant digits before 0s. */
-            while (data >= 1e25)
-            {
-                data *= 1e-10;
-                zeros += 10;
-                precisionFactor++;
-            }
-            while (data > 1e15)
-            {
-                data *= 0.1;
-                zeros += 1;
-                precisionFactor++;
-            }
-            /* Account for lost digits of precision */
-            if (precisionFactor >= 19)
-            {
-                data *= 0.01;
-                zeros += 2;
-                precisionFactor++;
-            }
-            else if (precisionFactor >= 10)
-            {
-                data *= 0.1;
-                zeros += 1;
-                precisionFactor++;
-            }
+            *exponentP += remaining;
+            prv_grisuRound(digits, count, distance, delta, rest, (uint64_t)divisor << shift);
+            return count;
         }
+        divisor /= 10;
     }
-    /* Exponential notation will add at least 3 characters. Make sure we save
-     * at least that many 0s. */
-    else if (data < (allowExponential ? 1e-3 : 0.1))
+
+    do
     {
-        /* For exponential notation take data to between 1 and 10, excluding 10.
-         * Otherwise take data to between 0.1 and 1, excluding 1. */
-        while (data < 1e-100)
-        {
-            data *= 1e100;
-            zeros -= 100;
-            precisionFactor++;
-        }
-        while (data < 1e-10)
-        {
-            data *= 1e10;
-            zeros -= 10;
-            precisionFactor++;
-        }
-        while (data < (allowExponential ? 1 : 0.1))
-        {
-            data *= 10;
-            zeros -= 1;
-            precisionFactor++;
-        }
-        if (allowExponential)
-        {
-            if (zeros <= -100)
-            {
-                expLen = 5;
-            }
-            else if(zeros <= -10)
-            {
-                expLen = 4;
-            }
-            else
-            {
-                expLen = 3;
-            }
-        }
-    }
+        fracPart *= 10;
+        delta *= 10;
+        distance *= 10;
+        digits[count++] = (char)('0' + (fracPart >> shift));
+        fracPart &= mask;
+        (*exponentP)--;
+    } while (fracPart > delta);
+
+    prv_grisuRound(digits, count, distance, delta, fracPart, mask + 1);
+
+    return count;
+}
 
-    noiseFloor = DBL_EPSILON * precisionFactor;
-    /* Adjust the noise floor to account for digits left of the decimal point. */
-    intPart = (uint64_t)data;
-    if (!intPart)
+/* Writes the shortest digits of a positive finite value, which equals
+ * 0.<digits> * 10^*pointP. Returns the number of digits. */
+static int prv_floatToDigits(double data,
+                             char * digits,
+                             int * pointP)
+{
+    uint64_t bits;
+    uint64_t mantissa;
+    int biasedExponent;
+    float_diyfp_t value;
+    float_diyfp_t low;
+    float_diyfp_t high;
+    const float_cached_power_t * powerP;
+    int exponent;
+    int count;
+
+    memcpy(&bits, &data, sizeof(bits));
+    mantissa = bits & (((uint64_t)1 << 52) - 1);
+    biasedExponent = (int)(bits >> 52) & 0x7FF;
+
+    if (biasedExponent == 0)
     {
-        /* Leading 0 and decimal point */
-        digits = 2;
+        value.f = mantissa;
+        value.e = 1 - 1075;
     }
     else
     {
-        /* Decimal point */
-        digits = 1;
+        value.f = mantissa | ((uint64_t)1 << 52);
+        value.e = biasedExponent - 1075;
     }
-    while (intPart > 0)
+
+    /* Boundaries halfway to the neighbouring doubles. The lower one is closer
+     * when the value is a power of two. */
+    high.f = (value.f << 1) + 1;
+    high.e = value.e - 1;
+    prv_diyfpNormalize(&high);
+    if (mantissa == 0 && biasedExponent > 1)
     {
-        noiseFloor *= 10;
-        intPart /= 10;
-        digits++;
+        low.f = (value.f << 2) - 1;
+        low.e = value.e - 2;
     }
-
-    intPart = (uint64_t)data;
-    decPart = data - intPart;
-    if (!allowExponential && zeros > 0)
+    else
     {
-        /* Ensure all significant digits are left of the zeros */
-        while (zeros > 0 && noiseFloor < 1)
-        {
-            decPart *= 10;
-            intPart = intPart * 10 + (unsigned)decPart;
-            decPart -= (unsigned)decPart;
-            zeros--;
-            noiseFloor *= 10;
-            digits++;
-        }
-        decPart = 0;
+        low.f = (value.f << 1) - 1;
+        low.e = value.e - 1;
     }
+    low.f <<= low.e - high.e;
+    low.e = high.e;
+    prv_diyfpNormalize(&value);
+
+    /* Scale so that the high boundary exponent is in [alpha, gamma] */
+    powerP = prv_getCachedPower(high.e);
+    prv_diyfpMultiply(&value, powerP);
+    prv_diyfpMultiply(&low, powerP);
+    prv_diyfpMultiply(&high, powerP);
 
-    if (decPart > noiseFloor)
+    /* Stay safely inside the boundaries despite the rounding of the multiplication */
+    low.f += 1;
+    high.f -= 1;
+
+    exponent = -powerP->k;
+    count = prv_grisuGenerate(digits, &exponent, &low, &value, &high);
+    *pointP = count + exponent;
+
+    return count;
+}
+
+/* Rounds the digits half up to at most target digits and drops trailing zeros */
+static void prv_roundDigits(char * digits,
+                            int * countP,
+                            int * pointP,
+                            int target)
+{
+    int count;
+
+    if (target >= *countP) return;
+    if (target < 0)
     {
-        /* Add 1 to the decimal part so we don't lose leading 0s. */
-        decPart += 1;
+        *countP = 0;
+        return;
+    }
 
-        /* Limit the number of digits to space in the buffer and round. */
-        roundCheck = 2;
-        do
+    count = target;
+    if (digits[target] >= '5')
+    {
+        while (count > 0 && digits[count - 1] == '9') count--;
+        if (count == 0)
         {
-            digits++;
-            if (head + expLen + digits > length) break;
-            decPart *= 10;
-            roundCheck *= 10;
-            noiseFloor *= 10;
-        } while (decPart - (uint64_t)decPart > noiseFloor);
-        decPart += 0.5;
-        if (decPart >= roundCheck)
+            digits[0] = '1';
+            count = 1;
+            (*pointP)++;
+        }
+        else
         {
-            intPart += 1;
+            digits[count - 1]++;
         }
     }
+    while (count > 0 && digits[count - 1] == '0') count--;
 
-    /* Put out the significant digits left of the decimal point or zeros. */
-    res = utils_uintToText(intPart, string + head, length - head);
-    if (res == 0) return 0;
-    head += res;
+    *countP = count;
+}
 
-    if (decPart <= noiseFloor
-     || (!allowExponential && -zeros >= (int)(length - head)))
+/* Copies the digits, or zeros when digits is NULL. Numbers are short, this
+ * is faster than calls to memcpy() and memset(). */
+static void prv_putChars(uint8_t * string,
+                         const char * digits,
+                         int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
     {
-        /* Only 0s right of the significant digits */
-        if (!allowExponential && zeros > 0)
-        {
-            if (head + zeros > length) return 0;
-            memset(string + head, '0', zeros);
-            head += zeros;
-        }
-        /* Add as much of ".0" as space permits */
-        if (head < length) string[head++] = '.';
-        if (head < length) string[head++] = '0';
-        if (head < length) string[head] = '\0';
-        return head;
+        string[i] = digits != NULL ? (uint8_t)digits[i] : '0';
     }
+}
 
-    if (!allowExponential && zeros < 0)
+static size_t prv_zeroToText(uint8_t * string,
+                             size_t length)
+{
+    /* Intentionally not distinguishing between +0.0 and -0.0. */
+    if (length < 3) return 0;
+    string[0] = '0';
+    string[1] = '.';
+    string[2] = '0';
+    if (length > 3) string[3] = '\0';
+    return 3;
+}
+
+size_t utils_floatToText(double data,
+                         uint8_t * string,
+                         size_t length,
+                         bool allowExponential)
+{
+    char digits[PRV_FLOAT_MAX_DIGITS + 1];
+    int count;
+    int point;
+    size_t head = 0;
+    size_t res;
+
+    if (!length || !string) return 0;
+
+    if (isnan(data))
     {
-        /* Add "." plus leading 0s. Leaving one off to be added back later. */
-        if (head - zeros > length) return 0;
-        string[head] = '.';
-        if (zeros < -1) memset(string + head + 1, '0', -(zeros) - 1);
-        head -= zeros;
+        /* Note that this is not valid for JSON. */
+        if (length < 3) return 0;
+        memcpy(string, "nan", 3);
+        if (length > 3) string[3] = '\0';
+        return 3;
     }
 
-    /* Digits for the fractional part. */
-    res = utils_uintToText((uint64_t)decPart, string + head, length - head);
-    if (!res) return 0;
+    if (data < 0)
+    {
+        string[head++] = '-';
+        data = -data;
+    }
 
-    // replace the leading 1 with a decimal point or 0
-    if (!allowExponential && zeros < 0)
+    if (data <= 0)
     {
-        string[head] = '0';
+        return prv_zeroToText(string, length);
     }
-    else
+    if (isinf(data))
     {
-        string[head] = '.';
+        /* Note that this is not valid for JSON. */
+        if (length < 3 + head) return 0;
+        memcpy(string + head, "inf", 3);
+        head += 3;
+        if (length > head) string[head] = '\0';
+        return head;
     }
-    head += res;
 
-    if (allowExponential && zeros)
+    count = prv_floatToDigits(data, digits, &point);
+
+    if (allowExponential && (data > 1e15 || data < 1e-3))
     {
-        if (head + expLen > length) return 0;
-        string[head++] = 'e';
-        res = utils_intToText(zeros, string + head, length - head);
-        if (res == 0) return 0;
-        head += res;
+        /* d.ddde-N, dropping digits that do not fit */
+        for (;;)
+        {
+            int exponent;
+            size_t expLen;
+            int target;
+
+            if (count == 0) return prv_zeroToText(string, length);
+
+            exponent = point - 1;
+            expLen = (exponent < 0 ? 2 : 1) + (exponent <= -100 || exponent >= 100 ? 3 : (exponent <= -10 || exponent >= 10 ? 2 : 1));
+            if (head + expLen + (count == 1 ? 3 : count + 1) <= length
+             || (count == 1 && head + expLen + 1 <= length))
+            {
+                string[head++] = (uint8_t)digits[0];
+                if (count > 1)
+                {
+                    string[head++] = '.';
+                    prv_putChars(string + head, digits + 1, count - 1);
+                    head += count - 1;
+                }
+                else if (head + expLen + 2 <= length)
+                {
+                    string[head++] = '.';
+                    string[head++] = '0';
+                }
+                string[head++] = 'e';
+                res = utils_intToText(exponent, string + head, length - head);
+                if (res == 0) return 0;
+                head += res;
+                if (length > head) string[head] = '\0';
+                return head;
+            }
+
+            target = (int)length - (int)head - (int)expLen - 1;
+            if (target < 1)
+            {
+                /* Not even one significant digit fits */
+                if (point <= 0) return prv_zeroToText(string, length);
+                return 0;
+            }
+            prv_roundDigits(digits, &count, &point, target);
+        }
     }
 
-    return head;
+    /* Plain decimal notation, dropping fractional digits that do not fit */
+    for (;;)
+    {
+        int target;
+
+        if (count == 0) return prv_zeroToText(string, length);
+
+        if (point >= count)
+        {
+            /* Integral value: digits, trailing zeros and as much of ".0" as space permits */
+            if (head + point > length) return 0;
+            prv_putChars(string + head, digits, count);
+            head += count;
+            prv_putChars(string + head, NULL, point - count);
+            head += point - count;
+            if (head < length) string[head++] = '.';
+            if (head < length) string[head++] = '0';
+            if (head < length) string[head] = '\0';
+            return head;
+        }
+
+        if (point > 0)
+        {
+            if (head + count + 1 <= length)
+            {
+                prv_putChars(string + head, digits, point);
+                head += point;
+                string[head++] = '.';
+                prv_putChars(string + head, digits + point, count - point);
+                head += count - point;
+                if (head < length) string[head] = '\0';
+                return head;
+            }
+            target = (int)length - (int)head - 1;
+            if (target < point) target = point;
+        }
+        else
+        {
+            if (head + 2 - point + count <= length)
+            {
+                string[head++] = '0';
+                string[head++] = '.';
+                prv_putChars(string + head, NULL, -point);
+                head -= point;
+                prv_putChars(string + head, digits, count);
+                head += count;
+                if (head < length) string[head] = '\0';
+                return head;
+            }
+            target = (int)length - (int)head - 2 + point;
+        }
+        prv_roundDigits(digits, &count, &point, target);
+    }
 }
 
 size_t utils_objLinkToText(uint16_t objectId,
@@ -708,6 +1202,12 @@ lwm2m_media_type_t utils_convertMediaType(coap_content_type_t type)
     case LWM2M_CONTENT_SENML_JSON:
         result = LWM2M_CONTENT_SENML_JSON;
         break;
+    case LWM2M_CONTENT_SENML_CBOR:
+        result = LWM2M_CONTENT_SENML_CBOR;
+        break;
+    case LWM2M_CONTENT_LWM2M_CBOR:
+        result = LWM2M_CONTENT_LWM2M_CBOR;
+        break;
     case APPLICATION_LINK_FORMAT:
         result = LWM2M_CONTENT_LINK;
         break;
@@ -803,6 +1303,20 @@ uint8_t utils_getResponseFormat(uint8_t accept_num,
                 break;
 #endif
 
+#ifdef LWM2M_SUPPORT_SENML_CBOR
+            case LWM2M_CONTENT_SENML_CBOR:
+                *format = LWM2M_CONTENT_SENML_CBOR;
+                found = true;
+                break;
+#endif
+
+#ifdef LWM2M_SUPPORT_LWM2M_CBOR
+            case LWM2M_CONTENT_LWM2M_CBOR:
+                *format = LWM2M_CONTENT_LWM2M_CBOR;
+                found = true;
+                break;
+#endif
+
             default:
                 break;
             }
@@ -811,7 +1325,9 @@ uint8_t utils_getResponseFormat(uint8_t accept_num,
     }
     else
     {
-#ifdef LWM2M_SUPPORT_SENML_JSON
+#ifdef LWM2M_SUPPORT_SENML_CBOR
+        *format = LWM2M_CONTENT_SENML_CBOR;
+#elif defined(LWM2M_SUPPORT_SENML_JSON)
         *format = LWM2M_CONTENT_SENML_JSON;
 #elif defined(LWM2M_SUPPORT_JSON)
         *format = LWM2M_CONTENT_JSON;
@@ -866,20 +1382,121 @@ lwm2m_server_t * utils_findBootstrapServer(lwm2m_context_t * contextP,
 }
 
 #ifndef LWM2M_CLIENT_MODE
+#ifdef LWM2M_SESSION_HASH
+static bool prv_matchClientSession(const void * item,
+                                   const void * key,
+                                   void * userData)
+{
+    return lwm2m_session_is_equal(((lwm2m_client_t *)item)->sessionH, (void *)key, userData);
+}
+#endif
+
+static bool prv_matchClientName(const void * item,
+                                const void * key,
+                                void * userData)
+{
+    (void)userData;
+
+    return 0 == strcmp(((lwm2m_client_t *)item)->name, (const char *)key);
+}
+
+static bool prv_matchClientId(const void * item,
+                              const void * key,
+                              void * userData)
+{
+    (void)userData;
+
+    return ((lwm2m_client_t *)item)->internalID == *(const uint16_t *)key;
+}
+
 lwm2m_client_t * utils_findClient(lwm2m_context_t * contextP,
                                   void * fromSessionH)
 {
     lwm2m_client_t * targetP;
 
+#ifdef LWM2M_SESSION_HASH
+    targetP = (lwm2m_client_t *)index_find(&contextP->clientSessionIndex,
+                                           lwm2m_session_hash(fromSessionH, contextP->userData),
+                                           prv_matchClientSession,
+                                           fromSessionH,
+                                           contextP->userData);
+#else
     targetP = contextP->clientList;
     while (targetP != NULL
         && false == lwm2m_session_is_equal(targetP->sessionH, fromSessionH, contextP->userData))
     {
         targetP = targetP->next;
     }
+#endif
 
     return targetP;
 }
+
+lwm2m_client_t * utils_findClientByName(lwm2m_context_t * contextP,
+                                        const char * name)
+{
+    return (lwm2m_client_t *)index_find(&contextP->clientNameIndex,
+                                        index_hashString(name),
+                                        prv_matchClientName,
+                                        name,
+                                        NULL);
+}
+
+lwm2m_client_t * utils_findClientById(lwm2m_context_t * contextP,
+                                      uint16_t clientID)
+{
+    return (lwm2m_client_t *)index_find(&contextP->clientIdIndex,
+                                        index_hashInteger(clientID),
+                                        prv_matchClientId,
+                                        &clientID,
+                                        NULL);
+}
+
+// Add the client to the indexes of the context according to its current internalID, name and session.
+// This must be called after adding the client to the clientList and after changing one of these fields.
+bool utils_indexClient(lwm2m_context_t * contextP,
+                       lwm2m_client_t * clientP)
+{
+    if (!index_add(&contextP->clientIdIndex, index_hashInteger(clientP->internalID), clientP))
+    {
+        return false;
+    }
+    if (clientP->name != NULL
+     && !index_add(&contextP->clientNameIndex, index_hashString(clientP->name), clientP))
+    {
+        index_remove(&contextP->clientIdIndex, index_hashInteger(clientP->internalID), clientP);
+        return false;
+    }
+#ifdef LWM2M_SESSION_HASH
+    if (clientP->sessionH != NULL
+     && !index_add(&contextP->clientSessionIndex, lwm2m_session_hash(clientP->sessionH, contextP->userData), clientP))
+    {
+        if (clientP->name != NULL) index_remove(&contextP->clientNameIndex, index_hashString(clientP->name), clientP);
+        index_remove(&contextP->clientIdIndex, index_hashInteger(clientP->internalID), clientP);
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+// Remove the client from the indexes of the context.
+// This must be called before removing the client from the clientList and before changing its internalID, name or session.
+void utils_unindexClient(lwm2m_context_t * contextP,
+                         lwm2m_client_t * clientP)
+{
+    index_remove(&contextP->clientIdIndex, index_hashInteger(clientP->internalID), clientP);
+    if (clientP->name != NULL)
+    {
+        index_remove(&contextP->clientNameIndex, index_hashString(clientP->name), clientP);
+    }
+#ifdef LWM2M_SESSION_HASH
+    if (clientP->sessionH != NULL)
+    {
+        index_remove(&contextP->clientSessionIndex, lwm2m_session_hash(clientP->sessionH, contextP->userData), clientP);
+    }
+#endif
+}
 #endif
 
 int utils_isAltPathValid(const char * altPath)
@@ -951,8 +1568,9 @@ void utils_copyValue(void * dst,
 
 
 #define PRV_B64_PADDING '='
+#define PRV_B64_INVALID 0xFF
 
-static char b64Alphabet[64] =
+static const char b64Alphabet[64] =
 {
     'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
     'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',
@@ -960,14 +1578,26 @@ static char b64Alphabet[64] =
     'w', 'x', 'y', 'z', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '+', '/'
 };
 
-static void prv_encodeBlock(const uint8_t input[3],
-                            uint8_t output[4])
+// value of each character in b64Alphabet, PRV_B64_INVALID for the others
+static const uint8_t b64Values[256] =
 {
-    output[0] = b64Alphabet[input[0] >> 2];
-    output[1] = b64Alphabet[((input[0] & 0x03) << 4) | (input[1] >> 4)];
-    output[2] = b64Alphabet[((input[1] & 0x0F) << 2) | (input[2] >> 6)];
-    output[3] = b64Alphabet[input[2] & 0x3F];
-}
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF, 0xFF, 0x3F,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
 
 size_t utils_base64GetSize(size_t dataLen)
 {
@@ -980,48 +1610,73 @@ size_t utils_base64GetSize(size_t dataLen)
 }
 
 size_t utils_base64Encode(const uint8_t * dataP,
-                          size_t dataLen, 
+                          size_t dataLen,
                           uint8_t * bufferP,
                           size_t bufferLen)
 {
-    unsigned int data_index;
-    unsigned int result_index;
-    size_t result_len;
+    size_t dataIndex;
+    size_t resultIndex;
+    size_t resultLen;
 
-    result_len = utils_base64GetSize(dataLen);
+    resultLen = utils_base64GetSize(dataLen);
 
-    if (result_len > bufferLen) return 0;
+    if (resultLen > bufferLen) return 0;
 
-    data_index = 0;
-    result_index = 0;
-    while (data_index < dataLen)
+    dataIndex = 0;
+    resultIndex = 0;
+    // six bytes at once into eight characters
+    while (dataLen - dataIndex >= 6)
     {
-        switch (dataLen - data_index)
-        {
-        case 0:
-            // should never happen
-            break;
-        case 1:
-            bufferP[result_index] = b64Alphabet[dataP[data_index] >> 2];
-            bufferP[result_index + 1] = b64Alphabet[(dataP[data_index] & 0x03) << 4];
-            bufferP[result_index + 2] = PRV_B64_PADDING;
-            bufferP[result_index + 3] = PRV_B64_PADDING;
-            break;
-        case 2:
-            bufferP[result_index] = b64Alphabet[dataP[data_index] >> 2];
-            bufferP[result_index + 1] = b64Alphabet[(dataP[data_index] & 0x03) << 4 | (dataP[data_index + 1] >> 4)];
-            bufferP[result_index + 2] = b64Alphabet[(dataP[data_index + 1] & 0x0F) << 2];
-            bufferP[result_index + 3] = PRV_B64_PADDING;
-            break;
-        default:
-            prv_encodeBlock(dataP + data_index, bufferP + result_index);
-            break;
-        }
-        data_index += 3;
-        result_index += 4;
+        uint64_t word = ((uint64_t)dataP[dataIndex] << 40)
+                      | ((uint64_t)dataP[dataIndex + 1] << 32)
+                      | ((uint64_t)dataP[dataIndex + 2] << 24)
+                      | ((uint64_t)dataP[dataIndex + 3] << 16)
+                      | ((uint64_t)dataP[dataIndex + 4] << 8)
+                      | (uint64_t)dataP[dataIndex + 5];
+
+        bufferP[resultIndex] = b64Alphabet[(word >> 42) & 0x3F];
+        bufferP[resultIndex + 1] = b64Alphabet[(word >> 36) & 0x3F];
+        bufferP[resultIndex + 2] = b64Alphabet[(word >> 30) & 0x3F];
+        bufferP[resultIndex + 3] = b64Alphabet[(word >> 24) & 0x3F];
+        bufferP[resultIndex + 4] = b64Alphabet[(word >> 18) & 0x3F];
+        bufferP[resultIndex + 5] = b64Alphabet[(word >> 12) & 0x3F];
+        bufferP[resultIndex + 6] = b64Alphabet[(word >> 6) & 0x3F];
+        bufferP[resultIndex + 7] = b64Alphabet[word & 0x3F];
+        dataIndex += 6;
+        resultIndex += 8;
+    }
+    while (dataLen - dataIndex >= 3)
+    {
+        uint32_t word = ((uint32_t)dataP[dataIndex] << 16)
+                      | ((uint32_t)dataP[dataIndex + 1] << 8)
+                      | (uint32_t)dataP[dataIndex + 2];
+
+        bufferP[resultIndex] = b64Alphabet[word >> 18];
+        bufferP[resultIndex + 1] = b64Alphabet[(word >> 12) & 0x3F];
+        bufferP[resultIndex + 2] = b64Alphabet[(word >> 6) & 0x3F];
+        bufferP[resultIndex + 3] = b64Alphabet[word & 0x3F];
+        dataIndex += 3;
+        resultIndex += 4;
+    }
+    switch (dataLen - dataIndex)
+    {
+    case 1:
+        bufferP[resultIndex] = b64Alphabet[dataP[dataIndex] >> 2];
+        bufferP[resultIndex + 1] = b64Alphabet[(dataP[dataIndex] & 0x03) << 4];
+        bufferP[resultIndex + 2] = PRV_B64_PADDING;
+        bufferP[resultIndex + 3] = PRV_B64_PADDING;
+        break;
+    case 2:
+        bufferP[resultIndex] = b64Alphabet[dataP[dataIndex] >> 2];
+        bufferP[resultIndex + 1] = b64Alphabet[(dataP[dataIndex] & 0x03) << 4 | (dataP[dataIndex + 1] >> 4)];
+        bufferP[resultIndex + 2] = b64Alphabet[(dataP[dataIndex + 1] & 0x0F) << 2];
+        bufferP[resultIndex + 3] = PRV_B64_PADDING;
+        break;
+    default:
+        break;
     }
 
-    return result_len;
+    return resultLen;
 }
 
 size_t utils_base64GetDecodedSize(const char * dataP, size_t dataLen)
@@ -1055,49 +1710,69 @@ size_t utils_base64GetDecodedSize(const char * dataP, size_t dataLen)
     return result;
 }
 
-static uint8_t prv_base64Value(char digit)
-{
-    uint8_t result = 0xFF;
-    if (digit >= 'A' && digit <= 'Z') result = digit - 'A';
-    else if (digit >= 'a' && digit <= 'z') result = digit - 'a' + 26;
-    else if (digit >= '0' && digit <= '9') result = digit - '0' + 52;
-    else if (digit == '+') result = 62;
-    else if (digit == '/') result = 63;
-    return result;
-}
-
 size_t utils_base64Decode(const char * dataP, size_t dataLen, uint8_t * bufferP, size_t bufferLen)
 {
+    const uint8_t * inputP = (const uint8_t *)dataP;
     size_t dataIndex;
     size_t bufferIndex;
+    size_t bulkLen;
     size_t decodedSize = utils_base64GetDecodedSize(dataP, dataLen);
 
     if(decodedSize > bufferLen) return 0;
 
+    // the last group of four characters may be padded
+    bulkLen = (dataLen % 4 == 0 && dataLen != 0) ? dataLen - 4 : dataLen - dataLen % 4;
+
     dataIndex = 0;
     bufferIndex = 0;
+    // eight characters at once into six bytes, validated together
+    while (bulkLen - dataIndex >= 8)
+    {
+        uint32_t v0 = b64Values[inputP[dataIndex]];
+        uint32_t v1 = b64Values[inputP[dataIndex + 1]];
+        uint32_t v2 = b64Values[inputP[dataIndex + 2]];
+        uint32_t v3 = b64Values[inputP[dataIndex + 3]];
+        uint32_t v4 = b64Values[inputP[dataIndex + 4]];
+        uint32_t v5 = b64Values[inputP[dataIndex + 5]];
+        uint32_t v6 = b64Values[inputP[dataIndex + 6]];
+        uint32_t v7 = b64Values[inputP[dataIndex + 7]];
+        uint32_t first;
+        uint32_t second;
+
+        if (((v0 | v1 | v2 | v3 | v4 | v5 | v6 | v7) & 0xC0) != 0) return 0;
+        first = (v0 << 18) | (v1 << 12) | (v2 << 6) | v3;
+        second = (v4 << 18) | (v5 << 12) | (v6 << 6) | v7;
+        bufferP[bufferIndex] = (uint8_t)(first >> 16);
+        bufferP[bufferIndex + 1] = (uint8_t)(first >> 8);
+        bufferP[bufferIndex + 2] = (uint8_t)first;
+        bufferP[bufferIndex + 3] = (uint8_t)(second >> 16);
+        bufferP[bufferIndex + 4] = (uint8_t)(second >> 8);
+        bufferP[bufferIndex + 5] = (uint8_t)second;
+        dataIndex += 8;
+        bufferIndex += 6;
+    }
     while (dataIndex < dataLen)
     {
         uint8_t v1, v2, v3, v4;
         if (dataLen - dataIndex < 2) return 0;
-        v1 = prv_base64Value(dataP[dataIndex++]);
-        if (v1 >= 64) return 0;
-        v2 = prv_base64Value(dataP[dataIndex++]);
-        if (v2 >= 64) return 0;
+        v1 = b64Values[inputP[dataIndex++]];
+        if (v1 == PRV_B64_INVALID) return 0;
+        v2 = b64Values[inputP[dataIndex++]];
+        if (v2 == PRV_B64_INVALID) return 0;
         bufferP[bufferIndex++] = (v1 << 2) + (v2 >> 4);
         if (dataIndex < dataLen)
         {
             if (dataP[dataIndex] != PRV_B64_PADDING)
             {
-                v3 = prv_base64Value(dataP[dataIndex++]);
-                if (v3 >= 64) return 0;
+                v3 = b64Values[inputP[dataIndex++]];
+                if (v3 == PRV_B64_INVALID) return 0;
                 bufferP[bufferIndex++] = (v2 << 4) + (v3 >> 2);
                 if (dataIndex < dataLen)
                 {
                     if (dataP[dataIndex] != PRV_B64_PADDING)
                     {
-                        v4 = prv_base64Value(dataP[dataIndex++]);
-                        if (v4 >= 64) return 0;
+                        v4 = b64Values[inputP[dataIndex++]];
+                        if (v4 == PRV_B64_INVALID) return 0;
                         bufferP[bufferIndex++] = (v3 << 6) + v4;
                     }
                     else
@@ -3,6 +3,10 @@
 # Set LWM2M_LITTLE_ENDIAN to FALSE or TRUE according to your destination platform or leave
 # it unset to determine endianess automatically.
 # Set LWM2M_VERSION to use a particular LWM2M version or leave it unset to use the latest.
+# Add LWM2M_SESSION_HASH to compile definitions to index clients by session on servers. This requires
+# lwm2m_session_hash() to be implemented.
+# Add LWM2M_WITH_MS_CLOCK to compile definitions to schedule CoAP retransmissions with a millisecond
+# resolution. This requires lwm2m_gettime_ms() to be implemented.
 
 set(WAKAAMA_SOURCES_DIR ${CMAKE_CURRENT_LIST_DIR})
 set(WAKAAMA_HEADERS_DIR ${CMAKE_CURRENT_LIST_DIR}/../include)
@@ -19,6 +23,8 @@ set(WAKAAMA_SOURCES
     ${WAKAAMA_SOURCES_DIR}/utils.c
     ${WAKAAMA_SOURCES_DIR}/objects.c
     ${WAKAAMA_SOURCES_DIR}/list.c
+    ${WAKAAMA_SOURCES_DIR}/index.c
+    ${WAKAAMA_SOURCES_DIR}/scheduler.c
     ${WAKAAMA_SOURCES_DIR}/packet.c
     ${WAKAAMA_SOURCES_DIR}/registration.c
     ${WAKAAMA_SOURCES_DIR}/bootstrap.c
@@ -0,0 +1,408 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+/*
+ * Minimal CBOR (RFC 8949) encoding and decoding primitives. Only definite
+ * lengths are supported. Floating point values are encoded in the shortest
+ * of the half, single and double precision forms keeping their exact value.
+ */
+
+#include "internals.h"
+#include <string.h>
+
+
+#if defined(LWM2M_SUPPORT_SENML_CBOR) || defined(LWM2M_SUPPORT_LWM2M_CBOR)
+
+#define CBOR_ADDITIONAL_MASK        0x1F
+#define CBOR_ADDITIONAL_ONE_BYTE    24
+#define CBOR_ADDITIONAL_TWO_BYTES   25
+#define CBOR_ADDITIONAL_FOUR_BYTES  26
+#define CBOR_ADDITIONAL_EIGHT_BYTES 27
+#define CBOR_MAJOR_SIMPLE           7
+
+#define CBOR_HALF_NAN               0x7E00
+#define CBOR_HALF_INFINITY          0x7C00
+
+static void prv_putBigEndian(uint8_t * buffer,
+                             uint64_t value,
+                             size_t length)
+{
+    while (length > 0)
+    {
+        length--;
+        buffer[length] = (uint8_t)value;
+        value >>= 8;
+    }
+}
+
+static uint64_t prv_getBigEndian(const uint8_t * buffer,
+                                 size_t length)
+{
+    uint64_t value = 0;
+    size_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        value = (value << 8) | buffer[i];
+    }
+    return value;
+}
+
+static size_t prv_putTypedValue(uint8_t * buffer,
+                                size_t length,
+                                uint8_t major,
+                                uint64_t value)
+{
+    uint8_t additional;
+    size_t size;
+
+    if (value < CBOR_ADDITIONAL_ONE_BYTE)
+    {
+        if (length < 1) return 0;
+        buffer[0] = (uint8_t)((major << 5) | value);
+        return 1;
+    }
+    if (value <= UINT8_MAX)
+    {
+        additional = CBOR_ADDITIONAL_ONE_BYTE;
+        size = 1;
+    }
+    else if (value <= UINT16_MAX)
+    {
+        additional = CBOR_ADDITIONAL_TWO_BYTES;
+        size = 2;
+    }
+    else if (value <= UINT32_MAX)
+    {
+        additional = CBOR_ADDITIONAL_FOUR_BYTES;
+        size = 4;
+    }
+    else
+    {
+        additional = CBOR_ADDITIONAL_EIGHT_BYTES;
+        size = 8;
+    }
+    if (length < size + 1) return 0;
+    buffer[0] = (uint8_t)((major << 5) | additional);
+    prv_putBigEndian(buffer + 1, value, size);
+
+    return size + 1;
+}
+
+size_t cbor_putHeader(uint8_t * buffer,
+                      size_t length,
+                      cbor_type_t type,
+                      uint64_t value)
+{
+    if (type == CBOR_TYPE_FLOAT) return 0;
+    return prv_putTypedValue(buffer, length, (uint8_t)type, value);
+}
+
+size_t cbor_putInt(uint8_t * buffer,
+                   size_t length,
+                   int64_t value)
+{
+    if (value >= 0)
+    {
+        return prv_putTypedValue(buffer, length, CBOR_TYPE_UNSIGNED_INTEGER, (uint64_t)value);
+    }
+    // -1 - value does not overflow, even for INT64_MIN
+    return prv_putTypedValue(buffer, length, CBOR_TYPE_NEGATIVE_INTEGER, (uint64_t)(-1 - value));
+}
+
+size_t cbor_putFloat(uint8_t * buffer,
+                     size_t length,
+                     double value)
+{
+    uint64_t bits;
+    uint64_t sign;
+    uint64_t mantissa;
+    uint64_t significand;
+    int exponent;
+    uint64_t shift;
+
+    memcpy(&bits, &value, sizeof(bits));
+    sign = bits >> 63;
+    exponent = (int)((bits >> 52) & 0x7FF);
+    mantissa = bits & 0xFFFFFFFFFFFFFull;
+
+    if (exponent == 0x7FF)
+    {
+        // infinites keep their sign, all NaNs are encoded as the canonical one
+        if (length < 3) return 0;
+        buffer[0] = (CBOR_MAJOR_SIMPLE << 5) | CBOR_ADDITIONAL_TWO_BYTES;
+        if (mantissa != 0)
+        {
+            prv_putBigEndian(buffer + 1, CBOR_HALF_NAN, 2);
+        }
+        else
+        {
+            prv_putBigEndian(buffer + 1, (sign << 15) | CBOR_HALF_INFINITY, 2);
+        }
+        return 3;
+    }
+    if (exponent == 0 && mantissa == 0)
+    {
+        if (length < 3) return 0;
+        buffer[0] = (CBOR_MAJOR_SIMPLE << 5) | CBOR_ADDITIONAL_TWO_BYTES;
+        prv_putBigEndian(buffer + 1, sign << 15, 2);
+        return 3;
+    }
+
+    if (exponent != 0)
+    {
+        exponent -= 1023;
+        significand = mantissa | (1ull << 52);
+
+        // half precision, normal then subnormal
+        if (exponent >= -14 && exponent <= 15 && (mantissa & 0x3FFFFFFFFFFull) == 0)
+        {
+            if (length < 3) return 0;
+            buffer[0] = (CBOR_MAJOR_SIMPLE << 5) | CBOR_ADDITIONAL_TWO_BYTES;
+            prv_putBigEndian(buffer + 1, (sign << 15) | ((uint64_t)(exponent + 15) << 10) | (mantissa >> 42), 2);
+            return 3;
+        }
+        if (exponent >= -24 && exponent < -14)
+        {
+            shift = (uint64_t)(28 - exponent);
+            if ((significand & ((1ull << shift) - 1)) == 0)
+            {
+                if (length < 3) return 0;
+                buffer[0] = (CBOR_MAJOR_SIMPLE << 5) | CBOR_ADDITIONAL_TWO_BYTES;
+                prv_putBigEndian(buffer + 1, (sign << 15) | (significand >> shift), 2);
+                return 3;
+            }
+        }
+
+        // single precision, normal then subnormal
+        if (exponent >= -126 && exponent <= 127 && (mantissa & 0x1FFFFFFFull) == 0)
+        {
+            if (length < 5) return 0;
+            buffer[0] = (CBOR_MAJOR_SIMPLE << 5) | CBOR_ADDITIONAL_FOUR_BYTES;
+            prv_putBigEndian(buffer + 1, (sign << 31) | ((uint64_t)(exponent + 127) << 23) | (mantissa >> 29), 4);
+            return 5;
+        }
+        if (exponent >= -149 && exponent < -126)
+        {
+            shift = (uint64_t)(-97 - exponent);
+            if ((significand & ((1ull << shift) - 1)) == 0)
+            {
+                if (length < 5) return 0;
+                buffer[0] = (CBOR_MAJOR_SIMPLE << 5) | CBOR_ADDITIONAL_FOUR_BYTES;
+                prv_putBigEndian(buffer + 1, (sign << 31) | (significand >> shift), 4);
+                return 5;
+            }
+        }
+    }
+
+    if (length < 9) return 0;
+    buffer[0] = (CBOR_MAJOR_SIMPLE << 5) | CBOR_ADDITIONAL_EIGHT_BYTES;
+    prv_putBigEndian(buffer + 1, bits, 8);
+    return 9;
+}
+
+size_t cbor_putString(uint8_t * buffer,
+                      size_t length,
+                      cbor_type_t type,
+                      const uint8_t * data,
+                      size_t dataLength)
+{
+    size_t head;
+
+    head = cbor_putHeader(buffer, length, type, dataLength);
+    if (head == 0 || length - head < dataLength) return 0;
+    if (dataLength > 0) memcpy(buffer + head, data, dataLength);
+
+    return head + dataLength;
+}
+
+static double prv_halfToDouble(uint16_t half)
+{
+    uint64_t bits;
+    uint64_t sign;
+    uint64_t exponent;
+    uint64_t mantissa;
+    double value;
+
+    sign = (uint64_t)(half >> 15) << 63;
+    exponent = (half >> 10) & 0x1F;
+    mantissa = half & 0x3FF;
+
+    if (exponent == 0)
+    {
+        // subnormal: mantissa * 2^-24, exact in double precision
+        value = (double)mantissa / 16777216.0;
+        return sign ? -value : value;
+    }
+    if (exponent == 0x1F)
+    {
+        bits = sign | (0x7FFull << 52) | (mantissa << 42);
+    }
+    else
+    {
+        bits = sign | ((exponent - 15 + 1023) << 52) | (mantissa << 42);
+    }
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+int cbor_getItem(const uint8_t * buffer,
+                 size_t bufferLen,
+                 cbor_item_t * itemP)
+{
+    uint8_t major;
+    uint8_t additional;
+    size_t size;
+    uint64_t value;
+
+    if (bufferLen < 1) return -1;
+    major = buffer[0] >> 5;
+    additional = buffer[0] & CBOR_ADDITIONAL_MASK;
+
+    switch (additional)
+    {
+    case CBOR_ADDITIONAL_ONE_BYTE:
+        size = 1;
+        break;
+    case CBOR_ADDITIONAL_TWO_BYTES:
+        size = 2;
+        break;
+    case CBOR_ADDITIONAL_FOUR_BYTES:
+        size = 4;
+        break;
+    case CBOR_ADDITIONAL_EIGHT_BYTES:
+        size = 8;
+        break;
+    default:
+        // reserved values and indefinite lengths are not supported
+        if (additional > CBOR_ADDITIONAL_EIGHT_BYTES) return -1;
+        size = 0;
+        break;
+    }
+    if (bufferLen - 1 < size) return -1;
+    value = size == 0 ? additional : prv_getBigEndian(buffer + 1, size);
+
+    itemP->type = (cbor_type_t)major;
+    itemP->value = value;
+    itemP->buffer = NULL;
+
+    switch (major)
+    {
+    case CBOR_TYPE_BYTE_STRING:
+    case CBOR_TYPE_TEXT_STRING:
+        if (value > bufferLen - 1 - size) return -1;
+        itemP->buffer = buffer + 1 + size;
+        return (int)(1 + size + value);
+
+    case CBOR_MAJOR_SIMPLE:
+        if (size == 2)
+        {
+            itemP->type = CBOR_TYPE_FLOAT;
+            itemP->asFloat = prv_halfToDouble((uint16_t)value);
+        }
+        else if (size == 4)
+        {
+            uint32_t bits = (uint32_t)value;
+            float single;
+
+            memcpy(&single, &bits, sizeof(single));
+            itemP->type = CBOR_TYPE_FLOAT;
+            itemP->asFloat = single;
+        }
+        else if (size == 8)
+        {
+            itemP->type = CBOR_TYPE_FLOAT;
+            memcpy(&itemP->asFloat, &value, sizeof(itemP->asFloat));
+        }
+        else if (size == 1 && value < 32)
+        {
+            // two bytes encoding of the simple values below 32 is not well-formed
+            return -1;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    return (int)(1 + size);
+}
+
+int cbor_skipItem(const uint8_t * buffer,
+                  size_t bufferLen)
+{
+    size_t index;
+    uint64_t pending;
+
+    index = 0;
+    pending = 1;
+    while (pending > 0)
+    {
+        cbor_item_t item;
+        int res;
+
+        res = cbor_getItem(buffer + index, bufferLen - index, &item);
+        if (res < 0) return -1;
+        index += res;
+        pending--;
+
+        switch (item.type)
+        {
+        case CBOR_TYPE_ARRAY:
+            // each item takes at least one byte
+            if (item.value > bufferLen - index) return -1;
+            pending += item.value;
+            break;
+        case CBOR_TYPE_MAP:
+            if (item.value > (bufferLen - index) / 2) return -1;
+            pending += 2 * item.value;
+            break;
+        case CBOR_TYPE_TAG:
+            pending++;
+            break;
+        default:
+            break;
+        }
+        if (pending > bufferLen - index) return -1;
+    }
+
+    return (int)index;
+}
+
+bool cbor_decodeNumber(const cbor_item_t * itemP,
+                       lwm2m_data_t * dataP)
+{
+    switch (itemP->type)
+    {
+    case CBOR_TYPE_UNSIGNED_INTEGER:
+        lwm2m_data_encode_uint(itemP->value, dataP);
+        break;
+    case CBOR_TYPE_NEGATIVE_INTEGER:
+        if (itemP->value > INT64_MAX) return false;
+        lwm2m_data_encode_int(-1 - (int64_t)itemP->value, dataP);
+        break;
+    case CBOR_TYPE_FLOAT:
+        lwm2m_data_encode_float(itemP->asFloat, dataP);
+        break;
+    default:
+        return false;
+    }
+
+    return true;
+}
+
+#endif
@@ -24,125 +24,247 @@
 #define _PRV_STR_LENGTH 32
 
 // dataP array length is assumed to be 1.
-static int prv_textSerialize(lwm2m_data_t * dataP,
-                             uint8_t ** bufferP)
+// Returns the length of the text, which is only written if it fits in length.
+static int prv_textSerializeInto(lwm2m_data_t * dataP,
+                                 uint8_t * buffer,
+                                 size_t length)
 {
+    uint8_t text[_PRV_STR_LENGTH * 2];
+    const uint8_t * src = text;
     size_t res;
 
     switch (dataP->type)
     {
     case LWM2M_TYPE_STRING:
     case LWM2M_TYPE_CORE_LINK:
-        *bufferP = (uint8_t *)lwm2m_malloc(dataP->value.asBuffer.length);
-        if (*bufferP == NULL) return 0;
-        memcpy(*bufferP, dataP->value.asBuffer.buffer, dataP->value.asBuffer.length);
-        return (int)dataP->value.asBuffer.length;
+        src = dataP->value.asBuffer.buffer;
+        res = dataP->value.asBuffer.length;
+        break;
 
     case LWM2M_TYPE_INTEGER:
-    {
-        uint8_t intString[_PRV_STR_LENGTH];
-
-        res = utils_intToText(dataP->value.asInteger, intString, _PRV_STR_LENGTH);
+        res = utils_intToText(dataP->value.asInteger, text, _PRV_STR_LENGTH);
         if (res == 0) return -1;
+        break;
 
-        *bufferP = (uint8_t *)lwm2m_malloc(res);
-        if (NULL == *bufferP) return -1;
+    case LWM2M_TYPE_UNSIGNED_INTEGER:
+        res = utils_uintToText(dataP->value.asUnsigned, text, _PRV_STR_LENGTH);
+        if (res == 0) return -1;
+        break;
 
-        memcpy(*bufferP, intString, res);
+    case LWM2M_TYPE_FLOAT:
+        res = utils_floatToText(dataP->value.asFloat, text, _PRV_STR_LENGTH * 2, false);
+        if (res == 0) return -1;
+        break;
 
-        return (int)res;
-    }
+    case LWM2M_TYPE_BOOLEAN:
+        text[0] = dataP->value.asBoolean ? '1' : '0';
+        res = 1;
+        break;
 
-    case LWM2M_TYPE_UNSIGNED_INTEGER:
+    case LWM2M_TYPE_OBJECT_LINK:
     {
-        uint8_t intString[_PRV_STR_LENGTH];
+        size_t idLength;
 
-        res = utils_uintToText(dataP->value.asUnsigned, intString, _PRV_STR_LENGTH);
-        if (res == 0) return -1;
+        idLength = utils_intToText(dataP->value.asObjLink.objectId, text, 5);
+        if (idLength == 0) return -1;
 
-        *bufferP = (uint8_t *)lwm2m_malloc(res);
-        if (NULL == *bufferP) return -1;
+        text[idLength] = ':';
+        res = idLength + 1;
 
-        memcpy(*bufferP, intString, res);
+        idLength = utils_intToText(dataP->value.asObjLink.objectInstanceId, text + res, 5);
+        if (idLength == 0) return -1;
+
+        res += idLength;
+        break;
+    }
 
+    case LWM2M_TYPE_OPAQUE:
+        res = utils_base64GetSize(dataP->value.asBuffer.length);
+        if (res <= length)
+        {
+            res = utils_base64Encode(dataP->value.asBuffer.buffer, dataP->value.asBuffer.length, buffer, length);
+            if (res == 0) return -1;
+        }
         return (int)res;
+
+    case LWM2M_TYPE_UNDEFINED:
+    default:
+        return -1;
     }
 
-    case LWM2M_TYPE_FLOAT:
+    if (res <= length && res > 0)
     {
-        uint8_t floatString[_PRV_STR_LENGTH * 2];
+        memcpy(buffer, src, res);
+    }
+    return (int)res;
+}
 
-        res = utils_floatToText(dataP->value.asFloat, floatString, _PRV_STR_LENGTH * 2, false);
-        if (res == 0) return -1;
+// dataP array length is assumed to be 1.
+static int prv_textSerialize(lwm2m_data_t * dataP,
+                             uint8_t ** bufferP)
+{
+    uint8_t text[_PRV_STR_LENGTH * 2];
+    int res;
 
-        *bufferP = (uint8_t *)lwm2m_malloc(res);
-        if (NULL == *bufferP) return -1;
+    *bufferP = NULL;
+    // numbers always fit in text
+    res = prv_textSerializeInto(dataP, text, sizeof(text));
+    if (res <= 0) return res;
 
-        memcpy(*bufferP, floatString, res);
+    *bufferP = (uint8_t *)lwm2m_malloc(res);
+    if (*bufferP == NULL) return -1;
 
-        return (int)res;
+    if ((size_t)res <= sizeof(text))
+    {
+        memcpy(*bufferP, text, res);
+    }
+    else if (prv_textSerializeInto(dataP, *bufferP, res) != res)
+    {
+        lwm2m_free(*bufferP);
+        *bufferP = NULL;
+        return -1;
     }
 
-    case LWM2M_TYPE_BOOLEAN:
-        *bufferP = (uint8_t *)lwm2m_malloc(1);
-        if (NULL == *bufferP) return -1;
+    return res;
+}
 
-        *bufferP[0] = dataP->value.asBoolean ? '1' : '0';
+#ifdef LWM2M_DATA_ARENA
 
-        return 1;
+// blocks are aligned for the most demanding member of lwm2m_data_t
+typedef union
+{
+    void *  asPointer;
+    int64_t asInteger;
+    double  asFloat;
+} prv_arena_align_t;
 
-    case LWM2M_TYPE_OBJECT_LINK:
+#define PRV_ARENA_ALIGN(S) (((S) + sizeof(prv_arena_align_t) - 1) / sizeof(prv_arena_align_t) * sizeof(prv_arena_align_t))
+
+struct _lwm2m_data_arena_chunk_
+{
+    lwm2m_data_arena_chunk_t * next;
+    size_t                     size; // bytes available after the header
+    size_t                     used;
+};
+
+#define PRV_ARENA_HEADER_SIZE PRV_ARENA_ALIGN(sizeof(lwm2m_data_arena_chunk_t))
+
+static LWM2M_THREAD_LOCAL lwm2m_data_arena_t * currentArenaP = NULL;
+
+void lwm2m_data_arena_init(lwm2m_data_arena_t * arenaP)
+{
+    memset(arenaP, 0, sizeof(lwm2m_data_arena_t));
+}
+
+void lwm2m_data_arena_reset(lwm2m_data_arena_t * arenaP)
+{
+    size_t size;
+
+    if (arenaP->chunkList == NULL) return;
+
+    if (arenaP->chunkList->next == NULL)
     {
-        char stringBuffer[11];
-        size_t length;
-        
-        length = utils_intToText(dataP->value.asObjLink.objectId, (uint8_t*)stringBuffer, 5);
-        if (length == 0) return -1;
+        arenaP->chunkList->used = 0;
+        return;
+    }
 
-        stringBuffer[5] = ':';
-        res = length + 1;
+    // replace the chunks by a single one large enough for the same usage
+    size = 0;
+    while (arenaP->chunkList != NULL)
+    {
+        lwm2m_data_arena_chunk_t * chunkP = arenaP->chunkList;
 
-        length = utils_intToText(dataP->value.asObjLink.objectInstanceId, (uint8_t*)stringBuffer + res, 5);
-        if (length == 0) return -1;
+        arenaP->chunkList = chunkP->next;
+        size += chunkP->size;
+        lwm2m_free(chunkP);
+    }
+    arenaP->chunkSize = size;
+}
 
-        res += length;
+void lwm2m_data_arena_close(lwm2m_data_arena_t * arenaP)
+{
+    while (arenaP->chunkList != NULL)
+    {
+        lwm2m_data_arena_chunk_t * chunkP = arenaP->chunkList;
 
-        *bufferP = (uint8_t *)lwm2m_malloc(res);
-        if (*bufferP == NULL) return -1;
+        arenaP->chunkList = chunkP->next;
+        lwm2m_free(chunkP);
+    }
+    memset(arenaP, 0, sizeof(lwm2m_data_arena_t));
+}
 
-        memcpy(*bufferP, stringBuffer, res);
+lwm2m_data_arena_t * lwm2m_data_arena_use(lwm2m_data_arena_t * arenaP)
+{
+    lwm2m_data_arena_t * previousP = currentArenaP;
 
-        return res;
+    currentArenaP = arenaP;
+
+    return previousP;
+}
+
+void * data_malloc(size_t size)
+{
+    lwm2m_data_arena_t * arenaP = currentArenaP;
+    lwm2m_data_arena_chunk_t * chunkP;
+    void * blockP;
+
+    if (arenaP == NULL) return lwm2m_malloc(size);
+
+    if (size > SIZE_MAX / 2) return NULL;
+    size = PRV_ARENA_ALIGN(size);
+
+    chunkP = arenaP->chunkList;
+    if (chunkP == NULL || chunkP->size - chunkP->used < size)
+    {
+        size_t chunkSize;
+
+        chunkSize = arenaP->chunkSize;
+        if (chunkSize < LWM2M_DATA_ARENA_CHUNK_SIZE) chunkSize = LWM2M_DATA_ARENA_CHUNK_SIZE;
+        if (chunkP != NULL && chunkSize < chunkP->size * 2) chunkSize = chunkP->size * 2;
+        if (chunkSize < size) chunkSize = size;
+        if (chunkSize > SIZE_MAX - PRV_ARENA_HEADER_SIZE) return NULL;
+
+        chunkP = (lwm2m_data_arena_chunk_t *)lwm2m_malloc(PRV_ARENA_HEADER_SIZE + chunkSize);
+        if (chunkP == NULL) return NULL;
+        chunkP->next = arenaP->chunkList;
+        chunkP->size = chunkSize;
+        chunkP->used = 0;
+        arenaP->chunkList = chunkP;
+        arenaP->chunkAllocations++;
     }
 
-    case LWM2M_TYPE_OPAQUE:
+    blockP = (uint8_t *)chunkP + PRV_ARENA_HEADER_SIZE + chunkP->used;
+    chunkP->used += size;
+    arenaP->allocations++;
+
+    return blockP;
+}
+
+void data_free(void * p)
+{
+    if (currentArenaP != NULL)
     {
-        size_t length;
+        lwm2m_data_arena_chunk_t * chunkP;
 
-        length = utils_base64GetSize(dataP->value.asBuffer.length);
-        *bufferP = (uint8_t *)lwm2m_malloc(length);
-        if (*bufferP == NULL) return 0;
-        length = utils_base64Encode(dataP->value.asBuffer.buffer, dataP->value.asBuffer.length, *bufferP, length);
-        if (length == 0)
+        for (chunkP = currentArenaP->chunkList; chunkP != NULL; chunkP = chunkP->next)
         {
-            lwm2m_free(*bufferP);
-            *bufferP = NULL;
-            return 0;
+            uintptr_t start = (uintptr_t)chunkP + PRV_ARENA_HEADER_SIZE;
+
+            // released by the next reset of the arena
+            if ((uintptr_t)p - start < chunkP->size) return;
         }
-        return (int)length;
     }
 
-    case LWM2M_TYPE_UNDEFINED:
-    default:
-        return -1;
-    }
+    lwm2m_free(p);
 }
 
+#endif
+
 static int prv_setBuffer(lwm2m_data_t * dataP,
                          const uint8_t * buffer,
                          size_t bufferLen)
 {
-    dataP->value.asBuffer.buffer = (uint8_t *)lwm2m_malloc(bufferLen);
+    dataP->value.asBuffer.buffer = (uint8_t *)data_malloc(bufferLen);
     if (dataP->value.asBuffer.buffer == NULL)
     {
         return 0;
@@ -160,7 +282,7 @@ lwm2m_data_t * lwm2m_data_new(int size)
     LOG_ARG("size: %d", size);
     if (size <= 0) return NULL;
 
-    dataP = (lwm2m_data_t *)lwm2m_malloc(size * sizeof(lwm2m_data_t));
+    dataP = (lwm2m_data_t *)data_malloc(size * sizeof(lwm2m_data_t));
 
     if (dataP != NULL)
     {
@@ -193,7 +315,7 @@ void lwm2m_data_free(int size,
         case LWM2M_TYPE_CORE_LINK:
             if (dataP[i].value.asBuffer.buffer != NULL)
             {
-                lwm2m_free(dataP[i].value.asBuffer.buffer);
+                data_free(dataP[i].value.asBuffer.buffer);
             }
             break;
 
@@ -202,7 +324,7 @@ void lwm2m_data_free(int size,
             break;
         }
     }
-    lwm2m_free(dataP);
+    data_free(dataP);
 }
 
 void lwm2m_data_encode_string(const char * string,
@@ -631,6 +753,7 @@ void lwm2m_data_include(lwm2m_data_t * subDataP,
     }
     dataP->value.asChildren.count = count;
     dataP->value.asChildren.array = subDataP;
+    dataP->value.asChildren.capacity = 0;
 }
 
 void lwm2m_data_encode_instances(lwm2m_data_t * subDataP,
@@ -711,21 +834,27 @@ int lwm2m_data_parse(lwm2m_uri_t * uriP,
         return senml_json_parse(uriP, buffer, bufferLen, dataP);
 #endif
 
+#ifdef LWM2M_SUPPORT_SENML_CBOR
+    case LWM2M_CONTENT_SENML_CBOR:
+        return senml_cbor_parse(uriP, buffer, bufferLen, dataP);
+#endif
+
+#ifdef LWM2M_SUPPORT_LWM2M_CBOR
+    case LWM2M_CONTENT_LWM2M_CBOR:
+        return lwm2m_cbor_parse(uriP, buffer, bufferLen, dataP);
+#endif
+
     default:
         return 0;
     }
 }
 
-int lwm2m_data_serialize(lwm2m_uri_t * uriP,
-                         int size,
-                         lwm2m_data_t * dataP,
-                         lwm2m_media_type_t * formatP,
-                         uint8_t ** bufferP)
+// adjusts the format to what can be serialized, returns false if nothing can
+static bool prv_checkFormat(lwm2m_uri_t * uriP,
+                            int size,
+                            lwm2m_data_t * dataP,
+                            lwm2m_media_type_t * formatP)
 {
-    LOG_URI(uriP);
-    LOG_ARG("size: %d, formatP: %s", size, STR_MEDIA_TYPE(*formatP));
-
-    // Check format
     if (*formatP == LWM2M_CONTENT_TEXT
      || *formatP == LWM2M_CONTENT_OPAQUE)
     {
@@ -735,14 +864,16 @@ int lwm2m_data_serialize(lwm2m_uri_t * uriP,
          || dataP->type == LWM2M_TYPE_OBJECT_INSTANCE
          || dataP->type == LWM2M_TYPE_MULTIPLE_RESOURCE)
         {
-#ifdef LWM2M_SUPPORT_SENML_JSON
+#ifdef LWM2M_SUPPORT_SENML_CBOR
+            *formatP = LWM2M_CONTENT_SENML_CBOR;
+#elif defined(LWM2M_SUPPORT_SENML_JSON)
             *formatP = LWM2M_CONTENT_SENML_JSON;
 #elif defined(LWM2M_SUPPORT_JSON)
             *formatP = LWM2M_CONTENT_JSON;
 #elif defined(LWM2M_SUPPORT_TLV)
             *formatP = LWM2M_CONTENT_TLV;
 #else
-            return -1;
+            return false;
 #endif
         }
     }
@@ -751,11 +882,52 @@ int lwm2m_data_serialize(lwm2m_uri_t * uriP,
      && dataP->type != LWM2M_TYPE_OPAQUE)
     {
         LOG("Opaque format is reserved to opaque resources.");
-        return -1;
+        return false;
     }
 
     LOG_ARG("Final format: %s", STR_MEDIA_TYPE(*formatP));
 
+    return true;
+}
+
+#ifdef LWM2M_SUPPORT_TLV
+static int prv_tlvCheckResourceInstance(lwm2m_uri_t * uriP,
+                                        int size,
+                                        lwm2m_data_t * dataP,
+                                        bool * isResourceInstanceP)
+{
+#ifndef LWM2M_VERSION_1_0
+    if (uriP != NULL && LWM2M_URI_IS_SET_RESOURCE_INSTANCE(uriP))
+    {
+        if(size != 1 || dataP->id != uriP->resourceInstanceId) return -1;
+        *isResourceInstanceP = true;
+    }
+    else
+#endif
+    if (uriP != NULL && LWM2M_URI_IS_SET_RESOURCE(uriP)
+     && (size != 1 || dataP->id != uriP->resourceId))
+    {
+        *isResourceInstanceP = true;
+    }
+    else
+    {
+        *isResourceInstanceP = false;
+    }
+    return 0;
+}
+#endif
+
+int lwm2m_data_serialize(lwm2m_uri_t * uriP,
+                         int size,
+                         lwm2m_data_t * dataP,
+                         lwm2m_media_type_t * formatP,
+                         uint8_t ** bufferP)
+{
+    LOG_URI(uriP);
+    LOG_ARG("size: %d, formatP: %s", size, STR_MEDIA_TYPE(*formatP));
+
+    if (!prv_checkFormat(uriP, size, dataP, formatP)) return -1;
+
     switch (*formatP)
     {
     case LWM2M_CONTENT_TEXT:
@@ -775,23 +947,7 @@ int lwm2m_data_serialize(lwm2m_uri_t * uriP,
     {
         bool isResourceInstance;
 
-#ifndef LWM2M_VERSION_1_0
-        if (uriP != NULL && LWM2M_URI_IS_SET_RESOURCE_INSTANCE(uriP))
-        {
-            if(size != 1 || dataP->id != uriP->resourceInstanceId) return -1;
-            isResourceInstance = true;
-        }
-        else
-#endif
-        if (uriP != NULL && LWM2M_URI_IS_SET_RESOURCE(uriP)
-         && (size != 1 || dataP->id != uriP->resourceId))
-        {
-            isResourceInstance = true;
-        }
-        else
-        {
-            isResourceInstance = false;
-        }
+        if (prv_tlvCheckResourceInstance(uriP, size, dataP, &isResourceInstance) != 0) return -1;
         return tlv_serialize(isResourceInstance, size, dataP, bufferP);
     }
 #endif
@@ -813,8 +969,107 @@ int lwm2m_data_serialize(lwm2m_uri_t * uriP,
         return senml_json_serialize(uriP, size, dataP, bufferP);
 #endif
 
+#ifdef LWM2M_SUPPORT_SENML_CBOR
+    case LWM2M_CONTENT_SENML_CBOR:
+        return senml_cbor_serialize(uriP, size, dataP, bufferP);
+#endif
+
+#ifdef LWM2M_SUPPORT_LWM2M_CBOR
+    case LWM2M_CONTENT_LWM2M_CBOR:
+        return lwm2m_cbor_serialize(uriP, size, dataP, bufferP);
+#endif
+
     default:
         return -1;
     }
 }
 
+int lwm2m_data_serialize_into(lwm2m_uri_t * uriP,
+                              int size,
+                              lwm2m_data_t * dataP,
+                              lwm2m_media_type_t * formatP,
+                              uint8_t * buffer,
+                              size_t length)
+{
+    uint8_t * allocated = NULL;
+    int res;
+
+    LOG_URI(uriP);
+    LOG_ARG("size: %d, formatP: %s", size, STR_MEDIA_TYPE(*formatP));
+
+    if (!prv_checkFormat(uriP, size, dataP, formatP)) return -1;
+
+    switch (*formatP)
+    {
+    case LWM2M_CONTENT_TEXT:
+        return prv_textSerializeInto(dataP, buffer, length);
+
+    case LWM2M_CONTENT_OPAQUE:
+        if (dataP->value.asBuffer.length <= length && dataP->value.asBuffer.length > 0)
+        {
+            memcpy(buffer, dataP->value.asBuffer.buffer, dataP->value.asBuffer.length);
+        }
+        return (int)dataP->value.asBuffer.length;
+
+#ifdef LWM2M_SUPPORT_TLV
+    case LWM2M_CONTENT_TLV:
+#ifdef LWM2M_OLD_CONTENT_FORMAT_SUPPORT
+    case LWM2M_CONTENT_TLV_OLD:
+#endif
+    {
+        bool isResourceInstance;
+
+        if (prv_tlvCheckResourceInstance(uriP, size, dataP, &isResourceInstance) != 0) return -1;
+        return tlv_serializeInto(isResourceInstance, size, dataP, buffer, length);
+    }
+#endif
+
+#ifdef LWM2M_SUPPORT_JSON
+    case LWM2M_CONTENT_JSON:
+#ifdef LWM2M_OLD_CONTENT_FORMAT_SUPPORT
+    case LWM2M_CONTENT_JSON_OLD:
+#endif
+        res = json_serializeInto(uriP, size, dataP, buffer, length);
+        if (res != 0) return res;
+        // too small, the serialization below tells the required length
+        break;
+#endif
+
+#ifdef LWM2M_SUPPORT_SENML_JSON
+    case LWM2M_CONTENT_SENML_JSON:
+        res = senml_json_serializeInto(uriP, size, dataP, buffer, length);
+        if (res != 0) return res;
+        // too small, the serialization below tells the required length
+        break;
+#endif
+
+#ifdef LWM2M_SUPPORT_SENML_CBOR
+    case LWM2M_CONTENT_SENML_CBOR:
+        res = senml_cbor_serializeInto(uriP, size, dataP, buffer, length);
+        if (res != 0) return res;
+        // too small, the serialization below tells the required length
+        break;
+#endif
+
+#ifdef LWM2M_SUPPORT_LWM2M_CBOR
+    case LWM2M_CONTENT_LWM2M_CBOR:
+        res = lwm2m_cbor_serializeInto(uriP, size, dataP, buffer, length);
+        if (res != 0) return res;
+        // too small, the serialization below tells the required length
+        break;
+#endif
+
+    default:
+        break;
+    }
+
+    res = lwm2m_data_serialize(uriP, size, dataP, formatP, &allocated);
+    if (res > 0 && (size_t)res <= length)
+    {
+        memcpy(buffer, allocated, res);
+    }
+    lwm2m_free(allocated);
+
+    return res;
+}
+
@@ -9,5 +9,9 @@ set(DATA_SOURCES
     ${DATA_SOURCES_DIR}/tlv.c
     ${DATA_SOURCES_DIR}/json.c
     ${DATA_SOURCES_DIR}/senml_json.c
+    ${DATA_SOURCES_DIR}/senml_cbor.c
+    ${DATA_SOURCES_DIR}/senml_common.c
+    ${DATA_SOURCES_DIR}/lwm2m_cbor.c
+    ${DATA_SOURCES_DIR}/cbor_common.c
     ${DATA_SOURCES_DIR}/json_common.c
 )
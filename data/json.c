@@ -22,16 +22,17 @@
 #include <string.h>
 #include <stdio.h>
 #include <inttypes.h>
+#include <limits.h>
 
 
 #ifdef LWM2M_SUPPORT_JSON
 
-#define PRV_JSON_BUFFER_SIZE 1024
+#define PRV_JSON_BUFFER_SIZE 1024 // initial size of the serialization buffer
+// returned by the serialization helpers when the buffer is too small
+#define PRV_JSON_NO_SPACE    -2
 
-#define JSON_MIN_ARRAY_LEN      21      // e":[{"n":"N","v":X}]}
 #define JSON_MIN_BASE_LEN        7      // n":"N",
 #define JSON_ITEM_MAX_SIZE      36      // with ten characters for value
-#define JSON_MIN_BX_LEN          5      // bt":1
 
 #define JSON_FALSE_STRING  "false"
 #define JSON_TRUE_STRING   "true"
@@ -92,32 +93,31 @@ typedef struct
 
 static int prv_parseItem(const uint8_t * buffer,
                          size_t bufferLen,
+                         size_t * indexP,
                          _record_t * recordP)
 {
-    size_t index;
+    int next;
 
     memset(recordP->ids, 0xFF, 4*sizeof(uint16_t));
     recordP->type = _TYPE_UNSET;
     recordP->value = NULL;
     recordP->valueLen = 0;
 
-    index = 0;
     do
     {
         size_t tokenStart;
         size_t tokenLen;
         size_t valueStart;
         size_t valueLen;
-        int next;
 
-        next = json_split(buffer+index, bufferLen-index, &tokenStart, &tokenLen, &valueStart, &valueLen);
+        next = json_nextMember(buffer, bufferLen, indexP, &tokenStart, &tokenLen, &valueStart, &valueLen);
         if (next < 0) return -1;
 
         switch (tokenLen)
         {
         case 1:
         {
-            switch (buffer[index+tokenStart])
+            switch (buffer[tokenStart])
             {
             case 'n':
             {
@@ -128,13 +128,13 @@ static int prv_parseItem(const uint8_t * buffer,
 
                 // Check for " around URI
                 if (valueLen < 2
-                 || buffer[index+valueStart] != '"'
-                 || buffer[index+valueStart+valueLen-1] != '"')
+                 || buffer[valueStart] != '"'
+                 || buffer[valueStart+valueLen-1] != '"')
                 {
                     return -1;
                 }
                 // Ignore starting /
-                if (buffer[index + valueStart + 1] == '/')
+                if (buffer[valueStart + 1] == '/')
                 {
                     if (valueLen < 4)
                     {
@@ -152,21 +152,21 @@ static int prv_parseItem(const uint8_t * buffer,
 
                         readId = 0;
                         i++;
-                        while (i < valueLen-1 && buffer[index+valueStart+i] != '/')
+                        while (i < valueLen-1 && buffer[valueStart+i] != '/')
                         {
-                            if (buffer[index+valueStart+i] < '0'
-                             || buffer[index+valueStart+i] > '9')
+                            if (buffer[valueStart+i] < '0'
+                             || buffer[valueStart+i] > '9')
                             {
                                 return -1;
                             }
                             readId *= 10;
-                            readId += buffer[index+valueStart+i] - '0';
+                            readId += buffer[valueStart+i] - '0';
                             if (readId > LWM2M_MAX_ID) return -1;
                             i++;
                         }
                         recordP->ids[j] = readId;
                         j++;
-                    } while (i < valueLen-1 && j < 4 && buffer[index+valueStart+i] == '/');
+                    } while (i < valueLen-1 && j < 4 && buffer[valueStart+i] == '/');
                     if (i < valueLen-1 ) return -1;
                 }
             }
@@ -175,7 +175,7 @@ static int prv_parseItem(const uint8_t * buffer,
             case 'v':
                 if (recordP->type != _TYPE_UNSET) return -1;
                 recordP->type = _TYPE_FLOAT;
-                recordP->value = buffer + index + valueStart;
+                recordP->value = buffer + valueStart;
                 recordP->valueLen = valueLen;
                 break;
 
@@ -192,16 +192,16 @@ static int prv_parseItem(const uint8_t * buffer,
         case 2:
         {
             // "bv", "ov", or "sv"
-            if (buffer[index+tokenStart+1] != 'v') return -1;
-            switch (buffer[index+tokenStart])
+            if (buffer[tokenStart+1] != 'v') return -1;
+            switch (buffer[tokenStart])
             {
             case 'b':
                 if (recordP->type != _TYPE_UNSET) return -1;
-                if (0 == lwm2m_strncmp(JSON_TRUE_STRING, (char *)buffer + index + valueStart, valueLen))
+                if (0 == lwm2m_strncmp(JSON_TRUE_STRING, (char *)buffer + valueStart, valueLen))
                 {
                     recordP->type = _TYPE_TRUE;
                 }
-                else if (0 == lwm2m_strncmp(JSON_FALSE_STRING, (char *)buffer + index + valueStart, valueLen))
+                else if (0 == lwm2m_strncmp(JSON_FALSE_STRING, (char *)buffer + valueStart, valueLen))
                 {
                     recordP->type = _TYPE_FALSE;
                 }
@@ -215,13 +215,13 @@ static int prv_parseItem(const uint8_t * buffer,
                 if (recordP->type != _TYPE_UNSET) return -1;
                 // Check for " around value
                 if (valueLen < 2
-                 || buffer[index+valueStart] != '"'
-                 || buffer[index+valueStart+valueLen-1] != '"')
+                 || buffer[valueStart] != '"'
+                 || buffer[valueStart+valueLen-1] != '"')
                 {
                     return -1;
                 }
                 recordP->type = _TYPE_OBJECT_LINK;
-                recordP->value = buffer + index + valueStart + 1;
+                recordP->value = buffer + valueStart + 1;
                 recordP->valueLen = valueLen - 2;
                 break;
 
@@ -229,13 +229,13 @@ static int prv_parseItem(const uint8_t * buffer,
                 if (recordP->type != _TYPE_UNSET) return -1;
                 // Check for " around value
                 if (valueLen < 2
-                 || buffer[index+valueStart] != '"'
-                 || buffer[index+valueStart+valueLen-1] != '"')
+                 || buffer[valueStart] != '"'
+                 || buffer[valueStart+valueLen-1] != '"')
                 {
                     return -1;
                 }
                 recordP->type = _TYPE_STRING;
-                recordP->value = buffer + index + valueStart + 1;
+                recordP->value = buffer + valueStart + 1;
                 recordP->valueLen = valueLen - 2;
                 break;
 
@@ -248,9 +248,7 @@ static int prv_parseItem(const uint8_t * buffer,
         default:
             return -1;
         }
-
-        index += next + 1;
-    } while (index < bufferLen);
+    } while (next > 0);
 
     return 0;
 }
@@ -274,17 +272,17 @@ static bool prv_convertValue(_record_t * recordP,
         if (0 != recordP->valueLen)
         {
             size_t stringLen;
-            uint8_t *string = (uint8_t *)lwm2m_malloc(recordP->valueLen);
+            uint8_t *string = (uint8_t *)data_malloc(recordP->valueLen);
             if (string == NULL) return false;
             stringLen = json_unescapeString(string, recordP->value, recordP->valueLen);
             if (stringLen)
             {
                 lwm2m_data_encode_nstring((char *)string, stringLen, targetP);
-                lwm2m_free(string);
+                data_free(string);
             }
             else
             {
-                lwm2m_free(string);
+                data_free(string);
                 return false;
             }
         }
@@ -434,7 +432,7 @@ static int prv_convertRecord(lwm2m_uri_t * uriP,
             }
             if (recordArray[index].ids[resSegmentIndex + 1] != LWM2M_MAX_ID)
             {
-                targetP->type = LWM2M_TYPE_MULTIPLE_RESOURCE;
+                if (targetP->type == LWM2M_TYPE_UNDEFINED) targetP->type = LWM2M_TYPE_MULTIPLE_RESOURCE;
                 targetP = json_extendData(targetP);
                 if (targetP == NULL) goto error;
                 targetP->id = recordArray[index].ids[resSegmentIndex + 1];
@@ -465,8 +463,9 @@ static int prv_convertRecord(lwm2m_uri_t * uriP,
             }
             parentP->value.asChildren.array = newRootP;
             parentP->value.asChildren.count = freeIndex;
+            parentP->value.asChildren.capacity = 0;
         }
-        lwm2m_free(rootP);     /* do not use lwm2m_data_free() to keep pointed values */
+        data_free(rootP);     /* do not use lwm2m_data_free() to keep pointed values */
     }
 
     return size;
@@ -490,6 +489,7 @@ int json_parse(lwm2m_uri_t * uriP,
     bool btFound = false;
     size_t bnStart;
     size_t bnLen;
+    size_t capacity = 0;
     _record_t * recordArray;
     lwm2m_data_t * parsedP;
 
@@ -505,109 +505,82 @@ int json_parse(lwm2m_uri_t * uriP,
     if (buffer[index] != '{') return -1;
     do
     {
+        size_t tokenStart;
+        size_t tokenLen;
+        int len;
+
         _GO_TO_NEXT_CHAR(index, buffer, bufferLen);
-        if (buffer[index] != '"') goto error;
-        if (index++ >= bufferLen) goto error;
-        switch (buffer[index])
-        {
-        case 'e':
+        len = json_stringLength(buffer + index, bufferLen - index);
+        if (len < 0) goto error;
+        tokenStart = index + 1;
+        tokenLen = len - 2;
+        index += len;
+        index += json_skipSpace(buffer + index, bufferLen - index);
+        if (index == bufferLen || buffer[index] != ':') goto error;
+        _GO_TO_NEXT_CHAR(index, buffer, bufferLen);
+
+        if (tokenLen == 1 && buffer[tokenStart] == 'e')
         {
-            int recordIndex;
+            uint8_t separator;
 
-            if (bufferLen-index < JSON_MIN_ARRAY_LEN) goto error;
-            index++;
-            if (buffer[index] != '"') goto error;
             if (eFound == true) goto error;
             eFound = true;
 
-            _GO_TO_NEXT_CHAR(index, buffer, bufferLen);
-            if (buffer[index] != ':') goto error;
-            _GO_TO_NEXT_CHAR(index, buffer, bufferLen);
             if (buffer[index] != '[') goto error;
             _GO_TO_NEXT_CHAR(index, buffer, bufferLen);
-            count = json_countItems(buffer + index, bufferLen - index);
-            if (count <= 0) goto error;
-            recordArray = (_record_t*)lwm2m_malloc(count * sizeof(_record_t));
-            if (recordArray == NULL) goto error;
-            // at this point we are sure buffer[index] is '{' and all { and } are matching
-            recordIndex = 0;
-            while (recordIndex < count)
+            // the records are parsed as they are found, the array growing as needed
+            do
             {
-                int itemLen = json_itemLength(buffer + index, bufferLen - index);
-                if (itemLen < 0) goto error;
-                if (0 != prv_parseItem(buffer + index + 1, itemLen - 2, recordArray + recordIndex))
+                if (buffer[index] != '{') goto error;
+                if ((size_t)count == capacity)
                 {
-                    goto error;
+                    _record_t * newArray;
+
+                    if (count == INT_MAX) goto error;
+                    newArray = (_record_t *)json_growArray(recordArray, count, sizeof(_record_t), &capacity);
+                    if (newArray == NULL) goto error;
+                    recordArray = newArray;
                 }
-                recordIndex++;
-                index += itemLen - 1;
-                _GO_TO_NEXT_CHAR(index, buffer, bufferLen);
-                switch (buffer[index])
+                index++;
+                if (0 != prv_parseItem(buffer, bufferLen, &index, recordArray + count))
                 {
-                case ',':
-                    _GO_TO_NEXT_CHAR(index, buffer, bufferLen);
-                    break;
-                case ']':
-                    if (recordIndex == count) break;
-                    // else this is an error
-                default:
                     goto error;
                 }
-            }
-            if (buffer[index] != ']') goto error;
-        }
-        break;
-
-        case 'b':
-            if (bufferLen-index < JSON_MIN_BX_LEN) goto error;
-            index++;
-            switch (buffer[index])
-            {
-            case 't':
-                index++;
-                if (buffer[index] != '"') goto error;
-                if (btFound == true) goto error;
-                btFound = true;
-
-                // TODO: handle timed values
-                // temp: skip this token
-                while(index < bufferLen && buffer[index] != ',' && buffer[index] != '}') index++;
+                count++;
+                index += json_skipSpace(buffer + index, bufferLen - index);
                 if (index == bufferLen) goto error;
-                index--;
-                // end temp
-                break;
-            case 'n':
+                separator = buffer[index];
+                if (separator == ',')
                 {
-                    int next;
-                    size_t tokenStart;
-                    size_t tokenLen;
-                    int itemLen;
-
-                    index++;
-                    if (buffer[index] != '"') goto error;
-                    if (bnFound == true) goto error;
-                    bnFound = true;
-                    index -= 3;
-                    itemLen = 0;
-                    while (buffer[index + itemLen] != '}'
-                        && buffer[index + itemLen] != ','
-                        && index + itemLen < bufferLen)
-                    {
-                        itemLen++;
-                    }
-                    if (index + itemLen == bufferLen) goto error;
-                    next = json_split(buffer+index, itemLen, &tokenStart, &tokenLen, &bnStart, &bnLen);
-                    if (next < 0) goto error;
-                    bnStart += index;
-                    index += next - 1;
+                    _GO_TO_NEXT_CHAR(index, buffer, bufferLen);
                 }
-                break;
-            default:
-                goto error;
-            }
-            break;
-
-        default:
+            } while (separator == ',');
+            if (buffer[index] != ']') goto error;
+        }
+        else if (tokenLen == 2 && buffer[tokenStart] == 'b' && buffer[tokenStart + 1] == 'n')
+        {
+            if (bnFound == true) goto error;
+            bnFound = true;
+            len = json_stringLength(buffer + index, bufferLen - index);
+            if (len < 0) goto error;
+            bnStart = index;
+            bnLen = len;
+            index += len - 1;
+        }
+        else if (tokenLen == 2 && buffer[tokenStart] == 'b' && buffer[tokenStart + 1] == 't')
+        {
+            if (btFound == true) goto error;
+            btFound = true;
+
+            // TODO: handle timed values
+            // temp: skip this token
+            while(index < bufferLen && buffer[index] != ',' && buffer[index] != '}') index++;
+            if (index == bufferLen) goto error;
+            index--;
+            // end temp
+        }
+        else
+        {
             goto error;
         }
 
@@ -662,7 +635,7 @@ int json_parse(lwm2m_uri_t * uriP,
         }
 
         count = prv_convertRecord(baseUriP, recordArray, count, &parsedP);
-        lwm2m_free(recordArray);
+        data_free(recordArray);
         recordArray = NULL;
 
         if (count > 0 && uriP != NULL)
@@ -745,7 +718,7 @@ error:
     }
     if (recordArray != NULL)
     {
-        lwm2m_free(recordArray);
+        data_free(recordArray);
     }
     return -1;
 }
@@ -761,7 +734,7 @@ static int prv_serializeValue(lwm2m_data_t * tlvP,
     {
     case LWM2M_TYPE_STRING:
     case LWM2M_TYPE_CORE_LINK:
-        if (bufferLen < JSON_ITEM_STRING_BEGIN_SIZE) return -1;
+        if (bufferLen < JSON_ITEM_STRING_BEGIN_SIZE) return PRV_JSON_NO_SPACE;
         memcpy(buffer, JSON_ITEM_STRING_BEGIN, JSON_ITEM_STRING_BEGIN_SIZE);
         head = JSON_ITEM_STRING_BEGIN_SIZE;
 
@@ -769,10 +742,10 @@ static int prv_serializeValue(lwm2m_data_t * tlvP,
                                 bufferLen - head,
                                 tlvP->value.asBuffer.buffer,
                                 tlvP->value.asBuffer.length);
-        if (tlvP->value.asBuffer.length != 0 && res == 0) return -1;
+        if (tlvP->value.asBuffer.length != 0 && res == 0) return PRV_JSON_NO_SPACE;
         head += res;
 
-        if (bufferLen - head < JSON_ITEM_STRING_END_SIZE) return -1;
+        if (bufferLen - head < JSON_ITEM_STRING_END_SIZE) return PRV_JSON_NO_SPACE;
         memcpy(buffer + head, JSON_ITEM_STRING_END, JSON_ITEM_STRING_END_SIZE);
         head += JSON_ITEM_STRING_END_SIZE;
 
@@ -784,15 +757,15 @@ static int prv_serializeValue(lwm2m_data_t * tlvP,
 
         if (0 == lwm2m_data_decode_int(tlvP, &value)) return -1;
 
-        if (bufferLen < JSON_ITEM_NUM_SIZE) return -1;
+        if (bufferLen < JSON_ITEM_NUM_SIZE) return PRV_JSON_NO_SPACE;
         memcpy(buffer, JSON_ITEM_NUM, JSON_ITEM_NUM_SIZE);
         head = JSON_ITEM_NUM_SIZE;
 
         res = utils_intToText(value, buffer + head, bufferLen - head);
-        if (!res) return -1;
+        if (!res) return PRV_JSON_NO_SPACE;
         head += res;
 
-        if (bufferLen - head < JSON_ITEM_NUM_END_SIZE) return -1;
+        if (bufferLen - head < JSON_ITEM_NUM_END_SIZE) return PRV_JSON_NO_SPACE;
         memcpy(buffer + head, JSON_ITEM_NUM_END, JSON_ITEM_NUM_END_SIZE);
         head += JSON_ITEM_NUM_END_SIZE;
     }
@@ -804,15 +777,15 @@ static int prv_serializeValue(lwm2m_data_t * tlvP,
 
         if (0 == lwm2m_data_decode_uint(tlvP, &value)) return -1;
 
-        if (bufferLen < JSON_ITEM_NUM_SIZE) return -1;
+        if (bufferLen < JSON_ITEM_NUM_SIZE) return PRV_JSON_NO_SPACE;
         memcpy(buffer, JSON_ITEM_NUM, JSON_ITEM_NUM_SIZE);
         head = JSON_ITEM_NUM_SIZE;
 
         res = utils_uintToText(value, buffer + head, bufferLen - head);
-        if (!res) return -1;
+        if (!res) return PRV_JSON_NO_SPACE;
         head += res;
 
-        if (bufferLen - head < JSON_ITEM_NUM_END_SIZE) return -1;
+        if (bufferLen - head < JSON_ITEM_NUM_END_SIZE) return PRV_JSON_NO_SPACE;
         memcpy(buffer + head, JSON_ITEM_NUM_END, JSON_ITEM_NUM_END_SIZE);
         head += JSON_ITEM_NUM_END_SIZE;
     }
@@ -824,18 +797,18 @@ static int prv_serializeValue(lwm2m_data_t * tlvP,
 
         if (0 == lwm2m_data_decode_float(tlvP, &value)) return -1;
 
-        if (bufferLen < JSON_ITEM_NUM_SIZE) return -1;
+        if (bufferLen < JSON_ITEM_NUM_SIZE) return PRV_JSON_NO_SPACE;
         memcpy(buffer, JSON_ITEM_NUM, JSON_ITEM_NUM_SIZE);
         head = JSON_ITEM_NUM_SIZE;
 
         res = utils_floatToText(value, buffer + head, bufferLen - head, true);
-        if (!res) return -1;
+        if (!res) return PRV_JSON_NO_SPACE;
         /* Error if inf or nan */
         if (buffer[head] != '-' && !isdigit(buffer[head])) return -1;
         if (res > 1 && buffer[head] == '-' && !isdigit(buffer[head+1])) return -1;
         head += res;
 
-        if (bufferLen - head < JSON_ITEM_NUM_END_SIZE) return -1;
+        if (bufferLen - head < JSON_ITEM_NUM_END_SIZE) return PRV_JSON_NO_SPACE;
         memcpy(buffer + head, JSON_ITEM_NUM_END, JSON_ITEM_NUM_END_SIZE);
         head += JSON_ITEM_NUM_END_SIZE;
     }
@@ -849,13 +822,13 @@ static int prv_serializeValue(lwm2m_data_t * tlvP,
 
         if (value == true)
         {
-            if (bufferLen < JSON_ITEM_BOOL_TRUE_SIZE) return -1;
+            if (bufferLen < JSON_ITEM_BOOL_TRUE_SIZE) return PRV_JSON_NO_SPACE;
             memcpy(buffer, JSON_ITEM_BOOL_TRUE, JSON_ITEM_BOOL_TRUE_SIZE);
             head = JSON_ITEM_BOOL_TRUE_SIZE;
         }
         else
         {
-            if (bufferLen < JSON_ITEM_BOOL_FALSE_SIZE) return -1;
+            if (bufferLen < JSON_ITEM_BOOL_FALSE_SIZE) return PRV_JSON_NO_SPACE;
             memcpy(buffer, JSON_ITEM_BOOL_FALSE, JSON_ITEM_BOOL_FALSE_SIZE);
             head = JSON_ITEM_BOOL_FALSE_SIZE;
         }
@@ -863,21 +836,21 @@ static int prv_serializeValue(lwm2m_data_t * tlvP,
     break;
 
     case LWM2M_TYPE_OPAQUE:
-        if (bufferLen < JSON_ITEM_STRING_BEGIN_SIZE) return -1;
+        if (bufferLen < JSON_ITEM_STRING_BEGIN_SIZE) return PRV_JSON_NO_SPACE;
         memcpy(buffer, JSON_ITEM_STRING_BEGIN, JSON_ITEM_STRING_BEGIN_SIZE);
         head = JSON_ITEM_STRING_BEGIN_SIZE;
 
         res = utils_base64Encode(tlvP->value.asBuffer.buffer, tlvP->value.asBuffer.length, buffer+head, bufferLen - head);
-        if (tlvP->value.asBuffer.length != 0 && res == 0) return -1;
+        if (tlvP->value.asBuffer.length != 0 && res == 0) return PRV_JSON_NO_SPACE;
         head += res;
 
-        if (bufferLen - head < JSON_ITEM_STRING_END_SIZE) return -1;
+        if (bufferLen - head < JSON_ITEM_STRING_END_SIZE) return PRV_JSON_NO_SPACE;
         memcpy(buffer + head, JSON_ITEM_STRING_END, JSON_ITEM_STRING_END_SIZE);
         head += JSON_ITEM_STRING_END_SIZE;
         break;
 
     case LWM2M_TYPE_OBJECT_LINK:
-        if (bufferLen < JSON_ITEM_OBJECT_LINK_BEGIN_SIZE) return -1;
+        if (bufferLen < JSON_ITEM_OBJECT_LINK_BEGIN_SIZE) return PRV_JSON_NO_SPACE;
         memcpy(buffer, JSON_ITEM_OBJECT_LINK_BEGIN, JSON_ITEM_OBJECT_LINK_BEGIN_SIZE);
         head = JSON_ITEM_OBJECT_LINK_BEGIN_SIZE;
 
@@ -885,10 +858,10 @@ static int prv_serializeValue(lwm2m_data_t * tlvP,
                                   tlvP->value.asObjLink.objectInstanceId,
                                   buffer + head,
                                   bufferLen - head);
-        if (!res) return -1;
+        if (!res) return PRV_JSON_NO_SPACE;
         head += res;
 
-        if (bufferLen - head < JSON_ITEM_OBJECT_LINK_END_SIZE) return -1;
+        if (bufferLen - head < JSON_ITEM_OBJECT_LINK_END_SIZE) return PRV_JSON_NO_SPACE;
         memcpy(buffer + head, JSON_ITEM_OBJECT_LINK_END, JSON_ITEM_OBJECT_LINK_END_SIZE);
         head += JSON_ITEM_OBJECT_LINK_END_SIZE;
         break;
@@ -941,30 +914,30 @@ static int prv_serializeData(lwm2m_data_t * tlvP,
         for (index = 0 ; index < tlvP->value.asChildren.count; index++)
         {
             res = prv_serializeData(tlvP->value.asChildren.array + index, uriStr, uriLen, buffer + head, bufferLen - head);
-            if (res < 0) return -1;
+            if (res < 0) return res;
             head += res;
         }
     }
     break;
 
     default:
-        if (bufferLen < JSON_RES_ITEM_URI_SIZE) return -1;
+        if (bufferLen < JSON_RES_ITEM_URI_SIZE) return PRV_JSON_NO_SPACE;
         memcpy(buffer, JSON_RES_ITEM_URI, JSON_RES_ITEM_URI_SIZE);
         head = JSON_RES_ITEM_URI_SIZE;
 
         if (parentUriLen > 0)
         {
-            if (bufferLen - head < parentUriLen) return -1;
+            if (bufferLen - head < parentUriLen) return PRV_JSON_NO_SPACE;
             memcpy(buffer + head, parentUriStr, parentUriLen);
             head += parentUriLen;
         }
 
         res = utils_intToText(tlvP->id, buffer + head, bufferLen - head);
-        if (res <= 0) return -1;
+        if (res <= 0) return PRV_JSON_NO_SPACE;
         head += res;
 
         res = prv_serializeValue(tlvP, buffer + head, bufferLen - head);
-        if (res < 0) return -1;
+        if (res < 0) return res;
         head += res;
         break;
     }
@@ -972,14 +945,14 @@ static int prv_serializeData(lwm2m_data_t * tlvP,
     return head;
 }
 
-int json_serialize(lwm2m_uri_t * uriP,
-                   int size,
-                   lwm2m_data_t * tlvP,
-                   uint8_t ** bufferP)
+int json_serializeInto(lwm2m_uri_t * uriP,
+                       int size,
+                       lwm2m_data_t * tlvP,
+                       uint8_t * buffer,
+                       size_t length)
 {
     int index;
     size_t head;
-    uint8_t bufferJSON[PRV_JSON_BUFFER_SIZE];
     uint8_t baseUriStr[URI_MAX_STRING_LEN];
     int baseUriLen;
     uri_depth_t rootLevel;
@@ -1029,10 +1002,10 @@ int json_serialize(lwm2m_uri_t * uriP,
     {
         int res;
 
-        if (baseUriLen >= URI_MAX_STRING_LEN -1) return 0;
+        if (baseUriLen >= URI_MAX_STRING_LEN -1) return -1;
         baseUriStr[baseUriLen++] = '/';
         res = utils_intToText(targetP->id, baseUriStr + baseUriLen, URI_MAX_STRING_LEN - baseUriLen);
-        if (res <= 0) return 0;
+        if (res <= 0) return -1;
         baseUriLen += res;
         num = targetP->value.asChildren.count;
         targetP = targetP->value.asChildren.array;
@@ -1040,49 +1013,75 @@ int json_serialize(lwm2m_uri_t * uriP,
 
     if (baseUriLen > 0)
     {
-        if (baseUriLen >= URI_MAX_STRING_LEN -1) return 0;
+        if (baseUriLen >= URI_MAX_STRING_LEN -1) return -1;
         baseUriStr[baseUriLen++] = '/';
-        memcpy(bufferJSON, JSON_BN_HEADER_1, JSON_BN_HEADER_1_SIZE);
+        if (JSON_BN_HEADER_1_SIZE + (size_t)baseUriLen + JSON_BN_HEADER_2_SIZE > length) return 0;
+        memcpy(buffer, JSON_BN_HEADER_1, JSON_BN_HEADER_1_SIZE);
         head = JSON_BN_HEADER_1_SIZE;
-        memcpy(bufferJSON + head, baseUriStr, baseUriLen);
+        memcpy(buffer + head, baseUriStr, baseUriLen);
         head += baseUriLen;
-        memcpy(bufferJSON + head, JSON_BN_HEADER_2, JSON_BN_HEADER_2_SIZE);
+        memcpy(buffer + head, JSON_BN_HEADER_2, JSON_BN_HEADER_2_SIZE);
         head += JSON_BN_HEADER_2_SIZE;
     }
     else
     {
-        memcpy(bufferJSON, JSON_HEADER, JSON_HEADER_SIZE);
+        if (JSON_HEADER_SIZE > length) return 0;
+        memcpy(buffer, JSON_HEADER, JSON_HEADER_SIZE);
         head = JSON_HEADER_SIZE;
         parentUriStr = (const uint8_t *)"/";
         parentUriLen = 1;
     }
 
-    for (index = 0 ; index < num && head < PRV_JSON_BUFFER_SIZE ; index++)
+    for (index = 0 ; index < num && head < length ; index++)
     {
         int res;
 
         res = prv_serializeData(targetP + index,
                                 parentUriStr,
                                 parentUriLen,
-                                bufferJSON + head,
-                                PRV_JSON_BUFFER_SIZE - head);
-        if (res < 0) return res;
+                                buffer + head,
+                                length - head);
+        if (res == PRV_JSON_NO_SPACE) return 0;
+        if (res < 0) return -1;
         head += res;
     }
 
-    if (head + JSON_FOOTER_SIZE - 1 > PRV_JSON_BUFFER_SIZE) return 0;
-
     if (num > 0) head = head - 1;
 
-    memcpy(bufferJSON + head, JSON_FOOTER, JSON_FOOTER_SIZE);
-    head = head + JSON_FOOTER_SIZE;
+    if (head + JSON_FOOTER_SIZE > length) return 0;
 
-    *bufferP = (uint8_t *)lwm2m_malloc(head);
-    if (*bufferP == NULL) return -1;
-    memcpy(*bufferP, bufferJSON, head);
+    memcpy(buffer + head, JSON_FOOTER, JSON_FOOTER_SIZE);
+    head = head + JSON_FOOTER_SIZE;
 
     return head;
 }
 
+int json_serialize(lwm2m_uri_t * uriP,
+                   int size,
+                   lwm2m_data_t * tlvP,
+                   uint8_t ** bufferP)
+{
+    size_t length;
+    int res;
+
+    // the buffer is doubled until the whole payload fits
+    length = PRV_JSON_BUFFER_SIZE;
+    do
+    {
+        *bufferP = (uint8_t *)lwm2m_malloc(length);
+        if (*bufferP == NULL) return -1;
+
+        res = json_serializeInto(uriP, size, tlvP, *bufferP, length);
+        if (res <= 0)
+        {
+            lwm2m_free(*bufferP);
+            *bufferP = NULL;
+        }
+        length *= 2;
+    } while (res == 0 && length <= INT_MAX);
+
+    return res;
+}
+
 #endif
 
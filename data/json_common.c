@@ -18,26 +18,18 @@
 
 #include "internals.h"
 #include <float.h>
+#include <limits.h>
+#include <string.h>
 
-#if defined(LWM2M_SUPPORT_JSON) || defined(LWM2M_SUPPORT_SENML_JSON)
+#if defined(LWM2M_SUPPORT_JSON) || defined(LWM2M_SUPPORT_SENML_JSON) || defined(LWM2M_SUPPORT_SENML_CBOR) || defined(LWM2M_SUPPORT_LWM2M_CBOR)
 
-#define _GO_TO_NEXT_CHAR(I,B,L)         \
-    {                                   \
-        I++;                            \
-        I += json_skipSpace(B+I, L-I);   \
-        if (I == L) goto error;         \
-    }
+#define PRV_JSON_ARRAY_SIZE 16 // initial capacity of the arrays grown by json_growArray()
 
-typedef enum
-{
-    _STEP_START,
-    _STEP_TOKEN,
-    _STEP_ANY_SEPARATOR,
-    _STEP_SEPARATOR,
-    _STEP_QUOTED_VALUE,
-    _STEP_VALUE,
-    _STEP_DONE
-} _itemState;
+// SWAR (SIMD within a register) helpers to test eight bytes at once
+#define PRV_SWAR_ONES           0x0101010101010101ULL
+#define PRV_SWAR_HIGHS          0x8080808080808080ULL
+#define PRV_SWAR_HAS_ZERO(W)    (((W) - PRV_SWAR_ONES) & ~(W) & PRV_SWAR_HIGHS)
+#define PRV_SWAR_HAS_BYTE(W,B)  PRV_SWAR_HAS_ZERO((W) ^ (PRV_SWAR_ONES * (uint8_t)(B)))
 
 static int prv_isReserved(char sign)
 {
@@ -82,207 +74,122 @@ size_t json_skipSpace(const uint8_t * buffer,size_t bufferLen)
     return i;
 }
 
-int json_split(const uint8_t * buffer,
-               size_t bufferLen,
-               size_t * tokenStartP,
-               size_t * tokenLenP,
-               size_t * valueStartP,
-               size_t * valueLenP)
+int json_stringLength(const uint8_t * buffer, size_t bufferLen)
 {
     size_t index;
-    _itemState step;
-
-    *tokenStartP = 0;
-    *tokenLenP = 0;
-    *valueStartP = 0;
-    *valueLenP = 0;
-    index = 0;
-    step = _STEP_START;
 
-    index = json_skipSpace(buffer + index, bufferLen - index);
-    if (index == bufferLen) return -1;
+    if (bufferLen == 0 || buffer[0] != '"') return -1;
 
+    index = 1;
     while (index < bufferLen)
     {
-        switch (step)
-        {
-        case _STEP_START:
-            if (buffer[index] == ',') goto loop_exit;
-            if (buffer[index] != '"') return -1;
-            *tokenStartP = index+1;
-            step = _STEP_TOKEN;
-            break;
-
-        case _STEP_TOKEN:
-            if (buffer[index] == ',') goto loop_exit;
-            if (buffer[index] == '"')
-            {
-                *tokenLenP = index - *tokenStartP;
-                step = _STEP_ANY_SEPARATOR;
-            }
-            break;
-
-        case _STEP_ANY_SEPARATOR:
-            if (buffer[index] == ',') goto loop_exit;
-            if (buffer[index] != ':') return -1;
-            step = _STEP_SEPARATOR;
-            break;
-
-        case _STEP_SEPARATOR:
-            if (buffer[index] == ',') goto loop_exit;
-            if (buffer[index] == '"')
-            {
-                *valueStartP = index;
-                step = _STEP_QUOTED_VALUE;
-            } else if (!prv_isReserved(buffer[index]))
-            {
-                *valueStartP = index;
-                step = _STEP_VALUE;
-            } else
-            {
-                return -1;
-            }
-            break;
-
-        case _STEP_QUOTED_VALUE:
-            if (buffer[index] == '"' && buffer[index-1] != '\\' )
-            {
-                *valueLenP = index - *valueStartP + 1;
-                step = _STEP_DONE;
-            }
-            break;
-
-        case _STEP_VALUE:
-            if (buffer[index] == ',') goto loop_exit;
-            if (prv_isWhiteSpace(buffer[index]))
-            {
-                *valueLenP = index - *valueStartP;
-                step = _STEP_DONE;
-            }
-            break;
-
-        case _STEP_DONE:
-            if (buffer[index] == ',') goto loop_exit;
-            return -1;
+        uint64_t word;
 
-        default:
-            return -1;
+        // skip eight characters at once as long as none of them is a quote or a backslash
+        while (bufferLen - index >= sizeof(word))
+        {
+            memcpy(&word, buffer + index, sizeof(word));
+            if (PRV_SWAR_HAS_BYTE(word, '"') || PRV_SWAR_HAS_BYTE(word, '\\')) break;
+            index += sizeof(word);
         }
+        if (index >= bufferLen) break;
 
-        index++;
-        if (step == _STEP_START
-         || step == _STEP_ANY_SEPARATOR
-         || step == _STEP_SEPARATOR
-         || step == _STEP_DONE)
+        switch (buffer[index])
         {
-            index += json_skipSpace(buffer + index, bufferLen - index);
+        case '"':
+            if (index + 1 > INT_MAX) return -1;
+            return (int)(index + 1);
+        case '\\':
+            // the escaped character can not end the string
+            index += 2;
+            break;
+        default:
+            index++;
+            break;
         }
     }
-loop_exit:
 
-    if (step == _STEP_VALUE)
-    {
-        *valueLenP = index - *valueStartP;
-        step = _STEP_DONE;
-    }
-
-    if (step != _STEP_DONE) return -1;
-
-    return (int)index;
+    return -1;
 }
 
-int json_itemLength(const uint8_t * buffer, size_t bufferLen)
+int json_nextMember(const uint8_t * buffer,
+                    size_t bufferLen,
+                    size_t * indexP,
+                    size_t * tokenStartP,
+                    size_t * tokenLenP,
+                    size_t * valueStartP,
+                    size_t * valueLenP)
 {
     size_t index;
-    int in;
-
-    index = 0;
-    in = 0;
+    int len;
+
+    index = *indexP;
+    index += json_skipSpace(buffer + index, bufferLen - index);
+    len = json_stringLength(buffer + index, bufferLen - index);
+    if (len < 0) return -1;
+    *tokenStartP = index + 1;
+    *tokenLenP = len - 2;
+    index += len;
+
+    index += json_skipSpace(buffer + index, bufferLen - index);
+    if (index == bufferLen || buffer[index] != ':') return -1;
+    index++;
+    index += json_skipSpace(buffer + index, bufferLen - index);
+    if (index == bufferLen) return -1;
 
-    while (index < bufferLen)
+    *valueStartP = index;
+    if (buffer[index] == '"')
     {
-        switch (in)
+        len = json_stringLength(buffer + index, bufferLen - index);
+        if (len < 0) return -1;
+        index += len;
+    }
+    else
+    {
+        while (index < bufferLen
+            && !prv_isReserved(buffer[index])
+            && !prv_isWhiteSpace(buffer[index]))
         {
-        case 0:
-            if (buffer[index] != '{') goto error;
-            in = 1;
-            _GO_TO_NEXT_CHAR(index, buffer, bufferLen);
-            break;
-        case 1:
-            if (buffer[index] == '{') goto error;
-            if (buffer[index] == '}')
-            {
-                return index + 1;
-            }
-            else if (buffer[index] == '"')
-            {
-                in = 2;
-                _GO_TO_NEXT_CHAR(index, buffer, bufferLen);
-            }
-            else
-            {
-                _GO_TO_NEXT_CHAR(index, buffer, bufferLen);
-            }
-            break;
-        case 2:
-            if (buffer[index] == '"')
-            {
-                in = 1;
-            }
-            else if (buffer[index] == '\\')
-            {
-                /* Escape in string. Skip the next character. */
-                index++;
-                if (index == bufferLen) goto error;
-            }
-            _GO_TO_NEXT_CHAR(index, buffer, bufferLen);
-            break;
-        default:
-            goto error;
+            index++;
         }
+        if (index == *valueStartP) return -1;
     }
+    *valueLenP = index - *valueStartP;
 
-error:
-    return -1;
+    index += json_skipSpace(buffer + index, bufferLen - index);
+    if (index == bufferLen) return -1;
+    switch (buffer[index])
+    {
+    case ',':
+        *indexP = index + 1;
+        return 1;
+    case '}':
+        *indexP = index + 1;
+        return 0;
+    default:
+        return -1;
+    }
 }
 
-int json_countItems(const uint8_t * buffer, size_t bufferLen)
+void * json_growArray(void * array, size_t count, size_t itemSize, size_t * capacityP)
 {
-    int count;
-    size_t index;
-    int in;
-
-    count = 0;
-    index = 0;
-    in = 0;
-
-    while (index < bufferLen)
+    size_t capacity;
+    void * newArray;
+
+    capacity = (*capacityP == 0) ? PRV_JSON_ARRAY_SIZE : *capacityP * 2;
+    if (capacity > SIZE_MAX / itemSize) return NULL;
+    newArray = data_malloc(capacity * itemSize);
+    if (newArray == NULL) return NULL;
+    if (array != NULL)
     {
-        int len = json_itemLength(buffer + index,  bufferLen - index);
-        if (len <= 0) return -1;
-        count++;
-        index += len - 1;
-        _GO_TO_NEXT_CHAR(index, buffer, bufferLen);
-        if (buffer[index] == ']')
-        {
-            /* Done processing */
-            index = bufferLen;
-        }
-        else if (buffer[index] == ',')
-        {
-            _GO_TO_NEXT_CHAR(index, buffer, bufferLen);
-        }
-        else return -1;
+        memcpy(newArray, array, count * itemSize);
+        data_free(array);
     }
-    if (in > 0) goto error;
-
-    return count;
+    *capacityP = capacity;
 
-error:
-    return -1;
+    return newArray;
 }
 
-
 int json_convertNumeric(const uint8_t *value,
                         size_t valueLen,
                         lwm2m_data_t *targetP)
@@ -491,21 +398,38 @@ size_t json_escapeString(uint8_t *dst, size_t dstLen, const uint8_t *src, size_t
 
 lwm2m_data_t * json_extendData(lwm2m_data_t * parentP)
 {
-    lwm2m_data_t * newP;
+    size_t count;
+
+    switch (parentP->type)
+    {
+    case LWM2M_TYPE_OBJECT:
+    case LWM2M_TYPE_OBJECT_INSTANCE:
+    case LWM2M_TYPE_MULTIPLE_RESOURCE:
+        break;
+    default:
+        // the value of a leaf is not a list of children
+        return NULL;
+    }
 
-    newP = lwm2m_data_new(parentP->value.asChildren.count + 1);
-    if (newP == NULL) return NULL;
-    if (parentP->value.asChildren.count)
+    count = parentP->value.asChildren.count;
+    if (count >= parentP->value.asChildren.capacity)
     {
-        memcpy(newP,
-               parentP->value.asChildren.array,
-               parentP->value.asChildren.count * sizeof(lwm2m_data_t));
-        lwm2m_free(parentP->value.asChildren.array);     /* do not use lwm2m_data_free() to keep pointed values */
+        lwm2m_data_t * newP;
+
+        if (count > INT_MAX / 2) return NULL;
+        newP = lwm2m_data_new(count == 0 ? 1 : (int)count * 2);
+        if (newP == NULL) return NULL;
+        if (count != 0)
+        {
+            memcpy(newP, parentP->value.asChildren.array, count * sizeof(lwm2m_data_t));
+            data_free(parentP->value.asChildren.array);     /* do not use lwm2m_data_free() to keep pointed values */
+        }
+        parentP->value.asChildren.array = newP;
+        parentP->value.asChildren.capacity = count == 0 ? 1 : count * 2;
     }
-    parentP->value.asChildren.array = newP;
-    parentP->value.asChildren.count += 1;
+    parentP->value.asChildren.count = count + 1;
 
-    return newP + parentP->value.asChildren.count - 1;
+    return parentP->value.asChildren.array + count;
 }
 
 int json_dataStrip(int size, lwm2m_data_t * dataP, lwm2m_data_t ** resultP)
@@ -540,6 +464,7 @@ int json_dataStrip(int size, lwm2m_data_t * dataP, lwm2m_data_t ** resultP)
             else
             {
                 (*resultP)[j].value.asChildren.count = childLen;
+                (*resultP)[j].value.asChildren.capacity = 0;
             }
             break;
         }
@@ -0,0 +1,467 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+/*
+ * LwM2M CBOR content format (LwM2M 1.2 core specification, section 7.4.7).
+ * The payload is a tree of nested maps keyed by the path components, starting
+ * from the Object ID. A key can also be an array of path components, which is
+ * used here to collapse the levels having a single child, e.g.:
+ *   {[3, 0]: {0: "Open Mobile Alliance", 9: 95}}
+ */
+
+#include "internals.h"
+#include <string.h>
+#include <limits.h>
+
+
+#ifdef LWM2M_SUPPORT_LWM2M_CBOR
+
+#ifdef LWM2M_VERSION_1_0
+#error LwM2M CBOR not supported with LWM2M 1.0
+#endif
+
+#define PRV_CBOR_BUFFER_SIZE 1024 // initial size of the serialization buffer
+// returned by the serialization helpers when the buffer is too small
+#define PRV_CBOR_NO_SPACE    -2
+
+#define PRV_MAX_DEPTH        4    // Object, Object Instance, Resource, Resource Instance
+#define PRV_TAG_EPOCH_TIME   1
+
+static bool prv_isContainer(const lwm2m_data_t * dataP)
+{
+    switch (dataP->type)
+    {
+    case LWM2M_TYPE_OBJECT:
+    case LWM2M_TYPE_OBJECT_INSTANCE:
+    case LWM2M_TYPE_MULTIPLE_RESOURCE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// parses a map and its nested maps, adding a record per value when recordArray is not NULL
+static int prv_parseMap(const uint8_t * buffer,
+                        size_t bufferLen,
+                        const uint16_t * ids,
+                        int depth,
+                        senml_record_t * recordArray,
+                        int * countP)
+{
+    cbor_item_t item;
+    uint64_t pairs;
+    size_t index;
+    int res;
+
+    res = cbor_getItem(buffer, bufferLen, &item);
+    if (res < 0 || item.type != CBOR_TYPE_MAP) return -1;
+    index = res;
+    pairs = item.value;
+    if (pairs > (bufferLen - index) / 2) return -1;
+
+    while (pairs > 0)
+    {
+        uint16_t path[PRV_MAX_DEPTH];
+        int pathLen;
+        cbor_item_t value;
+
+        pairs--;
+        if (depth > 0) memcpy(path, ids, depth * sizeof(uint16_t));
+        pathLen = depth;
+
+        res = cbor_getItem(buffer + index, bufferLen - index, &item);
+        if (res < 0) return -1;
+        index += res;
+        switch (item.type)
+        {
+        case CBOR_TYPE_UNSIGNED_INTEGER:
+            if (pathLen >= PRV_MAX_DEPTH || item.value >= LWM2M_MAX_ID) return -1;
+            path[pathLen++] = (uint16_t)item.value;
+            break;
+
+        case CBOR_TYPE_ARRAY:
+        {
+            uint64_t count = item.value;
+
+            if (count == 0 || count > (uint64_t)(PRV_MAX_DEPTH - pathLen)) return -1;
+            while (count > 0)
+            {
+                count--;
+                res = cbor_getItem(buffer + index, bufferLen - index, &item);
+                if (res < 0) return -1;
+                if (item.type != CBOR_TYPE_UNSIGNED_INTEGER || item.value >= LWM2M_MAX_ID) return -1;
+                index += res;
+                path[pathLen++] = (uint16_t)item.value;
+            }
+        }
+        break;
+
+        default:
+            return -1;
+        }
+
+        res = cbor_getItem(buffer + index, bufferLen - index, &value);
+        if (res < 0) return -1;
+        if (value.type == CBOR_TYPE_MAP)
+        {
+            if (pathLen >= PRV_MAX_DEPTH) return -1;
+            res = prv_parseMap(buffer + index, bufferLen - index, path, pathLen, recordArray, countP);
+            if (res < 0) return -1;
+            index += res;
+            continue;
+        }
+
+        // values are only found at the Resource and Resource Instance levels
+        if (pathLen < URI_DEPTH_RESOURCE) return -1;
+        if (value.type == CBOR_TYPE_TAG)
+        {
+            if (value.value != PRV_TAG_EPOCH_TIME) return -1;
+            index += res;
+            res = cbor_getItem(buffer + index, bufferLen - index, &value);
+            if (res < 0) return -1;
+            if (value.type != CBOR_TYPE_UNSIGNED_INTEGER && value.type != CBOR_TYPE_NEGATIVE_INTEGER) return -1;
+        }
+        index += res;
+
+        if (recordArray != NULL)
+        {
+            senml_record_t * recordP = recordArray + *countP;
+
+            memset(recordP, 0, sizeof(senml_record_t));
+            memset(recordP->ids, 0xFF, sizeof(recordP->ids));
+            memcpy(recordP->ids, path, pathLen * sizeof(uint16_t));
+            switch (value.type)
+            {
+            case CBOR_TYPE_UNSIGNED_INTEGER:
+            case CBOR_TYPE_NEGATIVE_INTEGER:
+            case CBOR_TYPE_FLOAT:
+                if (!cbor_decodeNumber(&value, &recordP->value)) return -1;
+                break;
+            case CBOR_TYPE_TEXT_STRING:
+            case CBOR_TYPE_BYTE_STRING:
+                /* Don't use lwm2m_data_encode_nstring or lwm2m_data_encode_opaque here. They would copy the buffer */
+                recordP->value.type = value.type == CBOR_TYPE_TEXT_STRING ? LWM2M_TYPE_STRING : LWM2M_TYPE_OPAQUE;
+                recordP->value.value.asBuffer.buffer = (uint8_t *)value.buffer;
+                recordP->value.value.asBuffer.length = (size_t)value.value;
+                break;
+            case CBOR_TYPE_SIMPLE:
+                if (value.value == CBOR_SIMPLE_TRUE)
+                {
+                    lwm2m_data_encode_bool(true, &recordP->value);
+                }
+                else if (value.value == CBOR_SIMPLE_FALSE)
+                {
+                    lwm2m_data_encode_bool(false, &recordP->value);
+                }
+                else if (value.value != CBOR_SIMPLE_NULL)
+                {
+                    return -1;
+                }
+                break;
+            default:
+                return -1;
+            }
+        }
+        (*countP)++;
+    }
+
+    return (int)index;
+}
+
+int lwm2m_cbor_parse(const lwm2m_uri_t * uriP,
+                     const uint8_t * buffer,
+                     size_t bufferLen,
+                     lwm2m_data_t ** dataP)
+{
+    senml_record_t * recordArray;
+    int count;
+    int res;
+
+    LOG_ARG("bufferLen: %d", bufferLen);
+    LOG_URI(uriP);
+    *dataP = NULL;
+
+    // the first pass validates the payload and counts the values
+    count = 0;
+    res = prv_parseMap(buffer, bufferLen, NULL, 0, NULL, &count);
+    if (res < 0 || (size_t)res != bufferLen || count == 0) goto error;
+
+    recordArray = (senml_record_t *)data_malloc(count * sizeof(senml_record_t));
+    if (recordArray == NULL) goto error;
+    count = 0;
+    res = prv_parseMap(buffer, bufferLen, NULL, 0, recordArray, &count);
+    if (res < 0)
+    {
+        data_free(recordArray);
+        goto error;
+    }
+
+    count = senml_convertRecords(uriP, recordArray, count, senml_copyBuffer, dataP);
+    data_free(recordArray);
+    if (count < 0) goto error;
+
+    LOG_ARG("Parsing successful. count: %d", count);
+    return count;
+
+error:
+    LOG("Parsing failed");
+    return -1;
+}
+
+static size_t prv_putPath(uint8_t * buffer,
+                          size_t bufferLen,
+                          const uint16_t * path,
+                          int pathLen)
+{
+    size_t head;
+    size_t res;
+    int i;
+
+    if (pathLen == 1)
+    {
+        return cbor_putHeader(buffer, bufferLen, CBOR_TYPE_UNSIGNED_INTEGER, path[0]);
+    }
+
+    head = cbor_putHeader(buffer, bufferLen, CBOR_TYPE_ARRAY, pathLen);
+    if (!head) return 0;
+    for (i = 0; i < pathLen; i++)
+    {
+        res = cbor_putHeader(buffer + head, bufferLen - head, CBOR_TYPE_UNSIGNED_INTEGER, path[i]);
+        if (!res) return 0;
+        head += res;
+    }
+
+    return head;
+}
+
+static int prv_serializeValue(const lwm2m_data_t * tlvP,
+                              uint8_t * buffer,
+                              size_t bufferLen)
+{
+    size_t res;
+
+    switch (tlvP->type)
+    {
+    case LWM2M_TYPE_UNDEFINED:
+        res = cbor_putHeader(buffer, bufferLen, CBOR_TYPE_SIMPLE, CBOR_SIMPLE_NULL);
+        break;
+
+    case LWM2M_TYPE_STRING:
+    case LWM2M_TYPE_CORE_LINK:
+        res = cbor_putString(buffer,
+                             bufferLen,
+                             CBOR_TYPE_TEXT_STRING,
+                             tlvP->value.asBuffer.buffer,
+                             tlvP->value.asBuffer.length);
+        break;
+
+    case LWM2M_TYPE_OPAQUE:
+        res = cbor_putString(buffer,
+                             bufferLen,
+                             CBOR_TYPE_BYTE_STRING,
+                             tlvP->value.asBuffer.buffer,
+                             tlvP->value.asBuffer.length);
+        break;
+
+    case LWM2M_TYPE_INTEGER:
+        res = cbor_putInt(buffer, bufferLen, tlvP->value.asInteger);
+        break;
+
+    case LWM2M_TYPE_UNSIGNED_INTEGER:
+        res = cbor_putHeader(buffer, bufferLen, CBOR_TYPE_UNSIGNED_INTEGER, tlvP->value.asUnsigned);
+        break;
+
+    case LWM2M_TYPE_FLOAT:
+        res = cbor_putFloat(buffer, bufferLen, tlvP->value.asFloat);
+        break;
+
+    case LWM2M_TYPE_BOOLEAN:
+        res = cbor_putHeader(buffer,
+                             bufferLen,
+                             CBOR_TYPE_SIMPLE,
+                             tlvP->value.asBoolean ? CBOR_SIMPLE_TRUE : CBOR_SIMPLE_FALSE);
+        break;
+
+    case LWM2M_TYPE_OBJECT_LINK:
+    {
+        uint8_t link[URI_MAX_STRING_LEN];
+        size_t linkLen;
+
+        linkLen = utils_objLinkToText(tlvP->value.asObjLink.objectId,
+                                      tlvP->value.asObjLink.objectInstanceId,
+                                      link,
+                                      sizeof(link));
+        if (!linkLen) return -1;
+        res = cbor_putString(buffer, bufferLen, CBOR_TYPE_TEXT_STRING, link, linkLen);
+    }
+    break;
+
+    default:
+        return -1;
+    }
+
+    if (!res) return PRV_CBOR_NO_SPACE;
+
+    return (int)res;
+}
+
+// serializes the map pairs of the items, prefix is added to the path of each of them
+static int prv_serializeItems(const uint16_t * prefix,
+                              int prefixLen,
+                              int depth,
+                              const lwm2m_data_t * itemsP,
+                              size_t count,
+                              uint8_t * buffer,
+                              size_t bufferLen)
+{
+    size_t head;
+    size_t index;
+    int res;
+
+    head = 0;
+    for (index = 0; index < count; index++)
+    {
+        uint16_t path[PRV_MAX_DEPTH];
+        int pathLen;
+        const lwm2m_data_t * nodeP;
+
+        if (depth + prefixLen >= PRV_MAX_DEPTH) return -1;
+        if (prefixLen > 0) memcpy(path, prefix, prefixLen * sizeof(uint16_t));
+        pathLen = prefixLen;
+        nodeP = itemsP + index;
+        path[pathLen++] = nodeP->id;
+        // levels with a single child are collapsed in the key
+        while (prv_isContainer(nodeP)
+            && nodeP->value.asChildren.count == 1
+            && depth + pathLen < PRV_MAX_DEPTH)
+        {
+            nodeP = nodeP->value.asChildren.array;
+            path[pathLen++] = nodeP->id;
+        }
+
+        res = (int)prv_putPath(buffer + head, bufferLen - head, path, pathLen);
+        if (!res) return PRV_CBOR_NO_SPACE;
+        head += res;
+
+        if (prv_isContainer(nodeP))
+        {
+            res = (int)cbor_putHeader(buffer + head, bufferLen - head, CBOR_TYPE_MAP, nodeP->value.asChildren.count);
+            if (!res) return PRV_CBOR_NO_SPACE;
+            head += res;
+            res = prv_serializeItems(NULL,
+                                     0,
+                                     depth + pathLen,
+                                     nodeP->value.asChildren.array,
+                                     nodeP->value.asChildren.count,
+                                     buffer + head,
+                                     bufferLen - head);
+        }
+        else
+        {
+            res = prv_serializeValue(nodeP, buffer + head, bufferLen - head);
+        }
+        if (res < 0) return res;
+        head += res;
+    }
+
+    return (int)head;
+}
+
+int lwm2m_cbor_serializeInto(const lwm2m_uri_t * uriP,
+                             int size,
+                             const lwm2m_data_t * tlvP,
+                             uint8_t * buffer,
+                             size_t length)
+{
+    uint8_t uriStr[URI_MAX_STRING_LEN];
+    uint16_t prefix[PRV_MAX_DEPTH];
+    int prefixLen;
+    uri_depth_t baseLevel;
+    uri_depth_t rootLevel;
+    lwm2m_data_t * targetP;
+    size_t head;
+    int num;
+    int res;
+
+    LOG_ARG("size: %d", size);
+    LOG_URI(uriP);
+    if (size != 0 && tlvP == NULL) return -1;
+
+    if (uri_toString(uriP, uriStr, URI_MAX_STRING_LEN, &baseLevel) < 0) return -1;
+    num = json_findAndCheckData(uriP, baseLevel, size, tlvP, &targetP, &rootLevel);
+    if (num < 0) return -1;
+
+    // the path of the parent of the items, which are found at rootLevel
+    prefixLen = 0;
+    if (rootLevel > URI_DEPTH_OBJECT) prefix[prefixLen++] = uriP->objectId;
+    if (rootLevel > URI_DEPTH_OBJECT_INSTANCE) prefix[prefixLen++] = uriP->instanceId;
+    if (rootLevel > URI_DEPTH_RESOURCE) prefix[prefixLen++] = uriP->resourceId;
+
+    if (prefixLen > 0 && num > 1)
+    {
+        // a single key for the common path
+        head = cbor_putHeader(buffer, length, CBOR_TYPE_MAP, 1);
+        if (!head) return 0;
+        res = (int)prv_putPath(buffer + head, length - head, prefix, prefixLen);
+        if (!res) return 0;
+        head += res;
+        res = (int)cbor_putHeader(buffer + head, length - head, CBOR_TYPE_MAP, num);
+        if (!res) return 0;
+        head += res;
+        res = prv_serializeItems(NULL, 0, prefixLen, targetP, num, buffer + head, length - head);
+    }
+    else
+    {
+        head = cbor_putHeader(buffer, length, CBOR_TYPE_MAP, num);
+        if (!head) return 0;
+        res = prv_serializeItems(prefix, prefixLen, 0, targetP, num, buffer + head, length - head);
+    }
+    if (res == PRV_CBOR_NO_SPACE) return 0;
+    if (res < 0) return -1;
+    head += res;
+
+    return (int)head;
+}
+
+int lwm2m_cbor_serialize(const lwm2m_uri_t * uriP,
+                         int size,
+                         const lwm2m_data_t * tlvP,
+                         uint8_t ** bufferP)
+{
+    size_t length;
+    int res;
+
+    // the buffer is doubled until the whole payload fits
+    length = PRV_CBOR_BUFFER_SIZE;
+    do
+    {
+        *bufferP = (uint8_t *)lwm2m_malloc(length);
+        if (*bufferP == NULL) return -1;
+
+        res = lwm2m_cbor_serializeInto(uriP, size, tlvP, *bufferP, length);
+        if (res <= 0)
+        {
+            lwm2m_free(*bufferP);
+            *bufferP = NULL;
+        }
+        length *= 2;
+    } while (res == 0 && length <= INT_MAX);
+
+    return res;
+}
+
+#endif
@@ -0,0 +1,712 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+/*
+ * SenML CBOR (RFC 8428 section 6) content format. The records are the same
+ * as in SenML JSON, with integer labels instead of the text ones.
+ */
+
+#include "internals.h"
+#include <string.h>
+#include <limits.h>
+
+
+#ifdef LWM2M_SUPPORT_SENML_CBOR
+
+#ifdef LWM2M_VERSION_1_0
+#error SenML CBOR not supported with LWM2M 1.0
+#endif
+
+#define PRV_CBOR_BUFFER_SIZE 1024 // initial size of the serialization buffer
+// returned by the serialization helpers when the buffer is too small
+#define PRV_CBOR_NO_SPACE    -2
+
+#define SENML_CBOR_LABEL_BVER          -1
+#define SENML_CBOR_LABEL_BN            -2
+#define SENML_CBOR_LABEL_BT            -3
+#define SENML_CBOR_LABEL_BV            -5
+#define SENML_CBOR_LABEL_N             0
+#define SENML_CBOR_LABEL_V             2
+#define SENML_CBOR_LABEL_VS            3
+#define SENML_CBOR_LABEL_VB            4
+#define SENML_CBOR_LABEL_T             6
+#define SENML_CBOR_LABEL_VD            8
+// no integer label is registered for object links
+#define SENML_CBOR_LABEL_VLO           "vlo"
+#define SENML_CBOR_LABEL_VLO_SIZE      3
+
+#define SENML_CBOR_VERSION             10
+
+// the largest integer label handled, others are ignored
+#define PRV_MAX_LABEL                  INT8_MAX
+// labels between -PRV_SEEN_OFFSET and PRV_SEEN_OFFSET are checked for duplicates
+#define PRV_SEEN_OFFSET                15
+
+static bool prv_convertTime(const cbor_item_t * itemP,
+                            time_t * timeP)
+{
+    switch (itemP->type)
+    {
+    case CBOR_TYPE_UNSIGNED_INTEGER:
+        if (itemP->value > INT64_MAX) return false;
+        *timeP = (time_t)itemP->value;
+        break;
+    case CBOR_TYPE_NEGATIVE_INTEGER:
+        if (itemP->value > INT64_MAX) return false;
+        *timeP = (time_t)(-1 - (int64_t)itemP->value);
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+static int prv_parseLabel(int label,
+                          const cbor_item_t * valueP,
+                          senml_record_t * recordP,
+                          const uint8_t ** nameP,
+                          size_t * nameLengthP,
+                          char * baseUri,
+                          time_t * baseTime,
+                          lwm2m_data_t * baseValue)
+{
+    switch (label)
+    {
+    case SENML_CBOR_LABEL_BN:
+        if (valueP->type != CBOR_TYPE_TEXT_STRING) return -1;
+        if (valueP->value + 2 > URI_MAX_STRING_LEN) return -1;
+        if (valueP->value == 1 && valueP->buffer[0] != '/') return -1;
+        memcpy(baseUri, valueP->buffer, (size_t)valueP->value);
+        baseUri[valueP->value] = '\0';
+        break;
+
+    case SENML_CBOR_LABEL_BT:
+        if (!prv_convertTime(valueP, baseTime)) return -1;
+        break;
+
+    case SENML_CBOR_LABEL_BV:
+        if (!cbor_decodeNumber(valueP, baseValue)) return -1;
+        /* Convert explicit 0 to implicit 0 */
+        switch (baseValue->type)
+        {
+        case LWM2M_TYPE_INTEGER:
+            if (baseValue->value.asInteger == 0)
+            {
+                baseValue->type = LWM2M_TYPE_UNDEFINED;
+            }
+            break;
+        case LWM2M_TYPE_UNSIGNED_INTEGER:
+            if (baseValue->value.asUnsigned == 0)
+            {
+                baseValue->type = LWM2M_TYPE_UNDEFINED;
+            }
+            break;
+        case LWM2M_TYPE_FLOAT:
+            if (baseValue->value.asFloat == 0.0)
+            {
+                baseValue->type = LWM2M_TYPE_UNDEFINED;
+            }
+            break;
+        default:
+            return -1;
+        }
+        break;
+
+    case SENML_CBOR_LABEL_BVER:
+        /* Only the default version (10) is supported */
+        if (valueP->type != CBOR_TYPE_UNSIGNED_INTEGER
+         || valueP->value != SENML_CBOR_VERSION)
+        {
+            return -1;
+        }
+        break;
+
+    case SENML_CBOR_LABEL_N:
+        if (valueP->type != CBOR_TYPE_TEXT_STRING) return -1;
+        *nameP = valueP->buffer;
+        *nameLengthP = (size_t)valueP->value;
+        break;
+
+    case SENML_CBOR_LABEL_T:
+        if (!prv_convertTime(valueP, &recordP->time)) return -1;
+        break;
+
+    case SENML_CBOR_LABEL_V:
+        if (recordP->value.type != LWM2M_TYPE_UNDEFINED) return -1;
+        if (!cbor_decodeNumber(valueP, &recordP->value)) return -1;
+        break;
+
+    case SENML_CBOR_LABEL_VB:
+        if (recordP->value.type != LWM2M_TYPE_UNDEFINED) return -1;
+        if (valueP->type != CBOR_TYPE_SIMPLE) return -1;
+        if (valueP->value == CBOR_SIMPLE_TRUE)
+        {
+            lwm2m_data_encode_bool(true, &recordP->value);
+        }
+        else if (valueP->value == CBOR_SIMPLE_FALSE)
+        {
+            lwm2m_data_encode_bool(false, &recordP->value);
+        }
+        else
+        {
+            return -1;
+        }
+        break;
+
+    case SENML_CBOR_LABEL_VS:
+    case SENML_CBOR_LABEL_VD:
+        if (recordP->value.type != LWM2M_TYPE_UNDEFINED) return -1;
+        if (label == SENML_CBOR_LABEL_VS)
+        {
+            if (valueP->type != CBOR_TYPE_TEXT_STRING) return -1;
+            /* Don't use lwm2m_data_encode_nstring here. It would copy the buffer */
+            recordP->value.type = LWM2M_TYPE_STRING;
+        }
+        else
+        {
+            if (valueP->type != CBOR_TYPE_BYTE_STRING) return -1;
+            /* Don't use lwm2m_data_encode_opaque here. It would copy the buffer */
+            recordP->value.type = LWM2M_TYPE_OPAQUE;
+        }
+        recordP->value.value.asBuffer.buffer = (uint8_t *)valueP->buffer;
+        recordP->value.value.asBuffer.length = (size_t)valueP->value;
+        break;
+
+    default:
+        // ignored, the caller skips the value
+        return 1;
+    }
+
+    return 0;
+}
+
+static int prv_parseItem(const uint8_t * buffer,
+                         size_t bufferLen,
+                         senml_record_t * recordP,
+                         char * baseUri,
+                         time_t * baseTime,
+                         lwm2m_data_t * baseValue)
+{
+    cbor_item_t item;
+    const uint8_t * name = NULL;
+    size_t nameLength = 0;
+    uint32_t seen = 0;
+    uint64_t pairs;
+    size_t index;
+    int res;
+
+    memset(recordP->ids, 0xFF, 4*sizeof(uint16_t));
+    memset(&recordP->value, 0, sizeof(recordP->value));
+    recordP->time = 0;
+
+    res = cbor_getItem(buffer, bufferLen, &item);
+    if (res < 0 || item.type != CBOR_TYPE_MAP) return -1;
+    index = res;
+    pairs = item.value;
+    if (pairs > (bufferLen - index) / 2) return -1;
+
+    while (pairs > 0)
+    {
+        cbor_item_t label;
+        cbor_item_t value;
+        int id;
+
+        pairs--;
+        res = cbor_getItem(buffer + index, bufferLen - index, &label);
+        if (res < 0) return -1;
+        index += res;
+        res = cbor_getItem(buffer + index, bufferLen - index, &value);
+        if (res < 0) return -1;
+
+        switch (label.type)
+        {
+        case CBOR_TYPE_UNSIGNED_INTEGER:
+            id = label.value > PRV_MAX_LABEL ? PRV_MAX_LABEL : (int)label.value;
+            break;
+        case CBOR_TYPE_NEGATIVE_INTEGER:
+            id = label.value > PRV_MAX_LABEL ? -PRV_MAX_LABEL : -1 - (int)label.value;
+            break;
+        case CBOR_TYPE_TEXT_STRING:
+            if (label.value == SENML_CBOR_LABEL_VLO_SIZE
+             && 0 == memcmp(label.buffer, SENML_CBOR_LABEL_VLO, SENML_CBOR_LABEL_VLO_SIZE))
+            {
+                if (recordP->value.type != LWM2M_TYPE_UNDEFINED) return -1;
+                if (value.type != CBOR_TYPE_TEXT_STRING) return -1;
+                if (!utils_textToObjLink(value.buffer,
+                                         (size_t)value.value,
+                                         &recordP->value.value.asObjLink.objectId,
+                                         &recordP->value.value.asObjLink.objectInstanceId))
+                {
+                    return -1;
+                }
+                recordP->value.type = LWM2M_TYPE_OBJECT_LINK;
+                index += res;
+                continue;
+            }
+            if (label.value > 0 && label.buffer[label.value - 1] == '_')
+            {
+                /* Label ending in _ must be supported or generate error. */
+                return -1;
+            }
+            id = PRV_MAX_LABEL;
+            break;
+        default:
+            return -1;
+        }
+
+        // each label is allowed once in a record
+        if (id >= -PRV_SEEN_OFFSET && id <= PRV_SEEN_OFFSET)
+        {
+            uint32_t mask = 1u << (id + PRV_SEEN_OFFSET);
+
+            if (seen & mask) return -1;
+            seen |= mask;
+        }
+
+        switch (prv_parseLabel(id, &value, recordP, &name, &nameLength, baseUri, baseTime, baseValue))
+        {
+        case 0:
+            index += res;
+            break;
+        case 1:
+            res = cbor_skipItem(buffer + index, bufferLen - index);
+            if (res < 0) return -1;
+            index += res;
+            break;
+        default:
+            return -1;
+        }
+    }
+
+    res = senml_applyBase(recordP, baseUri, name, nameLength, *baseTime, baseValue);
+    if (res < 0) return -1;
+
+    return (int)index;
+}
+
+int senml_cbor_parse(const lwm2m_uri_t * uriP,
+                     const uint8_t * buffer,
+                     size_t bufferLen,
+                     lwm2m_data_t ** dataP)
+{
+    cbor_item_t item;
+    size_t index;
+    int count;
+    senml_record_t * recordArray;
+    int recordIndex;
+    char baseUri[URI_MAX_STRING_LEN + 1];
+    time_t baseTime;
+    lwm2m_data_t baseValue;
+    int res;
+
+    LOG_ARG("bufferLen: %d", bufferLen);
+    LOG_URI(uriP);
+    *dataP = NULL;
+    recordArray = NULL;
+
+    res = cbor_getItem(buffer, bufferLen, &item);
+    if (res < 0 || item.type != CBOR_TYPE_ARRAY) return -1;
+    index = res;
+    // each record takes at least one byte
+    if (item.value == 0 || item.value > bufferLen - index || item.value > INT_MAX) return -1;
+    count = (int)item.value;
+
+    recordArray = (senml_record_t*)data_malloc(count * sizeof(senml_record_t));
+    if (recordArray == NULL) goto error;
+    baseUri[0] = '\0';
+    baseTime = 0;
+    memset(&baseValue, 0, sizeof(baseValue));
+    for (recordIndex = 0; recordIndex < count; recordIndex++)
+    {
+        res = prv_parseItem(buffer + index,
+                            bufferLen - index,
+                            recordArray + recordIndex,
+                            baseUri,
+                            &baseTime,
+                            &baseValue);
+        if (res < 0) goto error;
+        index += res;
+    }
+    if (index != bufferLen) goto error;
+
+    count = senml_convertRecords(uriP, recordArray, count, senml_copyBuffer, dataP);
+    data_free(recordArray);
+    recordArray = NULL;
+    if (count < 0) goto error;
+
+    LOG_ARG("Parsing successful. count: %d", count);
+    return count;
+
+error:
+    LOG("Parsing failed");
+    if (recordArray != NULL)
+    {
+        data_free(recordArray);
+    }
+    return -1;
+}
+
+static int prv_serializeValue(const lwm2m_data_t * tlvP,
+                              uint8_t * buffer,
+                              size_t bufferLen)
+{
+    size_t res;
+    size_t head;
+
+    switch (tlvP->type)
+    {
+    case LWM2M_TYPE_STRING:
+    case LWM2M_TYPE_CORE_LINK:
+        head = cbor_putInt(buffer, bufferLen, SENML_CBOR_LABEL_VS);
+        if (!head) return PRV_CBOR_NO_SPACE;
+        res = cbor_putString(buffer + head,
+                             bufferLen - head,
+                             CBOR_TYPE_TEXT_STRING,
+                             tlvP->value.asBuffer.buffer,
+                             tlvP->value.asBuffer.length);
+        break;
+
+    case LWM2M_TYPE_INTEGER:
+    {
+        int64_t value;
+
+        if (0 == lwm2m_data_decode_int(tlvP, &value)) return -1;
+
+        head = cbor_putInt(buffer, bufferLen, SENML_CBOR_LABEL_V);
+        if (!head) return PRV_CBOR_NO_SPACE;
+        res = cbor_putInt(buffer + head, bufferLen - head, value);
+    }
+    break;
+
+    case LWM2M_TYPE_UNSIGNED_INTEGER:
+    {
+        uint64_t value;
+
+        if (0 == lwm2m_data_decode_uint(tlvP, &value)) return -1;
+
+        head = cbor_putInt(buffer, bufferLen, SENML_CBOR_LABEL_V);
+        if (!head) return PRV_CBOR_NO_SPACE;
+        res = cbor_putHeader(buffer + head, bufferLen - head, CBOR_TYPE_UNSIGNED_INTEGER, value);
+    }
+    break;
+
+    case LWM2M_TYPE_FLOAT:
+    {
+        double value;
+
+        if (0 == lwm2m_data_decode_float(tlvP, &value)) return -1;
+
+        head = cbor_putInt(buffer, bufferLen, SENML_CBOR_LABEL_V);
+        if (!head) return PRV_CBOR_NO_SPACE;
+        res = cbor_putFloat(buffer + head, bufferLen - head, value);
+    }
+    break;
+
+    case LWM2M_TYPE_BOOLEAN:
+    {
+        bool value;
+
+        if (0 == lwm2m_data_decode_bool(tlvP, &value)) return -1;
+
+        head = cbor_putInt(buffer, bufferLen, SENML_CBOR_LABEL_VB);
+        if (!head) return PRV_CBOR_NO_SPACE;
+        res = cbor_putHeader(buffer + head,
+                             bufferLen - head,
+                             CBOR_TYPE_SIMPLE,
+                             value ? CBOR_SIMPLE_TRUE : CBOR_SIMPLE_FALSE);
+    }
+    break;
+
+    case LWM2M_TYPE_OPAQUE:
+        head = cbor_putInt(buffer, bufferLen, SENML_CBOR_LABEL_VD);
+        if (!head) return PRV_CBOR_NO_SPACE;
+        res = cbor_putString(buffer + head,
+                             bufferLen - head,
+                             CBOR_TYPE_BYTE_STRING,
+                             tlvP->value.asBuffer.buffer,
+                             tlvP->value.asBuffer.length);
+        break;
+
+    case LWM2M_TYPE_OBJECT_LINK:
+    {
+        uint8_t link[URI_MAX_STRING_LEN];
+        size_t linkLen;
+
+        linkLen = utils_objLinkToText(tlvP->value.asObjLink.objectId,
+                                      tlvP->value.asObjLink.objectInstanceId,
+                                      link,
+                                      sizeof(link));
+        if (!linkLen) return -1;
+
+        head = cbor_putString(buffer,
+                              bufferLen,
+                              CBOR_TYPE_TEXT_STRING,
+                              (const uint8_t *)SENML_CBOR_LABEL_VLO,
+                              SENML_CBOR_LABEL_VLO_SIZE);
+        if (!head) return PRV_CBOR_NO_SPACE;
+        res = cbor_putString(buffer + head, bufferLen - head, CBOR_TYPE_TEXT_STRING, link, linkLen);
+    }
+    break;
+
+    default:
+        return -1;
+    }
+
+    if (!res) return PRV_CBOR_NO_SPACE;
+
+    return (int)(head + res);
+}
+
+static int prv_countRecords(const lwm2m_data_t * tlvP)
+{
+    size_t index;
+    int count;
+
+    switch (tlvP->type)
+    {
+    case LWM2M_TYPE_MULTIPLE_RESOURCE:
+    case LWM2M_TYPE_OBJECT:
+    case LWM2M_TYPE_OBJECT_INSTANCE:
+        count = 0;
+        for (index = 0 ; index < tlvP->value.asChildren.count; index++)
+        {
+            count += prv_countRecords(tlvP->value.asChildren.array + index);
+        }
+        return count;
+
+    default:
+        return 1;
+    }
+}
+
+static int prv_serializeData(const lwm2m_data_t * tlvP,
+                             const uint8_t * baseUriStr,
+                             size_t baseUriLen,
+                             uri_depth_t baseLevel,
+                             const uint8_t * parentUriStr,
+                             size_t parentUriLen,
+                             uri_depth_t level,
+                             bool *baseNameOutput,
+                             uint8_t * buffer,
+                             size_t bufferLen)
+{
+    uint8_t uriStr[URI_MAX_STRING_LEN];
+    size_t uriLen;
+    size_t head;
+    size_t res;
+    int result;
+
+    if (parentUriLen > 0)
+    {
+        if (URI_MAX_STRING_LEN < parentUriLen) return -1;
+        memcpy(uriStr, parentUriStr, parentUriLen);
+    }
+    uriLen = parentUriLen;
+    res = utils_intToText(tlvP->id, uriStr + uriLen, URI_MAX_STRING_LEN - uriLen);
+    if (res == 0) return -1;
+    uriLen += res;
+
+    switch (tlvP->type)
+    {
+    case LWM2M_TYPE_MULTIPLE_RESOURCE:
+    case LWM2M_TYPE_OBJECT:
+    case LWM2M_TYPE_OBJECT_INSTANCE:
+    {
+        size_t index;
+
+        if (uriLen >= URI_MAX_STRING_LEN) return -1;
+        uriStr[uriLen++] = '/';
+
+        head = 0;
+        for (index = 0 ; index < tlvP->value.asChildren.count; index++)
+        {
+            result = prv_serializeData(tlvP->value.asChildren.array + index,
+                                       baseUriStr,
+                                       baseUriLen,
+                                       baseLevel,
+                                       uriStr,
+                                       uriLen,
+                                       level,
+                                       baseNameOutput,
+                                       buffer + head,
+                                       bufferLen - head);
+            if (result < 0) return result;
+            head += result;
+        }
+    }
+    break;
+
+    default:
+    {
+        bool withBaseName;
+        bool withName;
+        uint64_t pairs;
+
+        withBaseName = !*baseNameOutput && baseUriLen > 0;
+        withName = !baseUriLen || level > baseLevel;
+        pairs = (withBaseName ? 1 : 0) + (withName ? 1 : 0) + (tlvP->type != LWM2M_TYPE_UNDEFINED ? 1 : 0);
+
+        head = cbor_putHeader(buffer, bufferLen, CBOR_TYPE_MAP, pairs);
+        if (!head) return PRV_CBOR_NO_SPACE;
+
+        if (withBaseName)
+        {
+            res = cbor_putInt(buffer + head, bufferLen - head, SENML_CBOR_LABEL_BN);
+            if (!res) return PRV_CBOR_NO_SPACE;
+            head += res;
+            res = cbor_putString(buffer + head, bufferLen - head, CBOR_TYPE_TEXT_STRING, baseUriStr, baseUriLen);
+            if (!res) return PRV_CBOR_NO_SPACE;
+            head += res;
+            *baseNameOutput = true;
+        }
+
+        /* TODO: support base time */
+
+        if (withName)
+        {
+            res = cbor_putInt(buffer + head, bufferLen - head, SENML_CBOR_LABEL_N);
+            if (!res) return PRV_CBOR_NO_SPACE;
+            head += res;
+            res = cbor_putString(buffer + head, bufferLen - head, CBOR_TYPE_TEXT_STRING, uriStr, uriLen);
+            if (!res) return PRV_CBOR_NO_SPACE;
+            head += res;
+        }
+
+        if (tlvP->type != LWM2M_TYPE_UNDEFINED)
+        {
+            result = prv_serializeValue(tlvP, buffer + head, bufferLen - head);
+            if (result < 0) return result;
+            head += result;
+        }
+
+        /* TODO: support time */
+    }
+    break;
+    }
+
+    return (int)head;
+}
+
+int senml_cbor_serializeInto(const lwm2m_uri_t * uriP,
+                             int size,
+                             const lwm2m_data_t * tlvP,
+                             uint8_t * buffer,
+                             size_t length)
+{
+    int index;
+    size_t head;
+    uint8_t baseUriStr[URI_MAX_STRING_LEN];
+    int baseUriLen;
+    uri_depth_t rootLevel;
+    uri_depth_t baseLevel;
+    int num;
+    int count;
+    lwm2m_data_t * targetP;
+    const uint8_t *parentUriStr = NULL;
+    size_t parentUriLen = 0;
+    bool baseNameOutput = false;
+
+    LOG_ARG("size: %d", size);
+    LOG_URI(uriP);
+    if (size != 0 && tlvP == NULL) return -1;
+
+    baseUriLen = uri_toString(uriP, baseUriStr, URI_MAX_STRING_LEN, &baseLevel);
+    if (baseUriLen < 0) return -1;
+    if (baseUriLen > 1
+     && baseLevel != URI_DEPTH_RESOURCE
+     && baseLevel != URI_DEPTH_RESOURCE_INSTANCE)
+    {
+        if (baseUriLen >= URI_MAX_STRING_LEN -1) return -1;
+        baseUriStr[baseUriLen++] = '/';
+    }
+
+    num = json_findAndCheckData(uriP, baseLevel, size, tlvP, &targetP, &rootLevel);
+    if (num < 0) return -1;
+
+    if (baseLevel < rootLevel
+     && baseUriLen > 1
+     && baseUriStr[baseUriLen - 1] != '/')
+    {
+        if (baseUriLen >= URI_MAX_STRING_LEN -1) return -1;
+        baseUriStr[baseUriLen++] = '/';
+    }
+
+    if (!baseUriLen || baseUriStr[baseUriLen - 1] != '/')
+    {
+        parentUriStr = (const uint8_t *)"/";
+        parentUriLen = 1;
+    }
+
+    count = 0;
+    for (index = 0 ; index < num ; index++)
+    {
+        count += prv_countRecords(targetP + index);
+    }
+
+    head = cbor_putHeader(buffer, length, CBOR_TYPE_ARRAY, count);
+    if (!head) return 0;
+
+    for (index = 0 ; index < num ; index++)
+    {
+        int res;
+
+        res = prv_serializeData(targetP + index,
+                                baseUriStr,
+                                baseUriLen,
+                                baseLevel,
+                                parentUriStr,
+                                parentUriLen,
+                                rootLevel,
+                                &baseNameOutput,
+                                buffer + head,
+                                length - head);
+        if (res == PRV_CBOR_NO_SPACE) return 0;
+        if (res < 0) return -1;
+        head += res;
+    }
+
+    return (int)head;
+}
+
+int senml_cbor_serialize(const lwm2m_uri_t * uriP,
+                         int size,
+                         const lwm2m_data_t * tlvP,
+                         uint8_t ** bufferP)
+{
+    size_t length;
+    int res;
+
+    // the buffer is doubled until the whole payload fits
+    length = PRV_CBOR_BUFFER_SIZE;
+    do
+    {
+        *bufferP = (uint8_t *)lwm2m_malloc(length);
+        if (*bufferP == NULL) return -1;
+
+        res = senml_cbor_serializeInto(uriP, size, tlvP, *bufferP, length);
+        if (res <= 0)
+        {
+            lwm2m_free(*bufferP);
+            *bufferP = NULL;
+        }
+        length *= 2;
+    } while (res == 0 && length <= INT_MAX);
+
+    return res;
+}
+
+#endif
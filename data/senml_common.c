@@ -0,0 +1,431 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+/*
+ * Handling of the SenML records shared by the SenML JSON and SenML CBOR
+ * content formats. The records are decoded by the format specific parser,
+ * then combined with the base values and converted to lwm2m_data_t here.
+ */
+
+#include "internals.h"
+#include <string.h>
+
+
+#if defined(LWM2M_SUPPORT_SENML_JSON) || defined(LWM2M_SUPPORT_SENML_CBOR) || defined(LWM2M_SUPPORT_LWM2M_CBOR)
+
+static bool prv_convertValue(const senml_record_t * recordP,
+                             senml_convertBuffer_t convertBuffer,
+                             lwm2m_data_t * targetP)
+{
+    switch (recordP->value.type)
+    {
+    case LWM2M_TYPE_STRING:
+    case LWM2M_TYPE_OPAQUE:
+        return convertBuffer(recordP, targetP);
+    default:
+        targetP->type = recordP->value.type;
+        memcpy(&targetP->value, &recordP->value.value, sizeof(targetP->value));
+        break;
+    case LWM2M_TYPE_OBJECT:
+    case LWM2M_TYPE_OBJECT_INSTANCE:
+    case LWM2M_TYPE_MULTIPLE_RESOURCE:
+    case LWM2M_TYPE_CORE_LINK:
+        /* Should never happen */
+        return false;
+    }
+
+    return true;
+}
+
+// checks that the nodes of longer paths can be added below dataP
+// A node only reached by records without value is still undefined and takes the given type.
+static bool prv_isContainer(lwm2m_data_t * dataP,
+                            lwm2m_data_type_t type)
+{
+    if (dataP->type == LWM2M_TYPE_UNDEFINED && dataP->value.asChildren.count == 0)
+    {
+        dataP->type = type;
+        return true;
+    }
+
+    return dataP->type == type;
+}
+
+static bool prv_hasChildren(const lwm2m_data_t * dataP)
+{
+    switch (dataP->type)
+    {
+    case LWM2M_TYPE_OBJECT:
+    case LWM2M_TYPE_OBJECT_INSTANCE:
+    case LWM2M_TYPE_MULTIPLE_RESOURCE:
+        return dataP->value.asChildren.count != 0;
+    default:
+        return false;
+    }
+}
+
+static int prv_convertRecord(const senml_record_t * recordArray,
+                             int count,
+                             senml_convertBuffer_t convertBuffer,
+                             lwm2m_data_t ** dataP)
+{
+    int index;
+    int freeIndex;
+    lwm2m_data_t * rootP;
+
+    rootP = lwm2m_data_new(count);
+    if (NULL == rootP)
+    {
+        *dataP = NULL;
+        return -1;
+    }
+
+    freeIndex = 0;
+    for (index = 0 ; index < count ; index++)
+    {
+        lwm2m_data_t * targetP;
+        int i;
+
+        targetP = json_findDataItem(rootP, count, recordArray[index].ids[0]);
+        if (targetP == NULL)
+        {
+            targetP = rootP + freeIndex;
+            freeIndex++;
+            targetP->id = recordArray[index].ids[0];
+            targetP->type = LWM2M_TYPE_OBJECT;
+        }
+        if (recordArray[index].ids[1] != LWM2M_MAX_ID)
+        {
+            lwm2m_data_t * parentP;
+            uri_depth_t level;
+
+            parentP = targetP;
+            level = URI_DEPTH_OBJECT_INSTANCE;
+            for (i = 1 ; i <= 2 ; i++)
+            {
+                if (recordArray[index].ids[i] == LWM2M_MAX_ID) break;
+                // a value was given to a shorter path
+                if (!prv_isContainer(parentP, i == 1 ? LWM2M_TYPE_OBJECT : LWM2M_TYPE_OBJECT_INSTANCE)) goto error;
+                targetP = json_findDataItem(parentP->value.asChildren.array,
+                                           parentP->value.asChildren.count,
+                                           recordArray[index].ids[i]);
+                if (targetP == NULL)
+                {
+                    targetP = json_extendData(parentP);
+                    if (targetP == NULL) goto error;
+                    targetP->id = recordArray[index].ids[i];
+                    targetP->type = utils_depthToDatatype(level);
+                }
+                level = json_decreaseLevel(level);
+                parentP = targetP;
+            }
+            if (recordArray[index].ids[3] != LWM2M_MAX_ID)
+            {
+                if (targetP->type == LWM2M_TYPE_UNDEFINED) targetP->type = LWM2M_TYPE_MULTIPLE_RESOURCE;
+                targetP = json_extendData(targetP);
+                if (targetP == NULL) goto error;
+                targetP->id = recordArray[index].ids[3];
+                targetP->type = LWM2M_TYPE_UNDEFINED;
+            }
+        }
+
+        if (prv_hasChildren(targetP))
+        {
+            // a record without value on the path of a node already holding longer paths adds nothing
+            if (recordArray[index].value.type != LWM2M_TYPE_UNDEFINED) goto error;
+            continue;
+        }
+        if (!prv_convertValue(recordArray + index, convertBuffer, targetP)) goto error;
+    }
+
+    if (freeIndex < count)
+    {
+        *dataP = lwm2m_data_new(freeIndex);
+        if (*dataP == NULL) goto error;
+        memcpy(*dataP, rootP, freeIndex * sizeof(lwm2m_data_t));
+        data_free(rootP);     /* do not use lwm2m_data_free() to keep pointed values */
+    }
+    else
+    {
+        *dataP = rootP;
+    }
+
+    return freeIndex;
+
+error:
+    lwm2m_data_free(count, rootP);
+    *dataP = NULL;
+
+    return -1;
+}
+
+#if defined(LWM2M_SUPPORT_SENML_CBOR) || defined(LWM2M_SUPPORT_LWM2M_CBOR)
+bool senml_copyBuffer(const senml_record_t * recordP,
+                      lwm2m_data_t * targetP)
+{
+    switch (recordP->value.type)
+    {
+    case LWM2M_TYPE_STRING:
+        lwm2m_data_encode_nstring((const char *)recordP->value.value.asBuffer.buffer,
+                                  recordP->value.value.asBuffer.length,
+                                  targetP);
+        break;
+    case LWM2M_TYPE_OPAQUE:
+        lwm2m_data_encode_opaque(recordP->value.value.asBuffer.buffer,
+                                 recordP->value.value.asBuffer.length,
+                                 targetP);
+        break;
+    default:
+        return false;
+    }
+
+    // the type is left undefined when the copy failed
+    return targetP->type != LWM2M_TYPE_UNDEFINED;
+}
+#endif
+
+int senml_applyBase(senml_record_t * recordP,
+                    const char * baseUri,
+                    const uint8_t * name,
+                    size_t nameLength,
+                    time_t baseTime,
+                    const lwm2m_data_t * baseValue)
+{
+    recordP->time += baseTime;
+    if (baseUri[0] || name)
+    {
+        lwm2m_uri_t uri;
+        size_t length = strlen(baseUri);
+        char uriStr[URI_MAX_STRING_LEN];
+        if (length > sizeof(uriStr)) return -1;
+        memcpy(uriStr, baseUri, length);
+        if (nameLength)
+        {
+            if (nameLength + length > sizeof(uriStr)) return -1;
+            memcpy(uriStr + length, name, nameLength);
+            length += nameLength;
+        }
+        if (!lwm2m_stringToUri(uriStr, length, &uri)) return -1;
+        if (LWM2M_URI_IS_SET_OBJECT(&uri))
+        {
+            recordP->ids[0] = uri.objectId;
+        }
+        if (LWM2M_URI_IS_SET_INSTANCE(&uri))
+        {
+            recordP->ids[1] = uri.instanceId;
+        }
+        if (LWM2M_URI_IS_SET_RESOURCE(&uri))
+        {
+            recordP->ids[2] = uri.resourceId;
+        }
+        if (LWM2M_URI_IS_SET_RESOURCE_INSTANCE(&uri))
+        {
+            recordP->ids[3] = uri.resourceInstanceId;
+        }
+    }
+    if (baseValue->type != LWM2M_TYPE_UNDEFINED)
+    {
+        if (recordP->value.type == LWM2M_TYPE_UNDEFINED)
+        {
+            memcpy(&recordP->value, baseValue, sizeof(*baseValue));
+        }
+        else
+        {
+            switch (recordP->value.type)
+            {
+            case LWM2M_TYPE_INTEGER:
+                switch(baseValue->type)
+                {
+                case LWM2M_TYPE_INTEGER:
+                    recordP->value.value.asInteger += baseValue->value.asInteger;
+                    break;
+                case LWM2M_TYPE_UNSIGNED_INTEGER:
+                    recordP->value.value.asInteger += baseValue->value.asUnsigned;
+                    break;
+                case LWM2M_TYPE_FLOAT:
+                    recordP->value.value.asInteger += baseValue->value.asFloat;
+                    break;
+                default:
+                    return -1;
+                }
+                break;
+            case LWM2M_TYPE_UNSIGNED_INTEGER:
+                switch(baseValue->type)
+                {
+                case LWM2M_TYPE_INTEGER:
+                    recordP->value.value.asUnsigned += baseValue->value.asInteger;
+                    break;
+                case LWM2M_TYPE_UNSIGNED_INTEGER:
+                    recordP->value.value.asUnsigned += baseValue->value.asUnsigned;
+                    break;
+                case LWM2M_TYPE_FLOAT:
+                    recordP->value.value.asUnsigned += baseValue->value.asFloat;
+                    break;
+                default:
+                    return -1;
+                }
+                break;
+            case LWM2M_TYPE_FLOAT:
+                switch(baseValue->type)
+                {
+                case LWM2M_TYPE_INTEGER:
+                    recordP->value.value.asFloat += baseValue->value.asInteger;
+                    break;
+                case LWM2M_TYPE_UNSIGNED_INTEGER:
+                    recordP->value.value.asFloat += baseValue->value.asUnsigned;
+                    break;
+                case LWM2M_TYPE_FLOAT:
+                    recordP->value.value.asFloat += baseValue->value.asFloat;
+                    break;
+                default:
+                    return -1;
+                }
+                break;
+            default:
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int senml_convertRecords(const lwm2m_uri_t * uriP,
+                         const senml_record_t * recordArray,
+                         int count,
+                         senml_convertBuffer_t convertBuffer,
+                         lwm2m_data_t ** dataP)
+{
+    lwm2m_data_t * parsedP;
+    lwm2m_data_t * resultP;
+    int size;
+
+    *dataP = NULL;
+    count = prv_convertRecord(recordArray, count, convertBuffer, &parsedP);
+    if (count < 0) return -1;
+
+    if (count > 0 && uriP != NULL && LWM2M_URI_IS_SET_OBJECT(uriP))
+    {
+        if (parsedP->type != LWM2M_TYPE_OBJECT) goto error;
+        if (parsedP->id != uriP->objectId) goto error;
+        if (!LWM2M_URI_IS_SET_INSTANCE(uriP))
+        {
+            size = parsedP->value.asChildren.count;
+            resultP = parsedP->value.asChildren.array;
+        }
+        else
+        {
+            int i;
+
+            resultP = NULL;
+            /* be permissive and allow full object JSON when requesting for a single instance */
+            for (i = 0 ;
+                 i < (int)parsedP->value.asChildren.count && resultP == NULL;
+                 i++)
+            {
+                lwm2m_data_t * targetP;
+
+                targetP = parsedP->value.asChildren.array + i;
+                if (targetP->id == uriP->instanceId)
+                {
+                    resultP = targetP->value.asChildren.array;
+                    size = targetP->value.asChildren.count;
+                }
+            }
+            if (resultP == NULL) goto error;
+            if (LWM2M_URI_IS_SET_RESOURCE(uriP))
+            {
+                lwm2m_data_t * resP;
+
+                resP = NULL;
+                for (i = 0 ; i < size && resP == NULL; i++)
+                {
+                    lwm2m_data_t * targetP;
+
+                    targetP = resultP + i;
+                    if (targetP->id == uriP->resourceId)
+                    {
+                        if (targetP->type == LWM2M_TYPE_MULTIPLE_RESOURCE
+                         && LWM2M_URI_IS_SET_RESOURCE_INSTANCE(uriP))
+                        {
+                            resP = targetP->value.asChildren.array;
+                            size = targetP->value.asChildren.count;
+                        }
+                        else
+                        {
+                            size = json_dataStrip(1, targetP, &resP);
+                            if (size <= 0) goto error;
+                            lwm2m_data_free(count, parsedP);
+                            parsedP = NULL;
+                        }
+                    }
+                }
+                if (resP == NULL) goto error;
+                resultP = resP;
+            }
+            if (LWM2M_URI_IS_SET_RESOURCE_INSTANCE(uriP))
+            {
+                lwm2m_data_t * resP;
+
+                resP = NULL;
+                for (i = 0 ; i < size && resP == NULL; i++)
+                {
+                    lwm2m_data_t * targetP;
+
+                    targetP = resultP + i;
+                    if (targetP->id == uriP->resourceInstanceId)
+                    {
+                        size = json_dataStrip(1, targetP, &resP);
+                        if (size <= 0) goto error;
+                        lwm2m_data_free(count, parsedP);
+                        parsedP = NULL;
+                    }
+                }
+                if (resP == NULL) goto error;
+                resultP = resP;
+            }
+        }
+    }
+    else
+    {
+        resultP = parsedP;
+        size = count;
+    }
+
+    if (parsedP != NULL)
+    {
+        lwm2m_data_t * tempP;
+
+        size = json_dataStrip(size, resultP, &tempP);
+        if (size <= 0) goto error;
+        lwm2m_data_free(count, parsedP);
+        resultP = tempP;
+    }
+    *dataP = resultP;
+
+    return size;
+
+
+error:
+    if (parsedP != NULL)
+    {
+        lwm2m_data_free(count, parsedP);
+    }
+    return -1;
+}
+
+#endif
@@ -278,16 +278,14 @@ static int prv_createHeader(uint8_t * header,
     return header_len;
 }
 
-int lwm2m_decode_TLV(const uint8_t * buffer,
-                    size_t buffer_len,
-                    lwm2m_data_type_t * oType,
-                    uint16_t * oID,
-                    size_t * oDataIndex,
-                    size_t * oDataLen)
+// decodes the header only, the value may not be in the buffer yet
+static int prv_decodeHeader(const uint8_t * buffer,
+                            size_t buffer_len,
+                            lwm2m_data_type_t * oType,
+                            uint16_t * oID,
+                            size_t * oDataIndex,
+                            size_t * oDataLen)
 {
-
-    LOG_ARG("buffer_len: %d", buffer_len);
-        ;
     if (buffer_len < 2) return 0;
 
     *oDataIndex = 2;
@@ -336,11 +334,39 @@ int lwm2m_decode_TLV(const uint8_t * buffer,
         return 0;
     }
 
+    return *oDataIndex;
+}
+
+int lwm2m_decode_TLV(const uint8_t * buffer,
+                    size_t buffer_len,
+                    lwm2m_data_type_t * oType,
+                    uint16_t * oID,
+                    size_t * oDataIndex,
+                    size_t * oDataLen)
+{
+
+    LOG_ARG("buffer_len: %d", buffer_len);
+        ;
+    if (0 == prv_decodeHeader(buffer, buffer_len, oType, oID, oDataIndex, oDataLen)) return 0;
+
     if (*oDataIndex + *oDataLen > buffer_len) return 0;
 
     return *oDataIndex + *oDataLen;
 }
 
+int tlv_decodeResourceHeader(const uint8_t * buffer,
+                             size_t bufferLen,
+                             uint16_t * idP,
+                             size_t * valueLengthP)
+{
+    lwm2m_data_type_t type;
+    size_t dataIndex;
+
+    if (bufferLen < 1 || (buffer[0] & _PRV_TLV_TYPE_MASK) != _PRV_TLV_TYPE_RESOURCE) return 0;
+
+    return prv_decodeHeader(buffer, bufferLen, &type, idP, &dataIndex, valueLengthP);
+}
+
 
 int tlv_parse(const uint8_t * buffer,
               size_t bufferLen,
@@ -350,33 +376,30 @@ int tlv_parse(const uint8_t * buffer,
     uint16_t id;
     size_t dataIndex;
     size_t dataLen;
-    int index = 0;
+    size_t index = 0;
     int result;
+    int count = 0;
     int size = 0;
 
     LOG_ARG("bufferLen: %d", bufferLen);
 
     *dataP = NULL;
 
-    while (0 != (result = lwm2m_decode_TLV((uint8_t*)buffer + index, bufferLen - index, &type, &id, &dataIndex, &dataLen)))
+    // count the records first to allocate the array at once
+    while (0 != (result = lwm2m_decode_TLV(buffer + index, bufferLen - index, &type, &id, &dataIndex, &dataLen)))
     {
-        lwm2m_data_t * newTlvP;
+        count++;
+        index += result;
+    }
+    if (count == 0) return 0;
 
-        newTlvP = lwm2m_data_new(size + 1);
-        if (size >= 1)
-        {
-            if (newTlvP == NULL)
-            {
-                lwm2m_data_free(size, *dataP);
-                return 0;
-            }
-            else
-            {
-                memcpy(newTlvP, *dataP, size * sizeof(lwm2m_data_t));
-                lwm2m_free(*dataP);
-            }
-        }
-        *dataP = newTlvP;
+    *dataP = lwm2m_data_new(count);
+    if (*dataP == NULL) return 0;
+
+    index = 0;
+    for (size = 0 ; size < count ; size++)
+    {
+        result = lwm2m_decode_TLV(buffer + index, bufferLen - index, &type, &id, &dataIndex, &dataLen);
 
         (*dataP)[size].type = type;
         (*dataP)[size].id = id;
@@ -388,6 +411,7 @@ int tlv_parse(const uint8_t * buffer,
             if ((*dataP)[size].value.asChildren.count == 0)
             {
                 lwm2m_data_free(size + 1, *dataP);
+                *dataP = NULL;
                 return 0;
             }
         }
@@ -395,7 +419,6 @@ int tlv_parse(const uint8_t * buffer,
         {
             lwm2m_data_encode_opaque(buffer + index + dataIndex, dataLen, (*dataP) + size);
         }
-        size++;
         index += result;
     }
 
@@ -498,150 +521,155 @@ static int prv_getLength(int size,
 }
 
 
-int tlv_serialize(bool isResourceInstance, 
-                  int size,
-                  lwm2m_data_t * dataP,
-                  uint8_t ** bufferP)
+/*
+ * Writes the TLV of the size items of dataP so that it ends at buffer + end.
+ * Items are written from the last one and every value before its header, whose
+ * length depends on the length of the value: the children of an instance or of
+ * a multiple resource are written in place and only measured once.
+ * Returns the index of the first byte written, or -1.
+ */
+static int prv_serializeBackward(bool isResourceInstance,
+                                 int size,
+                                 lwm2m_data_t * dataP,
+                                 uint8_t * buffer,
+                                 int end)
 {
-    int length;
-    int index;
+    int index = end;
     int i;
 
-    LOG_ARG("isResourceInstance: %s, size: %d", isResourceInstance?"true":"false", size);
-
-    *bufferP = NULL;
-    length = prv_getLength(size, dataP);
-    if (length <= 0) return length;
-
-    *bufferP = (uint8_t *)lwm2m_malloc(length);
-    if (*bufferP == NULL) return 0;
-
-    index = 0;
-    for (i = 0 ; i < size && length != 0 ; i++)
+    for (i = size - 1 ; i >= 0 ; i--)
     {
-        int headerLen;
-        bool isInstance;
         lwm2m_data_t * cur = &dataP[i];
+        uint8_t data_buffer[_PRV_64BIT_BUFFER_SIZE];
+        const uint8_t * value = data_buffer;
+        size_t data_len;
+        bool isInstance = isResourceInstance;
+        bool isContainer = false;
+        int headerLen;
 
-        isInstance = isResourceInstance;
         switch (cur->type)
         {
         case LWM2M_TYPE_MULTIPLE_RESOURCE:
-            isInstance = true;
-            // fall through
         case LWM2M_TYPE_OBJECT_INSTANCE:
             {
-                uint8_t * tmpBuffer;
-                int res;
-
-                res = tlv_serialize(isInstance, cur->value.asChildren.count, cur->value.asChildren.array, &tmpBuffer);
-                if (res < 0)
-                {
-                    length = -1;
-                }
-                else
-                {
-                    size_t tmpLength;
-
-                    tmpLength = (size_t)res;
-                    headerLen = prv_createHeader(*bufferP + index, false, cur->type, cur->id, tmpLength);
-                    index += headerLen;
-                    if (tmpLength > 0)
-                    {
-                        memcpy(*bufferP + index, tmpBuffer, tmpLength);
-                        index += tmpLength;
-                        lwm2m_free(tmpBuffer);
-                    }
-                }
+                int start;
+
+                start = prv_serializeBackward(cur->type == LWM2M_TYPE_MULTIPLE_RESOURCE ? true : isResourceInstance,
+                                              cur->value.asChildren.count,
+                                              cur->value.asChildren.array,
+                                              buffer,
+                                              index);
+                if (start < 0) return -1;
+                data_len = (size_t)(index - start);
+                index = start;
+                isInstance = false;
+                isContainer = true;
             }
             break;
 
         case LWM2M_TYPE_OBJECT_LINK:
             {
                 int k;
-                uint8_t buf[4];
                 uint32_t v = cur->value.asObjLink.objectId;
                 v <<= 16;
                 v |= cur->value.asObjLink.objectInstanceId;
                 for (k = 3; k >= 0; --k) {
-                    buf[k] = (uint8_t)(v & 0xFF);
+                    data_buffer[k] = (uint8_t)(v & 0xFF);
                     v >>= 8;
                 }
                 // keep encoding as buffer
-                headerLen = prv_createHeader(*bufferP + index, isInstance, cur->type, cur->id, 4);
-                index += headerLen;
-                memcpy(*bufferP + index, buf, 4);
-                index += 4;
+                data_len = 4;
             }
             break;
 
         case LWM2M_TYPE_STRING:
         case LWM2M_TYPE_OPAQUE:
         case LWM2M_TYPE_CORE_LINK:
-            headerLen = prv_createHeader(*bufferP + index, isInstance, cur->type, cur->id, cur->value.asBuffer.length);
-            index += headerLen;
-            if (cur->value.asBuffer.length > 0) {
-                memcpy(*bufferP + index, cur->value.asBuffer.buffer, cur->value.asBuffer.length);
-            }
-            index += cur->value.asBuffer.length;
+            value = cur->value.asBuffer.buffer;
+            data_len = cur->value.asBuffer.length;
             break;
 
         case LWM2M_TYPE_INTEGER:
-            {
-                size_t data_len;
-                uint8_t data_buffer[_PRV_64BIT_BUFFER_SIZE];
-
-                data_len = prv_encodeInt(cur->value.asInteger, data_buffer);
-                headerLen = prv_createHeader(*bufferP + index, isInstance, cur->type, cur->id, data_len);
-                index += headerLen;
-                memcpy(*bufferP + index, data_buffer, data_len);
-                index += data_len;
-            }
+            data_len = prv_encodeInt(cur->value.asInteger, data_buffer);
             break;
 
         case LWM2M_TYPE_UNSIGNED_INTEGER:
-            {
-                size_t data_len;
-                uint8_t data_buffer[_PRV_64BIT_BUFFER_SIZE];
-
-                data_len = prv_encodeUInt(cur->value.asUnsigned, data_buffer);
-                headerLen = prv_createHeader(*bufferP + index, isInstance, cur->type, cur->id, data_len);
-                index += headerLen;
-                memcpy(*bufferP + index, data_buffer, data_len);
-                index += data_len;
-            }
+            data_len = prv_encodeUInt(cur->value.asUnsigned, data_buffer);
             break;
 
         case LWM2M_TYPE_FLOAT:
-            {
-                size_t data_len;
-                uint8_t data_buffer[_PRV_64BIT_BUFFER_SIZE];
-
-                data_len = prv_encodeFloat(cur->value.asFloat, data_buffer);
-                headerLen = prv_createHeader(*bufferP + index, isInstance, cur->type, cur->id, data_len);
-                index += headerLen;
-                memcpy(*bufferP + index, data_buffer, data_len);
-                index += data_len;
-            }
+            data_len = prv_encodeFloat(cur->value.asFloat, data_buffer);
             break;
 
         case LWM2M_TYPE_BOOLEAN:
-            headerLen = prv_createHeader(*bufferP + index, isInstance, cur->type, cur->id, 1);
-            index += headerLen;
-            (*bufferP)[index] = cur->value.asBoolean ? 1 : 0;
-            index += 1;
+            data_buffer[0] = cur->value.asBoolean ? 1 : 0;
+            data_len = 1;
             break;
 
         default:
-            length = -1;
-            break;
+            return -1;
         }
+
+        if (!isContainer)
+        {
+            if ((size_t)index < data_len) return -1;
+            index -= data_len;
+            if (data_len > 0)
+            {
+                memcpy(buffer + index, value, data_len);
+            }
+        }
+
+        headerLen = prv_getHeaderLength(cur->id, data_len);
+        if (index < headerLen) return -1;
+        index -= headerLen;
+        prv_createHeader(buffer + index, isInstance, cur->type, cur->id, data_len);
     }
 
-    if (length < 0)
+    return index;
+}
+
+int tlv_serializeInto(bool isResourceInstance,
+                      int size,
+                      lwm2m_data_t * dataP,
+                      uint8_t * buffer,
+                      size_t length)
+{
+    int res;
+
+    LOG_ARG("isResourceInstance: %s, size: %d, length: %u", isResourceInstance?"true":"false", size, length);
+
+    res = prv_getLength(size, dataP);
+    if (res <= 0 || (size_t)res > length) return res;
+
+    // the buffer is exactly filled, from the end of the TLV
+    if (prv_serializeBackward(isResourceInstance, size, dataP, buffer, res) != 0) return -1;
+
+    return res;
+}
+
+int tlv_serialize(bool isResourceInstance, 
+                  int size,
+                  lwm2m_data_t * dataP,
+                  uint8_t ** bufferP)
+{
+    int length;
+
+    LOG_ARG("isResourceInstance: %s, size: %d", isResourceInstance?"true":"false", size);
+
+    *bufferP = NULL;
+    length = prv_getLength(size, dataP);
+    if (length <= 0) return length;
+
+    *bufferP = (uint8_t *)lwm2m_malloc(length);
+    if (*bufferP == NULL) return 0;
+
+    // the buffer is exactly filled, from its end
+    if (prv_serializeBackward(isResourceInstance, size, dataP, *bufferP, length) != 0)
     {
         lwm2m_free(*bufferP);
         *bufferP = NULL;
+        length = -1;
     }
 
     LOG_ARG("returning %u", length);
@@ -70,6 +70,7 @@
 #include <errno.h>
 #include <signal.h>
 #include <inttypes.h>
+#include <pthread.h>
 
 #include "commandline.h"
 #include "connection.h"
@@ -78,6 +79,154 @@
 
 static int g_quit = 0;
 
+/*
+ * Sharded mode (-t N): N worker threads each run their own context on their
+ * own SO_REUSEPORT socket bound to the same port. The kernel hashes the peer
+ * address to pick a socket, so all the packets of a client reach the same
+ * worker. The main thread reads the command line and forwards each command to
+ * the worker owning the target client.
+ *
+ * Client IDs are allocated by each context, so two workers can use the same
+ * one. The directory maps the IDs displayed to the user to the worker and its
+ * local ID. It is written by the workers on registration and deregistration
+ * and read by the main thread to route commands.
+ */
+
+// A client in the directory shared by the shards, id is the ID displayed to the user
+typedef struct _directory_entry_
+{
+    struct _directory_entry_ * next;    // matches lwm2m_list_t::next
+    uint16_t                   id;      // matches lwm2m_list_t::id
+    int                        shard;
+    uint16_t                   localID; // ID of the client in the context of its shard
+} directory_entry_t;
+
+// A client in the context of a shard, id is its ID in that context
+typedef struct _local_entry_
+{
+    struct _local_entry_ *     next;        // matches lwm2m_list_t::next
+    uint16_t                   id;          // matches lwm2m_list_t::id
+    uint16_t                   directoryID; // ID of the client in the directory
+} local_entry_t;
+
+typedef struct _shard_command_
+{
+    struct _shard_command_ * next;
+    char                     line[MAX_PACKET_SIZE];
+} shard_command_t;
+
+typedef struct
+{
+    int                        index;
+    pthread_t                  thread;
+    int                        sock;
+    int                        wakeup[2];   // pipe from the main thread
+    lwm2m_context_t *          lwm2mH;
+    lwm2m_connection_layer_t * connLayer;
+    command_desc_t *           commands;
+    local_entry_t *            localList;   // local ID to directory ID, only used by the worker
+    pthread_mutex_t            mutex;       // protects the fields below
+    shard_command_t *          queueHead;
+    shard_command_t *          queueTail;
+    bool                       stop;
+} shard_t;
+
+static pthread_mutex_t g_directoryMutex = PTHREAD_MUTEX_INITIALIZER;
+static directory_entry_t * g_directory = NULL;
+
+static uint16_t prv_directory_add(shard_t * shardP,
+                                  uint16_t localID)
+{
+    directory_entry_t * entryP;
+    local_entry_t * localP;
+
+    // a client registering again keeps its ID
+    localP = (local_entry_t *)LWM2M_LIST_FIND(shardP->localList, localID);
+    if (localP != NULL) return localP->directoryID;
+
+    entryP = (directory_entry_t *)malloc(sizeof(directory_entry_t));
+    localP = (local_entry_t *)malloc(sizeof(local_entry_t));
+    if (entryP == NULL || localP == NULL)
+    {
+        free(entryP);
+        free(localP);
+        return localID;
+    }
+
+    pthread_mutex_lock(&g_directoryMutex);
+    entryP->id = lwm2m_list_newId((lwm2m_list_t *)g_directory);
+    entryP->shard = shardP->index;
+    entryP->localID = localID;
+    g_directory = (directory_entry_t *)LWM2M_LIST_ADD(g_directory, entryP);
+    pthread_mutex_unlock(&g_directoryMutex);
+
+    localP->id = localID;
+    localP->directoryID = entryP->id;
+    shardP->localList = (local_entry_t *)LWM2M_LIST_ADD(shardP->localList, localP);
+
+    return entryP->id;
+}
+
+static void prv_directory_remove(shard_t * shardP,
+                                 uint16_t localID)
+{
+    local_entry_t * localP;
+    directory_entry_t * entryP;
+
+    shardP->localList = (local_entry_t *)LWM2M_LIST_RM(shardP->localList, localID, &localP);
+    if (localP == NULL) return;
+
+    pthread_mutex_lock(&g_directoryMutex);
+    g_directory = (directory_entry_t *)LWM2M_LIST_RM(g_directory, localP->directoryID, &entryP);
+    pthread_mutex_unlock(&g_directoryMutex);
+
+    free(entryP);
+    free(localP);
+}
+
+// Returns true if the client is known, the shard and the local ID are then set.
+static bool prv_directory_find(uint16_t id,
+                               int * shardP,
+                               uint16_t * localIdP)
+{
+    directory_entry_t * entryP;
+
+    pthread_mutex_lock(&g_directoryMutex);
+    entryP = (directory_entry_t *)LWM2M_LIST_FIND(g_directory, id);
+    if (entryP != NULL)
+    {
+        *shardP = entryP->shard;
+        *localIdP = entryP->localID;
+    }
+    pthread_mutex_unlock(&g_directoryMutex);
+
+    return entryP != NULL;
+}
+
+static bool prv_directory_is_empty(void)
+{
+    bool result;
+
+    pthread_mutex_lock(&g_directoryMutex);
+    result = (g_directory == NULL);
+    pthread_mutex_unlock(&g_directoryMutex);
+
+    return result;
+}
+
+// The ID displayed to the user for a client of this context
+static uint16_t prv_client_id(lwm2m_context_t * lwm2mH,
+                              uint16_t localID)
+{
+    shard_t * shardP = (shard_t *)lwm2mH->userData;
+    local_entry_t * localP;
+
+    if (shardP == NULL) return localID;
+
+    localP = (local_entry_t *)LWM2M_LIST_FIND(shardP->localList, localID);
+    return localP != NULL ? localP->directoryID : localID;
+}
+
 static void prv_print_error(uint8_t status)
 {
     fprintf(stdout, "Error: ");
@@ -144,11 +293,12 @@ static void prv_dump_binding(lwm2m_binding_t binding)
     }
 }
 
-static void prv_dump_client(lwm2m_client_t * targetP)
+static void prv_dump_client(lwm2m_context_t * lwm2mH,
+                            lwm2m_client_t * targetP)
 {
     lwm2m_client_object_t * objectP;
 
-    fprintf(stdout, "Client #%d:\r\n", targetP->internalID);
+    fprintf(stdout, "Client #%d:\r\n", prv_client_id(lwm2mH, targetP->internalID));
     fprintf(stdout, "\tname: \"%s\"\r\n", targetP->name);
     fprintf(stdout, "\tversion: \"%s\"\r\n", prv_dump_version(targetP->version));
     prv_dump_binding(targetP->binding);
@@ -200,13 +350,14 @@ static void prv_output_clients(lwm2m_context_t *lwm2mH,
 
     if (targetP == NULL)
     {
-        fprintf(stdout, "No client.\r\n");
+        // in sharded mode, the main thread reports when no worker has a client
+        if (lwm2mH->userData == NULL) fprintf(stdout, "No client.\r\n");
         return;
     }
 
     for (targetP = lwm2mH->clientList ; targetP != NULL ; targetP = targetP->next)
     {
-        prv_dump_client(targetP);
+        prv_dump_client(lwm2mH, targetP);
     }
 }
 
@@ -260,10 +411,9 @@ static void prv_result_callback(lwm2m_context_t *contextP,
                                 void * userData)
 {
     /* unused parameters */
-    (void)contextP;
     (void)userData;
 
-    fprintf(stdout, "\r\nClient #%d ", clientID);
+    fprintf(stdout, "\r\nClient #%d ", prv_client_id(contextP, clientID));
     prv_printUri(uriP);
     fprintf(stdout, " : ");
     print_status(stdout, status);
@@ -286,10 +436,9 @@ static void prv_notify_callback(lwm2m_context_t *contextP,
                                 void * userData)
 {
     /* unused parameters */
-    (void)contextP;
     (void)userData;
 
-    fprintf(stdout, "\r\nNotify from client #%d ", clientID);
+    fprintf(stdout, "\r\nNotify from client #%d ", prv_client_id(contextP, clientID));
     prv_printUri(uriP);
     fprintf(stdout, " number %d\r\n", count);
 
@@ -975,6 +1124,7 @@ static void prv_monitor_callback(lwm2m_context_t *lwm2mH,
                                  void * userData)
 {
     lwm2m_client_t * targetP;
+    shard_t * shardP = (shard_t *)lwm2mH->userData;
 
     /* unused parameter */
     (void)userData;
@@ -982,23 +1132,31 @@ static void prv_monitor_callback(lwm2m_context_t *lwm2mH,
     switch (status)
     {
     case COAP_201_CREATED:
-        fprintf(stdout, "\r\nNew client #%d registered.\r\n", clientID);
+        if (shardP != NULL)
+        {
+            fprintf(stdout, "\r\nNew client #%d registered on worker %d.\r\n", prv_directory_add(shardP, clientID), shardP->index);
+        }
+        else
+        {
+            fprintf(stdout, "\r\nNew client #%d registered.\r\n", clientID);
+        }
 
         targetP = (lwm2m_client_t *)lwm2m_list_find((lwm2m_list_t *)lwm2mH->clientList, clientID);
 
-        prv_dump_client(targetP);
+        prv_dump_client(lwm2mH, targetP);
         break;
 
     case COAP_202_DELETED:
-        fprintf(stdout, "\r\nClient #%d unregistered.\r\n", clientID);
+        fprintf(stdout, "\r\nClient #%d unregistered.\r\n", prv_client_id(lwm2mH, clientID));
+        if (shardP != NULL) prv_directory_remove(shardP, clientID);
         break;
 
     case COAP_204_CHANGED:
-        fprintf(stdout, "\r\nClient #%d updated.\r\n", clientID);
+        fprintf(stdout, "\r\nClient #%d updated.\r\n", prv_client_id(lwm2mH, clientID));
 
         targetP = (lwm2m_client_t *)lwm2m_list_find((lwm2m_list_t *)lwm2mH->clientList, clientID);
 
-        prv_dump_client(targetP);
+        prv_dump_client(lwm2mH, targetP);
         break;
 
     default:
@@ -1027,6 +1185,390 @@ void handle_sigint(int signum)
     g_quit = 2;
 }
 
+static void prv_receive(int sock,
+                        lwm2m_connection_layer_t * connLayer)
+{
+    uint8_t buffer[MAX_PACKET_SIZE];
+    int numBytes;
+    struct sockaddr_storage addr;
+    socklen_t addrLen;
+
+    addrLen = sizeof(addr);
+    numBytes = recvfrom(sock, buffer, MAX_PACKET_SIZE, 0, (struct sockaddr *)&addr, &addrLen);
+
+    if (numBytes == -1)
+    {
+        fprintf(stderr, "Error in recvfrom(): %d\r\n", errno);
+    }
+    else if (numBytes >= MAX_PACKET_SIZE)
+    {
+        fprintf(stderr, "Received packet >= MAX_PACKET_SIZE\r\n");
+    }
+    else
+    {
+        char s[INET6_ADDRSTRLEN];
+        in_port_t port;
+        connection_t * connP;
+
+        s[0] = 0;
+        if (AF_INET == addr.ss_family)
+        {
+            struct sockaddr_in *saddr = (struct sockaddr_in *)&addr;
+            inet_ntop(saddr->sin_family, &saddr->sin_addr, s, INET6_ADDRSTRLEN);
+            port = saddr->sin_port;
+        }
+        else if (AF_INET6 == addr.ss_family)
+        {
+            struct sockaddr_in6 *saddr = (struct sockaddr_in6 *)&addr;
+            inet_ntop(saddr->sin6_family, &saddr->sin6_addr, s, INET6_ADDRSTRLEN);
+            port = saddr->sin6_port;
+        }
+
+        fprintf(stderr, "%d bytes received from [%s]:%hu\r\n", numBytes, s, ntohs(port));
+        output_buffer(stderr, buffer, numBytes, 0);
+
+        connP = connectionlayer_find_connection(connLayer, &addr, addrLen);
+        if (connP == NULL) {
+            connection_new_incoming(connLayer, sock, &addr, addrLen);
+        }
+        connectionlayer_handle_packet(connLayer, &addr, addrLen, buffer, numBytes);
+    }
+}
+
+static void * prv_shard_main(void * arg)
+{
+    shard_t * shardP = (shard_t *)arg;
+    bool stop = false;
+
+    while (!stop)
+    {
+        fd_set readfds;
+        struct timeval tv;
+        int64_t timeout;
+        int result;
+
+        FD_ZERO(&readfds);
+        FD_SET(shardP->sock, &readfds);
+        FD_SET(shardP->wakeup[0], &readfds);
+
+        timeout = 60000;
+
+        result = lwm2m_step_ms(shardP->lwm2mH, &timeout);
+        if (result != 0)
+        {
+            fprintf(stderr, "lwm2m_step() failed on worker %d: 0x%X\r\n", shardP->index, result);
+            timeout = 1000;
+        }
+        tv.tv_sec = timeout / 1000;
+        tv.tv_usec = (timeout % 1000) * 1000;
+
+        result = select(FD_SETSIZE, &readfds, 0, 0, &tv);
+        if (result < 0)
+        {
+            if (errno != EINTR)
+            {
+                fprintf(stderr, "Error in select() on worker %d: %d\r\n", shardP->index, errno);
+            }
+            continue;
+        }
+
+        if (FD_ISSET(shardP->sock, &readfds))
+        {
+            prv_receive(shardP->sock, shardP->connLayer);
+        }
+        if (FD_ISSET(shardP->wakeup[0], &readfds))
+        {
+            shard_command_t * commandP;
+            char drain[64];
+
+            if (read(shardP->wakeup[0], drain, sizeof(drain)) < 0)
+            {
+                fprintf(stderr, "Error in read() on worker %d: %d\r\n", shardP->index, errno);
+            }
+
+            pthread_mutex_lock(&shardP->mutex);
+            commandP = shardP->queueHead;
+            shardP->queueHead = NULL;
+            shardP->queueTail = NULL;
+            stop = shardP->stop;
+            pthread_mutex_unlock(&shardP->mutex);
+
+            while (commandP != NULL)
+            {
+                shard_command_t * nextP = commandP->next;
+
+                handle_command(shardP->lwm2mH, shardP->commands, commandP->line);
+                fprintf(stdout, "\r\n> ");
+                fflush(stdout);
+                free(commandP);
+                commandP = nextP;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static void prv_shard_wakeup(shard_t * shardP)
+{
+    if (write(shardP->wakeup[1], "", 1) < 0)
+    {
+        fprintf(stderr, "Error waking up worker %d: %d\r\n", shardP->index, errno);
+    }
+}
+
+static void prv_shard_post(shard_t * shardP,
+                           const char * line)
+{
+    shard_command_t * commandP;
+
+    commandP = (shard_command_t *)malloc(sizeof(shard_command_t));
+    if (commandP == NULL) return;
+    commandP->next = NULL;
+    snprintf(commandP->line, sizeof(commandP->line), "%s", line);
+
+    pthread_mutex_lock(&shardP->mutex);
+    if (shardP->queueTail == NULL)
+    {
+        shardP->queueHead = commandP;
+    }
+    else
+    {
+        shardP->queueTail->next = commandP;
+    }
+    shardP->queueTail = commandP;
+    pthread_mutex_unlock(&shardP->mutex);
+
+    prv_shard_wakeup(shardP);
+}
+
+// Runs in the main thread: forwards the command to the worker owning its client.
+static void prv_dispatch_command(shard_t * shards,
+                                 int shardCount,
+                                 command_desc_t * commands,
+                                 char * buffer)
+{
+    char line[MAX_PACKET_SIZE];
+    char * args;
+    int length;
+    uint16_t id;
+    uint16_t localID;
+    int shard;
+    int i;
+
+    length = 0;
+    while (buffer[length] != 0 && !isspace(buffer[length]&0xFF))
+        length++;
+    args = buffer + length;
+    while (args[0] != 0 && isspace(args[0]&0xFF))
+        args++;
+
+    if (length == 4 && !strncmp(buffer, "list", length))
+    {
+        if (prv_directory_is_empty())
+        {
+            fprintf(stdout, "No client.\r\n");
+            return;
+        }
+        for (i = 0; i < shardCount; i++)
+        {
+            prv_shard_post(shards + i, buffer);
+        }
+        return;
+    }
+
+    if (prv_read_id(args, &id) != 1)
+    {
+        // not a client command: quit, help or a syntax error
+        handle_command(NULL, commands, buffer);
+        return;
+    }
+
+    if (!prv_directory_find(id, &shard, &localID))
+    {
+        fprintf(stdout, "Unknown client #%d.", id);
+        return;
+    }
+
+    // replace the client ID by the one known by the worker
+    while (args[0] != 0 && !isspace(args[0]&0xFF))
+        args++;
+    snprintf(line, sizeof(line), "%.*s %d%s", length, buffer, localID, args);
+    prv_shard_post(shards + shard, line);
+}
+
+static void prv_stop_shards(shard_t * shards,
+                            int shardCount)
+{
+    int i;
+
+    for (i = 0; i < shardCount; i++)
+    {
+        if (shards[i].lwm2mH == NULL) continue;
+
+        pthread_mutex_lock(&shards[i].mutex);
+        shards[i].stop = true;
+        pthread_mutex_unlock(&shards[i].mutex);
+        prv_shard_wakeup(shards + i);
+        pthread_join(shards[i].thread, NULL);
+    }
+
+    for (i = 0; i < shardCount; i++)
+    {
+        if (shards[i].lwm2mH != NULL)
+        {
+            lwm2m_close(shards[i].lwm2mH);
+        }
+        connectionlayer_free(shards[i].connLayer);
+        lwm2m_list_free((lwm2m_list_t *)shards[i].localList);
+        while (shards[i].queueHead != NULL)
+        {
+            shard_command_t * commandP = shards[i].queueHead;
+
+            shards[i].queueHead = commandP->next;
+            free(commandP);
+        }
+        if (shards[i].sock >= 0) close(shards[i].sock);
+        if (shards[i].wakeup[0] >= 0) close(shards[i].wakeup[0]);
+        if (shards[i].wakeup[1] >= 0) close(shards[i].wakeup[1]);
+        pthread_mutex_destroy(&shards[i].mutex);
+    }
+
+    lwm2m_list_free((lwm2m_list_t *)g_directory);
+    g_directory = NULL;
+}
+
+static int prv_run_shards(int shardCount,
+                          const char * localPort,
+                          int addressFamily,
+                          command_desc_t * commands)
+{
+    shard_t * shards;
+    sigset_t signals;
+    sigset_t previousSignals;
+    int result = 0;
+    int i;
+
+    shards = (shard_t *)malloc(shardCount * sizeof(shard_t));
+    if (shards == NULL)
+    {
+        fprintf(stderr, "Memory allocation failed\r\n");
+        return -1;
+    }
+    memset(shards, 0, shardCount * sizeof(shard_t));
+    for (i = 0; i < shardCount; i++)
+    {
+        shards[i].index = i;
+        shards[i].commands = commands;
+        shards[i].sock = -1;
+        shards[i].wakeup[0] = -1;
+        shards[i].wakeup[1] = -1;
+        pthread_mutex_init(&shards[i].mutex, NULL);
+    }
+
+    // only the main thread handles SIGINT, the workers inherit this mask
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &signals, &previousSignals);
+
+    for (i = 0; i < shardCount && result == 0; i++)
+    {
+        shard_t * shardP = shards + i;
+
+        shardP->sock = create_socket_reuseport(localPort, addressFamily);
+        if (shardP->sock < 0)
+        {
+            fprintf(stderr, "Error opening socket with SO_REUSEPORT for worker %d: %d\r\n", i, errno);
+            result = -1;
+            break;
+        }
+        if (pipe(shardP->wakeup) != 0)
+        {
+            fprintf(stderr, "Error creating pipe for worker %d: %d\r\n", i, errno);
+            result = -1;
+            break;
+        }
+        shardP->lwm2mH = lwm2m_init(shardP);
+        if (NULL == shardP->lwm2mH)
+        {
+            fprintf(stderr, "lwm2m_init() failed\r\n");
+            result = -1;
+            break;
+        }
+        shardP->connLayer = connectionlayer_create(shardP->lwm2mH);
+        lwm2m_set_monitoring_callback(shardP->lwm2mH, prv_monitor_callback, NULL);
+
+        if (0 != pthread_create(&shardP->thread, NULL, prv_shard_main, shardP))
+        {
+            fprintf(stderr, "Error starting worker %d\r\n", i);
+            lwm2m_close(shardP->lwm2mH);
+            shardP->lwm2mH = NULL;
+            result = -1;
+        }
+    }
+
+    pthread_sigmask(SIG_SETMASK, &previousSignals, NULL);
+
+    if (result == 0)
+    {
+        fprintf(stdout, "%d workers listening on port %s\r\n", shardCount, localPort);
+        fprintf(stdout, "> "); fflush(stdout);
+    }
+
+    while (result == 0 && 0 == g_quit)
+    {
+        fd_set readfds;
+        char buffer[MAX_PACKET_SIZE];
+        int numBytes;
+
+        // select() is interrupted by SIGINT, whatever the signal flags
+        FD_ZERO(&readfds);
+        FD_SET(STDIN_FILENO, &readfds);
+        if (select(STDIN_FILENO + 1, &readfds, 0, 0, NULL) < 0)
+        {
+            if (errno != EINTR)
+            {
+                fprintf(stderr, "Error in select(): %d\r\n", errno);
+                break;
+            }
+            continue;
+        }
+
+        numBytes = read(STDIN_FILENO, buffer, MAX_PACKET_SIZE - 1);
+        if (numBytes < 0)
+        {
+            fprintf(stderr, "Error in read(): %d\r\n", errno);
+            break;
+        }
+        if (numBytes == 0)
+        {
+            // end of input, keep serving the clients until interrupted
+            pause();
+            continue;
+        }
+        if (numBytes > 1)
+        {
+            buffer[numBytes] = 0;
+            prv_dispatch_command(shards, shardCount, commands, buffer);
+            fprintf(stdout, "\r\n");
+        }
+        if (g_quit == 0)
+        {
+            fprintf(stdout, "> ");
+            fflush(stdout);
+        }
+        else
+        {
+            fprintf(stdout, "\r\n");
+        }
+    }
+
+    prv_stop_shards(shards, shardCount);
+    free(shards);
+
+    return result;
+}
+
 void print_usage(void)
 {
     fprintf(stderr, "Usage: lwm2mserver [OPTION]\r\n");
@@ -1036,6 +1578,8 @@ void print_usage(void)
     fprintf(stdout, "  -l PORT\tSet the local UDP port of the Server. Default: "LWM2M_STANDARD_PORT_STR"\r\n");
     fprintf(stdout, "  -S BYTES\tCoAP block size. Options: 16, 32, 64, 128, 256, 512, 1024. Default: %" PRIu16 "\r\n",
             LWM2M_COAP_DEFAULT_BLOCK_SIZE);
+    fprintf(stdout, "  -t THREADS\tRun THREADS worker threads sharing the port, each with its own context.\r\n");
+    fprintf(stdout, "\t\tDefault: a single thread\r\n");
     fprintf(stdout, "\r\n");
 }
 
@@ -1044,12 +1588,14 @@ int main(int argc, char *argv[])
     int sock;
     fd_set readfds;
     struct timeval tv;
+    int64_t timeout;
     int result;
     lwm2m_context_t * lwm2mH = NULL;
     lwm2m_connection_layer_t *connLayer = NULL;
     int addressFamily = AF_INET6;
     int opt;
     const char * localPort = LWM2M_STANDARD_PORT_STR;
+    int shardCount = 0;
 
     command_desc_t commands[] =
     {
@@ -1154,6 +1700,16 @@ int main(int argc, char *argv[])
                 print_usage();
                 return 0;
             }
+        case 't':
+            opt++;
+            if (opt >= argc
+             || 1 != sscanf(argv[opt], "%d", &shardCount)
+             || shardCount < 1)
+            {
+                print_usage();
+                return 0;
+            }
+            break;
         default:
             print_usage();
             return 0;
@@ -1161,6 +1717,12 @@ int main(int argc, char *argv[])
         opt += 1;
     }
 
+    if (shardCount > 0)
+    {
+        signal(SIGINT, handle_sigint);
+        return prv_run_shards(shardCount, localPort, addressFamily, commands);
+    }
+
     sock = create_socket(localPort, addressFamily);
     if (sock < 0)
     {
@@ -1189,15 +1751,16 @@ int main(int argc, char *argv[])
         FD_SET(sock, &readfds);
         FD_SET(STDIN_FILENO, &readfds);
 
-        tv.tv_sec = 60;
-        tv.tv_usec = 0;
+        timeout = 60000;
 
-        result = lwm2m_step(lwm2mH, &(tv.tv_sec));
+        result = lwm2m_step_ms(lwm2mH, &timeout);
         if (result != 0)
         {
             fprintf(stderr, "lwm2m_step() failed: 0x%X\r\n", result);
             return -1;
         }
+        tv.tv_sec = timeout / 1000;
+        tv.tv_usec = (timeout % 1000) * 1000;
 
         result = select(FD_SETSIZE, &readfds, 0, 0, &tv);
 
@@ -1215,49 +1778,7 @@ int main(int argc, char *argv[])
 
             if (FD_ISSET(sock, &readfds))
             {
-                struct sockaddr_storage addr;
-                socklen_t addrLen;
-
-                addrLen = sizeof(addr);
-                numBytes = recvfrom(sock, buffer, MAX_PACKET_SIZE, 0, (struct sockaddr *)&addr, &addrLen);
-
-                if (numBytes == -1)
-                {
-                    fprintf(stderr, "Error in recvfrom(): %d\r\n", errno);
-                }
-                else if (numBytes >= MAX_PACKET_SIZE) 
-                {
-                    fprintf(stderr, "Received packet >= MAX_PACKET_SIZE\r\n");
-                } 
-                else
-                {
-                    char s[INET6_ADDRSTRLEN];
-                    in_port_t port;
-                    connection_t * connP;
-
-					s[0] = 0;
-                    if (AF_INET == addr.ss_family)
-                    {
-                        struct sockaddr_in *saddr = (struct sockaddr_in *)&addr;
-                        inet_ntop(saddr->sin_family, &saddr->sin_addr, s, INET6_ADDRSTRLEN);
-                        port = saddr->sin_port;
-                    }
-                    else if (AF_INET6 == addr.ss_family)
-                    {
-                        struct sockaddr_in6 *saddr = (struct sockaddr_in6 *)&addr;
-                        inet_ntop(saddr->sin6_family, &saddr->sin6_addr, s, INET6_ADDRSTRLEN);
-                        port = saddr->sin6_port;
-                    }
-
-                    fprintf(stderr, "%d bytes received from [%s]:%hu\r\n", numBytes, s, ntohs(port));
-                    output_buffer(stderr, buffer, numBytes, 0);
-
-                    connP = connectionlayer_find_connection(connLayer, &addr, addrLen);
-                    if (connP == NULL) {
-                        connection_new_incoming(connLayer, sock, &addr, addrLen);
-                    }
-                    connectionlayer_handle_packet(connLayer, &addr, addrLen, buffer, numBytes);
-                }
+                prv_receive(sock, connLayer);
             }
             else if (FD_ISSET(STDIN_FILENO, &readfds))
             {
@@ -359,6 +359,16 @@ void output_data(FILE * stream,
         fprintf(stream, "\n");
         break;
 
+    case LWM2M_CONTENT_SENML_CBOR:
+        fprintf(stream, "application/senml+cbor:\r\n");
+        output_buffer(stream, data, dataLength, indent);
+        break;
+
+    case LWM2M_CONTENT_LWM2M_CBOR:
+        fprintf(stream, "application/vnd.oma.lwm2m+cbor:\r\n");
+        output_buffer(stream, data, dataLength, indent);
+        break;
+
     case LWM2M_CONTENT_LINK:
         fprintf(stream, "application/link-format:\r\n");
         print_indent(stream, indent);
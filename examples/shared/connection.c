@@ -126,7 +126,7 @@ void connectionlayer_free_connection(lwm2m_connection_layer_t *connLayerP, conne
     }
 }
 
-int create_socket(const char *portStr, int addressFamily) {
+static int prv_create_socket(const char *portStr, int addressFamily, bool reusePort) {
     int s = -1;
     struct addrinfo hints;
     struct addrinfo *res;
@@ -143,6 +143,19 @@ int create_socket(const char *portStr, int addressFamily) {
 
     for (p = res; p != NULL && s == -1; p = p->ai_next) {
         s = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+        if (s >= 0 && reusePort) {
+#ifdef SO_REUSEPORT
+            int on = 1;
+
+            if (-1 == setsockopt(s, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on))) {
+                close(s);
+                s = -1;
+            }
+#else
+            close(s);
+            s = -1;
+#endif
+        }
         if (s >= 0) {
             if (-1 == bind(s, p->ai_addr, p->ai_addrlen)) {
                 close(s);
@@ -156,6 +169,12 @@ int create_socket(const char *portStr, int addressFamily) {
     return s;
 }
 
+int create_socket(const char *portStr, int addressFamily) { return prv_create_socket(portStr, addressFamily, false); }
+
+int create_socket_reuseport(const char *portStr, int addressFamily) {
+    return prv_create_socket(portStr, addressFamily, true);
+}
+
 void connectionlayer_add_connection(lwm2m_connection_layer_t *connLayer, connection_t *conn) {
     conn->next = connLayer->connList;
     connLayer->connList = conn;
@@ -285,6 +304,18 @@ bool lwm2m_session_is_equal(void *session1, void *session2, void *userData) {
     return (session1 == session2);
 }
 
+#ifdef LWM2M_SESSION_HASH
+uint32_t lwm2m_session_hash(void *session, void *userData) {
+    uint64_t value = (uint64_t)(uintptr_t)session;
+
+    (void)userData; /* unused */
+
+    /* sessions are compared by address, connections are at least 8-byte aligned */
+    value >>= 3;
+    return (uint32_t)(value ^ (value >> 32));
+}
+#endif
+
 /*
 
 int get_port(struct sockaddr *x)
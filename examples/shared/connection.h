@@ -65,6 +65,9 @@ connection_t *connectionlayer_find_connection(lwm2m_connection_layer_t *connLaye
 void connectionlayer_add_connection(lwm2m_connection_layer_t *connLayer, connection_t *conn);
 
 int create_socket(const char *portStr, int ai_family);
+// Several sockets can be bound to the same port, the kernel spreads the peers between them.
+// Returns -1 where SO_REUSEPORT is not available.
+int create_socket_reuseport(const char *portStr, int ai_family);
 
 connection_t *connection_new_incoming(lwm2m_connection_layer_t *connLayerP, int sock, struct sockaddr_storage *addr,
                                       size_t addrLen);
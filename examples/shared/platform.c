@@ -69,6 +69,16 @@ time_t lwm2m_gettime(void)
     return time(NULL);
 }
 
+#ifdef LWM2M_WITH_MS_CLOCK
+int64_t lwm2m_gettime_ms(void)
+{
+    struct timespec ts;
+
+    if (0 != clock_gettime(CLOCK_MONOTONIC, &ts)) return -1;
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+#endif
+
 void lwm2m_printf(const char * format, ...)
 {
     va_list ap;
@@ -74,6 +74,9 @@ extern "C" {
 #ifndef LWM2M_SUPPORT_SENML_JSON
 #define LWM2M_SUPPORT_SENML_JSON
 #endif
+#ifndef LWM2M_SUPPORT_SENML_CBOR
+#define LWM2M_SUPPORT_SENML_CBOR
+#endif
 #endif
 #endif
 
@@ -82,6 +85,9 @@ extern "C" {
 #ifndef LWM2M_SUPPORT_SENML_JSON
 #define LWM2M_SUPPORT_SENML_JSON
 #endif
+#ifndef LWM2M_SUPPORT_SENML_CBOR
+#define LWM2M_SUPPORT_SENML_CBOR
+#endif
 #endif
 #endif
 
@@ -128,6 +134,13 @@ int lwm2m_strcasecmp(const char * str1, const char * str2);
 // In case of error, this must return a negative value.
 // Per POSIX specifications, time_t is a signed integer.
 time_t lwm2m_gettime(void);
+#ifdef LWM2M_WITH_MS_CLOCK
+// This function must return the number of milliseconds elapsed since origin from a monotonic clock.
+// The origin does not need to match the one of lwm2m_gettime(). It is used to schedule CoAP
+// retransmissions with a sub-second resolution.
+// In case of error, this must return a negative value.
+int64_t lwm2m_gettime_ms(void);
+#endif
 
 #ifdef LWM2M_WITH_LOGS
 // Same usage as C89 printf()
@@ -158,6 +171,13 @@ uint8_t lwm2m_buffer_send(void * sessionH, uint8_t * buffer, size_t length, void
 // Returns true if the two sessions identify the same peer. false otherwise.
 // userData: parameter to lwm2m_init()
 bool lwm2m_session_is_equal(void * session1, void * session2, void * userData);
+#ifdef LWM2M_SESSION_HASH
+// Hash a session handle
+// Returns a hash value of the peer identified by the session. Two sessions for which
+// lwm2m_session_is_equal() returns true MUST have the same hash.
+// userData: parameter to lwm2m_init()
+uint32_t lwm2m_session_hash(void * session, void * userData);
+#endif
 
 /*
  * Error code
@@ -243,6 +263,7 @@ bool lwm2m_session_is_equal(void * session1, void * session2, void * userData);
 #define LWM2M_SERVER_TRIGGER_ID              21
 #define LWM2M_SERVER_PREFERRED_TRANSPORT_ID  22
 #define LWM2M_SERVER_MUTE_SEND_ID            23
+#define LWM2M_SERVER_NOTIFICATION_MODE_ID    26 // LwM2M 1.2 Default Notification Mode: 0 for NON, 1 for CON
 
 #define LWM2M_SECURITY_MODE_PRE_SHARED_KEY  0
 #define LWM2M_SECURITY_MODE_RAW_PUBLIC_KEY  1
@@ -278,8 +299,45 @@ void lwm2m_list_free(lwm2m_list_t * head);
 #define LWM2M_LIST_FIND(H,I) lwm2m_list_find((lwm2m_list_t *)H, I)
 #define LWM2M_LIST_FREE(H) lwm2m_list_free((lwm2m_list_t *)H)
 
+/*
+ * Hash index used internally to speed up lookups in large lists
+ */
+
+typedef struct
+{
+    uint32_t hash;
+    void *   item;  // NULL if the slot is free
+} lwm2m_index_entry_t;
+
+typedef struct
+{
+    lwm2m_index_entry_t * entries;
+    size_t                capacity; // zero or a power of two
+    size_t                count;
+} lwm2m_index_t;
+
+/*
+ * Deadline of a pending event, used internally to schedule retransmissions,
+ * lifetimes and observation periods
+ */
+
+typedef void (*lwm2m_timer_callback_t) (lwm2m_context_t * contextP, void * userData, time_t currentTime);
+
+typedef struct _lwm2m_timer_
+{
+    struct _lwm2m_timer_ * child;   // pairing heap links
+    struct _lwm2m_timer_ * sibling;
+    struct _lwm2m_timer_ * prev;    // parent for the first child, previous sibling otherwise
+    int64_t                deadline;  // in milliseconds
+    bool                   scheduled;
+    lwm2m_timer_callback_t callback;
+    void *                 userData;
+} lwm2m_timer_t;
+
 /*
  * Helper functions for CoAP block size settings.
+ * This is the default block size of the contexts initialized afterwards,
+ * see lwm2m_context_set_coap_block_size() to change the one of a context.
  */
 bool lwm2m_set_coap_block_size(uint16_t coap_block_size_arg);
 uint16_t lwm2m_get_coap_block_size(void);
@@ -332,6 +390,9 @@ int lwm2m_stringToUri(const char * buffer, size_t buffer_len, lwm2m_uri_t * uriP
  * - LWM2M_TYPE_BOOLEAN: value.asBoolean
  *
  * LWM2M_TYPE_STRING is also used when the data is in text format.
+ *
+ * value.asChildren.capacity is the number of items allocated in value.asChildren.array when the parsers
+ * grew it ahead of its count. It is 0 when the array has exactly count items.
  */
 
 typedef enum
@@ -373,6 +434,7 @@ struct _lwm2m_data_t
         {
             size_t         count;
             lwm2m_data_t * array;
+            size_t         capacity;
         } asChildren;
         struct
         {
@@ -391,12 +453,18 @@ typedef enum
     LWM2M_CONTENT_TLV        = 11542,
     LWM2M_CONTENT_JSON_OLD   = 1543,     // Keep old value for backward-compatibility
     LWM2M_CONTENT_JSON       = 11543,
-    LWM2M_CONTENT_SENML_JSON = 110
+    LWM2M_CONTENT_SENML_JSON = 110,
+    LWM2M_CONTENT_SENML_CBOR = 112,
+    LWM2M_CONTENT_LWM2M_CBOR = 11544
 } lwm2m_media_type_t;
 
 lwm2m_data_t * lwm2m_data_new(int size);
 int lwm2m_data_parse(lwm2m_uri_t * uriP, const uint8_t * buffer, size_t bufferLen, lwm2m_media_type_t format, lwm2m_data_t ** dataP);
 int lwm2m_data_serialize(lwm2m_uri_t * uriP, int size, lwm2m_data_t * dataP, lwm2m_media_type_t * formatP, uint8_t ** bufferP);
+// Same as lwm2m_data_serialize() but writes into the caller's buffer of length bytes. Returns the length of the
+// serialized data or -1 in case of error. If the returned length is larger than length, the content of buffer is
+// undefined and the call can be repeated with a buffer large enough.
+int lwm2m_data_serialize_into(lwm2m_uri_t * uriP, int size, lwm2m_data_t * dataP, lwm2m_media_type_t * formatP, uint8_t * buffer, size_t length);
 void lwm2m_data_free(int size, lwm2m_data_t * dataP);
 
 void lwm2m_data_encode_string(const char * string, lwm2m_data_t * dataP);
@@ -415,6 +483,38 @@ void lwm2m_data_encode_corelink(const char * corelink, lwm2m_data_t * dataP);
 void lwm2m_data_encode_instances(lwm2m_data_t * subDataP, size_t count, lwm2m_data_t * dataP);
 void lwm2m_data_include(lwm2m_data_t * subDataP, size_t count, lwm2m_data_t * dataP);
 
+#ifdef LWM2M_DATA_ARENA
+/*
+ * Bump allocator for lwm2m_data_t trees
+ *
+ * While an arena is in use by the calling thread, lwm2m_data_new(), the lwm2m_data_encode_*() functions
+ * and the parsers take their memory from it and lwm2m_data_free() leaves it in place. Everything is
+ * released at once by lwm2m_data_arena_reset(). The arena gets its chunks from lwm2m_malloc() and keeps
+ * them across resets so that similar requests do not reach the heap anymore. Serialized payloads are
+ * still allocated with lwm2m_malloc().
+ *
+ * A client context uses its own arena while handling a request and while reading an observed value.
+ * The data the objects receive or allocate in their callbacks must then not be kept after they return.
+ */
+typedef struct _lwm2m_data_arena_chunk_ lwm2m_data_arena_chunk_t;
+
+typedef struct
+{
+    lwm2m_data_arena_chunk_t * chunkList;
+    size_t                     chunkSize;        // minimal size of the next chunk, the peak usage after a reset
+    size_t                     allocations;      // blocks served by the arena
+    size_t                     chunkAllocations; // calls to lwm2m_malloc() made by the arena
+} lwm2m_data_arena_t;
+
+void lwm2m_data_arena_init(lwm2m_data_arena_t * arenaP);
+// release all the blocks served since the last reset. Must not be called while the arena is in use.
+void lwm2m_data_arena_reset(lwm2m_data_arena_t * arenaP);
+// free the chunks of the arena
+void lwm2m_data_arena_close(lwm2m_data_arena_t * arenaP);
+// make arenaP the arena of the calling thread, NULL to allocate from the heap again. Returns the previous one.
+lwm2m_data_arena_t * lwm2m_data_arena_use(lwm2m_data_arena_t * arenaP);
+#endif
+
 
 /*
  * Utility function to parse TLV buffers directly
@@ -463,6 +563,14 @@ typedef uint8_t (*lwm2m_create_callback_t) (lwm2m_context_t * contextP, uint16_t
 typedef uint8_t (*lwm2m_raw_block1_create_callback_t) (lwm2m_context_t * contextP, lwm2m_uri_t * uriP, lwm2m_media_type_t format, uint8_t * buffer, int length, lwm2m_object_t * objectP, uint32_t block_num, uint8_t block_more);
 typedef uint8_t (*lwm2m_raw_block1_write_callback_t) (lwm2m_context_t * contextP, lwm2m_uri_t * uriP, lwm2m_media_type_t format, uint8_t * buffer, int length, lwm2m_object_t * objectP, uint32_t block_num, uint8_t block_more);
 typedef uint8_t (*lwm2m_raw_block1_execute_callback_t) (lwm2m_context_t * contextP, lwm2m_uri_t * uriP, uint8_t * buffer, int length, lwm2m_object_t * objectP, uint32_t block_num, uint8_t block_more);
+#else
+/*
+ * Receives the value of a resource written block-wise, chunk by chunk, instead of the whole decoded value.
+ * Used for the TLV and opaque writes to a single resource, a TLV Multiple Resource is still reassembled for
+ * writeFunc. offset is the position of the chunk in the value, a chunk at offset 0 starting a new value. last is
+ * true for the last chunk. The callback returns COAP_204_CHANGED to continue the transfer, any other code aborts it.
+ */
+typedef uint8_t (*lwm2m_block_write_callback_t) (lwm2m_context_t * contextP, lwm2m_uri_t * uriP, size_t offset, uint8_t * buffer, size_t length, bool last, lwm2m_object_t * objectP);
 #endif
 typedef uint8_t (*lwm2m_delete_callback_t) (lwm2m_context_t * contextP, uint16_t instanceId, lwm2m_object_t * objectP);
 
@@ -481,6 +589,8 @@ struct _lwm2m_object_t
     lwm2m_raw_block1_create_callback_t   rawBlock1CreateFunc;
     lwm2m_raw_block1_write_callback_t    rawBlock1WriteFunc;
     lwm2m_raw_block1_execute_callback_t  rawBlock1ExecuteFunc;
+#else
+    lwm2m_block_write_callback_t         blockWriteFunc;  // optional, streams block-wise writes
 #endif
     lwm2m_delete_callback_t   deleteFunc;
     lwm2m_discover_callback_t discoverFunc;
@@ -544,11 +654,12 @@ typedef enum
 {
     BLOCK_1,
     BLOCK_2,
+    BLOCK_2_CACHE,                            // serialized read response sent block by block by a client
 } block_type_t;
 
 typedef union _block_data_identifier_
 {
-    char * uri;                               // resource string if block1 
+    char * uri;                               // resource string if block1 or block2 cache
     int32_t mid;                                    // mid of the last request if block2 eg the mid for the expected block
 } block_data_identifier_t;
 
@@ -561,13 +672,36 @@ struct _lwm2m_block_data_
     block_type_t                    blockType;
     block_data_identifier_t         identifier;
     uint8_t *                       blockBuffer;        // data buffer
-    size_t                          blockBufferSize;    // buffer size
+    size_t                          blockBufferSize;    // size of the data received
+    size_t                          blockBufferCapacity;// allocated size of blockBuffer
     uint32_t                        blockNum;           // block num of the last message received
+    bool                            complete;           // the last block was received
+    bool                            streamed;           // block1: the blocks go to the object instead of a buffer
 #ifdef LWM2M_RAW_BLOCK1_REQUESTS
     uint16_t                        mid;                // mid of the last message received
+#else
+    size_t                          valueOffset;        // streamed writes: length of the value handed over
+    size_t                          valueLength;        // streamed writes: length of the value, SIZE_MAX if unknown
+#endif
+#ifdef LWM2M_CLIENT_MODE
+    time_t                          expiry;             // block2 cache: date after which the representation is dropped
+    uint32_t                        etag;               // block2 cache: ETag of the representation
+    uint16_t                        accept;             // block2 cache: Accept option of the read, UINT16_MAX if none
+    uint16_t                        format;             // block2 cache: content format of the representation
 #endif
 };
 
+/*
+ * Notification kept for a server in queue mode while the client sleeps
+ */
+typedef struct _lwm2m_queued_notification_
+{
+    struct _lwm2m_queued_notification_ * next;
+    struct _lwm2m_watcher_ * watcher;
+    bool                     confirmable;
+    size_t                   length;
+    uint8_t *                buffer;  // datagram, its message ID is set when sent
+} lwm2m_queued_notification_t;
 
 typedef struct _lwm2m_server_
 {
@@ -582,6 +716,14 @@ typedef struct _lwm2m_server_
     char *                  location;
     bool                    dirty;
     lwm2m_block_data_t *    blockData;   // list to handle temporary block data.
+    bool                    confirmNotifications; // notifications sent as CON, see LWM2M_SERVER_NOTIFICATION_MODE_ID
+    uint8_t                 notificationsInFlight; // CON notifications not acknowledged yet, at most LWM2M_NSTART
+    struct _lwm2m_watcher_ * deferredList; // watchers whose notification waits for one in flight to be acknowledged
+    size_t                  transactionCount;      // transactions with the server in lwm2m_context_t::transactionList
+    time_t                  queueAwakeUntil;       // queue mode: end of the exchanges with the server
+    bool                    queueSleeping;         // queue mode: notifications are kept in notificationQueue
+    lwm2m_queued_notification_t * notificationQueue; // oldest first, sent after the next registration update
+    uint8_t                 notificationQueueCount; // at most LWM2M_QUEUE_MODE_MAX_NOTIFICATIONS
 #ifndef LWM2M_VERSION_1_0
     uint16_t                servObjInstID;// Server object instance ID if not a bootstrap server.
     uint8_t                 attempt;      // Current registration attempt
@@ -682,6 +824,7 @@ typedef struct _lwm2m_client_
     lwm2m_observation_t *   observationList;
     uint16_t                observationId;
     lwm2m_block_data_t *    blockData;   // list to handle temporary block data.
+    lwm2m_timer_t           lifetimeTimer; // expires at endOfLife
 } lwm2m_client_t;
 
 
@@ -699,18 +842,22 @@ struct _lwm2m_transaction_
 {
     lwm2m_transaction_t * next;  // matches lwm2m_list_t::next
     uint16_t              mID;   // matches lwm2m_list_t::id
+    lwm2m_transaction_t * prev;
     void *                peerH;
     uint8_t               ack_received; // indicates, that the ACK was received
     time_t                response_timeout; // timeout to wait for response, if token is used. When 0, use calculated acknowledge timeout.
     uint8_t  retrans_counter;
-    time_t   retrans_time;
+    uint32_t ack_timeout;  // initial retransmission timeout in milliseconds, randomized
+    int64_t  retrans_time; // in milliseconds
     void * message;
     uint16_t buffer_len;
     uint8_t * buffer;
-    uint16_t payload_len; // the length of the entire payload, message payload might be smaller in case of a block1 transfer
+    uint32_t payload_len; // the length of the entire payload, message payload might be smaller in case of a block1 transfer
     uint8_t * payload; // carries the entire payload accross multiple transactions in case of a block 1 transfer
     lwm2m_transaction_callback_t callback;
     void * userData;
+    bool userDataShared; // userData may be referenced by another transaction of the same block transfer
+    lwm2m_timer_t timer; // expires at retrans_time
 };
 
 /*
@@ -722,11 +869,16 @@ typedef struct _lwm2m_watcher_
 
     bool active;
     bool update;
+    bool notify;    // notification decided, waiting to be sent in this step
     lwm2m_server_t * server;
     lwm2m_attributes_t * parameters;
     lwm2m_media_type_t format;
     uint8_t token[8];
     size_t tokenLen;
+    lwm2m_transaction_t * transaction; // CON notification waiting for its acknowledgement
+    struct _lwm2m_observed_ * observed; // URI of the watcher
+    struct _lwm2m_watcher_ * nextDeferred; // in lwm2m_server_t::deferredList
+    bool deferred;
     time_t lastTime;
     uint32_t counter;
     uint16_t lastMid;
@@ -738,12 +890,30 @@ typedef struct _lwm2m_watcher_
     } lastValue;
 } lwm2m_watcher_t;
 
+/*
+ * Observed URIs indexed by path: a node per object, instance, resource and
+ * resource instance observed or with an observed descendant.
+ */
+typedef struct _lwm2m_observed_node_
+{
+    struct _lwm2m_observed_node_ *  parent;
+    struct _lwm2m_observed_node_ ** children;      // sorted by ID
+    uint32_t                        childCount;
+    uint32_t                        childCapacity;
+    uint16_t                        id;
+    struct _lwm2m_observed_ *       observedP;     // observation of this path, NULL if none
+} lwm2m_observed_node_t;
+
 typedef struct _lwm2m_observed_
 {
     struct _lwm2m_observed_ * next;
 
     lwm2m_uri_t uri;
     lwm2m_watcher_t * watcherList;
+    lwm2m_timer_t timer; // next time the watchers need to be checked
+    struct _lwm2m_observed_ * nextDirty; // in lwm2m_context_t::observedDirtyList
+    bool dirty;
+    lwm2m_observed_node_t * node; // in lwm2m_context_t::observedTree
 } lwm2m_observed_t;
 
 #ifdef LWM2M_CLIENT_MODE
@@ -763,6 +933,13 @@ typedef enum
  * LWM2M Context
  */
 
+#ifdef LWM2M_CLIENT_MODE
+// LWM2M queue mode callback
+// Called when all the servers are in queue mode and none can reach the client anymore: the application may power the
+// radio down until lwm2m_queue_flush() or until the next registration update scheduled by lwm2m_step().
+typedef void (*lwm2m_queue_callback_t) (lwm2m_context_t * contextP, void * userData);
+#endif
+
 #ifdef LWM2M_BOOTSTRAP_SERVER_MODE
 // In all the following APIs, the session handle MUST uniquely identify a peer.
 
@@ -786,9 +963,22 @@ struct _lwm2m_context_
     lwm2m_server_t *     serverList;
     lwm2m_object_t *     objectList;
     lwm2m_observed_t *   observedList;
+    lwm2m_observed_t *   observedDirtyList; // observed URIs to check at the next step
+    lwm2m_observed_node_t observedTree;     // observedList indexed by path, the root has no ID
+#ifdef LWM2M_DATA_ARENA
+    lwm2m_data_arena_t   dataArena;         // lwm2m_data_t trees of the request or notification being built
+#endif
+    uint32_t             nextETag;          // ETag of the next read response cached for block-wise transfers
+    lwm2m_queue_callback_t queueCallback;   // called when the radio may be powered down
+    void *               queueUserData;
 #endif
 #if defined(LWM2M_SERVER_MODE) || defined(LWM2M_BOOTSTRAP_SERVER_MODE)
     lwm2m_client_t *        clientList;
+    lwm2m_index_t           clientIdIndex;      // clientList indexed by internalID
+    lwm2m_index_t           clientNameIndex;    // clientList indexed by endpoint name
+#ifdef LWM2M_SESSION_HASH
+    lwm2m_index_t           clientSessionIndex; // clientList indexed by lwm2m_session_hash()
+#endif
 #endif
 #ifdef LWM2M_SERVER_MODE
     lwm2m_result_callback_t monitorCallback;
@@ -800,6 +990,17 @@ struct _lwm2m_context_
 #endif
     uint16_t                nextMID;
     lwm2m_transaction_t *   transactionList;
+    lwm2m_index_t           transactionMidIndex;   // transactionList indexed by message ID
+    lwm2m_index_t           transactionTokenIndex; // requests of transactionList indexed by token
+    size_t                  transactionUnindexed;  // transactions missing from the indexes after an allocation failure
+    uint16_t                coapBlockSize;
+    size_t                  maxBlockTransferSize;  // maximal size of the block-wise transfers buffered per peer, 0 for no limit
+    lwm2m_timer_t *         timerHeap;
+    time_t                  schedulerTime;   // lwm2m_gettime() at the last step
+    int64_t                 schedulerTimeMs; // millisecond clock at the last step
+    bool                    schedulerRunning;
+    uint8_t *               sendBuffer;      // datagrams are serialized here before lwm2m_buffer_send()
+    size_t                  sendBufferSize;
     void *                  userData;
 };
 
@@ -808,9 +1009,18 @@ struct _lwm2m_context_
 lwm2m_context_t * lwm2m_init(void * userData);
 // close a liblwm2m context.
 void lwm2m_close(lwm2m_context_t * contextP);
+// set or get the CoAP block size used by a context for block-wise transfers.
+bool lwm2m_context_set_coap_block_size(lwm2m_context_t * contextP, uint16_t coap_block_size_arg);
+uint16_t lwm2m_context_get_coap_block_size(lwm2m_context_t * contextP);
+// set or get the maximal size of the block-wise transfers a context buffers for one peer, 0 for no limit.
+// The default is LWM2M_MAX_BLOCK_TRANSFER_SIZE. Larger transfers are answered with 4.13 (Request Entity Too Large).
+void lwm2m_context_set_max_block_transfer_size(lwm2m_context_t * contextP, size_t size);
+size_t lwm2m_context_get_max_block_transfer_size(lwm2m_context_t * contextP);
 
 // perform any required pending operation and adjust timeoutP to the maximal time interval to wait in seconds.
 int lwm2m_step(lwm2m_context_t * contextP, time_t * timeoutP);
+// same as lwm2m_step() with timeoutP in milliseconds. Use it along with LWM2M_WITH_MS_CLOCK.
+int lwm2m_step_ms(lwm2m_context_t * contextP, int64_t * timeoutP);
 // dispatch received data to liblwm2m
 void lwm2m_handle_packet(lwm2m_context_t * contextP, uint8_t * buffer, int length, void * fromSessionH);
 
@@ -830,6 +1040,13 @@ int lwm2m_update_registration(lwm2m_context_t * contextP, uint16_t shortServerID
 // send deregistration to all servers connected to client
 void lwm2m_deregister(lwm2m_context_t * context);
 void lwm2m_resource_value_changed(lwm2m_context_t * contextP, lwm2m_uri_t * uriP);
+// Queue mode (binding with Q): a server reaches the client LWM2M_QUEUE_MODE_TIMEOUT seconds after their last exchange.
+// It then sleeps and the notifications to it are kept, up to LWM2M_QUEUE_MODE_MAX_NOTIFICATIONS per server.
+// set the callback telling when the radio may be powered down.
+void lwm2m_set_queue_callback(lwm2m_context_t * contextP, lwm2m_queue_callback_t callback, void * userData);
+// to call once the radio is powered up: sends a registration update to each sleeping server, followed by the
+// notifications kept for it.
+int lwm2m_queue_flush(lwm2m_context_t * contextP);
 #endif
 
 #ifdef LWM2M_SERVER_MODE
@@ -0,0 +1,94 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+/*
+ * Base64 throughput for the opaque values of JSON and SenML JSON payloads,
+ * from small keys to certificates and firmware chunks. The size column is
+ * the length of the binary data.
+ */
+
+#include "benchmarks.h"
+#include "internals.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BASE64_BYTES_TOTAL (256 * 1024 * 1024) // binary bytes processed per benchmark
+
+static const size_t dataSizes[] = {16, 1024, 16 * 1024, 1024 * 1024};
+
+static void prv_report(const char *name, size_t size, size_t iterations, uint64_t elapsed) {
+    benchmark_report(name, size, iterations, elapsed);
+    printf("%-40s %8s %12.1f MB/s\n", "", "",
+           (double)size * (double)iterations * 1e9 / (double)elapsed / (1024.0 * 1024.0));
+}
+
+void benchmark_base64(void) {
+    size_t n;
+
+    for (n = 0; n < sizeof(dataSizes) / sizeof(dataSizes[0]); n++) {
+        size_t size = dataSizes[n];
+        size_t encodedSize = utils_base64GetSize(size);
+        size_t iterations = BASE64_BYTES_TOTAL / size;
+        uint8_t *data;
+        uint8_t *encoded;
+        uint8_t *decoded;
+        uint64_t start;
+        size_t i;
+
+        data = (uint8_t *)malloc(size);
+        encoded = (uint8_t *)malloc(encodedSize);
+        decoded = (uint8_t *)malloc(size);
+        if (data == NULL || encoded == NULL || decoded == NULL) {
+            fprintf(stderr, "allocation failed\n");
+            free(data);
+            free(encoded);
+            free(decoded);
+            return;
+        }
+        for (i = 0; i < size; i++) {
+            data[i] = (uint8_t)benchmark_random();
+        }
+
+        start = benchmark_now();
+        for (i = 0; i < iterations; i++) {
+            if (utils_base64Encode(data, size, encoded, encodedSize) != encodedSize) {
+                fprintf(stderr, "base64 encoding failed\n");
+                break;
+            }
+        }
+        prv_report("base64 encode (bytes)", size, iterations, benchmark_now() - start);
+
+        start = benchmark_now();
+        for (i = 0; i < iterations; i++) {
+            if (utils_base64Decode((const char *)encoded, encodedSize, decoded, size) != size) {
+                fprintf(stderr, "base64 decoding failed\n");
+                break;
+            }
+        }
+        prv_report("base64 decode (bytes)", size, iterations, benchmark_now() - start);
+
+        if (memcmp(data, decoded, size) != 0) {
+            fprintf(stderr, "base64 round trip failed\n");
+        }
+
+        free(data);
+        free(encoded);
+        free(decoded);
+    }
+}
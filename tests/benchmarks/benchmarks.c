@@ -0,0 +1,109 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+#include "benchmarks.h"
+#include "liblwm2m.h"
+
+#include <stdio.h>
+#include <time.h>
+
+size_t benchmark_sentPackets;
+
+static uint32_t randomState = 0x12345678;
+
+uint64_t benchmark_now(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+void benchmark_report(const char *name, size_t size, size_t operations, uint64_t elapsed) {
+    printf("%-40s %8zu %12.1f ns/op\n", name, size, operations == 0 ? 0.0 : (double)elapsed / (double)operations);
+}
+
+uint32_t benchmark_random(void) {
+    // xorshift32
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+/*
+ * The benchmarks never touch a network: sessions are opaque handles
+ * and sent packets are only counted.
+ */
+uint8_t lwm2m_buffer_send(void *sessionH, uint8_t *buffer, size_t length, void *userData) {
+    (void)sessionH;
+    (void)buffer;
+    (void)length;
+    (void)userData;
+
+    benchmark_sentPackets++;
+    return COAP_NO_ERROR;
+}
+
+bool lwm2m_session_is_equal(void *session1, void *session2, void *userData) {
+    (void)userData;
+
+    return (session1 == session2);
+}
+
+#ifdef LWM2M_SESSION_HASH
+uint32_t lwm2m_session_hash(void *session, void *userData) {
+    uint64_t value = (uint64_t)(uintptr_t)session;
+
+    (void)userData;
+
+    value >>= 3;
+    return (uint32_t)(value ^ (value >> 32));
+}
+#endif
+
+#ifdef LWM2M_CLIENT_MODE
+void *lwm2m_connect_server(uint16_t secObjInstID, void *userData) {
+    (void)userData;
+
+    return (void *)(uintptr_t)(secObjInstID + 1);
+}
+
+void lwm2m_close_connection(void *sessionH, void *userData) {
+    (void)sessionH;
+    (void)userData;
+}
+#endif
+
+int main(void) {
+    printf("%-40s %8s %15s\n", "benchmark", "size", "cost");
+
+#ifdef LWM2M_SERVER_MODE
+    benchmark_client_lookup();
+    benchmark_block();
+#endif
+#ifdef LWM2M_CLIENT_MODE
+    benchmark_observe();
+    benchmark_coap_parse();
+    benchmark_codec();
+    benchmark_json_parse();
+    benchmark_float_format();
+    benchmark_number_parse();
+    benchmark_base64();
+#endif
+
+    return 0;
+}
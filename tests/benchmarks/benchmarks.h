@@ -0,0 +1,48 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+#ifndef BENCHMARKS_H_
+#define BENCHMARKS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Returns a monotonic time stamp in nanoseconds
+uint64_t benchmark_now(void);
+// Prints one result line: the cost per operation for a given problem size
+void benchmark_report(const char * name, size_t size, size_t operations, uint64_t elapsed);
+// Small deterministic pseudo random generator so runs are comparable
+uint32_t benchmark_random(void);
+
+// Number of packets given to lwm2m_buffer_send()
+extern size_t benchmark_sentPackets;
+
+#ifdef LWM2M_SERVER_MODE
+void benchmark_client_lookup(void);
+void benchmark_block(void);
+#endif
+#ifdef LWM2M_CLIENT_MODE
+void benchmark_observe(void);
+void benchmark_coap_parse(void);
+void benchmark_codec(void);
+void benchmark_json_parse(void);
+void benchmark_float_format(void);
+void benchmark_number_parse(void);
+void benchmark_base64(void);
+#endif
+
+#endif /* BENCHMARKS_H_ */
@@ -0,0 +1,120 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+/*
+ * Cost per block of the reassembly of multi-megabyte block-wise transfers,
+ * with and without the Size1/Size2 option announcing the whole size. The
+ * "copy per block" case reproduces the previous reassembly, which copied
+ * the whole payload received so far on each block.
+ */
+
+#include "benchmarks.h"
+#include "internals.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BLOCK_SIZE 1024
+
+static const size_t transferSizes[] = {1024 * 1024, 4 * 1024 * 1024};
+
+static uint8_t block[BLOCK_SIZE];
+
+static void prv_benchmarkBlock1(size_t size, bool announced) {
+    lwm2m_block_data_t *blockData = NULL;
+    uint8_t *result = NULL;
+    size_t resultLength = 0;
+    uint32_t count = (uint32_t)(size / BLOCK_SIZE);
+    uint64_t start;
+    uint32_t i;
+
+    start = benchmark_now();
+    for (i = 0; i < count; i++) {
+        coap_block1_handler(&blockData, "/5/0/0", block, BLOCK_SIZE, BLOCK_SIZE, i, i + 1 < count,
+                            announced ? (uint32_t)size : 0, 0, &result, &resultLength);
+    }
+    benchmark_report(announced ? "block1 write (Size1)" : "block1 write (no Size1)", size, count,
+                     benchmark_now() - start);
+
+    if (resultLength != size) {
+        fprintf(stderr, "block1 reassembly failed\n");
+    }
+    free_block_data(blockData);
+}
+
+static void prv_benchmarkBlock2(size_t size, bool announced) {
+    lwm2m_block_data_t *blockData = NULL;
+    uint8_t *result = NULL;
+    size_t resultLength = 0;
+    uint32_t count = (uint32_t)(size / BLOCK_SIZE);
+    uint64_t start;
+    uint32_t i;
+
+    start = benchmark_now();
+    for (i = 0; i < count; i++) {
+        // each block is the response to a new request
+        coap_block2_handler(&blockData, (uint16_t)i, block, BLOCK_SIZE, BLOCK_SIZE, i, i + 1 < count,
+                            announced ? (uint32_t)size : 0, 0, &result, &resultLength);
+        coap_block2_set_expected_mid(blockData, (uint16_t)i, (uint16_t)(i + 1));
+    }
+    benchmark_report(announced ? "block2 read (Size2)" : "block2 read (no Size2)", size, count,
+                     benchmark_now() - start);
+
+    if (resultLength != size) {
+        fprintf(stderr, "block2 reassembly failed\n");
+    }
+    block2_delete(&blockData, (uint16_t)count);
+}
+
+static void prv_benchmarkCopyPerBlock(size_t size) {
+    uint8_t *buffer = NULL;
+    size_t length = 0;
+    uint32_t count = (uint32_t)(size / BLOCK_SIZE);
+    uint64_t start;
+    uint32_t i;
+
+    start = benchmark_now();
+    for (i = 0; i < count; i++) {
+        uint8_t *newBuffer = (uint8_t *)lwm2m_malloc(length + BLOCK_SIZE);
+
+        if (newBuffer == NULL) break;
+        if (length != 0) memcpy(newBuffer, buffer, length);
+        memcpy(newBuffer + length, block, BLOCK_SIZE);
+        lwm2m_free(buffer);
+        buffer = newBuffer;
+        length += BLOCK_SIZE;
+    }
+    benchmark_report("block reassembly (copy per block)", size, count, benchmark_now() - start);
+
+    lwm2m_free(buffer);
+}
+
+void benchmark_block(void) {
+    size_t i;
+
+    memset(block, 0x5A, sizeof(block));
+
+    // quadratic, only the smallest size
+    prv_benchmarkCopyPerBlock(transferSizes[0]);
+
+    for (i = 0; i < sizeof(transferSizes) / sizeof(transferSizes[0]); i++) {
+        prv_benchmarkBlock1(transferSizes[i], false);
+        prv_benchmarkBlock1(transferSizes[i], true);
+        prv_benchmarkBlock2(transferSizes[i], false);
+        prv_benchmarkBlock2(transferSizes[i], true);
+    }
+}
@@ -0,0 +1,143 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+/*
+ * Cost of the per packet client lookups of a server holding an
+ * increasing number of registered clients. With the client indexes the
+ * cost per packet must stay flat. Only the first registration of an
+ * endpoint still walks the client list to allocate its ID.
+ */
+
+#include "benchmarks.h"
+#include "internals.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define LOOKUP_OPERATIONS 200000
+
+static const size_t clientCounts[] = {1000, 10000, 50000};
+
+static void *prv_session(size_t index) { return (void *)(uintptr_t)(0x10000 + index * 16); }
+
+static void prv_endpointName(size_t index, char *name, size_t size) { snprintf(name, size, "urn:dev:bench-%zu", index); }
+
+static size_t prv_register(lwm2m_context_t *contextP, size_t index, uint16_t mid) {
+    coap_packet_t message;
+    uint8_t buffer[256];
+    char query[64];
+    char name[32];
+    const char *payload = "</1/0>,</3/0>";
+    size_t length;
+
+    prv_endpointName(index, name, sizeof(name));
+    snprintf(query, sizeof(query), "ep=%s&lt=86400&lwm2m=1.0", name);
+
+    coap_init_message(&message, COAP_TYPE_NON, COAP_POST, mid);
+    coap_set_header_uri_path(&message, "/" URI_REGISTRATION_SEGMENT);
+    coap_set_header_uri_query(&message, query);
+    coap_set_header_content_type(&message, LWM2M_CONTENT_LINK);
+    coap_set_payload(&message, payload, strlen(payload));
+    length = coap_serialize_message(&message, buffer);
+
+    lwm2m_handle_packet(contextP, buffer, length, prv_session(index));
+    return length;
+}
+
+static size_t prv_buildUpdate(size_t index, uint16_t mid, uint8_t *buffer) {
+    coap_packet_t message;
+    char path[32];
+
+    // client IDs are allocated in registration order
+    snprintf(path, sizeof(path), "/" URI_REGISTRATION_SEGMENT "/%zu", index);
+
+    coap_init_message(&message, COAP_TYPE_NON, COAP_POST, mid);
+    coap_set_header_uri_path(&message, path);
+    return coap_serialize_message(&message, buffer);
+}
+
+static void prv_benchmarkSize(size_t count) {
+    lwm2m_context_t *contextP;
+    uint8_t buffer[64];
+    char name[32];
+    uint64_t start;
+    size_t found;
+    size_t i;
+
+    contextP = lwm2m_init(NULL);
+    if (contextP == NULL) {
+        fprintf(stderr, "lwm2m_init() failed\n");
+        return;
+    }
+
+    start = benchmark_now();
+    for (i = 0; i < count; i++) {
+        prv_register(contextP, i, (uint16_t)i);
+    }
+    benchmark_report("server register (new endpoint)", count, count, benchmark_now() - start);
+
+    found = 0;
+    for (i = 0; i < count; i++) {
+        found += utils_findClientByName(contextP, (prv_endpointName(i, name, sizeof(name)), name)) != NULL;
+    }
+    if (found != count) {
+        fprintf(stderr, "only %zu of %zu clients registered\n", found, count);
+    }
+
+    start = benchmark_now();
+    for (i = 0; i < LOOKUP_OPERATIONS; i++) {
+        prv_register(contextP, benchmark_random() % count, (uint16_t)i);
+    }
+    benchmark_report("server register (known endpoint)", count, LOOKUP_OPERATIONS, benchmark_now() - start);
+
+    start = benchmark_now();
+    for (i = 0; i < LOOKUP_OPERATIONS; i++) {
+        size_t index = benchmark_random() % count;
+        size_t length = prv_buildUpdate(index, (uint16_t)i, buffer);
+
+        lwm2m_handle_packet(contextP, buffer, length, prv_session(index));
+    }
+    benchmark_report("server registration update packet", count, LOOKUP_OPERATIONS, benchmark_now() - start);
+
+    found = 0;
+    start = benchmark_now();
+    for (i = 0; i < LOOKUP_OPERATIONS; i++) {
+        found += utils_findClient(contextP, prv_session(benchmark_random() % count)) != NULL;
+    }
+    benchmark_report("utils_findClient()", count, LOOKUP_OPERATIONS, benchmark_now() - start);
+
+    start = benchmark_now();
+    for (i = 0; i < LOOKUP_OPERATIONS; i++) {
+        prv_endpointName(benchmark_random() % count, name, sizeof(name));
+        found += utils_findClientByName(contextP, name) != NULL;
+    }
+    benchmark_report("utils_findClientByName()", count, LOOKUP_OPERATIONS, benchmark_now() - start);
+
+    if (found != 2 * LOOKUP_OPERATIONS) {
+        fprintf(stderr, "%zu lookups failed\n", 2 * LOOKUP_OPERATIONS - found);
+    }
+
+    lwm2m_close(contextP);
+}
+
+void benchmark_client_lookup(void) {
+    size_t i;
+
+    for (i = 0; i < sizeof(clientCounts) / sizeof(clientCounts[0]); i++) {
+        prv_benchmarkSize(clientCounts[i]);
+    }
+}
@@ -0,0 +1,102 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+/*
+ * Parse throughput of typical LwM2M requests. The Uri-Path, Uri-Query and
+ * Location-Path options of a parsed packet point into the datagram, the
+ * list nodes coming from a pool inside coap_packet_t. Only a packet with
+ * more than COAP_MAX_PARSED_OPTIONS such options allocates the others.
+ */
+
+#include "benchmarks.h"
+#include "internals.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define PARSE_ITERATIONS 1000000
+
+static size_t prv_buildRead(uint8_t *buffer) {
+    coap_packet_t message;
+    size_t length;
+
+    coap_init_message(&message, COAP_TYPE_CON, COAP_GET, 0x1234);
+    coap_set_header_token(&message, (const uint8_t *)"\x01\x02\x03\x04", 4);
+    coap_set_header_uri_path(&message, "/3/0/1");
+    length = coap_serialize_message(&message, buffer);
+    coap_free_header(&message);
+    return length;
+}
+
+static size_t prv_buildRegistration(uint8_t *buffer) {
+    static const char *payload = "</1/0>,</3/0>,</5/0>,</3303/0>";
+    coap_packet_t message;
+    size_t length;
+
+    coap_init_message(&message, COAP_TYPE_CON, COAP_POST, 0x1234);
+    coap_set_header_token(&message, (const uint8_t *)"\x01\x02\x03\x04", 4);
+    coap_set_header_uri_path(&message, "/rd");
+    coap_set_header_uri_query(&message, "?ep=benchmark-client&lt=300&lwm2m=1.1&b=U");
+    coap_set_header_content_type(&message, LWM2M_CONTENT_LINK);
+    coap_set_payload(&message, payload, strlen(payload));
+    length = coap_serialize_message(&message, buffer);
+    coap_free_header(&message);
+    return length;
+}
+
+static size_t prv_buildAttributes(uint8_t *buffer) {
+    coap_packet_t message;
+    size_t length;
+
+    coap_init_message(&message, COAP_TYPE_CON, COAP_PUT, 0x1234);
+    coap_set_header_token(&message, (const uint8_t *)"\x01\x02\x03\x04", 4);
+    coap_set_header_uri_path(&message, "/3303/0/5700");
+    coap_set_header_uri_query(&message, "?pmin=10&pmax=60&gt=30.5&lt=-10&st=0.5&epmin=1&epmax=120");
+    length = coap_serialize_message(&message, buffer);
+    coap_free_header(&message);
+    return length;
+}
+
+static void prv_benchmarkParse(const char *name, size_t (*build)(uint8_t *)) {
+    uint8_t buffer[256];
+    coap_packet_t packet;
+    size_t length;
+    size_t i;
+    uint64_t start;
+    uint64_t elapsed;
+
+    length = build(buffer);
+
+    start = benchmark_now();
+    for (i = 0; i < PARSE_ITERATIONS; i++) {
+        if (coap_parse_message(&packet, buffer, (uint16_t)length) != NO_ERROR) {
+            fprintf(stderr, "%s: parsing failed\n", name);
+            return;
+        }
+        coap_free_header(&packet);
+    }
+    elapsed = benchmark_now() - start;
+
+    benchmark_report(name, length, PARSE_ITERATIONS, elapsed);
+    printf("%-40s %8s %12.0f packets/s\n", "", "", (double)PARSE_ITERATIONS * 1e9 / (double)elapsed);
+}
+
+void benchmark_coap_parse(void) {
+    prv_benchmarkParse("parse read (3 options)", prv_buildRead);
+    prv_benchmarkParse("parse registration (5 options)", prv_buildRegistration);
+    prv_benchmarkParse("parse write-attributes (10 options)", prv_buildAttributes);
+}
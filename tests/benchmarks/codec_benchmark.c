@@ -0,0 +1,143 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+/*
+ * Cost of serializing and parsing a whole object made of many instances,
+ * each with single resources of every type and a multiple resource. The
+ * payload size is reported below each serialization.
+ */
+
+#include "benchmarks.h"
+#include "internals.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define CODEC_OBJECT_ID        3303
+#define CODEC_MULTIPLE_COUNT   4
+#define CODEC_ITERATIONS_TOTAL 2000000 // resources encoded per benchmark
+
+static const size_t instanceCounts[] = {10, 100, 1000};
+
+static lwm2m_data_t *prv_buildObject(size_t count) {
+    static const uint8_t opaque[32] = {0};
+    lwm2m_data_t *instancesP;
+    size_t i;
+
+    instancesP = lwm2m_data_new((int)count);
+    if (instancesP == NULL) return NULL;
+
+    for (i = 0; i < count; i++) {
+        lwm2m_data_t *resourcesP = lwm2m_data_new(6);
+        lwm2m_data_t *multipleP = lwm2m_data_new(CODEC_MULTIPLE_COUNT);
+        int j;
+
+        if (resourcesP == NULL || multipleP == NULL) return NULL;
+
+        resourcesP[0].id = 5700;
+        lwm2m_data_encode_float(20.5 + (double)i, resourcesP + 0);
+        resourcesP[1].id = 5701;
+        lwm2m_data_encode_string("Cel", resourcesP + 1);
+        resourcesP[2].id = 5750;
+        lwm2m_data_encode_string("temperature sensor of the room", resourcesP + 2);
+        resourcesP[3].id = 5850;
+        lwm2m_data_encode_bool(i % 2 == 0, resourcesP + 3);
+        resourcesP[4].id = 5900;
+        lwm2m_data_encode_opaque(opaque, sizeof(opaque), resourcesP + 4);
+        for (j = 0; j < CODEC_MULTIPLE_COUNT; j++) {
+            multipleP[j].id = (uint16_t)j;
+            lwm2m_data_encode_int(1000 * j - (int64_t)i, multipleP + j);
+        }
+        resourcesP[5].id = 5910;
+        lwm2m_data_encode_instances(multipleP, CODEC_MULTIPLE_COUNT, resourcesP + 5);
+
+        instancesP[i].id = (uint16_t)i;
+        lwm2m_data_include(resourcesP, 6, instancesP + i);
+    }
+
+    return instancesP;
+}
+
+static void prv_benchmarkFormat(lwm2m_media_type_t format, const char *serializeName, const char *parseName) {
+    size_t n;
+
+    for (n = 0; n < sizeof(instanceCounts) / sizeof(instanceCounts[0]); n++) {
+        size_t count = instanceCounts[n];
+        size_t iterations = CODEC_ITERATIONS_TOTAL / (count * (5 + CODEC_MULTIPLE_COUNT));
+        lwm2m_data_t *objectP;
+        lwm2m_uri_t uri;
+        uint8_t *buffer = NULL;
+        int length = 0;
+        uint64_t start;
+        uint64_t elapsed;
+        size_t i;
+
+        LWM2M_URI_RESET(&uri);
+        uri.objectId = CODEC_OBJECT_ID;
+        objectP = prv_buildObject(count);
+        if (objectP == NULL) {
+            fprintf(stderr, "allocation failed\n");
+            return;
+        }
+
+        start = benchmark_now();
+        for (i = 0; i < iterations; i++) {
+            lwm2m_media_type_t media = format;
+
+            lwm2m_free(buffer);
+            length = lwm2m_data_serialize(&uri, (int)count, objectP, &media, &buffer);
+            if (length <= 0) {
+                fprintf(stderr, "%s: serialization failed\n", serializeName);
+                return;
+            }
+        }
+        elapsed = benchmark_now() - start;
+        benchmark_report(serializeName, count, iterations, elapsed);
+        printf("%-40s %8zu %12d bytes\n", "", count, length);
+
+        start = benchmark_now();
+        for (i = 0; i < iterations; i++) {
+            lwm2m_data_t *parsedP = NULL;
+            int size;
+
+            size = lwm2m_data_parse(&uri, buffer, (size_t)length, format, &parsedP);
+            if (size <= 0) {
+                fprintf(stderr, "%s: parsing failed\n", parseName);
+                return;
+            }
+            lwm2m_data_free(size, parsedP);
+        }
+        elapsed = benchmark_now() - start;
+        benchmark_report(parseName, count, iterations, elapsed);
+
+        lwm2m_free(buffer);
+        lwm2m_data_free((int)count, objectP);
+    }
+}
+
+void benchmark_codec(void) {
+    prv_benchmarkFormat(LWM2M_CONTENT_TLV, "TLV serialize (instances)", "TLV parse (instances)");
+#ifdef LWM2M_SUPPORT_SENML_JSON
+    prv_benchmarkFormat(LWM2M_CONTENT_SENML_JSON, "SenML JSON serialize (instances)", "SenML JSON parse (instances)");
+#endif
+#ifdef LWM2M_SUPPORT_SENML_CBOR
+    prv_benchmarkFormat(LWM2M_CONTENT_SENML_CBOR, "SenML CBOR serialize (instances)", "SenML CBOR parse (instances)");
+#endif
+#ifdef LWM2M_SUPPORT_LWM2M_CBOR
+    prv_benchmarkFormat(LWM2M_CONTENT_LWM2M_CBOR, "LwM2M CBOR serialize (instances)", "LwM2M CBOR parse (instances)");
+#endif
+}
@@ -0,0 +1,82 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+/*
+ * Cost of utils_floatToText(), used for every float in text, JSON and SenML
+ * JSON payloads. Sensor readings have few significant digits, locations
+ * about eight and arbitrary doubles up to seventeen. The text length is the
+ * average number of characters written per value.
+ */
+
+#include "benchmarks.h"
+#include "internals.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define FLOAT_VALUE_COUNT       1024
+#define FLOAT_FORMAT_ITERATIONS 2000
+
+static double values[FLOAT_VALUE_COUNT];
+
+static void prv_benchmarkFormat(const char *name, bool allowExponential) {
+    uint8_t text[400];
+    size_t characters = 0;
+    uint64_t start;
+    uint64_t elapsed;
+    size_t i;
+    size_t j;
+
+    start = benchmark_now();
+    for (i = 0; i < FLOAT_FORMAT_ITERATIONS; i++) {
+        for (j = 0; j < FLOAT_VALUE_COUNT; j++) {
+            characters += utils_floatToText(values[j], text, sizeof(text), allowExponential);
+        }
+    }
+    elapsed = benchmark_now() - start;
+
+    benchmark_report(name, characters / (FLOAT_FORMAT_ITERATIONS * FLOAT_VALUE_COUNT),
+                     FLOAT_FORMAT_ITERATIONS * FLOAT_VALUE_COUNT, elapsed);
+}
+
+void benchmark_float_format(void) {
+    size_t i;
+
+    // Temperatures with a resolution of 0.01 degree
+    for (i = 0; i < FLOAT_VALUE_COUNT; i++) {
+        values[i] = (double)((int)(benchmark_random() % 6000) - 2000) / 100.0;
+    }
+    prv_benchmarkFormat("Float to text (sensor)", true);
+
+    // Latitudes with six decimals
+    for (i = 0; i < FLOAT_VALUE_COUNT; i++) {
+        values[i] = (double)((int)(benchmark_random() % 180000000) - 90000000) / 1000000.0;
+    }
+    prv_benchmarkFormat("Float to text (location)", true);
+
+    // Any double, including tiny and huge ones
+    for (i = 0; i < FLOAT_VALUE_COUNT; i++) {
+        uint64_t bits;
+
+        do {
+            bits = ((uint64_t)benchmark_random() << 32) | benchmark_random();
+        } while (((bits >> 52) & 0x7FF) == 0x7FF); // no infinities or NaN
+        memcpy(values + i, &bits, sizeof(values[i]));
+    }
+    prv_benchmarkFormat("Float to text (random, exponential)", true);
+    prv_benchmarkFormat("Float to text (random, plain)", false);
+}
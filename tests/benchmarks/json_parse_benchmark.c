@@ -0,0 +1,172 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+/*
+ * Parse throughput of the JSON based content formats, as a server parsing
+ * notifications or a client parsing a bootstrap write would see it. Each
+ * payload holds records of about 40 bytes with short and long strings. The
+ * indented variant adds the whitespace a pretty printing peer would send.
+ */
+
+#include "benchmarks.h"
+#include "internals.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define JSON_OBJECT_ID   3303
+#define JSON_BYTES_TOTAL (200 * 1024 * 1024) // bytes parsed per benchmark
+
+static const size_t instanceCounts[] = {10, 1000};
+
+static lwm2m_data_t *prv_buildObject(size_t count) {
+    lwm2m_data_t *instancesP;
+    size_t i;
+
+    instancesP = lwm2m_data_new((int)count);
+    if (instancesP == NULL) return NULL;
+
+    for (i = 0; i < count; i++) {
+        lwm2m_data_t *resourcesP = lwm2m_data_new(4);
+
+        if (resourcesP == NULL) return NULL;
+
+        resourcesP[0].id = 5700;
+        lwm2m_data_encode_float(20.5 + (double)i, resourcesP + 0);
+        resourcesP[1].id = 5701;
+        lwm2m_data_encode_string("Cel", resourcesP + 1);
+        resourcesP[2].id = 5750;
+        lwm2m_data_encode_string("temperature sensor of the \"main\" room, second floor", resourcesP + 2);
+        resourcesP[3].id = 5850;
+        lwm2m_data_encode_bool(i % 2 == 0, resourcesP + 3);
+
+        instancesP[i].id = (uint16_t)i;
+        lwm2m_data_include(resourcesP, 4, instancesP + i);
+    }
+
+    return instancesP;
+}
+
+// Adds a new line and some indentation after each structural character outside of strings
+static uint8_t *prv_indent(const uint8_t *buffer, int length, int *newLengthP) {
+    uint8_t *newBuffer;
+    bool inString = false;
+    int head = 0;
+    int i;
+
+    newBuffer = (uint8_t *)malloc((size_t)length * 6);
+    if (newBuffer == NULL) return NULL;
+
+    for (i = 0; i < length; i++) {
+        newBuffer[head++] = buffer[i];
+        if (inString) {
+            if (buffer[i] == '\\') {
+                newBuffer[head++] = buffer[++i];
+            } else if (buffer[i] == '"') {
+                inString = false;
+            }
+        } else if (buffer[i] == '"') {
+            inString = true;
+        } else if (buffer[i] == '{' || buffer[i] == '[' || buffer[i] == ',') {
+            memcpy(newBuffer + head, "\n    ", 5);
+            head += 5;
+        } else if (buffer[i] == ':') {
+            newBuffer[head++] = ' ';
+        }
+    }
+
+    *newLengthP = head;
+    return newBuffer;
+}
+
+static void prv_benchmarkParse(const char *name, lwm2m_media_type_t format, const lwm2m_uri_t *uriP,
+                               const uint8_t *buffer, int length, size_t count) {
+    size_t iterations = JSON_BYTES_TOTAL / (size_t)length;
+    uint64_t start;
+    uint64_t elapsed;
+    size_t i;
+
+    start = benchmark_now();
+    for (i = 0; i < iterations; i++) {
+        lwm2m_data_t *parsedP = NULL;
+        int size;
+
+        size = lwm2m_data_parse((lwm2m_uri_t *)uriP, buffer, (size_t)length, format, &parsedP);
+        if (size <= 0) {
+            fprintf(stderr, "%s: parsing failed\n", name);
+            return;
+        }
+        lwm2m_data_free(size, parsedP);
+    }
+    elapsed = benchmark_now() - start;
+
+    benchmark_report(name, count, iterations, elapsed);
+    printf("%-40s %8d %12.1f MB/s\n", "", length,
+           (double)length * (double)iterations * 1e9 / (double)elapsed / (1024.0 * 1024.0));
+}
+
+static void prv_benchmarkFormat(lwm2m_media_type_t format, const char *name, const char *indentedName) {
+    size_t n;
+
+    for (n = 0; n < sizeof(instanceCounts) / sizeof(instanceCounts[0]); n++) {
+        size_t count = instanceCounts[n];
+        lwm2m_media_type_t media = format;
+        lwm2m_data_t *objectP;
+        lwm2m_uri_t uri;
+        uint8_t *buffer;
+        uint8_t *indented;
+        int length;
+        int indentedLength;
+
+        LWM2M_URI_RESET(&uri);
+        uri.objectId = JSON_OBJECT_ID;
+        objectP = prv_buildObject(count);
+        if (objectP == NULL) {
+            fprintf(stderr, "allocation failed\n");
+            return;
+        }
+        length = lwm2m_data_serialize(&uri, (int)count, objectP, &media, &buffer);
+        lwm2m_data_free((int)count, objectP);
+        if (length <= 0) {
+            fprintf(stderr, "%s: serialization failed\n", name);
+            return;
+        }
+        indented = prv_indent(buffer, length, &indentedLength);
+        if (indented == NULL) {
+            fprintf(stderr, "allocation failed\n");
+            lwm2m_free(buffer);
+            return;
+        }
+
+        prv_benchmarkParse(name, format, &uri, buffer, length, count);
+        prv_benchmarkParse(indentedName, format, &uri, indented, indentedLength, count);
+
+        free(indented);
+        lwm2m_free(buffer);
+    }
+}
+
+void benchmark_json_parse(void) {
+#ifdef LWM2M_SUPPORT_JSON
+    prv_benchmarkFormat(LWM2M_CONTENT_JSON, "JSON parse (instances)", "JSON indented parse (instances)");
+#endif
+#ifdef LWM2M_SUPPORT_SENML_JSON
+    prv_benchmarkFormat(LWM2M_CONTENT_SENML_JSON, "SenML JSON parse (instances)",
+                        "SenML JSON indented parse (instances)");
+#endif
+}
@@ -0,0 +1,148 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+/*
+ * Cost of parsing the numbers of text, JSON and SenML JSON payloads:
+ * sensor readings, locations and arbitrary doubles printed with seventeen
+ * digits, plus timestamps and counters as integers. The size column is the
+ * average text length.
+ */
+
+#include "benchmarks.h"
+#include "internals.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define NUMBER_COUNT            1024
+#define NUMBER_PARSE_ITERATIONS 2000
+#define NUMBER_TEXT_SIZE        32
+
+static char texts[NUMBER_COUNT][NUMBER_TEXT_SIZE];
+static int lengths[NUMBER_COUNT];
+
+static void prv_report(const char *name, size_t characters, uint64_t elapsed) {
+    size_t operations = NUMBER_PARSE_ITERATIONS * NUMBER_COUNT;
+
+    benchmark_report(name, characters / NUMBER_COUNT, operations, elapsed);
+    printf("%-40s %8s %12.1f MB/s\n", "", "",
+           (double)characters * NUMBER_PARSE_ITERATIONS * 1e9 / (double)elapsed / (1024.0 * 1024.0));
+}
+
+static void prv_benchmarkFloat(const char *name) {
+    size_t characters = 0;
+    double sum = 0;
+    uint64_t start;
+    uint64_t elapsed;
+    size_t i;
+    size_t j;
+
+    for (j = 0; j < NUMBER_COUNT; j++) {
+        characters += (size_t)lengths[j];
+    }
+
+    start = benchmark_now();
+    for (i = 0; i < NUMBER_PARSE_ITERATIONS; i++) {
+        for (j = 0; j < NUMBER_COUNT; j++) {
+            double value;
+
+            if (!utils_textToFloat((const uint8_t *)texts[j], lengths[j], &value, true)) {
+                fprintf(stderr, "%s: parsing \"%s\" failed\n", name, texts[j]);
+                return;
+            }
+            sum += value;
+        }
+    }
+    elapsed = benchmark_now() - start;
+
+    if (sum < 0) printf("\n"); // keeps the loop from being optimized away
+    prv_report(name, characters, elapsed);
+}
+
+static void prv_benchmarkInt(const char *name) {
+    size_t characters = 0;
+    int64_t sum = 0;
+    uint64_t start;
+    uint64_t elapsed;
+    size_t i;
+    size_t j;
+
+    for (j = 0; j < NUMBER_COUNT; j++) {
+        characters += (size_t)lengths[j];
+    }
+
+    start = benchmark_now();
+    for (i = 0; i < NUMBER_PARSE_ITERATIONS; i++) {
+        for (j = 0; j < NUMBER_COUNT; j++) {
+            int64_t value;
+
+            if (!utils_textToInt((const uint8_t *)texts[j], lengths[j], &value)) {
+                fprintf(stderr, "%s: parsing \"%s\" failed\n", name, texts[j]);
+                return;
+            }
+            sum += value;
+        }
+    }
+    elapsed = benchmark_now() - start;
+
+    if (sum == 1) printf("\n"); // keeps the loop from being optimized away
+    prv_report(name, characters, elapsed);
+}
+
+void benchmark_number_parse(void) {
+    size_t i;
+
+    // Temperatures with a resolution of 0.01 degree
+    for (i = 0; i < NUMBER_COUNT; i++) {
+        lengths[i] = snprintf(texts[i], NUMBER_TEXT_SIZE, "%.2f",
+                              (double)((int)(benchmark_random() % 6000) - 2000) / 100.0);
+    }
+    prv_benchmarkFloat("Text to float (sensor)");
+
+    // Latitudes with six decimals
+    for (i = 0; i < NUMBER_COUNT; i++) {
+        lengths[i] = snprintf(texts[i], NUMBER_TEXT_SIZE, "%.6f",
+                              (double)((int)(benchmark_random() % 180000000) - 90000000) / 1000000.0);
+    }
+    prv_benchmarkFloat("Text to float (location)");
+
+    // Any double, with all the digits needed to read it back
+    for (i = 0; i < NUMBER_COUNT; i++) {
+        uint64_t bits;
+        double value;
+
+        do {
+            bits = ((uint64_t)benchmark_random() << 32) | benchmark_random();
+        } while (((bits >> 52) & 0x7FF) == 0x7FF); // no infinities or NaN
+        memcpy(&value, &bits, sizeof(value));
+        lengths[i] = snprintf(texts[i], NUMBER_TEXT_SIZE, "%.17g", value);
+    }
+    prv_benchmarkFloat("Text to float (random)");
+
+    // Timestamps in seconds
+    for (i = 0; i < NUMBER_COUNT; i++) {
+        lengths[i] = snprintf(texts[i], NUMBER_TEXT_SIZE, "%u", 1700000000u + benchmark_random() % 100000000u);
+    }
+    prv_benchmarkInt("Text to integer (time)");
+
+    // Large counters
+    for (i = 0; i < NUMBER_COUNT; i++) {
+        lengths[i] = snprintf(texts[i], NUMBER_TEXT_SIZE, "%lld",
+                              (long long)(((uint64_t)benchmark_random() << 31) ^ benchmark_random()));
+    }
+    prv_benchmarkInt("Text to integer (64 bit)");
+}
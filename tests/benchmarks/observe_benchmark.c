@@ -0,0 +1,223 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+/*
+ * Cost of a client step with an increasing number of observed resources.
+ * Only the resources reported by lwm2m_resource_value_changed() or reaching
+ * their maximal period are read. The "all changed" case is the cost the
+ * previous polling engine paid on every step, whatever changed.
+ * The cost of registering the observations and of reporting one changed
+ * value is measured as well, as a gateway relaying sensor callbacks sees it.
+ */
+
+#include "benchmarks.h"
+#include "internals.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define OBSERVE_OBJECT_ID   3303
+#define OBSERVE_RESOURCE_ID 5700
+#define OBSERVE_STEPS       200
+#define OBSERVE_CHANGES     200000 // lwm2m_resource_value_changed() calls per benchmark
+#define OBSERVE_SERVERS     3
+
+static const size_t observedCounts[] = {1000, 10000};
+
+static size_t readCount;
+static double *values;
+
+static uint8_t prv_read(lwm2m_context_t *contextP, uint16_t instanceId, int *numDataP, lwm2m_data_t **dataArrayP,
+                        lwm2m_object_t *objectP) {
+    (void)contextP;
+    (void)objectP;
+
+    readCount++;
+    if (*numDataP == 0) {
+        *dataArrayP = lwm2m_data_new(1);
+        if (*dataArrayP == NULL) return COAP_500_INTERNAL_SERVER_ERROR;
+        *numDataP = 1;
+        (*dataArrayP)->id = OBSERVE_RESOURCE_ID;
+    }
+    lwm2m_data_encode_float(values[instanceId], *dataArrayP);
+    return COAP_205_CONTENT;
+}
+
+static void prv_uri(size_t index, lwm2m_uri_t *uriP) {
+    LWM2M_URI_RESET(uriP);
+    uriP->objectId = OBSERVE_OBJECT_ID;
+    uriP->instanceId = (uint16_t)index;
+    uriP->resourceId = OBSERVE_RESOURCE_ID;
+}
+
+static void prv_observe(lwm2m_context_t *contextP, lwm2m_server_t *serverP, size_t index) {
+    coap_packet_t message;
+    coap_packet_t response;
+    lwm2m_uri_t uri;
+    lwm2m_data_t *dataP;
+    uint8_t token[4];
+
+    token[0] = (uint8_t)index;
+    token[1] = (uint8_t)(index >> 8);
+    token[2] = (uint8_t)(index >> 16);
+    token[3] = (uint8_t)(index >> 24);
+
+    coap_init_message(&message, COAP_TYPE_CON, COAP_GET, (uint16_t)index);
+    coap_set_header_token(&message, token, sizeof(token));
+    coap_set_header_observe(&message, 0);
+    coap_init_message(&response, COAP_TYPE_ACK, COAP_205_CONTENT, (uint16_t)index);
+    coap_set_header_content_type(&response, LWM2M_CONTENT_TEXT);
+
+    dataP = lwm2m_data_new(1);
+    dataP->id = OBSERVE_RESOURCE_ID;
+    lwm2m_data_encode_float(values[index], dataP);
+
+    prv_uri(index, &uri);
+    observe_handleRequest(contextP, &uri, serverP, 1, dataP, &message, &response);
+    lwm2m_data_free(1, dataP);
+}
+
+static void prv_step(lwm2m_context_t *contextP) {
+    time_t timeout = 60;
+    int64_t timeoutMs = 60000;
+    time_t tv_sec = lwm2m_gettime();
+
+    observe_step(contextP, tv_sec, &timeout);
+    scheduler_step(contextP, tv_sec, scheduler_getTimeMs(), &timeoutMs);
+}
+
+static void prv_benchmarkSteps(lwm2m_context_t *contextP, size_t count, size_t changed, const char *name) {
+    uint64_t start;
+    uint64_t elapsed = 0;
+    size_t reads = 0;
+    size_t step;
+    size_t i;
+
+    for (step = 0; step < OBSERVE_STEPS; step++) {
+        size_t first = benchmark_random() % count;
+
+        // lwm2m_resource_value_changed() is called by the application, outside of the step
+        for (i = 0; i < changed; i++) {
+            lwm2m_uri_t uri;
+            size_t index = (first + i) % count;
+
+            values[index] += 1.0;
+            prv_uri(index, &uri);
+            lwm2m_resource_value_changed(contextP, &uri);
+        }
+
+        readCount = 0;
+        start = benchmark_now();
+        prv_step(contextP);
+        elapsed += benchmark_now() - start;
+        reads += readCount;
+    }
+
+    benchmark_report(name, count, OBSERVE_STEPS, elapsed);
+    printf("%-40s %8zu %12.1f reads/step\n", "", count, (double)reads / OBSERVE_STEPS);
+}
+
+static void prv_benchmarkValueChanged(lwm2m_context_t *contextP, size_t count) {
+    uint64_t start;
+    uint64_t elapsed;
+    size_t i;
+
+    start = benchmark_now();
+    for (i = 0; i < OBSERVE_CHANGES; i++) {
+        lwm2m_uri_t uri;
+
+        prv_uri(benchmark_random() % count, &uri);
+        lwm2m_resource_value_changed(contextP, &uri);
+    }
+    elapsed = benchmark_now() - start;
+    benchmark_report("resource value changed", count, OBSERVE_CHANGES, elapsed);
+
+    // notifies the changed values
+    prv_step(contextP);
+}
+
+static void prv_benchmarkSize(size_t count) {
+    lwm2m_context_t *contextP;
+    lwm2m_object_t object;
+    lwm2m_list_t *instances;
+    lwm2m_server_t servers[OBSERVE_SERVERS];
+    uint64_t start;
+    size_t i;
+
+    contextP = lwm2m_init(NULL);
+    values = (double *)lwm2m_malloc(count * sizeof(double));
+    instances = (lwm2m_list_t *)lwm2m_malloc(count * sizeof(lwm2m_list_t));
+    if (contextP == NULL || values == NULL || instances == NULL) {
+        fprintf(stderr, "allocation failed\n");
+        return;
+    }
+
+    memset(&object, 0, sizeof(object));
+    object.objID = OBSERVE_OBJECT_ID;
+    object.readFunc = prv_read;
+    for (i = 0; i < count; i++) {
+        instances[i].next = i + 1 < count ? &instances[i + 1] : NULL;
+        instances[i].id = (uint16_t)i;
+        values[i] = 20.0;
+    }
+    object.instanceList = instances;
+    contextP->objectList = &object;
+
+    memset(servers, 0, sizeof(servers));
+    for (i = 0; i < OBSERVE_SERVERS; i++) {
+        servers[i].sessionH = (void *)(i + 1);
+        servers[i].status = STATE_REGISTERED;
+    }
+
+    start = benchmark_now();
+    for (i = 0; i < count; i++) {
+        prv_observe(contextP, servers + 0, i);
+    }
+    benchmark_report("observe registration", count, count, benchmark_now() - start);
+    // activating the observations checks them once
+    prv_step(contextP);
+
+    prv_benchmarkValueChanged(contextP, count);
+
+    prv_benchmarkSteps(contextP, count, 0, "client step (nothing changed)");
+    prv_benchmarkSteps(contextP, count, count / 100, "client step (1% changed)");
+    prv_benchmarkSteps(contextP, count, count, "client step (all changed)");
+
+    // the same values notified to more servers
+    for (i = 0; i < count; i++) {
+        size_t j;
+
+        for (j = 1; j < OBSERVE_SERVERS; j++) {
+            prv_observe(contextP, servers + j, i);
+        }
+    }
+    prv_step(contextP);
+    prv_benchmarkSteps(contextP, count, count, "client step (all changed, 3 servers)");
+
+    contextP->objectList = NULL;
+    lwm2m_close(contextP);
+    lwm2m_free(instances);
+    lwm2m_free(values);
+}
+
+void benchmark_observe(void) {
+    size_t i;
+
+    for (i = 0; i < sizeof(observedCounts) / sizeof(observedCounts[0]); i++) {
+        prv_benchmarkSize(observedCounts[i]);
+    }
+}
@@ -18,6 +18,7 @@
 
 #include "tests.h"
 #include "CUnit/Basic.h"
+#include "connection.h"
 #include "internals.h"
 #include "liblwm2m.h"
 
@@ -28,7 +29,7 @@ static void handle_12345(lwm2m_block_data_t ** blk1,
     size_t bsize;
     uint8_t *resultBuffer = NULL;
 
-    uint8_t st = coap_block1_handler(blk1, uri, buffer, 5, 5, 0, true, &resultBuffer, &bsize);
+    uint8_t st = coap_block1_handler(blk1, uri, buffer, 5, 5, 0, true, 0, 0, &resultBuffer, &bsize);
     CU_ASSERT_EQUAL(st, COAP_231_CONTINUE)
     CU_ASSERT_PTR_NULL(resultBuffer)
 }
@@ -39,7 +40,7 @@ static void handle_67(lwm2m_block_data_t ** blk1,
     size_t bsize;
     uint8_t *resultBuffer = NULL;
 
-    uint8_t st = coap_block1_handler(blk1, uri, buffer, 2, 5, 1, false, &resultBuffer, &bsize);
+    uint8_t st = coap_block1_handler(blk1, uri, buffer, 2, 5, 1, false, 0, 0, &resultBuffer, &bsize);
     CU_ASSERT_EQUAL(st, NO_ERROR)
     CU_ASSERT_PTR_NOT_NULL(resultBuffer)
     CU_ASSERT_EQUAL(bsize, 7)
@@ -57,6 +58,763 @@ static void test_block1_nominal(void)
     free_block_data(blk1);
 }
 
+static void test_block1_size1(void)
+{
+    lwm2m_block_data_t * blk1 = NULL;
+    uint8_t block[16];
+    uint8_t *resultBuffer = NULL;
+    size_t bsize = 0;
+    uint8_t *firstBuffer;
+    uint32_t i;
+    uint8_t st;
+
+    // the Size1 option announces 10 blocks and a half, the buffer is allocated once
+    for (i = 0; i < 11; i++) {
+        memset(block, 'a' + i, sizeof(block));
+        st = coap_block1_handler(&blk1, "/5/0/0", block, i < 10 ? 16 : 8, 16, i, i < 10, 168, 0, &resultBuffer, &bsize);
+        if (i == 0) {
+            CU_ASSERT_PTR_NOT_NULL_FATAL(blk1)
+            CU_ASSERT_EQUAL(blk1->blockBufferCapacity, 168)
+            firstBuffer = blk1->blockBuffer;
+        }
+        CU_ASSERT_PTR_EQUAL(blk1->blockBuffer, firstBuffer)
+        CU_ASSERT_EQUAL(st, i < 10 ? COAP_231_CONTINUE : NO_ERROR)
+    }
+    CU_ASSERT_EQUAL(bsize, 168)
+    CU_ASSERT_PTR_EQUAL(resultBuffer, firstBuffer)
+    CU_ASSERT_EQUAL(resultBuffer[0], 'a')
+    CU_ASSERT_EQUAL(resultBuffer[16 * 5], 'f')
+    CU_ASSERT_EQUAL(resultBuffer[167], 'k')
+
+    free_block_data(blk1);
+}
+
+static void test_block1_size1_huge(void)
+{
+    lwm2m_block_data_t * blk1 = NULL;
+    uint8_t block[16];
+    uint8_t *resultBuffer = NULL;
+    size_t bsize = 0;
+    uint32_t i;
+    uint8_t st;
+
+    // a Size1 option announcing almost 4 GB does not allocate them
+    memset(block, 'a', sizeof(block));
+    st = coap_block1_handler(&blk1, "/5/0/0", block, 16, 16, 0, true, UINT32_MAX, 0, &resultBuffer, &bsize);
+    CU_ASSERT_EQUAL(st, COAP_231_CONTINUE)
+    CU_ASSERT_PTR_NOT_NULL_FATAL(blk1)
+    CU_ASSERT(blk1->blockBufferCapacity <= 16 * 16)
+
+    // the transfer goes on, the buffer grows with the blocks actually received
+    for (i = 1; i < 40; i++) {
+        st = coap_block1_handler(&blk1, "/5/0/0", block, 16, 16, i, i < 39, 0, 0, &resultBuffer, &bsize);
+        CU_ASSERT_EQUAL(st, i < 39 ? COAP_231_CONTINUE : NO_ERROR)
+    }
+    CU_ASSERT_EQUAL(bsize, 16 * 40)
+    CU_ASSERT(blk1->blockBufferCapacity < 2 * 16 * 40)
+
+    free_block_data(blk1);
+}
+
+static void test_block1_growth(void)
+{
+    lwm2m_block_data_t * blk1 = NULL;
+    uint8_t block[16];
+    uint8_t *resultBuffer = NULL;
+    size_t bsize = 0;
+    uint8_t *lastBuffer = NULL;
+    int reallocations = 0;
+    uint32_t i;
+    uint8_t st;
+
+    // without Size1, the buffer grows geometrically
+    for (i = 0; i < 1024; i++) {
+        memset(block, (uint8_t)i, sizeof(block));
+        st = coap_block1_handler(&blk1, "/5/0/0", block, 16, 16, i, i < 1023, 0, 0, &resultBuffer, &bsize);
+        CU_ASSERT_EQUAL(st, i < 1023 ? COAP_231_CONTINUE : NO_ERROR)
+        if (blk1->blockBuffer != lastBuffer) {
+            reallocations++;
+            lastBuffer = blk1->blockBuffer;
+        }
+    }
+    CU_ASSERT_EQUAL(reallocations, 11)
+    CU_ASSERT_EQUAL(bsize, 16 * 1024)
+    for (i = 0; i < 1024; i++) {
+        CU_ASSERT_EQUAL(resultBuffer[i * 16 + 15], (uint8_t)i)
+    }
+
+    free_block_data(blk1);
+}
+
+static void test_block1_max_size(void)
+{
+    lwm2m_block_data_t * blk1 = NULL;
+    uint8_t block[16];
+    uint8_t *resultBuffer = NULL;
+    size_t bsize = 0;
+    uint8_t st;
+
+    memset(block, 0, sizeof(block));
+
+    // an announced size above the maximum is refused at once
+    st = coap_block1_handler(&blk1, "/5/0/0", block, 16, 16, 0, true, 100, 64, &resultBuffer, &bsize);
+    CU_ASSERT_EQUAL(st, COAP_413_ENTITY_TOO_LARGE)
+    CU_ASSERT_PTR_NULL(blk1)
+
+    // the maximum is reached while receiving
+    st = coap_block1_handler(&blk1, "/5/0/0", block, 16, 16, 0, true, 0, 64, &resultBuffer, &bsize);
+    CU_ASSERT_EQUAL(st, COAP_231_CONTINUE)
+    st = coap_block1_handler(&blk1, "/5/0/0", block, 16, 16, 1, true, 0, 64, &resultBuffer, &bsize);
+    CU_ASSERT_EQUAL(st, COAP_231_CONTINUE)
+    st = coap_block1_handler(&blk1, "/5/0/0", block, 16, 16, 2, true, 0, 64, &resultBuffer, &bsize);
+    CU_ASSERT_EQUAL(st, COAP_231_CONTINUE)
+
+    // the maximum is shared by the transfers of the peer
+    st = coap_block1_handler(&blk1, "/5/0/1", block, 16, 16, 0, true, 32, 64, &resultBuffer, &bsize);
+    CU_ASSERT_EQUAL(st, COAP_413_ENTITY_TOO_LARGE)
+
+    st = coap_block1_handler(&blk1, "/5/0/0", block, 16, 16, 3, true, 0, 64, &resultBuffer, &bsize);
+    CU_ASSERT_EQUAL(st, COAP_231_CONTINUE)
+    st = coap_block1_handler(&blk1, "/5/0/0", block, 16, 16, 4, false, 0, 64, &resultBuffer, &bsize);
+    CU_ASSERT_EQUAL(st, COAP_413_ENTITY_TOO_LARGE)
+    CU_ASSERT_PTR_NULL(blk1)
+
+    // a complete transfer is released to make room for a new one
+    st = coap_block1_handler(&blk1, "/5/0/0", block, 16, 16, 0, true, 48, 64, &resultBuffer, &bsize);
+    CU_ASSERT_EQUAL(st, COAP_231_CONTINUE)
+    st = coap_block1_handler(&blk1, "/5/0/0", block, 16, 16, 1, false, 48, 64, &resultBuffer, &bsize);
+    CU_ASSERT_EQUAL(st, NO_ERROR)
+    st = coap_block1_handler(&blk1, "/5/0/1", block, 16, 16, 0, true, 48, 64, &resultBuffer, &bsize);
+    CU_ASSERT_EQUAL(st, COAP_231_CONTINUE)
+    CU_ASSERT_PTR_NOT_NULL_FATAL(blk1)
+    CU_ASSERT_PTR_NULL(blk1->next)
+
+    free_block_data(blk1);
+}
+
+static void test_block2_size2(void)
+{
+    lwm2m_block_data_t * blk2 = NULL;
+    uint8_t block[32];
+    uint8_t *resultBuffer = NULL;
+    size_t bsize = 0;
+    uint8_t st;
+
+    memset(block, 'x', sizeof(block));
+    st = coap_block2_handler(&blk2, 12, block, 32, 32, 0, true, 40, 0, &resultBuffer, &bsize);
+    CU_ASSERT_EQUAL(st, COAP_231_CONTINUE)
+    CU_ASSERT_PTR_NOT_NULL_FATAL(blk2)
+    CU_ASSERT_EQUAL(blk2->blockBufferCapacity, 40)
+    coap_block2_set_expected_mid(blk2, 12, 13);
+    st = coap_block2_handler(&blk2, 13, block, 8, 32, 1, false, 0, 0, &resultBuffer, &bsize);
+    CU_ASSERT_EQUAL(st, NO_ERROR)
+    CU_ASSERT_EQUAL(bsize, 40)
+    block2_delete(&blk2, 13);
+    CU_ASSERT_PTR_NULL(blk2)
+}
+
+static void test_size_options(void)
+{
+    coap_packet_t message;
+    coap_packet_t parsed;
+    uint8_t buffer[64];
+    size_t length;
+    uint32_t size = 0;
+
+    coap_init_message(&message, COAP_TYPE_CON, COAP_PUT, 1);
+    coap_set_header_block1(&message, 0, 1, 1024);
+    coap_set_header_size1(&message, 3000000);
+    coap_set_header_size(&message, 70000);
+    length = coap_serialize_message(&message, buffer);
+    CU_ASSERT_TRUE(length <= coap_serialize_get_size(&message))
+
+    CU_ASSERT_EQUAL_FATAL(coap_parse_message(&parsed, buffer, (uint16_t)length), NO_ERROR)
+    CU_ASSERT_TRUE(coap_get_header_size1(&parsed, &size))
+    CU_ASSERT_EQUAL(size, 3000000)
+    CU_ASSERT_TRUE(coap_get_header_size(&parsed, &size))
+    CU_ASSERT_EQUAL(size, 70000)
+    coap_free_header(&parsed);
+}
+
+#define STREAM_OBJECT_ID 5
+#define STREAM_BLOCK_SIZE 16
+
+typedef struct
+{
+    uint8_t value[128];
+    size_t length;      // bytes handed over
+    int chunks;
+    int lastChunks;
+    bool badOffset;
+} stream_state_t;
+
+static stream_state_t streamState;
+static uint8_t lastResponseCode;
+
+static uint8_t stream_write(lwm2m_context_t * contextP, lwm2m_uri_t * uriP, size_t offset, uint8_t * buffer, size_t length, bool last, lwm2m_object_t * objectP)
+{
+    (void)contextP;
+    (void)uriP;
+    (void)objectP;
+
+    if (offset != streamState.length || offset + length > sizeof(streamState.value))
+    {
+        streamState.badOffset = true;
+        return COAP_500_INTERNAL_SERVER_ERROR;
+    }
+    memcpy(streamState.value + offset, buffer, length);
+    streamState.length += length;
+    streamState.chunks++;
+    if (last) streamState.lastChunks++;
+    return COAP_204_CHANGED;
+}
+
+static int stream_send(uint8_t const * buffer, size_t length, void * userData)
+{
+    coap_packet_t packet;
+
+    (void)userData;
+    lastResponseCode = 0;
+    if (NO_ERROR == coap_parse_message(&packet, (uint8_t *)buffer, (uint16_t)length))
+    {
+        lastResponseCode = packet.code;
+        coap_free_header(&packet);
+    }
+    return 0;
+}
+
+static uint8_t stream_block(lwm2m_context_t * contextP, connection_t * connP, const char * uri, uint16_t contentType, uint8_t * payload, size_t length, uint32_t num, uint8_t more)
+{
+    coap_packet_t message;
+    uint8_t buffer[128];
+    size_t size;
+
+    coap_init_message(&message, COAP_TYPE_CON, COAP_PUT, (uint16_t)(100 + num));
+    coap_set_header_uri_path(&message, uri);
+    coap_set_header_content_type(&message, contentType);
+    coap_set_header_block1(&message, num, more, STREAM_BLOCK_SIZE);
+    coap_set_payload(&message, payload, length);
+    size = coap_serialize_message(&message, buffer);
+    coap_free_header(&message);
+
+    lwm2m_handle_packet(contextP, buffer, (int)size, connP);
+    return lastResponseCode;
+}
+
+// writes value block by block, with the given prefix before it
+static void stream_value(lwm2m_context_t * contextP, connection_t * connP, uint16_t contentType, const uint8_t * prefix, size_t prefixLength, const uint8_t * value, size_t valueLength)
+{
+    uint8_t payload[128];
+    size_t length = prefixLength + valueLength;
+    uint32_t num;
+
+    CU_ASSERT_FATAL(length <= sizeof(payload))
+    if (prefixLength != 0) memcpy(payload, prefix, prefixLength);
+    memcpy(payload + prefixLength, value, valueLength);
+    for (num = 0; num * STREAM_BLOCK_SIZE < length; num++)
+    {
+        size_t offset = num * STREAM_BLOCK_SIZE;
+        size_t blockLength = MIN(STREAM_BLOCK_SIZE, length - offset);
+        bool more = offset + blockLength < length;
+
+        CU_ASSERT_EQUAL(stream_block(contextP, connP, "/5/0/1", contentType, payload + offset, blockLength, num, more), more ? COAP_231_CONTINUE : COAP_204_CHANGED)
+        if (more)
+        {
+            // nothing is buffered while the value is received
+            CU_ASSERT_PTR_NOT_NULL_FATAL(contextP->serverList->blockData)
+            CU_ASSERT_PTR_NULL(contextP->serverList->blockData->blockBuffer)
+        }
+    }
+}
+
+static void test_block1_stream(void)
+{
+    lwm2m_context_t * contextP;
+    lwm2m_server_t server;
+    lwm2m_object_t object;
+    lwm2m_list_t instance;
+    connection_t connection;
+    uint8_t value[90];
+    uint8_t tlvHeader[3] = { 0xC8, 0x01, sizeof(value) };
+    uint8_t wrongHeader[3] = { 0xC8, 0x02, sizeof(value) };
+    size_t i;
+
+    for (i = 0; i < sizeof(value); i++) value[i] = (uint8_t)i;
+
+    contextP = lwm2m_init(NULL);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(contextP)
+    memset(&connection, 0, sizeof(connection));
+    connection.sendFunc = stream_send;
+    memset(&server, 0, sizeof(server));
+    server.sessionH = &connection;
+    server.status = STATE_REGISTERED;
+    contextP->serverList = &server;
+    memset(&instance, 0, sizeof(instance));
+    memset(&object, 0, sizeof(object));
+    object.objID = STREAM_OBJECT_ID;
+    object.instanceList = &instance;
+    object.blockWriteFunc = stream_write;
+    contextP->objectList = &object;
+
+    // TLV: the header of the resource is removed from the first chunk
+    memset(&streamState, 0, sizeof(streamState));
+    stream_value(contextP, &connection, LWM2M_CONTENT_TLV, tlvHeader, sizeof(tlvHeader), value, sizeof(value));
+    CU_ASSERT_FALSE(streamState.badOffset)
+    CU_ASSERT_EQUAL(streamState.chunks, 6)
+    CU_ASSERT_EQUAL(streamState.lastChunks, 1)
+    CU_ASSERT_EQUAL(streamState.length, sizeof(value))
+    CU_ASSERT_EQUAL(memcmp(streamState.value, value, sizeof(value)), 0)
+
+    // the retransmission of the last block is acknowledged, but not handed over again
+    CU_ASSERT_EQUAL(stream_block(contextP, &connection, "/5/0/1", LWM2M_CONTENT_TLV, value + 77, 13, 5, 0), COAP_204_CHANGED)
+    CU_ASSERT_EQUAL(streamState.chunks, 6)
+
+    // opaque
+    memset(&streamState, 0, sizeof(streamState));
+    stream_value(contextP, &connection, LWM2M_CONTENT_OPAQUE, NULL, 0, value, sizeof(value));
+    CU_ASSERT_FALSE(streamState.badOffset)
+    CU_ASSERT_EQUAL(streamState.chunks, 6)
+    CU_ASSERT_EQUAL(streamState.lastChunks, 1)
+    CU_ASSERT_EQUAL(memcmp(streamState.value, value, sizeof(value)), 0)
+
+    // a TLV header for another resource is refused
+    memset(&streamState, 0, sizeof(streamState));
+    memcpy(value, wrongHeader, sizeof(wrongHeader));
+    CU_ASSERT_EQUAL(stream_block(contextP, &connection, "/5/0/1", LWM2M_CONTENT_TLV, value, STREAM_BLOCK_SIZE, 0, 1), COAP_400_BAD_REQUEST)
+    CU_ASSERT_EQUAL(streamState.chunks, 0)
+
+    // a missing block aborts the transfer
+    CU_ASSERT_EQUAL(stream_block(contextP, &connection, "/5/0/1", LWM2M_CONTENT_OPAQUE, value, STREAM_BLOCK_SIZE, 0, 1), COAP_231_CONTINUE)
+    CU_ASSERT_EQUAL(stream_block(contextP, &connection, "/5/0/1", LWM2M_CONTENT_OPAQUE, value, STREAM_BLOCK_SIZE, 2, 1), COAP_408_REQ_ENTITY_INCOMPLETE)
+    CU_ASSERT_EQUAL(stream_block(contextP, &connection, "/5/0/1", LWM2M_CONTENT_OPAQUE, value, STREAM_BLOCK_SIZE, 3, 1), COAP_408_REQ_ENTITY_INCOMPLETE)
+    CU_ASSERT_EQUAL(streamState.chunks, 1)
+
+    // a value larger than announced by its TLV header is refused
+    memset(&streamState, 0, sizeof(streamState));
+    tlvHeader[2] = 20;
+    memcpy(value, tlvHeader, sizeof(tlvHeader));
+    CU_ASSERT_EQUAL(stream_block(contextP, &connection, "/5/0/1", LWM2M_CONTENT_TLV, value, STREAM_BLOCK_SIZE, 0, 1), COAP_231_CONTINUE)
+    CU_ASSERT_EQUAL(stream_block(contextP, &connection, "/5/0/1", LWM2M_CONTENT_TLV, value, STREAM_BLOCK_SIZE, 1, 0), COAP_400_BAD_REQUEST)
+    CU_ASSERT_PTR_NULL(server.blockData)
+
+    while (server.blockData != NULL)
+    {
+        lwm2m_block_data_t * next = server.blockData->next;
+        free_block_data(server.blockData);
+        server.blockData = next;
+    }
+    contextP->serverList = NULL;
+    contextP->objectList = NULL;
+    lwm2m_close(contextP);
+}
+
+static int multipleWrites;
+static int multipleInstances;
+
+static uint8_t multiple_write(lwm2m_context_t * contextP, uint16_t instanceId, int numData, lwm2m_data_t * dataArray, lwm2m_object_t * objectP, lwm2m_write_type_t writeType)
+{
+    (void)contextP;
+    (void)instanceId;
+    (void)objectP;
+    (void)writeType;
+
+    multipleWrites++;
+    if (numData == 1 && dataArray->id == 1 && dataArray->type == LWM2M_TYPE_MULTIPLE_RESOURCE)
+    {
+        multipleInstances = (int)dataArray->value.asChildren.count;
+    }
+    return COAP_204_CHANGED;
+}
+
+static void test_block1_stream_multiple(void)
+{
+    lwm2m_context_t * contextP;
+    lwm2m_server_t server;
+    lwm2m_object_t object;
+    lwm2m_list_t instance;
+    connection_t connection;
+    uint8_t payload[3 + 10 * 7];
+    size_t length = sizeof(payload);
+    uint32_t num;
+    size_t i;
+
+    // a Multiple Resource of 10 instances of 4 bytes
+    payload[0] = 0x88;
+    payload[1] = 0x01;
+    payload[2] = 10 * 7;
+    for (i = 0; i < 10; i++)
+    {
+        uint8_t * instanceP = payload + 3 + i * 7;
+
+        instanceP[0] = 0x48;
+        instanceP[1] = (uint8_t)i;
+        instanceP[2] = 4;
+        memset(instanceP + 3, (int)i, 4);
+    }
+
+    contextP = lwm2m_init(NULL);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(contextP)
+    memset(&connection, 0, sizeof(connection));
+    connection.sendFunc = stream_send;
+    memset(&server, 0, sizeof(server));
+    server.sessionH = &connection;
+    server.status = STATE_REGISTERED;
+    contextP->serverList = &server;
+    memset(&instance, 0, sizeof(instance));
+    memset(&object, 0, sizeof(object));
+    object.objID = STREAM_OBJECT_ID;
+    object.instanceList = &instance;
+    object.writeFunc = multiple_write;
+    object.blockWriteFunc = stream_write;
+    contextP->objectList = &object;
+
+    // not streamed but reassembled for writeFunc
+    memset(&streamState, 0, sizeof(streamState));
+    multipleWrites = 0;
+    multipleInstances = 0;
+    for (num = 0; num * STREAM_BLOCK_SIZE < length; num++)
+    {
+        size_t offset = num * STREAM_BLOCK_SIZE;
+        size_t blockLength = MIN(STREAM_BLOCK_SIZE, length - offset);
+        bool more = offset + blockLength < length;
+
+        CU_ASSERT_EQUAL(stream_block(contextP, &connection, "/5/0/1", LWM2M_CONTENT_TLV, payload + offset, blockLength, num, more), more ? COAP_231_CONTINUE : COAP_204_CHANGED)
+    }
+    CU_ASSERT_EQUAL(streamState.chunks, 0)
+    CU_ASSERT_EQUAL(multipleWrites, 1)
+    CU_ASSERT_EQUAL(multipleInstances, 10)
+
+    while (server.blockData != NULL)
+    {
+        lwm2m_block_data_t * next = server.blockData->next;
+        free_block_data(server.blockData);
+        server.blockData = next;
+    }
+    contextP->serverList = NULL;
+    contextP->objectList = NULL;
+    lwm2m_close(contextP);
+}
+
+#define LARGE_OBJECT_ID       1024
+#define LARGE_RESOURCE_COUNT  400
+#define LARGE_VALUE_LENGTH    250
+
+typedef struct
+{
+    uint8_t * payload;
+    size_t length;
+    uint8_t code;
+    uint8_t more;
+    uint32_t num;
+} large_read_state_t;
+
+static large_read_state_t largeState;
+
+static uint8_t large_read(lwm2m_context_t * contextP, uint16_t instanceId, int * numDataP, lwm2m_data_t ** dataArrayP, lwm2m_object_t * objectP)
+{
+    char value[LARGE_VALUE_LENGTH];
+    int i;
+
+    (void)contextP;
+    (void)instanceId;
+    (void)objectP;
+
+    if (*numDataP != 0) return COAP_404_NOT_FOUND;
+    *dataArrayP = lwm2m_data_new(LARGE_RESOURCE_COUNT);
+    if (*dataArrayP == NULL) return COAP_500_INTERNAL_SERVER_ERROR;
+    *numDataP = LARGE_RESOURCE_COUNT;
+    for (i = 0; i < LARGE_RESOURCE_COUNT; i++)
+    {
+        memset(value, 'a' + i % 26, sizeof(value));
+        (*dataArrayP)[i].id = (uint16_t)i;
+        lwm2m_data_encode_nstring(value, sizeof(value), *dataArrayP + i);
+    }
+    return COAP_205_CONTENT;
+}
+
+static int large_send(uint8_t const * buffer, size_t length, void * userData)
+{
+    coap_packet_t packet;
+    uint16_t size;
+
+    (void)userData;
+    largeState.code = 0;
+    if (NO_ERROR == coap_parse_message(&packet, (uint8_t *)buffer, (uint16_t)length))
+    {
+        largeState.code = packet.code;
+        largeState.more = 0;
+        if (coap_get_header_block2(&packet, &largeState.num, &largeState.more, &size, NULL)
+         && largeState.length == largeState.num * size)
+        {
+            memcpy(largeState.payload + largeState.length, packet.payload, packet.payload_len);
+            largeState.length += packet.payload_len;
+        }
+        coap_free_header(&packet);
+    }
+    return 0;
+}
+
+static void test_block2_large_read(void)
+{
+#ifdef LWM2M_SUPPORT_SENML_JSON
+    lwm2m_media_type_t format = LWM2M_CONTENT_SENML_JSON;
+#else
+    lwm2m_media_type_t format = LWM2M_CONTENT_JSON;
+#endif
+    lwm2m_context_t * contextP;
+    lwm2m_server_t server;
+    lwm2m_object_t object;
+    lwm2m_list_t instance;
+    connection_t connection;
+    lwm2m_uri_t uri;
+    lwm2m_data_t * dataP = NULL;
+    int size = 0;
+    uint8_t * expected;
+    int expectedLength;
+    uint32_t num;
+
+    contextP = lwm2m_init(NULL);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(contextP)
+    memset(&connection, 0, sizeof(connection));
+    connection.sendFunc = large_send;
+    memset(&server, 0, sizeof(server));
+    server.sessionH = &connection;
+    server.status = STATE_REGISTERED;
+    contextP->serverList = &server;
+    memset(&instance, 0, sizeof(instance));
+    memset(&object, 0, sizeof(object));
+    object.objID = LARGE_OBJECT_ID;
+    object.instanceList = &instance;
+    object.readFunc = large_read;
+    contextP->objectList = &object;
+
+    lwm2m_stringToUri("/1024/0", 7, &uri);
+    CU_ASSERT_EQUAL_FATAL(large_read(contextP, 0, &size, &dataP, &object), COAP_205_CONTENT)
+    expectedLength = lwm2m_data_serialize(&uri, size, dataP, &format, &expected);
+    lwm2m_data_free(size, dataP);
+    CU_ASSERT_FATAL(expectedLength > 100 * 1024)
+
+    memset(&largeState, 0, sizeof(largeState));
+    largeState.payload = (uint8_t *)lwm2m_malloc(expectedLength);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(largeState.payload)
+
+    // the first request has no block2 option, the following ones ask for the next block
+    largeState.more = 1;
+    for (num = 0; largeState.more != 0 && num * contextP->coapBlockSize <= (uint32_t)expectedLength; num++)
+    {
+        coap_packet_t message;
+        uint8_t buffer[64];
+        size_t length;
+
+        coap_init_message(&message, COAP_TYPE_CON, COAP_GET, (uint16_t)(200 + num));
+        coap_set_header_uri_path(&message, "/1024/0");
+        coap_set_header_accept(&message, format);
+        if (num != 0) coap_set_header_block2(&message, num, 0, contextP->coapBlockSize);
+        length = coap_serialize_message(&message, buffer);
+        coap_free_header(&message);
+
+        lwm2m_handle_packet(contextP, buffer, (int)length, &connection);
+        CU_ASSERT_EQUAL_FATAL(largeState.code, COAP_205_CONTENT)
+        CU_ASSERT_EQUAL_FATAL(largeState.num, num)
+    }
+    CU_ASSERT_EQUAL(largeState.more, 0)
+    CU_ASSERT_EQUAL_FATAL(largeState.length, (size_t)expectedLength)
+    CU_ASSERT_EQUAL(memcmp(largeState.payload, expected, expectedLength), 0)
+
+    lwm2m_free(largeState.payload);
+    lwm2m_free(expected);
+    contextP->serverList = NULL;
+    contextP->objectList = NULL;
+    lwm2m_close(contextP);
+}
+
+#define CLONE_PAYLOAD_LENGTH  80
+#define CLONE_BLOCK_SIZE      32
+
+typedef struct
+{
+    uint8_t code;
+    uint16_t mid;
+    uint8_t token[8];
+    uint8_t tokenLength;
+    char path[32];
+    char query[32];
+    bool hasBlock1;
+    bool hasBlock2;
+    uint32_t num;
+    uint8_t more;
+    uint16_t size;
+    uint8_t payload[CLONE_PAYLOAD_LENGTH];
+    size_t payloadLength;
+} clone_sent_t;
+
+static clone_sent_t cloneSent;
+
+static void clone_options_to_string(multi_option_t * optionP, char separator, char * buffer, size_t size)
+{
+    size_t length = 0;
+
+    buffer[0] = 0;
+    for ( ; optionP != NULL ; optionP = optionP->next)
+    {
+        CU_ASSERT_FATAL(length + optionP->len + 2 <= size)
+        buffer[length++] = separator;
+        memcpy(buffer + length, optionP->data, optionP->len);
+        length += optionP->len;
+        buffer[length] = 0;
+    }
+}
+
+static int clone_send(uint8_t const * buffer, size_t length, void * userData)
+{
+    coap_packet_t packet;
+
+    (void)userData;
+    memset(&cloneSent, 0, sizeof(cloneSent));
+    CU_ASSERT_EQUAL_FATAL(coap_parse_message(&packet, (uint8_t *)buffer, (uint16_t)length), NO_ERROR)
+    cloneSent.code = packet.code;
+    cloneSent.mid = packet.mid;
+    cloneSent.tokenLength = packet.token_len;
+    memcpy(cloneSent.token, packet.token, packet.token_len);
+    clone_options_to_string(packet.uri_path, '/', cloneSent.path, sizeof(cloneSent.path));
+    clone_options_to_string(packet.uri_query, '&', cloneSent.query, sizeof(cloneSent.query));
+    cloneSent.hasBlock1 = coap_get_header_block1(&packet, &cloneSent.num, &cloneSent.more, &cloneSent.size, NULL);
+    cloneSent.hasBlock2 = coap_get_header_block2(&packet, &cloneSent.num, &cloneSent.more, &cloneSent.size, NULL);
+    CU_ASSERT_FATAL(packet.payload_len <= sizeof(cloneSent.payload))
+    if (packet.payload_len != 0) memcpy(cloneSent.payload, packet.payload, packet.payload_len);
+    cloneSent.payloadLength = packet.payload_len;
+    coap_free_header(&packet);
+    return 0;
+}
+
+static lwm2m_context_t * clone_init(lwm2m_server_t * serverP, connection_t * connectionP)
+{
+    lwm2m_context_t * contextP;
+
+    contextP = lwm2m_init(NULL);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(contextP)
+    memset(connectionP, 0, sizeof(connection_t));
+    connectionP->sendFunc = clone_send;
+    memset(serverP, 0, sizeof(lwm2m_server_t));
+    serverP->sessionH = connectionP;
+    serverP->status = STATE_REGISTERED;
+    contextP->serverList = serverP;
+    return contextP;
+}
+
+// sends a request to /3/0/1?a=1&b=2 as the peer of the transaction clones
+static lwm2m_transaction_t * clone_request(lwm2m_context_t * contextP, connection_t * connectionP, coap_method_t method)
+{
+    lwm2m_transaction_t * transacP;
+    lwm2m_uri_t uri;
+    uint8_t token[2] = {0x12, 0x34};
+
+    CU_ASSERT_FATAL(lwm2m_stringToUri("/3/0/1", 6, &uri) != 0)
+    transacP = transaction_new(connectionP, method, NULL, &uri, contextP->nextMID++, sizeof(token), token);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(transacP)
+    coap_set_header_uri_query(transacP->message, "a=1&b=2");
+    transaction_add(contextP, transacP);
+    return transacP;
+}
+
+// answers the last message sent by the client
+static void clone_respond(lwm2m_context_t * contextP, connection_t * connectionP, uint8_t code, bool block2,
+                          uint32_t num, uint8_t more, uint8_t * payload, size_t payloadLength)
+{
+    coap_packet_t message;
+    uint8_t buffer[128];
+    size_t length;
+
+    coap_init_message(&message, COAP_TYPE_ACK, code, cloneSent.mid);
+    coap_set_header_token(&message, cloneSent.token, cloneSent.tokenLength);
+    if (block2)
+    {
+        coap_set_header_block2(&message, num, more, CLONE_BLOCK_SIZE);
+    }
+    else
+    {
+        coap_set_header_block1(&message, num, more, CLONE_BLOCK_SIZE);
+    }
+    coap_set_payload(&message, payload, payloadLength);
+    length = coap_serialize_message(&message, buffer);
+    CU_ASSERT_FATAL(length > 0)
+    lwm2m_handle_packet(contextP, buffer, (int)length, connectionP);
+}
+
+static void test_block2_next_request(void)
+{
+    lwm2m_context_t * contextP;
+    lwm2m_server_t server;
+    connection_t connection;
+    uint8_t block[CLONE_BLOCK_SIZE];
+    uint16_t mid;
+
+    contextP = clone_init(&server, &connection);
+    CU_ASSERT_EQUAL_FATAL(transaction_send(contextP, clone_request(contextP, &connection, COAP_GET)), 0)
+    CU_ASSERT_FALSE(cloneSent.hasBlock2)
+
+    // the follow-up GET carries the options of the first request
+    mid = cloneSent.mid;
+    memset(block, 'a', sizeof(block));
+    clone_respond(contextP, &connection, COAP_205_CONTENT, true, 0, 1, block, sizeof(block));
+    CU_ASSERT_EQUAL(cloneSent.code, COAP_GET)
+    CU_ASSERT_NOT_EQUAL(cloneSent.mid, mid)
+    CU_ASSERT_TRUE(cloneSent.hasBlock2)
+    CU_ASSERT_EQUAL(cloneSent.num, 1)
+    CU_ASSERT_EQUAL(cloneSent.size, CLONE_BLOCK_SIZE)
+    CU_ASSERT_STRING_EQUAL(cloneSent.path, "/3/0/1")
+    CU_ASSERT_STRING_EQUAL(cloneSent.query, "&a=1&b=2")
+
+    memset(block, 'b', sizeof(block));
+    clone_respond(contextP, &connection, COAP_205_CONTENT, true, 1, 0, block, 8);
+    CU_ASSERT_PTR_NULL(contextP->transactionList)
+
+    contextP->serverList = NULL;
+    lwm2m_close(contextP);
+}
+
+static void test_block1_retry(void)
+{
+    lwm2m_context_t * contextP;
+    lwm2m_server_t server;
+    connection_t connection;
+    lwm2m_transaction_t * transacP;
+    uint8_t payload[CLONE_PAYLOAD_LENGTH];
+    uint32_t num;
+
+    for (num = 0; num < CLONE_PAYLOAD_LENGTH; num++)
+    {
+        payload[num] = (uint8_t)num;
+    }
+    contextP = clone_init(&server, &connection);
+    transacP = clone_request(contextP, &connection, COAP_POST);
+    transaction_set_payload(contextP, transacP, payload, CLONE_PAYLOAD_LENGTH);
+    CU_ASSERT_EQUAL_FATAL(transaction_send(contextP, transacP), 0)
+    CU_ASSERT_FALSE(cloneSent.hasBlock1)
+    CU_ASSERT_EQUAL(cloneSent.payloadLength, CLONE_PAYLOAD_LENGTH)
+
+    // the peer only takes smaller blocks, each one is sent with the options of the first request
+    clone_respond(contextP, &connection, COAP_413_ENTITY_TOO_LARGE, false, 0, 0, NULL, 0);
+    for (num = 0; num * CLONE_BLOCK_SIZE < CLONE_PAYLOAD_LENGTH; num++)
+    {
+        CU_ASSERT_EQUAL_FATAL(cloneSent.code, COAP_POST)
+        CU_ASSERT_TRUE(cloneSent.hasBlock1)
+        CU_ASSERT_EQUAL_FATAL(cloneSent.num, num)
+        CU_ASSERT_EQUAL(cloneSent.size, CLONE_BLOCK_SIZE)
+        CU_ASSERT_STRING_EQUAL(cloneSent.path, "/3/0/1")
+        CU_ASSERT_STRING_EQUAL(cloneSent.query, "&a=1&b=2")
+        CU_ASSERT_EQUAL(cloneSent.payloadLength, MIN(CLONE_BLOCK_SIZE, CLONE_PAYLOAD_LENGTH - num * CLONE_BLOCK_SIZE))
+        CU_ASSERT_EQUAL(memcmp(cloneSent.payload, payload + num * CLONE_BLOCK_SIZE, cloneSent.payloadLength), 0)
+        clone_respond(contextP, &connection, cloneSent.more ? COAP_231_CONTINUE : COAP_204_CHANGED, false, num,
+                      cloneSent.more, NULL, 0);
+    }
+    CU_ASSERT_EQUAL(num, 3)
+    CU_ASSERT_PTR_NULL(contextP->transactionList)
+
+    contextP->serverList = NULL;
+    lwm2m_close(contextP);
+}
+
 // This test needs rework...
 /*
 static void test_block1_retransmit(void)
@@ -75,6 +833,17 @@ static void test_block1_retransmit(void)
 
 static struct TestTable table[] = {
         { "test of test_block1_nominal()", test_block1_nominal },
+        { "test of block1 preallocation from Size1", test_block1_size1 },
+        { "test of block1 with a huge Size1", test_block1_size1_huge },
+        { "test of block1 buffer growth", test_block1_growth },
+        { "test of block1 maximal size", test_block1_max_size },
+        { "test of block2 preallocation from Size2", test_block2_size2 },
+        { "test of Size1 and Size2 options", test_size_options },
+        { "test of streamed block1 writes", test_block1_stream },
+        { "test of block1 writes of a multiple resource with blockWriteFunc", test_block1_stream_multiple },
+        { "test of a large read through block2", test_block2_large_read },
+        { "test of the request for the next block2", test_block2_next_request },
+        { "test of a block1 retry with smaller blocks", test_block1_retry },
         //{ "test of test_block1_retransmit()", test_block1_retransmit },
         { NULL, NULL },
 };
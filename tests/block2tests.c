@@ -0,0 +1,254 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+/*
+ * A client answers a read larger than a block with the first block and keeps
+ * the representation: the next blocks requested by the server must be sliced
+ * from it without reading the object again.
+ */
+
+#include "tests.h"
+#include "CUnit/Basic.h"
+#include "connection.h"
+#include "internals.h"
+#include "liblwm2m.h"
+
+#define BLOCK2_OBJECT_ID      3303
+#define BLOCK2_INSTANCE_COUNT 8
+#define BLOCK2_BLOCK_SIZE     64
+#define BLOCK2_BUFFER_SIZE    4096
+#define BLOCK2_NONE           UINT32_MAX // read without Block2 option
+
+static int readCount;
+
+// last response sent by the client
+static uint8_t lastCode;
+static uint32_t lastBlockNum;
+static bool lastBlockMore;
+static uint8_t lastETag[COAP_ETAG_LEN];
+static uint8_t lastETagLength;
+static uint8_t received[BLOCK2_BUFFER_SIZE];
+static size_t receivedLength;
+
+static int block2_send(uint8_t const *buffer, size_t length, void *userData) {
+    coap_packet_t packet;
+
+    (void)userData;
+    lastCode = 0;
+    if (NO_ERROR != coap_parse_message(&packet, (uint8_t *)buffer, (uint16_t)length)) return 0;
+
+    lastCode = packet.code;
+    lastBlockNum = 0;
+    lastBlockMore = false;
+    if (IS_OPTION(&packet, COAP_OPTION_BLOCK2)) {
+        lastBlockNum = packet.block2_num;
+        lastBlockMore = packet.block2_more != 0;
+        receivedLength = (size_t)packet.block2_num * packet.block2_size;
+    } else {
+        receivedLength = 0;
+    }
+    lastETagLength = IS_OPTION(&packet, COAP_OPTION_ETAG) ? packet.etag_len : 0;
+    memcpy(lastETag, packet.etag, lastETagLength);
+    if (receivedLength + packet.payload_len <= sizeof(received)) {
+        memcpy(received + receivedLength, packet.payload, packet.payload_len);
+        receivedLength += packet.payload_len;
+    }
+    coap_free_header(&packet);
+    return 0;
+}
+
+static uint8_t block2_read(lwm2m_context_t *contextP, uint16_t instanceId, int *numDataP, lwm2m_data_t **dataArrayP,
+                           lwm2m_object_t *objectP) {
+    (void)contextP;
+    (void)objectP;
+
+    readCount++;
+    if (*numDataP != 0) return COAP_404_NOT_FOUND;
+
+    *dataArrayP = lwm2m_data_new(2);
+    if (*dataArrayP == NULL) return COAP_500_INTERNAL_SERVER_ERROR;
+    *numDataP = 2;
+    (*dataArrayP)[0].id = 5700;
+    lwm2m_data_encode_int(instanceId, *dataArrayP + 0);
+    (*dataArrayP)[1].id = 5750;
+    lwm2m_data_encode_string("a description long enough to spread the object over many blocks", *dataArrayP + 1);
+
+    return COAP_205_CONTENT;
+}
+
+static void send_read(lwm2m_context_t *contextP, connection_t *connectionP, lwm2m_media_type_t format,
+                      uint32_t blockNum) {
+    static uint16_t mid = 2000;
+    coap_packet_t message;
+    uint8_t buffer[128];
+    size_t length;
+
+    coap_init_message(&message, COAP_TYPE_CON, COAP_GET, mid++);
+    coap_set_header_uri_path(&message, "/3303");
+    coap_set_header_accept(&message, format);
+    if (blockNum != BLOCK2_NONE) coap_set_header_block2(&message, blockNum, 0, BLOCK2_BLOCK_SIZE);
+    length = coap_serialize_message(&message, buffer);
+    coap_free_header(&message);
+    CU_ASSERT_FATAL(length > 0)
+
+    lwm2m_handle_packet(contextP, buffer, (int)length, connectionP);
+}
+
+static lwm2m_context_t *block2_init(lwm2m_server_t *serverP, lwm2m_object_t *objectP, lwm2m_list_t *instances,
+                                    connection_t *connectionP) {
+    lwm2m_context_t *contextP;
+    uint16_t i;
+
+    contextP = lwm2m_init(NULL);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(contextP)
+    memset(connectionP, 0, sizeof(*connectionP));
+    connectionP->sendFunc = block2_send;
+    memset(serverP, 0, sizeof(*serverP));
+    serverP->sessionH = connectionP;
+    serverP->status = STATE_REGISTERED;
+    contextP->serverList = serverP;
+    memset(instances, 0, BLOCK2_INSTANCE_COUNT * sizeof(lwm2m_list_t));
+    for (i = 0; i < BLOCK2_INSTANCE_COUNT; i++) {
+        instances[i].id = i;
+        instances[i].next = i + 1 < BLOCK2_INSTANCE_COUNT ? instances + i + 1 : NULL;
+    }
+    memset(objectP, 0, sizeof(*objectP));
+    objectP->objID = BLOCK2_OBJECT_ID;
+    objectP->instanceList = instances;
+    objectP->readFunc = block2_read;
+    contextP->objectList = objectP;
+
+    return contextP;
+}
+
+static void block2_close(lwm2m_context_t *contextP, lwm2m_server_t *serverP) {
+    while (serverP->blockData != NULL) {
+        lwm2m_block_data_t *blockData = serverP->blockData;
+
+        serverP->blockData = blockData->next;
+        free_block_data(blockData);
+    }
+    contextP->serverList = NULL;
+    contextP->objectList = NULL;
+    lwm2m_close(contextP);
+}
+
+static void test_block2_read_once(void) {
+    lwm2m_context_t *contextP;
+    lwm2m_server_t server;
+    lwm2m_object_t object;
+    lwm2m_list_t instances[BLOCK2_INSTANCE_COUNT];
+    connection_t connection;
+    uint8_t expected[BLOCK2_BUFFER_SIZE];
+    size_t expectedLength;
+    uint8_t etag[COAP_ETAG_LEN];
+    uint8_t etagLength;
+    uint32_t blockNum;
+
+    contextP = block2_init(&server, &object, instances, &connection);
+
+    // the whole representation in a single block
+    readCount = 0;
+    send_read(contextP, &connection, LWM2M_CONTENT_TLV, BLOCK2_NONE);
+    CU_ASSERT_EQUAL(lastCode, COAP_205_CONTENT)
+    CU_ASSERT_EQUAL(readCount, BLOCK2_INSTANCE_COUNT)
+    CU_ASSERT_FALSE(lastBlockMore)
+    CU_ASSERT_EQUAL(lastETagLength, 0)
+    CU_ASSERT_PTR_NULL(server.blockData)
+    CU_ASSERT_FATAL(receivedLength > 4 * BLOCK2_BLOCK_SIZE)
+    memcpy(expected, received, receivedLength);
+    expectedLength = receivedLength;
+
+    // one read whatever the number of blocks
+    CU_ASSERT_TRUE_FATAL(lwm2m_context_set_coap_block_size(contextP, BLOCK2_BLOCK_SIZE))
+    readCount = 0;
+    send_read(contextP, &connection, LWM2M_CONTENT_TLV, 0);
+    CU_ASSERT_EQUAL(lastCode, COAP_205_CONTENT)
+    CU_ASSERT_TRUE(lastBlockMore)
+    CU_ASSERT_EQUAL_FATAL(lastETagLength, 4)
+    memcpy(etag, lastETag, lastETagLength);
+    etagLength = lastETagLength;
+    for (blockNum = 1; lastBlockMore && blockNum < 100; blockNum++) {
+        send_read(contextP, &connection, LWM2M_CONTENT_TLV, blockNum);
+        CU_ASSERT_EQUAL(lastCode, COAP_205_CONTENT)
+        CU_ASSERT_EQUAL(lastBlockNum, blockNum)
+        CU_ASSERT_EQUAL(lastETagLength, etagLength)
+        CU_ASSERT_EQUAL(memcmp(lastETag, etag, etagLength), 0)
+    }
+    CU_ASSERT_FALSE(lastBlockMore)
+    CU_ASSERT_EQUAL(blockNum, (expectedLength + BLOCK2_BLOCK_SIZE - 1) / BLOCK2_BLOCK_SIZE)
+    CU_ASSERT_EQUAL(readCount, BLOCK2_INSTANCE_COUNT)
+    CU_ASSERT_EQUAL(receivedLength, expectedLength)
+    CU_ASSERT_EQUAL(memcmp(received, expected, expectedLength), 0)
+    // dropped with the last block
+    CU_ASSERT_PTR_NULL(server.blockData)
+
+    block2_close(contextP, &server);
+}
+
+static void test_block2_read_again(void) {
+    lwm2m_context_t *contextP;
+    lwm2m_server_t server;
+    lwm2m_object_t object;
+    lwm2m_list_t instances[BLOCK2_INSTANCE_COUNT];
+    connection_t connection;
+    uint8_t etag[COAP_ETAG_LEN];
+
+    contextP = block2_init(&server, &object, instances, &connection);
+    CU_ASSERT_TRUE_FATAL(lwm2m_context_set_coap_block_size(contextP, BLOCK2_BLOCK_SIZE))
+
+    readCount = 0;
+    send_read(contextP, &connection, LWM2M_CONTENT_TLV, 0);
+    CU_ASSERT_EQUAL_FATAL(lastETagLength, 4)
+    memcpy(etag, lastETag, lastETagLength);
+
+    // a new transfer gets a new representation
+    send_read(contextP, &connection, LWM2M_CONTENT_TLV, 0);
+    CU_ASSERT_EQUAL(readCount, 2 * BLOCK2_INSTANCE_COUNT)
+    CU_ASSERT_EQUAL_FATAL(lastETagLength, 4)
+    CU_ASSERT_NOT_EQUAL(memcmp(lastETag, etag, 4), 0)
+    memcpy(etag, lastETag, lastETagLength);
+
+    send_read(contextP, &connection, LWM2M_CONTENT_TLV, 1);
+    CU_ASSERT_EQUAL(lastCode, COAP_205_CONTENT)
+    CU_ASSERT_EQUAL(readCount, 2 * BLOCK2_INSTANCE_COUNT)
+    CU_ASSERT_EQUAL(memcmp(lastETag, etag, 4), 0)
+
+    // the cached representation is in another format
+    send_read(contextP, &connection, LWM2M_CONTENT_JSON, 1);
+    CU_ASSERT_EQUAL(lastCode, COAP_205_CONTENT)
+    CU_ASSERT_EQUAL(readCount, 3 * BLOCK2_INSTANCE_COUNT)
+    CU_ASSERT_NOT_EQUAL(memcmp(lastETag, etag, 4), 0)
+
+    block2_close(contextP, &server);
+}
+
+static struct TestTable table[] = {
+    {"test of a block-wise read served from one read", test_block2_read_once},
+    {"test of block-wise reads read again", test_block2_read_again},
+    {NULL, NULL},
+};
+
+CU_ErrorCode create_block2_suit() {
+    CU_pSuite pSuite = NULL;
+
+    pSuite = CU_add_suite("Suite_block2", NULL, NULL);
+    if (NULL == pSuite) {
+        return CU_get_error();
+    }
+    return add_tests(pSuite, table);
+}
@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <inttypes.h>
 #include <float.h>
+#include <math.h>
 
 static const int64_t ints[]={12, -114 , 1 , 134 , 43243 , 0, -215025, INT64_MIN, INT64_MAX};
 static const char* ints_text[] = {"12","-114","1", "134", "43243","0","-215025", "-9223372036854775808", "9223372036854775807"};
@@ -34,7 +35,7 @@ static const uint64_t uints[]={12, 1 , 134 , 43243 , 0, UINT64_MAX};
 static const char* uints_text[] = {"12","1", "134", "43243","0","18446744073709551615"};
 static const double floats[]={12, -114 , -30 , 1.02 , 134.000235 , 0.43243 , 0, -21.5025, -0.0925, 0.98765, 6.667e-11, 56.789, -52.0006, FLT_MIN, FLT_MAX, DBL_MIN, DBL_MAX};
 static const char* floats_text[] = {"12.0","-114.0","-30.0", "1.02", "134.000235","0.43243","0.0","-21.5025","-0.0925","0.98765", "0.00000000006667", "56.789", "-52.0006", "0.00000000000000000000000000000000000001175494", "340282346638528859811704183484516925440.0", "0.00000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000002225073858", "179769313486231570814527423731704356798070567525844996598917476803157260780028538760589558632766878171540458953514382464234321326889464182768467546703537516986049910576551282076245490090389328944075868508455133942304583236903222948165808559332123348274797826204144723168738177180919299881250404026184124858368.0"};
-static const char* floats_exponential[] = {"12.0","-114.0","-30.0", "1.02", "134.000235","0.43243","0.0","-21.5025","-0.0925","0.98765", "6.667e-11", "56.789", "-52.0006", "1.17549435082229e-38", "3.40282346638529e38", "2.2250738585072e-308", "1.7976931348623e308"};
+static const char* floats_exponential[] = {"12.0","-114.0","-30.0", "1.02", "134.000235","0.43243","0.0","-21.5025","-0.0925","0.98765", "6.667e-11", "56.789", "-52.0006", "1.1754943508222875e-38", "3.4028234663852886e38", "2.2250738585072014e-308", "1.7976931348623157e308"};
 
 static void test_utils_textToInt(void)
 {
@@ -165,6 +166,172 @@ static void test_utils_textToFloatUnwantedExponential(void)
     CU_ASSERT_FALSE(utils_textToFloat((const uint8_t *)with_exponential_E, strlen(with_exponential_E), &res, false))
 }
 
+static uint64_t prv_randomBits(uint64_t * stateP)
+{
+    /* xorshift64 */
+    *stateP ^= *stateP << 13;
+    *stateP ^= *stateP >> 7;
+    *stateP ^= *stateP << 17;
+    return *stateP;
+}
+
+static bool prv_parsesLikeStrtod(const char * text)
+{
+    double expected;
+    double res;
+
+    expected = strtod(text, NULL);
+    if (!utils_textToFloat((const uint8_t *)text, (int)strlen(text), &res, true))
+    {
+        printf("\"%s\" -> not converted\n", text);
+        return false;
+    }
+    /* Bit identical, including the sign */
+    if (memcmp(&res, &expected, sizeof(res)) != 0)
+    {
+        printf("\"%s\" -> fail (%.17g instead of %.17g)\n", text, res, expected);
+        return false;
+    }
+    return true;
+}
+
+static void test_utils_textToFloatCorrectRounding(void)
+{
+    static const char * texts[] = {
+        "9007199254740993",                 /* halfway between two doubles, rounds to even */
+        "9007199254740995",
+        "9007199254740993.0000000001",      /* just above halfway */
+        "1e23",
+        "8.98846567431158e307",
+        "1.7976931348623157e308",
+        "1.7976931348623158e308",           /* rounds down to DBL_MAX */
+        "1.7976931348623159e308",           /* overflows */
+        "2.2250738585072014e-308",
+        "2.2250738585072011e-308",          /* largest subnormal */
+        "4.9406564584124654e-324",
+        "2.4703282292062327e-324",          /* underflows to 0 */
+        "0.1000000000000000055511151231257827",
+        "123456789012345678901234567890",
+        "0.000000000000000000000000000000000000000000001",
+        "-0.0",
+        "+12.5",
+        " 42",
+        "1e",
+        "1e+",
+        "1.5e-3x",
+        "0x1p-2",
+        "inf",
+        "-nan",
+        "000000000000000000000000000000000000123.456",
+        "12345678.87654321",
+        "1234567890123456789",
+        "12345678901234567890",
+        "1234567812345678e-300",
+    };
+    uint64_t state = 0x2545F4914F6CDD1D;
+    size_t failures = 0;
+    size_t i;
+
+    for (i = 0; i < sizeof(texts)/sizeof(texts[0]); i++)
+    {
+        if (!prv_parsesLikeStrtod(texts[i])) failures++;
+    }
+
+    /* Random decimal strings with up to 25 digits and any exponent */
+    for (i = 0; i < 200000; i++)
+    {
+        char text[48];
+        size_t head = 0;
+        int digits = (int)(prv_randomBits(&state) % 25) + 1;
+        int point = (int)(prv_randomBits(&state) % (digits + 1));
+        int j;
+
+        if (prv_randomBits(&state) & 1) text[head++] = '-';
+        for (j = 0; j < digits; j++)
+        {
+            if (j == point && j > 0) text[head++] = '.';
+            text[head++] = (char)('0' + prv_randomBits(&state) % 10);
+        }
+        text[head] = '\0';
+        if (prv_randomBits(&state) & 1)
+        {
+            snprintf(text + head, sizeof(text) - head, "e%d", (int)(prv_randomBits(&state) % 700) - 350);
+        }
+        if (!prv_parsesLikeStrtod(text)) failures++;
+    }
+
+    /* Random doubles printed with all the digits needed to read them back */
+    for (i = 0; i < 200000; i++)
+    {
+        char text[32];
+        uint64_t bits = prv_randomBits(&state);
+        double value;
+        double res;
+
+        memcpy(&value, &bits, sizeof(value));
+        if (isnan(value) || isinf(value)) continue;
+        snprintf(text, sizeof(text), "%.17g", value);
+        if (!utils_textToFloat((const uint8_t *)text, (int)strlen(text), &res, true)
+         || memcmp(&res, &value, sizeof(res)) != 0)
+        {
+            printf("\"%s\" -> fail\n", text);
+            failures++;
+        }
+    }
+
+    CU_ASSERT_EQUAL(failures, 0)
+}
+
+static void test_utils_textToIntRoundTrip(void)
+{
+    static const char * invalid[] = {
+        "", "-", "+1", "1-", "12a", " 1", "1.0",
+        "9223372036854775808", "-9223372036854775809", "99999999999999999999",
+        "123456789012345678901234567890",
+    };
+    static const char * invalidUnsigned[] = {
+        "", "-1", "18446744073709551616", "18446744073709551620", "184467440737095516150", "1234567a",
+    };
+    uint64_t state = 0x9E3779B97F4A7C15;
+    int64_t value;
+    uint64_t uvalue;
+    size_t i;
+
+    for (i = 0; i < sizeof(invalid)/sizeof(invalid[0]); i++)
+    {
+        CU_ASSERT_FALSE(utils_textToInt((const uint8_t *)invalid[i], (int)strlen(invalid[i]), &value))
+    }
+    for (i = 0; i < sizeof(invalidUnsigned)/sizeof(invalidUnsigned[0]); i++)
+    {
+        CU_ASSERT_FALSE(utils_textToUInt((const uint8_t *)invalidUnsigned[i], (int)strlen(invalidUnsigned[i]), &uvalue))
+    }
+
+    CU_ASSERT(utils_textToInt((const uint8_t *)"-0000000000000000000000042", 26, &value))
+    CU_ASSERT_EQUAL(value, -42)
+    CU_ASSERT(utils_textToUInt((const uint8_t *)"18446744073709551615", 20, &uvalue))
+    CU_ASSERT_EQUAL(uvalue, UINT64_MAX)
+
+    for (i = 0; i < 100000; i++)
+    {
+        uint8_t text[24];
+        uint64_t bits = prv_randomBits(&state);
+        int64_t expected;
+        size_t len;
+
+        /* Any length from 1 to 20 digits */
+        bits >>= prv_randomBits(&state) % 64;
+        memcpy(&expected, &bits, sizeof(expected));
+
+        len = utils_intToText(expected, text, sizeof(text));
+        CU_ASSERT(utils_textToInt(text, (int)len, &value))
+        CU_ASSERT_EQUAL(value, expected)
+
+        len = utils_uintToText(bits, text, sizeof(text));
+        CU_ASSERT(utils_textToUInt(text, (int)len, &uvalue))
+        CU_ASSERT_EQUAL(uvalue, bits)
+    }
+}
+
 static void test_utils_textToObjLink(void)
 {
     uint16_t objectId;
@@ -384,6 +551,140 @@ static void test_utils_floatToTextExponential(void)
     }
 }
 
+static void test_utils_floatToTextShortest(void)
+{
+    static const double values[] = {0.1, 0.3, 1.0/3.0, 2.0/3.0, 20.5, 1e-3, 9.999e-4, 1e15, 1e16, 1e20, 123456789012345678.0, 4.35, 5e-324, -1e-5};
+    static const char* plain[] = {"0.1", "0.3", "0.3333333333333333", "0.6666666666666666", "20.5", "0.001", "0.0009999", "1000000000000000.0", "10000000000000000.0", "100000000000000000000.0", "123456789012345680.0", "4.35", NULL, "-0.00001"};
+    static const char* exponential[] = {"0.1", "0.3", "0.3333333333333333", "0.6666666666666666", "20.5", "0.001", "9.999e-4", "1000000000000000.0", "1.0e16", "1.0e20", "1.2345678901234568e17", "4.35", "5.0e-324", "-1.0e-5"};
+    char res[400];
+    size_t i;
+    size_t len;
+
+    for (i = 0 ; i < sizeof(values)/sizeof(values[0]); i++)
+    {
+        if (plain[i] != NULL)
+        {
+            len = utils_floatToText(values[i], (uint8_t*)res, sizeof(res), false);
+            CU_ASSERT_EQUAL(len, strlen(plain[i]))
+            CU_ASSERT_NSTRING_EQUAL(res, plain[i], len)
+            if (len != strlen(plain[i]) || strncmp(res, plain[i], len))
+                printf("%zu \"%.17g\" -> fail (%.*s)\n", i, values[i], (int)len, res);
+        }
+
+        len = utils_floatToText(values[i], (uint8_t*)res, sizeof(res), true);
+        CU_ASSERT_EQUAL(len, strlen(exponential[i]))
+        CU_ASSERT_NSTRING_EQUAL(res, exponential[i], len)
+        if (len != strlen(exponential[i]) || strncmp(res, exponential[i], len))
+            printf("%zu \"%.17g\" -> fail (%.*s)\n", i, values[i], (int)len, res);
+    }
+}
+
+static bool prv_floatRoundTrips(double value, bool allowExponential)
+{
+    char text[400];
+    size_t len;
+    size_t i;
+    int first = -1;
+    int last = -1;
+    int digits = 0;
+    double res;
+
+    len = utils_floatToText(value, (uint8_t*)text, sizeof(text), allowExponential);
+    if (len == 0 || len >= sizeof(text)) return false;
+    if (!utils_textToFloat((uint8_t*)text, (int)len, &res, allowExponential)) return false;
+
+    /* Never more significant digits than a double needs */
+    for (i = 0; i < len && text[i] != 'e'; i++)
+    {
+        if (text[i] >= '0' && text[i] <= '9')
+        {
+            if (first < 0 && text[i] != '0') first = (int)i;
+            if (text[i] != '0') last = (int)i;
+        }
+    }
+    for (i = first; (int)i <= last; i++)
+    {
+        if (text[i] != '.') digits++;
+    }
+    if (digits > 17)
+    {
+        printf("\"%.17g\" -> too many digits (%.*s)\n", value, (int)len, text);
+        return false;
+    }
+
+    /* Bit identical, including the sign */
+    if (memcmp(&res, &value, sizeof(res)) != 0)
+    {
+        printf("\"%.17g\" -> fail (%.*s)\n", value, (int)len, text);
+        return false;
+    }
+    return true;
+}
+
+static void test_utils_floatToTextRoundTrip(void)
+{
+    uint64_t state = 0x9E3779B97F4A7C15;
+    size_t failures = 0;
+    size_t i;
+    int exponent;
+
+    for (i = 0; i < 200000; i++)
+    {
+        uint64_t bits;
+        double value;
+
+        /* xorshift64 over random bit patterns, covering subnormals and all exponents */
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        bits = state;
+        memcpy(&value, &bits, sizeof(value));
+        if (isnan(value) || isinf(value)) continue;
+
+        if (!prv_floatRoundTrips(value, true)) failures++;
+        if (!prv_floatRoundTrips(value, false)) failures++;
+    }
+
+    /* Powers of two and ten are where the boundaries are asymmetric or the
+     * digits are shortest, and their neighbours where they are the longest. */
+    for (exponent = 1; exponent < 0x7FF; exponent++)
+    {
+        uint64_t bits = (uint64_t)exponent << 52;
+        double value;
+
+        memcpy(&value, &bits, sizeof(value));
+        if (!prv_floatRoundTrips(value, true)) failures++;
+        bits--;
+        memcpy(&value, &bits, sizeof(value));
+        if (!prv_floatRoundTrips(value, true)) failures++;
+        bits += 2;
+        memcpy(&value, &bits, sizeof(value));
+        if (!prv_floatRoundTrips(-value, false)) failures++;
+    }
+    for (exponent = -323; exponent <= 308; exponent++)
+    {
+        char text[8];
+        double value;
+        uint64_t bits;
+
+        snprintf(text, sizeof(text), "1e%d", exponent);
+        value = strtod(text, NULL);
+        if (!prv_floatRoundTrips(value, true)) failures++;
+        if (!prv_floatRoundTrips(value, false)) failures++;
+        memcpy(&bits, &value, sizeof(bits));
+        bits++;
+        memcpy(&value, &bits, sizeof(value));
+        if (!prv_floatRoundTrips(value, true)) failures++;
+        if (!prv_floatRoundTrips(value, false)) failures++;
+    }
+    for (i = 1; i <= 100000; i++)
+    {
+        if (!prv_floatRoundTrips((double)i / 1000.0, true)) failures++;
+    }
+
+    CU_ASSERT_EQUAL(failures, 0)
+}
+
 static void test_utils_objLinkToText(void)
 {
     uint8_t text[12];
@@ -428,6 +729,82 @@ static void test_utils_base64(void)
     }
 }
 
+// bit by bit encoding to compare with
+static size_t prv_base64Reference(const uint8_t *binary, size_t length, char *base64)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t head = 0;
+    size_t i;
+
+    for (i = 0; i < length * 8; i += 6)
+    {
+        unsigned int value = 0;
+        size_t bit;
+
+        for (bit = i; bit < i + 6; bit++)
+        {
+            value <<= 1;
+            if (bit < length * 8 && (binary[bit / 8] & (0x80 >> (bit % 8))) != 0) value |= 1;
+        }
+        base64[head++] = alphabet[value];
+    }
+    while (head % 4 != 0) base64[head++] = '=';
+
+    return head;
+}
+
+static void test_utils_base64Bulk(void)
+{
+    const char invalid[] = { '-', '_', ' ', '\n', '.', (char)0xC1 };
+    uint8_t binary[100];
+    char expected[140];
+    uint8_t encoded[140];
+    uint8_t decoded[100];
+    uint64_t state = 7;
+    size_t length;
+
+    for (length = 0; length <= sizeof(binary); length++)
+    {
+        size_t expectedLength;
+        size_t i;
+
+        for (i = 0; i < length; i++) binary[i] = (uint8_t)prv_randomBits(&state);
+        expectedLength = prv_base64Reference(binary, length, expected);
+
+        CU_ASSERT_EQUAL(utils_base64GetSize(length), expectedLength)
+        CU_ASSERT_EQUAL(utils_base64Encode(binary, length, encoded, sizeof(encoded)), expectedLength)
+        CU_ASSERT_NSTRING_EQUAL(encoded, expected, expectedLength)
+        if (expectedLength > 0)
+        {
+            CU_ASSERT_EQUAL(utils_base64Encode(binary, length, encoded, expectedLength - 1), 0)
+        }
+        CU_ASSERT_EQUAL(utils_base64GetDecodedSize(expected, expectedLength), length)
+        memset(decoded, 0, sizeof(decoded));
+        CU_ASSERT_EQUAL(utils_base64Decode(expected, expectedLength, decoded, sizeof(decoded)), length)
+        CU_ASSERT_EQUAL(memcmp(decoded, binary, length), 0)
+        if (length > 0)
+        {
+            CU_ASSERT_EQUAL(utils_base64Decode(expected, expectedLength, decoded, length - 1), 0)
+        }
+
+        // without padding
+        while (expectedLength > 0 && expected[expectedLength - 1] == '=') expectedLength--;
+        memset(decoded, 0, sizeof(decoded));
+        CU_ASSERT_EQUAL(utils_base64Decode(expected, expectedLength, decoded, sizeof(decoded)), length)
+        CU_ASSERT_EQUAL(memcmp(decoded, binary, length), 0)
+
+        // with a character out of the alphabet anywhere
+        for (i = 0; i < expectedLength; i++)
+        {
+            char saved = expected[i];
+
+            expected[i] = invalid[i % sizeof(invalid)];
+            CU_ASSERT_EQUAL(utils_base64Decode(expected, expectedLength, decoded, sizeof(decoded)), 0)
+            expected[i] = saved;
+        }
+    }
+}
+
 static struct TestTable table[] = {
         { "test of utils_textToInt()", test_utils_textToInt },
         { "test of utils_textToUInt()", test_utils_textToUInt },
@@ -435,13 +812,18 @@ static struct TestTable table[] = {
         { "test of utils_textToFloat(negative)", test_utils_textToFloatNegativeTests },
         { "test of utils_textToFloat(exponential)", test_utils_textToFloatExponential },
         { "test of utils_textToFloat(unwanted exponential)", test_utils_textToFloatUnwantedExponential },
+        { "test of utils_textToFloat(correct rounding)", test_utils_textToFloatCorrectRounding },
+        { "test of utils_textToInt(round trip)", test_utils_textToIntRoundTrip },
         { "test of utils_textToObjLink()", test_utils_textToObjLink },
         { "test of utils_intToText()", test_utils_intToText },
         { "test of utils_uintToText()", test_utils_uintToText },
         { "test of utils_floatToText()", test_utils_floatToText },
         { "test of utils_floatToText(exponential)", test_utils_floatToTextExponential },
+        { "test of utils_floatToText(shortest)", test_utils_floatToTextShortest },
+        { "test of utils_floatToText(round trip)", test_utils_floatToTextRoundTrip },
         { "test of utils_objLinkToText()", test_utils_objLinkToText },
         { "test of base64 functions", test_utils_base64 },
+        { "test of base64 functions(bulk)", test_utils_base64Bulk },
         { NULL, NULL },
 };
 
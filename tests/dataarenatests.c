@@ -0,0 +1,376 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+/*
+ * The arena counts its blocks and the chunks it gets from lwm2m_malloc():
+ * once warmed up, building, parsing and freeing the same trees must not
+ * reach the heap anymore.
+ */
+
+#include "tests.h"
+#include "CUnit/Basic.h"
+#include "connection.h"
+#include "internals.h"
+#include "liblwm2m.h"
+
+#ifdef LWM2M_DATA_ARENA
+
+#define ARENA_OBJECT_ID      3303
+#define ARENA_INSTANCE_COUNT 3
+#define ARENA_ROUNDS         10
+
+static lwm2m_data_t *build_instance(uint16_t id) {
+    lwm2m_data_t *resourcesP;
+
+    resourcesP = lwm2m_data_new(4);
+    if (resourcesP == NULL) return NULL;
+    resourcesP[0].id = 5700;
+    lwm2m_data_encode_float(20.5 + id, resourcesP + 0);
+    resourcesP[1].id = 5701;
+    lwm2m_data_encode_string("Cel", resourcesP + 1);
+    resourcesP[2].id = 5750;
+    lwm2m_data_encode_string("temperature sensor of the main room", resourcesP + 2);
+    resourcesP[3].id = 5850;
+    lwm2m_data_encode_bool(id % 2 == 0, resourcesP + 3);
+
+    return resourcesP;
+}
+
+static lwm2m_data_t *build_object(void) {
+    lwm2m_data_t *instancesP;
+    uint16_t i;
+
+    instancesP = lwm2m_data_new(ARENA_INSTANCE_COUNT);
+    if (instancesP == NULL) return NULL;
+    for (i = 0; i < ARENA_INSTANCE_COUNT; i++) {
+        lwm2m_data_t *resourcesP = build_instance(i);
+
+        if (resourcesP == NULL) return NULL;
+        instancesP[i].id = i;
+        lwm2m_data_include(resourcesP, 4, instancesP + i);
+    }
+
+    return instancesP;
+}
+
+// builds the object, serializes it and parses it back. Returns the number of parsed records, 0 on failure.
+static int round_trip(lwm2m_media_type_t format) {
+    lwm2m_data_t *objectP;
+    lwm2m_data_t *parsedP = NULL;
+    lwm2m_uri_t uri;
+    uint8_t *buffer;
+    int length;
+    int size;
+
+    LWM2M_URI_RESET(&uri);
+    uri.objectId = ARENA_OBJECT_ID;
+    objectP = build_object();
+    if (objectP == NULL) return 0;
+    length = lwm2m_data_serialize(&uri, ARENA_INSTANCE_COUNT, objectP, &format, &buffer);
+    lwm2m_data_free(ARENA_INSTANCE_COUNT, objectP);
+    if (length <= 0) return 0;
+
+    size = lwm2m_data_parse(&uri, buffer, (size_t)length, format, &parsedP);
+    lwm2m_free(buffer);
+    if (size <= 0) return 0;
+    lwm2m_data_free(size, parsedP);
+
+    return size;
+}
+
+static void check_rounds(lwm2m_media_type_t format) {
+    lwm2m_data_arena_t arena;
+    size_t chunkAllocations = 0;
+    size_t allocations = 0;
+    int round;
+
+    lwm2m_data_arena_init(&arena);
+    CU_ASSERT_PTR_NULL(lwm2m_data_arena_use(&arena))
+
+    for (round = 0; round < ARENA_ROUNDS; round++) {
+        size_t before = arena.allocations;
+
+        CU_ASSERT_EQUAL(round_trip(format), ARENA_INSTANCE_COUNT)
+        lwm2m_data_arena_reset(&arena);
+
+        if (round == 0) {
+            allocations = arena.allocations - before;
+            CU_ASSERT(allocations > 0)
+        } else {
+            CU_ASSERT_EQUAL(arena.allocations - before, allocations)
+        }
+        // the first reset replaces the chunks by a single one, kept by the next resets
+        if (round == 1) {
+            chunkAllocations = arena.chunkAllocations;
+        } else if (round > 1) {
+            CU_ASSERT_EQUAL(arena.chunkAllocations, chunkAllocations)
+        }
+    }
+
+    CU_ASSERT_PTR_EQUAL(lwm2m_data_arena_use(NULL), &arena)
+    lwm2m_data_arena_close(&arena);
+    CU_ASSERT_PTR_NULL(arena.chunkList)
+}
+
+static void test_arena_tlv(void) {
+    check_rounds(LWM2M_CONTENT_TLV);
+}
+
+static void test_arena_json(void) {
+    check_rounds(LWM2M_CONTENT_JSON);
+}
+
+#ifdef LWM2M_SUPPORT_SENML_JSON
+static void test_arena_senml_json(void) {
+    check_rounds(LWM2M_CONTENT_SENML_JSON);
+}
+#endif
+
+#ifdef LWM2M_SUPPORT_SENML_CBOR
+static void test_arena_senml_cbor(void) {
+    check_rounds(LWM2M_CONTENT_SENML_CBOR);
+}
+#endif
+
+#ifdef LWM2M_SUPPORT_LWM2M_CBOR
+static void test_arena_lwm2m_cbor(void) {
+    check_rounds(LWM2M_CONTENT_LWM2M_CBOR);
+}
+#endif
+
+static void test_arena_chunks(void) {
+    lwm2m_data_arena_t arena;
+    lwm2m_data_t *dataP;
+    size_t chunkAllocations;
+    int i;
+
+    lwm2m_data_arena_init(&arena);
+    lwm2m_data_arena_use(&arena);
+
+    // several chunks, replaced by a single one large enough at the reset
+    for (i = 0; i < 4; i++) {
+        dataP = lwm2m_data_new(LWM2M_DATA_ARENA_CHUNK_SIZE / sizeof(lwm2m_data_t));
+        CU_ASSERT_PTR_NOT_NULL_FATAL(dataP)
+        CU_ASSERT_EQUAL((uintptr_t)dataP % _Alignof(lwm2m_data_t), 0)
+        lwm2m_data_encode_nstring("a", 1, dataP);
+        CU_ASSERT_EQUAL((uintptr_t)dataP->value.asBuffer.buffer % _Alignof(lwm2m_data_t), 0)
+    }
+    chunkAllocations = arena.chunkAllocations;
+    CU_ASSERT(chunkAllocations > 1)
+    lwm2m_data_arena_reset(&arena);
+    CU_ASSERT_PTR_NULL(arena.chunkList)
+
+    for (i = 0; i < 4; i++) {
+        dataP = lwm2m_data_new(LWM2M_DATA_ARENA_CHUNK_SIZE / sizeof(lwm2m_data_t));
+        CU_ASSERT_PTR_NOT_NULL_FATAL(dataP)
+        lwm2m_data_encode_nstring("a", 1, dataP);
+    }
+    CU_ASSERT_EQUAL(arena.chunkAllocations, chunkAllocations + 1)
+    lwm2m_data_arena_use(NULL);
+    lwm2m_data_arena_close(&arena);
+}
+
+static void test_arena_heap_data(void) {
+    lwm2m_data_arena_t arena;
+    lwm2m_data_t *heapP;
+    lwm2m_data_t *arenaP;
+
+    // data allocated before the arena is in use goes back to the heap
+    heapP = build_instance(0);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(heapP)
+
+    lwm2m_data_arena_init(&arena);
+    lwm2m_data_arena_use(&arena);
+    arenaP = lwm2m_data_new(1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(arenaP)
+    lwm2m_data_include(heapP, 4, arenaP);
+    CU_ASSERT_EQUAL(arena.allocations, 1)
+    lwm2m_data_free(1, arenaP);
+    lwm2m_data_arena_use(NULL);
+    lwm2m_data_arena_close(&arena);
+}
+
+static uint8_t lastCode;
+
+static int arena_send(uint8_t const *buffer, size_t length, void *userData) {
+    coap_packet_t packet;
+
+    (void)userData;
+    lastCode = 0;
+    if (NO_ERROR == coap_parse_message(&packet, (uint8_t *)buffer, (uint16_t)length)) {
+        lastCode = packet.code;
+        coap_free_header(&packet);
+    }
+    return 0;
+}
+
+static uint8_t arena_read(lwm2m_context_t *contextP, uint16_t instanceId, int *numDataP, lwm2m_data_t **dataArrayP,
+                          lwm2m_object_t *objectP) {
+    (void)contextP;
+    (void)objectP;
+
+    if (*numDataP == 0) {
+        *dataArrayP = build_instance(instanceId);
+        if (*dataArrayP == NULL) return COAP_500_INTERNAL_SERVER_ERROR;
+        *numDataP = 4;
+    } else {
+        int i;
+
+        for (i = 0; i < *numDataP; i++) {
+            if ((*dataArrayP)[i].id != 5701) return COAP_404_NOT_FOUND;
+            lwm2m_data_encode_string("Cel", *dataArrayP + i);
+        }
+    }
+    return COAP_205_CONTENT;
+}
+
+static uint8_t arena_write(lwm2m_context_t *contextP, uint16_t instanceId, int numData, lwm2m_data_t *dataArray,
+                           lwm2m_object_t *objectP, lwm2m_write_type_t writeType) {
+    (void)contextP;
+    (void)instanceId;
+    (void)objectP;
+    (void)writeType;
+
+    if (numData != 4 || dataArray[2].id != 5750 || dataArray[2].value.asBuffer.buffer == NULL) {
+        return COAP_400_BAD_REQUEST;
+    }
+    return COAP_204_CHANGED;
+}
+
+static void send_request(lwm2m_context_t *contextP, connection_t *connectionP, coap_method_t method, const char *path,
+                         lwm2m_media_type_t format, const uint8_t *payload, size_t payloadLength) {
+    static uint16_t mid = 1000;
+    coap_packet_t message;
+    uint8_t buffer[512];
+    size_t length;
+
+    coap_init_message(&message, COAP_TYPE_CON, method, mid++);
+    coap_set_header_uri_path(&message, path);
+    if (payload != NULL) {
+        coap_set_header_content_type(&message, format);
+        coap_set_payload(&message, payload, payloadLength);
+    } else {
+        coap_set_header_accept(&message, format);
+    }
+    length = coap_serialize_message(&message, buffer);
+    coap_free_header(&message);
+    CU_ASSERT_FATAL(length > 0)
+
+    lwm2m_handle_packet(contextP, buffer, (int)length, connectionP);
+}
+
+static void test_arena_client_requests(void) {
+    lwm2m_context_t *contextP;
+    lwm2m_server_t server;
+    lwm2m_object_t object;
+    lwm2m_list_t instance;
+    connection_t connection;
+    lwm2m_data_t *dataP;
+    lwm2m_media_type_t format = LWM2M_CONTENT_TLV;
+    lwm2m_uri_t uri;
+    uint8_t *payload;
+    int payloadLength;
+    size_t chunkAllocations = 0;
+    size_t allocations = 0;
+    int round;
+
+    contextP = lwm2m_init(NULL);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(contextP)
+    memset(&connection, 0, sizeof(connection));
+    connection.sendFunc = arena_send;
+    memset(&server, 0, sizeof(server));
+    server.sessionH = &connection;
+    server.status = STATE_REGISTERED;
+    contextP->serverList = &server;
+    memset(&instance, 0, sizeof(instance));
+    memset(&object, 0, sizeof(object));
+    object.objID = ARENA_OBJECT_ID;
+    object.instanceList = &instance;
+    object.readFunc = arena_read;
+    object.writeFunc = arena_write;
+    contextP->objectList = &object;
+
+    lwm2m_stringToUri("/3303/0", 7, &uri);
+    dataP = build_instance(0);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(dataP)
+    payloadLength = lwm2m_data_serialize(&uri, 4, dataP, &format, &payload);
+    lwm2m_data_free(4, dataP);
+    CU_ASSERT_FATAL(payloadLength > 0)
+
+    for (round = 0; round < ARENA_ROUNDS; round++) {
+        size_t before = contextP->dataArena.allocations;
+
+        send_request(contextP, &connection, COAP_GET, "/3303/0", LWM2M_CONTENT_TLV, NULL, 0);
+        CU_ASSERT_EQUAL(lastCode, COAP_205_CONTENT)
+        send_request(contextP, &connection, COAP_GET, "/3303/0/5701", LWM2M_CONTENT_TEXT, NULL, 0);
+        CU_ASSERT_EQUAL(lastCode, COAP_205_CONTENT)
+        send_request(contextP, &connection, COAP_GET, "/3303/0", LWM2M_CONTENT_JSON, NULL, 0);
+        CU_ASSERT_EQUAL(lastCode, COAP_205_CONTENT)
+        send_request(contextP, &connection, COAP_PUT, "/3303/0", LWM2M_CONTENT_TLV, payload, (size_t)payloadLength);
+        CU_ASSERT_EQUAL(lastCode, COAP_204_CHANGED)
+
+        if (round == 0) {
+            allocations = contextP->dataArena.allocations - before;
+            CU_ASSERT(allocations > 0)
+        } else {
+            CU_ASSERT_EQUAL(contextP->dataArena.allocations - before, allocations)
+        }
+        if (round == 1) {
+            chunkAllocations = contextP->dataArena.chunkAllocations;
+            CU_ASSERT(chunkAllocations > 0)
+        } else if (round > 1) {
+            CU_ASSERT_EQUAL(contextP->dataArena.chunkAllocations, chunkAllocations)
+        }
+    }
+    // only in use while handling a request
+    CU_ASSERT_PTR_NULL(lwm2m_data_arena_use(NULL))
+
+    lwm2m_free(payload);
+    contextP->serverList = NULL;
+    contextP->objectList = NULL;
+    lwm2m_close(contextP);
+}
+
+static struct TestTable table[] = {
+    {"test of the arena with TLV", test_arena_tlv},
+    {"test of the arena with JSON", test_arena_json},
+#ifdef LWM2M_SUPPORT_SENML_JSON
+    {"test of the arena with SenML JSON", test_arena_senml_json},
+#endif
+#ifdef LWM2M_SUPPORT_SENML_CBOR
+    {"test of the arena with SenML CBOR", test_arena_senml_cbor},
+#endif
+#ifdef LWM2M_SUPPORT_LWM2M_CBOR
+    {"test of the arena with LwM2M CBOR", test_arena_lwm2m_cbor},
+#endif
+    {"test of the arena chunks", test_arena_chunks},
+    {"test of heap data freed with an arena in use", test_arena_heap_data},
+    {"test of the arena of a client context", test_arena_client_requests},
+    {NULL, NULL},
+};
+
+CU_ErrorCode create_data_arena_suit() {
+    CU_pSuite pSuite = NULL;
+
+    pSuite = CU_add_suite("Suite_data_arena", NULL, NULL);
+    if (NULL == pSuite) {
+        return CU_get_error();
+    }
+    return add_tests(pSuite, table);
+}
+
+#endif
@@ -0,0 +1,137 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+#include "tests.h"
+#include "CUnit/Basic.h"
+#include "internals.h"
+#include "liblwm2m.h"
+
+#define INDEX_TEST_ITEMS 1000
+
+typedef struct
+{
+    uint32_t key;
+} index_test_item_t;
+
+static bool match_key(const void * item, const void * key, void * userData)
+{
+    (void)userData;
+    return ((const index_test_item_t *)item)->key == *(const uint32_t *)key;
+}
+
+static index_test_item_t * find_key(lwm2m_index_t * indexP, uint32_t hash, uint32_t key)
+{
+    return (index_test_item_t *)index_find(indexP, hash, match_key, &key, NULL);
+}
+
+static void test_index_add_find_remove(void)
+{
+    lwm2m_index_t index;
+    index_test_item_t items[INDEX_TEST_ITEMS];
+    uint32_t i;
+
+    memset(&index, 0, sizeof(index));
+    CU_ASSERT_PTR_NULL(find_key(&index, index_hashInteger(0), 0))
+
+    for (i = 0; i < INDEX_TEST_ITEMS; i++) {
+        items[i].key = i;
+        CU_ASSERT_TRUE_FATAL(index_add(&index, index_hashInteger(i), &items[i]))
+    }
+    CU_ASSERT_EQUAL(index.count, INDEX_TEST_ITEMS)
+    CU_ASSERT(index.count * 4 <= index.capacity * 3)
+
+    for (i = 0; i < INDEX_TEST_ITEMS; i++) {
+        CU_ASSERT_PTR_EQUAL(find_key(&index, index_hashInteger(i), i), &items[i])
+    }
+    CU_ASSERT_PTR_NULL(find_key(&index, index_hashInteger(INDEX_TEST_ITEMS), INDEX_TEST_ITEMS))
+
+    // remove every other item, the remaining ones must stay reachable
+    for (i = 0; i < INDEX_TEST_ITEMS; i += 2) {
+        CU_ASSERT_TRUE(index_remove(&index, index_hashInteger(i), &items[i]))
+    }
+    CU_ASSERT_FALSE(index_remove(&index, index_hashInteger(0), &items[0]))
+    CU_ASSERT_EQUAL(index.count, INDEX_TEST_ITEMS / 2)
+
+    for (i = 0; i < INDEX_TEST_ITEMS; i++) {
+        if (i % 2 == 0) {
+            CU_ASSERT_PTR_NULL(find_key(&index, index_hashInteger(i), i))
+        } else {
+            CU_ASSERT_PTR_EQUAL(find_key(&index, index_hashInteger(i), i), &items[i])
+        }
+    }
+
+    index_clear(&index);
+    CU_ASSERT_EQUAL(index.count, 0)
+    CU_ASSERT_PTR_NULL(index.entries)
+}
+
+static void test_index_collisions(void)
+{
+    lwm2m_index_t index;
+    index_test_item_t items[64];
+    uint32_t i;
+
+    memset(&index, 0, sizeof(index));
+
+    // all items share the same hash and wrap around the end of the table
+    for (i = 0; i < 64; i++) {
+        items[i].key = i;
+        CU_ASSERT_TRUE_FATAL(index_add(&index, 0xFFFFFFFF, &items[i]))
+    }
+    for (i = 0; i < 64; i++) {
+        CU_ASSERT_PTR_EQUAL(find_key(&index, 0xFFFFFFFF, i), &items[i])
+    }
+
+    for (i = 0; i < 64; i += 3) {
+        CU_ASSERT_TRUE(index_remove(&index, 0xFFFFFFFF, &items[i]))
+    }
+    for (i = 0; i < 64; i++) {
+        if (i % 3 == 0) {
+            CU_ASSERT_PTR_NULL(find_key(&index, 0xFFFFFFFF, i))
+        } else {
+            CU_ASSERT_PTR_EQUAL(find_key(&index, 0xFFFFFFFF, i), &items[i])
+        }
+    }
+
+    index_clear(&index);
+}
+
+static void test_index_hash(void)
+{
+    const uint8_t data[] = {'e', 'p', '1'};
+
+    CU_ASSERT_EQUAL(index_hashString("ep1"), index_hashBytes(data, sizeof(data)))
+    CU_ASSERT_NOT_EQUAL(index_hashString("ep1"), index_hashString("ep2"))
+    CU_ASSERT_NOT_EQUAL(index_hashInteger(1), index_hashInteger(2))
+}
+
+static struct TestTable table[] = {
+        { "test of index_add(), index_find() and index_remove()", test_index_add_find_remove },
+        { "test of index collisions", test_index_collisions },
+        { "test of index hash functions", test_index_hash },
+        { NULL, NULL },
+};
+
+CU_ErrorCode create_index_suit() {
+    CU_pSuite pSuite = NULL;
+    pSuite = CU_add_suite("Suite_index", NULL, NULL);
+
+    if (NULL == pSuite) {
+        return CU_get_error();
+    }
+    return add_tests(pSuite, table);
+}
@@ -0,0 +1,507 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+/*
+ * A changed value must tag the observations of its URI, of the parents of
+ * its URI and of the URIs below it, and only them. The watchers notified in a
+ * step share one read and one serialization per format. CON notifications
+ * wait for the acknowledgement of the previous ones and only carry the latest
+ * value.
+ */
+
+#include "tests.h"
+#include "CUnit/Basic.h"
+#include "connection.h"
+#include "internals.h"
+#include "liblwm2m.h"
+
+static const char *observedPaths[] = {
+    "/3303", "/3303/1", "/3303/1/5700", "/3303/2/5700", "/3304/1/5700",
+};
+
+#define OBSERVED_COUNT (sizeof(observedPaths) / sizeof(observedPaths[0]))
+
+#define NOTIFY_SERVER_COUNT 3
+
+// notifications sent in a step
+static struct {
+    void *connection;
+    lwm2m_media_type_t format;
+    uint32_t observe;
+    uint8_t token[2];
+    uint8_t payload[256];
+    size_t payloadLength;
+} notifications[NOTIFY_SERVER_COUNT + 1];
+static size_t notificationCount;
+static int readCount;
+
+static void observe_in(lwm2m_context_t *contextP, lwm2m_server_t *serverP, const char *path, uint16_t mid,
+                       lwm2m_media_type_t format) {
+    coap_packet_t message;
+    coap_packet_t response;
+    lwm2m_uri_t uri;
+    lwm2m_data_t *dataP;
+    uint8_t token[2];
+
+    token[0] = (uint8_t)mid;
+    token[1] = (uint8_t)(mid >> 8);
+    coap_init_message(&message, COAP_TYPE_CON, COAP_GET, mid);
+    coap_set_header_token(&message, token, sizeof(token));
+    coap_set_header_observe(&message, 0);
+    coap_init_message(&response, COAP_TYPE_ACK, COAP_205_CONTENT, mid);
+    coap_set_header_content_type(&response, format);
+
+    dataP = lwm2m_data_new(1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(dataP)
+    dataP->id = 5700;
+    lwm2m_data_encode_int(20, dataP);
+
+    CU_ASSERT_FATAL(lwm2m_stringToUri(path, strlen(path), &uri) != 0)
+    CU_ASSERT_EQUAL(observe_handleRequest(contextP, &uri, serverP, 1, dataP, &message, &response), COAP_205_CONTENT)
+    lwm2m_data_free(1, dataP);
+}
+
+static void observe(lwm2m_context_t *contextP, lwm2m_server_t *serverP, const char *path, uint16_t mid) {
+    observe_in(contextP, serverP, path, mid, LWM2M_CONTENT_TEXT);
+}
+
+static lwm2m_watcher_t *find_watcher(lwm2m_context_t *contextP, const char *path) {
+    lwm2m_observed_t *observedP;
+    lwm2m_uri_t uri;
+
+    if (lwm2m_stringToUri(path, strlen(path), &uri) == 0) return NULL;
+    observedP = observe_findByUri(contextP, &uri);
+    if (observedP == NULL) return NULL;
+    return observedP->watcherList;
+}
+
+// Reports a change and returns a bit per observed path whose watcher was tagged
+static unsigned int value_changed(lwm2m_context_t *contextP, const char *path) {
+    unsigned int tagged = 0;
+    lwm2m_uri_t uri;
+    size_t i;
+
+    for (i = 0; i < OBSERVED_COUNT; i++) {
+        find_watcher(contextP, observedPaths[i])->update = false;
+    }
+    CU_ASSERT_FATAL(lwm2m_stringToUri(path, strlen(path), &uri) != 0)
+    lwm2m_resource_value_changed(contextP, &uri);
+    for (i = 0; i < OBSERVED_COUNT; i++) {
+        if (find_watcher(contextP, observedPaths[i])->update) tagged |= 1u << i;
+    }
+    return tagged;
+}
+
+static void test_observe_value_changed(void) {
+    lwm2m_context_t *contextP;
+    lwm2m_server_t server;
+    connection_t connection;
+    lwm2m_uri_t uri;
+    size_t i;
+
+    contextP = lwm2m_init(NULL);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(contextP)
+    memset(&connection, 0, sizeof(connection));
+    memset(&server, 0, sizeof(server));
+    server.sessionH = &connection;
+    server.status = STATE_REGISTERED;
+
+    for (i = 0; i < OBSERVED_COUNT; i++) {
+        observe(contextP, &server, observedPaths[i], (uint16_t)(100 + i));
+        CU_ASSERT_PTR_NOT_NULL_FATAL(find_watcher(contextP, observedPaths[i]))
+    }
+    // observed again by the same server
+    observe(contextP, &server, "/3303/1", 200);
+    CU_ASSERT_PTR_NULL(find_watcher(contextP, "/3303/1")->next)
+
+    // only the observed URIs are found, not their parents or children
+    CU_ASSERT_PTR_NULL(find_watcher(contextP, "/3303/2"))
+    CU_ASSERT_PTR_NULL(find_watcher(contextP, "/3303/1/5701"))
+    CU_ASSERT_PTR_NULL(find_watcher(contextP, "/3305"))
+
+    CU_ASSERT_EQUAL(value_changed(contextP, "/3303/1/5700"), 0x07)
+    CU_ASSERT_EQUAL(value_changed(contextP, "/3303/1/5701"), 0x03)
+    CU_ASSERT_EQUAL(value_changed(contextP, "/3303/2/5700"), 0x09)
+    CU_ASSERT_EQUAL(value_changed(contextP, "/3303/2"), 0x09)
+    CU_ASSERT_EQUAL(value_changed(contextP, "/3303"), 0x0F)
+    CU_ASSERT_EQUAL(value_changed(contextP, "/3304"), 0x10)
+    CU_ASSERT_EQUAL(value_changed(contextP, "/3304/2/5700"), 0x00)
+    CU_ASSERT_EQUAL(value_changed(contextP, "/3305/1/5700"), 0x00)
+
+    // cancelling the observations empties the tree
+    observe_cancel(contextP, 200, &connection);
+    CU_ASSERT_PTR_NULL(find_watcher(contextP, "/3303/1"))
+    CU_ASSERT_PTR_NOT_NULL(find_watcher(contextP, "/3303/1/5700"))
+    for (i = 0; i < OBSERVED_COUNT; i++) {
+        observe_cancel(contextP, (uint16_t)(100 + i), &connection);
+    }
+    CU_ASSERT_PTR_NULL(contextP->observedList)
+    CU_ASSERT_EQUAL(contextP->observedTree.childCount, 0)
+    CU_ASSERT_PTR_NULL(contextP->observedTree.children)
+
+    // clearing an object removes its nodes
+    observe(contextP, &server, "/3303/1/5700", 300);
+    observe(contextP, &server, "/3304/1", 301);
+    lwm2m_stringToUri("/3303", 5, &uri);
+    observe_clear(contextP, &uri);
+    CU_ASSERT_EQUAL(contextP->observedTree.childCount, 1)
+    CU_ASSERT_PTR_NOT_NULL(find_watcher(contextP, "/3304/1"))
+
+    lwm2m_close(contextP);
+}
+
+static int notify_send(uint8_t const *buffer, size_t length, void *userData) {
+    coap_packet_t packet;
+
+    CU_ASSERT_FATAL(notificationCount < NOTIFY_SERVER_COUNT + 1)
+    CU_ASSERT_EQUAL_FATAL(coap_parse_message(&packet, (uint8_t *)buffer, (uint16_t)length), NO_ERROR)
+    CU_ASSERT_EQUAL(packet.type, COAP_TYPE_NON)
+    CU_ASSERT_EQUAL(packet.code, COAP_205_CONTENT)
+    CU_ASSERT_EQUAL(packet.token_len, 2)
+    CU_ASSERT_FATAL(packet.payload_len <= sizeof(notifications[0].payload))
+    CU_ASSERT(IS_OPTION(&packet, COAP_OPTION_OBSERVE))
+
+    notifications[notificationCount].connection = userData;
+    notifications[notificationCount].format = (lwm2m_media_type_t)packet.content_type;
+    notifications[notificationCount].observe = packet.observe;
+    memcpy(notifications[notificationCount].token, packet.token, 2);
+    memcpy(notifications[notificationCount].payload, packet.payload, packet.payload_len);
+    notifications[notificationCount].payloadLength = packet.payload_len;
+    notificationCount++;
+    coap_free_header(&packet);
+    return 0;
+}
+
+static uint8_t notify_read(lwm2m_context_t *contextP, uint16_t instanceId, int *numDataP, lwm2m_data_t **dataArrayP,
+                           lwm2m_object_t *objectP) {
+    (void)contextP;
+    (void)objectP;
+
+    readCount++;
+    if (*numDataP != 0) return COAP_404_NOT_FOUND;
+
+    *dataArrayP = lwm2m_data_new(2);
+    if (*dataArrayP == NULL) return COAP_500_INTERNAL_SERVER_ERROR;
+    *numDataP = 2;
+    (*dataArrayP)[0].id = 5700;
+    lwm2m_data_encode_int(20 + instanceId, *dataArrayP + 0);
+    (*dataArrayP)[1].id = 5701;
+    lwm2m_data_encode_string("Cel", *dataArrayP + 1);
+
+    return COAP_205_CONTENT;
+}
+
+// returns the notification sent to a connection
+static size_t find_notification(connection_t *connectionP) {
+    size_t i;
+
+    for (i = 0; i < notificationCount; i++) {
+        if (notifications[i].connection == connectionP) break;
+    }
+    CU_ASSERT_FATAL(i < notificationCount)
+    return i;
+}
+
+static void test_observe_notify_formats(void) {
+    static const lwm2m_media_type_t formats[NOTIFY_SERVER_COUNT] = {
+        LWM2M_CONTENT_TLV,
+        LWM2M_CONTENT_JSON,
+        LWM2M_CONTENT_TLV,
+    };
+    lwm2m_context_t *contextP;
+    lwm2m_server_t servers[NOTIFY_SERVER_COUNT];
+    connection_t connections[NOTIFY_SERVER_COUNT];
+    lwm2m_object_t object;
+    lwm2m_list_t instance;
+    lwm2m_uri_t uri;
+    time_t timeout;
+    size_t first;
+    size_t i;
+
+    contextP = lwm2m_init(NULL);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(contextP)
+    memset(&instance, 0, sizeof(instance));
+    instance.id = 1;
+    memset(&object, 0, sizeof(object));
+    object.objID = 3303;
+    object.instanceList = &instance;
+    object.readFunc = notify_read;
+    contextP->objectList = &object;
+    for (i = 0; i < NOTIFY_SERVER_COUNT; i++) {
+        memset(connections + i, 0, sizeof(connections[i]));
+        connections[i].sendFunc = notify_send;
+        memset(servers + i, 0, sizeof(servers[i]));
+        servers[i].sessionH = connections + i;
+        servers[i].status = STATE_REGISTERED;
+        servers[i].next = i + 1 < NOTIFY_SERVER_COUNT ? servers + i + 1 : NULL;
+        observe_in(contextP, servers + i, "/3303/1", (uint16_t)(400 + i), formats[i]);
+    }
+    contextP->serverList = servers;
+
+    readCount = 0;
+    notificationCount = 0;
+    lwm2m_stringToUri("/3303/1/5700", 12, &uri);
+    lwm2m_resource_value_changed(contextP, &uri);
+    timeout = 60;
+    observe_step(contextP, lwm2m_gettime(), &timeout);
+
+    // one read for all the watchers, each notified in its own format
+    CU_ASSERT_EQUAL(readCount, 1)
+    CU_ASSERT_EQUAL_FATAL(notificationCount, NOTIFY_SERVER_COUNT)
+    first = find_notification(connections + 0);
+    for (i = 0; i < NOTIFY_SERVER_COUNT; i++) {
+        size_t n = find_notification(connections + i);
+
+        CU_ASSERT_EQUAL(notifications[n].format, formats[i])
+        CU_ASSERT_EQUAL(notifications[n].observe, 1)
+        CU_ASSERT_EQUAL(notifications[n].token[0], (uint8_t)(400 + i))
+        CU_ASSERT_EQUAL(notifications[n].token[1], (uint8_t)((400 + i) >> 8))
+        CU_ASSERT_TRUE(notifications[n].payloadLength > 0)
+        if (formats[i] == formats[0]) {
+            CU_ASSERT_EQUAL(notifications[n].payloadLength, notifications[first].payloadLength)
+            CU_ASSERT_EQUAL(memcmp(notifications[n].payload, notifications[first].payload,
+                                   notifications[first].payloadLength),
+                            0)
+        }
+    }
+    i = find_notification(connections + 1);
+    CU_ASSERT_EQUAL(notifications[i].payload[0], '{')
+
+    // nothing changed, nothing sent
+    notificationCount = 0;
+    observe_step(contextP, lwm2m_gettime(), &timeout);
+    CU_ASSERT_EQUAL(notificationCount, 0)
+    CU_ASSERT_EQUAL(readCount, 1)
+
+    // the observe counter goes on
+    lwm2m_resource_value_changed(contextP, &uri);
+    observe_step(contextP, lwm2m_gettime(), &timeout);
+    CU_ASSERT_EQUAL_FATAL(notificationCount, NOTIFY_SERVER_COUNT)
+    CU_ASSERT_EQUAL(notifications[0].observe, 2)
+
+    contextP->serverList = NULL;
+    contextP->objectList = NULL;
+    lwm2m_close(contextP);
+}
+
+#define LOSSY_SENT_MAX 32
+
+static int64_t lossyValues[3];
+
+// CON notifications sent, whether lost or not
+static struct {
+    coap_message_type_t type;
+    uint16_t mid;
+    uint8_t token;
+    int64_t value;
+} lossySent[LOSSY_SENT_MAX];
+static size_t lossySentCount;
+
+static int lossy_send(uint8_t const *buffer, size_t length, void *userData) {
+    coap_packet_t packet;
+    char text[32];
+
+    (void)userData;
+    CU_ASSERT_FATAL(lossySentCount < LOSSY_SENT_MAX)
+    CU_ASSERT_EQUAL_FATAL(coap_parse_message(&packet, (uint8_t *)buffer, (uint16_t)length), NO_ERROR)
+    CU_ASSERT_FATAL(packet.payload_len < sizeof(text))
+    CU_ASSERT_EQUAL(packet.code, COAP_205_CONTENT)
+
+    lossySent[lossySentCount].type = packet.type;
+    lossySent[lossySentCount].mid = packet.mid;
+    lossySent[lossySentCount].token = packet.token[0];
+    memcpy(text, packet.payload, packet.payload_len);
+    text[packet.payload_len] = 0;
+    lossySent[lossySentCount].value = strtoll(text, NULL, 10);
+    lossySentCount++;
+    coap_free_header(&packet);
+    return 0;
+}
+
+static uint8_t lossy_read(lwm2m_context_t *contextP, uint16_t instanceId, int *numDataP, lwm2m_data_t **dataArrayP,
+                          lwm2m_object_t *objectP) {
+    (void)contextP;
+    (void)objectP;
+
+    if (*numDataP == 0) {
+        *dataArrayP = lwm2m_data_new(1);
+        if (*dataArrayP == NULL) return COAP_500_INTERNAL_SERVER_ERROR;
+        *numDataP = 1;
+        (*dataArrayP)->id = 5700;
+    } else if (*numDataP != 1 || (*dataArrayP)->id != 5700) {
+        return COAP_404_NOT_FOUND;
+    }
+    lwm2m_data_encode_int(lossyValues[instanceId], *dataArrayP);
+    return COAP_205_CONTENT;
+}
+
+static void lossy_step(lwm2m_context_t *contextP) {
+    time_t timeout = 60;
+    int64_t timeoutMs = 60000;
+
+    observe_step(contextP, lwm2m_gettime(), &timeout);
+    scheduler_step(contextP, lwm2m_gettime(), scheduler_getTimeMs(), &timeoutMs);
+}
+
+// the retransmission timer of the notification in flight expires
+static void lossy_timeout(lwm2m_context_t *contextP, const char *path) {
+    lwm2m_watcher_t *watcherP = find_watcher(contextP, path);
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(watcherP->transaction)
+    transaction_send(contextP, watcherP->transaction);
+}
+
+static void lossy_change(lwm2m_context_t *contextP, uint16_t instanceId, int64_t value) {
+    lwm2m_uri_t uri;
+
+    lossyValues[instanceId] = value;
+    LWM2M_URI_RESET(&uri);
+    uri.objectId = 3303;
+    uri.instanceId = instanceId;
+    uri.resourceId = 5700;
+    lwm2m_resource_value_changed(contextP, &uri);
+}
+
+static void lossy_reply(lwm2m_context_t *contextP, connection_t *connectionP, coap_message_type_t type, uint16_t mid) {
+    coap_packet_t message;
+    uint8_t buffer[16];
+    size_t length;
+
+    coap_init_message(&message, type, 0, mid);
+    length = coap_serialize_message(&message, buffer);
+    CU_ASSERT_FATAL(length > 0)
+    lwm2m_handle_packet(contextP, buffer, (int)length, connectionP);
+}
+
+static void test_observe_notify_lossy(void) {
+    lwm2m_context_t *contextP;
+    lwm2m_server_t server;
+    connection_t connection;
+    lwm2m_object_t object;
+    lwm2m_list_t instances[2];
+    size_t i;
+
+    contextP = lwm2m_init(NULL);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(contextP)
+    memset(instances, 0, sizeof(instances));
+    instances[0].id = 1;
+    instances[0].next = instances + 1;
+    instances[1].id = 2;
+    memset(&object, 0, sizeof(object));
+    object.objID = 3303;
+    object.instanceList = instances;
+    object.readFunc = lossy_read;
+    contextP->objectList = &object;
+    memset(&connection, 0, sizeof(connection));
+    connection.sendFunc = lossy_send;
+    memset(&server, 0, sizeof(server));
+    server.sessionH = &connection;
+    server.status = STATE_REGISTERED;
+    server.confirmNotifications = true;
+    contextP->serverList = &server;
+    observe(contextP, &server, "/3303/1/5700", 1);
+    observe(contextP, &server, "/3303/2/5700", 2);
+
+    lossySentCount = 0;
+    lossy_change(contextP, 1, 21);
+    lossy_step(contextP);
+    CU_ASSERT_EQUAL_FATAL(lossySentCount, 1)
+    CU_ASSERT_EQUAL(lossySent[0].type, COAP_TYPE_CON)
+    CU_ASSERT_EQUAL(lossySent[0].token, 1)
+    CU_ASSERT_EQUAL(lossySent[0].value, 21)
+    CU_ASSERT_EQUAL(server.notificationsInFlight, 1)
+
+    // the server has LWM2M_NSTART notifications in flight: the changes wait, only the latest value is kept
+    lossy_change(contextP, 2, 31);
+    lossy_change(contextP, 1, 22);
+    lossy_change(contextP, 1, 23);
+    lossy_step(contextP);
+    CU_ASSERT_EQUAL(lossySentCount, 1)
+    CU_ASSERT_PTR_NOT_NULL(server.deferredList)
+
+    // the first transmission was lost
+    lossy_timeout(contextP, "/3303/1/5700");
+    CU_ASSERT_EQUAL_FATAL(lossySentCount, 2)
+    CU_ASSERT_EQUAL(lossySent[1].mid, lossySent[0].mid)
+    CU_ASSERT_EQUAL(lossySent[1].value, 21)
+
+    // acknowledged, the deferred notifications go one by one
+    lossy_reply(contextP, &connection, COAP_TYPE_ACK, lossySent[1].mid);
+    CU_ASSERT_EQUAL(server.notificationsInFlight, 0)
+    CU_ASSERT_PTR_NULL(server.deferredList)
+    lossy_step(contextP);
+    CU_ASSERT_EQUAL_FATAL(lossySentCount, 3)
+    lossy_reply(contextP, &connection, COAP_TYPE_ACK, lossySent[2].mid);
+    lossy_step(contextP);
+    CU_ASSERT_EQUAL_FATAL(lossySentCount, 4)
+    lossy_reply(contextP, &connection, COAP_TYPE_ACK, lossySent[3].mid);
+    lossy_step(contextP);
+    CU_ASSERT_EQUAL(lossySentCount, 4)
+    for (i = 2; i < 4; i++) {
+        CU_ASSERT_EQUAL(lossySent[i].type, COAP_TYPE_CON)
+        CU_ASSERT_NOT_EQUAL(lossySent[i].mid, lossySent[0].mid)
+        CU_ASSERT_EQUAL(lossySent[i].value, lossySent[i].token == 1 ? 23 : 31)
+    }
+    CU_ASSERT_NOT_EQUAL(lossySent[2].token, lossySent[3].token)
+    CU_ASSERT_EQUAL(server.notificationsInFlight, 0)
+
+    // never acknowledged: the server is no longer an observer once all retransmissions are lost
+    lossy_change(contextP, 1, 24);
+    lossy_step(contextP);
+    CU_ASSERT_EQUAL_FATAL(lossySentCount, 5)
+    for (i = 0; i <= COAP_MAX_RETRANSMIT; i++) {
+        lossy_timeout(contextP, "/3303/1/5700");
+    }
+    CU_ASSERT_EQUAL(server.notificationsInFlight, 0)
+    CU_ASSERT_EQUAL(lossySentCount, 5 + COAP_MAX_RETRANSMIT)
+    CU_ASSERT_FALSE(find_watcher(contextP, "/3303/1/5700")->active)
+    lossy_change(contextP, 1, 25);
+    lossy_change(contextP, 2, 32);
+    lossy_step(contextP);
+    CU_ASSERT_EQUAL_FATAL(lossySentCount, 6 + COAP_MAX_RETRANSMIT)
+    CU_ASSERT_EQUAL(lossySent[5 + COAP_MAX_RETRANSMIT].token, 2)
+    CU_ASSERT_EQUAL(lossySent[5 + COAP_MAX_RETRANSMIT].value, 32)
+
+    // a reset cancels the observation and its notification in flight
+    lossy_change(contextP, 1, 26);
+    lossy_reply(contextP, &connection, COAP_TYPE_RST, lossySent[5 + COAP_MAX_RETRANSMIT].mid);
+    CU_ASSERT_EQUAL(server.notificationsInFlight, 0)
+    CU_ASSERT_PTR_NULL(contextP->transactionList)
+    CU_ASSERT_PTR_NULL(find_watcher(contextP, "/3303/2/5700"))
+    CU_ASSERT_PTR_NULL(server.deferredList)
+
+    contextP->serverList = NULL;
+    contextP->objectList = NULL;
+    lwm2m_close(contextP);
+}
+
+static struct TestTable table[] = {
+    {"test of the observations tagged by a changed value", test_observe_value_changed},
+    {"test of the notifications of watchers in several formats", test_observe_notify_formats},
+    {"test of CON notifications on a lossy link", test_observe_notify_lossy},
+    {NULL, NULL},
+};
+
+CU_ErrorCode create_observe_suit() {
+    CU_pSuite pSuite = NULL;
+
+    pSuite = CU_add_suite("Suite_observe", NULL, NULL);
+    if (NULL == pSuite) {
+        return CU_get_error();
+    }
+    return add_tests(pSuite, table);
+}
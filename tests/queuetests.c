@@ -0,0 +1,355 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+/*
+ * A server in queue mode cannot reach the client once the exchanges stopped
+ * for LWM2M_QUEUE_MODE_TIMEOUT: its notifications are kept, up to
+ * LWM2M_QUEUE_MODE_MAX_NOTIFICATIONS, and sent right after the registration
+ * update waking it up.
+ */
+
+#include "tests.h"
+#include "CUnit/Basic.h"
+#include "connection.h"
+#include "internals.h"
+#include "liblwm2m.h"
+
+#define QUEUE_SENT_MAX (LWM2M_QUEUE_MODE_MAX_NOTIFICATIONS + 8)
+
+static int64_t queueValue;
+static int queueCallbackCount;
+
+// messages sent by the client
+static struct {
+    coap_message_type_t type;
+    uint8_t code;
+    uint16_t mid;
+    uint8_t token[8];
+    uint8_t tokenLength;
+    uint32_t observe;
+    int64_t value;
+} queueSent[QUEUE_SENT_MAX];
+static size_t queueSentCount;
+
+static int queue_send(uint8_t const *buffer, size_t length, void *userData) {
+    coap_packet_t packet;
+    char text[32];
+
+    (void)userData;
+    CU_ASSERT_FATAL(queueSentCount < QUEUE_SENT_MAX)
+    CU_ASSERT_EQUAL_FATAL(coap_parse_message(&packet, (uint8_t *)buffer, (uint16_t)length), NO_ERROR)
+
+    queueSent[queueSentCount].type = packet.type;
+    queueSent[queueSentCount].code = packet.code;
+    queueSent[queueSentCount].mid = packet.mid;
+    queueSent[queueSentCount].tokenLength = packet.token_len;
+    memcpy(queueSent[queueSentCount].token, packet.token, packet.token_len);
+    queueSent[queueSentCount].observe = packet.observe;
+    queueSent[queueSentCount].value = 0;
+    if (packet.code == COAP_205_CONTENT) {
+        CU_ASSERT_FATAL(packet.payload_len < sizeof(text))
+        memcpy(text, packet.payload, packet.payload_len);
+        text[packet.payload_len] = 0;
+        queueSent[queueSentCount].value = strtoll(text, NULL, 10);
+    }
+    queueSentCount++;
+    coap_free_header(&packet);
+    return 0;
+}
+
+static uint8_t queue_read(lwm2m_context_t *contextP, uint16_t instanceId, int *numDataP, lwm2m_data_t **dataArrayP,
+                          lwm2m_object_t *objectP) {
+    (void)contextP;
+    (void)instanceId;
+    (void)objectP;
+
+    if (*numDataP == 0) {
+        *dataArrayP = lwm2m_data_new(1);
+        if (*dataArrayP == NULL) return COAP_500_INTERNAL_SERVER_ERROR;
+        *numDataP = 1;
+        (*dataArrayP)->id = 5700;
+    } else if (*numDataP != 1 || (*dataArrayP)->id != 5700) {
+        return COAP_404_NOT_FOUND;
+    }
+    lwm2m_data_encode_int(queueValue, *dataArrayP);
+    return COAP_205_CONTENT;
+}
+
+static void queue_callback(lwm2m_context_t *contextP, void *userData) {
+    (void)contextP;
+    (void)userData;
+
+    queueCallbackCount++;
+}
+
+static void queue_observe(lwm2m_context_t *contextP, lwm2m_server_t *serverP) {
+    coap_packet_t message;
+    coap_packet_t response;
+    lwm2m_uri_t uri;
+    lwm2m_data_t *dataP;
+    uint8_t token[2] = {1, 0};
+
+    coap_init_message(&message, COAP_TYPE_CON, COAP_GET, 1);
+    coap_set_header_token(&message, token, sizeof(token));
+    coap_set_header_observe(&message, 0);
+    coap_init_message(&response, COAP_TYPE_ACK, COAP_205_CONTENT, 1);
+    coap_set_header_content_type(&response, LWM2M_CONTENT_TEXT);
+
+    dataP = lwm2m_data_new(1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(dataP)
+    dataP->id = 5700;
+    lwm2m_data_encode_int(queueValue, dataP);
+
+    CU_ASSERT_FATAL(lwm2m_stringToUri("/3303/1/5700", 12, &uri) != 0)
+    CU_ASSERT_EQUAL(observe_handleRequest(contextP, &uri, serverP, 1, dataP, &message, &response), COAP_205_CONTENT)
+    lwm2m_data_free(1, dataP);
+}
+
+static void queue_change(lwm2m_context_t *contextP, int64_t value) {
+    lwm2m_uri_t uri;
+    time_t timeout = 60;
+    int64_t timeoutMs = 60000;
+
+    queueValue = value;
+    LWM2M_URI_RESET(&uri);
+    uri.objectId = 3303;
+    uri.instanceId = 1;
+    uri.resourceId = 5700;
+    lwm2m_resource_value_changed(contextP, &uri);
+    observe_step(contextP, lwm2m_gettime(), &timeout);
+    scheduler_step(contextP, lwm2m_gettime(), scheduler_getTimeMs(), &timeoutMs);
+}
+
+// steps the registrations once the client stayed silent for the queue mode timeout
+static void queue_idle(lwm2m_context_t *contextP) {
+    time_t timeout = 60;
+
+    registration_step(contextP, lwm2m_gettime() + LWM2M_QUEUE_MODE_TIMEOUT + 20, &timeout);
+}
+
+static void test_queue_flush(void) {
+    lwm2m_context_t *contextP;
+    lwm2m_server_t server;
+    connection_t connection;
+    lwm2m_object_t object;
+    lwm2m_list_t instance;
+    char location[] = "/rd/1";
+    coap_packet_t message;
+    uint8_t buffer[32];
+    size_t length;
+    size_t i;
+
+    contextP = lwm2m_init(NULL);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(contextP)
+    memset(&instance, 0, sizeof(instance));
+    instance.id = 1;
+    memset(&object, 0, sizeof(object));
+    object.objID = 3303;
+    object.instanceList = &instance;
+    object.readFunc = queue_read;
+    contextP->objectList = &object;
+    memset(&connection, 0, sizeof(connection));
+    connection.sendFunc = queue_send;
+    memset(&server, 0, sizeof(server));
+    server.sessionH = &connection;
+    server.status = STATE_REGISTERED;
+    server.binding = BINDING_UQ;
+    server.location = location;
+    server.lifetime = 86400;
+    server.registration = lwm2m_gettime();
+    contextP->serverList = &server;
+    contextP->state = STATE_READY;
+    lwm2m_set_queue_callback(contextP, queue_callback, NULL);
+    queueValue = 20;
+    queue_observe(contextP, &server);
+
+    // awake, the notifications go at once
+    queueSentCount = 0;
+    queueCallbackCount = 0;
+    queue_change(contextP, 21);
+    CU_ASSERT_EQUAL_FATAL(queueSentCount, 1)
+    CU_ASSERT_EQUAL(queueSent[0].value, 21)
+    CU_ASSERT_FALSE(server.queueSleeping)
+
+    // idle, the radio may be powered down
+    queue_idle(contextP);
+    CU_ASSERT_TRUE(server.queueSleeping)
+    CU_ASSERT_EQUAL(queueCallbackCount, 1)
+    queue_idle(contextP);
+    CU_ASSERT_EQUAL(queueCallbackCount, 1)
+
+    // asleep, the oldest notifications are dropped once the queue is full
+    for (i = 0; i < LWM2M_QUEUE_MODE_MAX_NOTIFICATIONS + 4; i++) {
+        queue_change(contextP, 100 + (int64_t)i);
+    }
+    CU_ASSERT_EQUAL(queueSentCount, 1)
+    CU_ASSERT_EQUAL(server.notificationQueueCount, LWM2M_QUEUE_MODE_MAX_NOTIFICATIONS)
+
+    // woken up by a registration update followed by the queued notifications
+    CU_ASSERT_EQUAL(lwm2m_queue_flush(contextP), COAP_NO_ERROR)
+    CU_ASSERT_FALSE(server.queueSleeping)
+    CU_ASSERT_PTR_NULL(server.notificationQueue)
+    CU_ASSERT_EQUAL(server.notificationQueueCount, 0)
+    CU_ASSERT_EQUAL(server.status, STATE_REG_UPDATE_PENDING)
+    CU_ASSERT_EQUAL_FATAL(queueSentCount, 2 + LWM2M_QUEUE_MODE_MAX_NOTIFICATIONS)
+    CU_ASSERT_EQUAL(queueSent[1].type, COAP_TYPE_CON)
+    CU_ASSERT_EQUAL(queueSent[1].code, COAP_POST)
+    for (i = 2; i < queueSentCount; i++) {
+        CU_ASSERT_EQUAL(queueSent[i].type, COAP_TYPE_NON)
+        CU_ASSERT_EQUAL(queueSent[i].code, COAP_205_CONTENT)
+        CU_ASSERT_EQUAL(queueSent[i].value, 100 + 4 + (int64_t)i - 2)
+        if (i > 2) {
+            CU_ASSERT_EQUAL(queueSent[i].observe, queueSent[i - 1].observe + 1)
+            CU_ASSERT_NOT_EQUAL(queueSent[i].mid, queueSent[i - 1].mid)
+        }
+    }
+    CU_ASSERT(queueSent[2].observe > queueSent[0].observe)
+
+    // reachable until the update is acknowledged
+    queue_idle(contextP);
+    CU_ASSERT_FALSE(server.queueSleeping)
+
+    coap_init_message(&message, COAP_TYPE_ACK, COAP_204_CHANGED, queueSent[1].mid);
+    coap_set_header_token(&message, queueSent[1].token, queueSent[1].tokenLength);
+    length = coap_serialize_message(&message, buffer);
+    CU_ASSERT_FATAL(length > 0)
+    lwm2m_handle_packet(contextP, buffer, (int)length, &connection);
+    CU_ASSERT_EQUAL(server.status, STATE_REGISTERED)
+    CU_ASSERT_PTR_NULL(contextP->transactionList)
+
+    queue_idle(contextP);
+    CU_ASSERT_TRUE(server.queueSleeping)
+    CU_ASSERT_EQUAL(queueCallbackCount, 2)
+
+    // a reset of the last notification cancels the observation and leaves nothing to send
+    queue_change(contextP, 200);
+    CU_ASSERT_EQUAL(server.notificationQueueCount, 1)
+    coap_init_message(&message, COAP_TYPE_RST, 0, queueSent[queueSentCount - 1].mid);
+    length = coap_serialize_message(&message, buffer);
+    CU_ASSERT_FATAL(length > 0)
+    lwm2m_handle_packet(contextP, buffer, (int)length, &connection);
+    CU_ASSERT_PTR_NULL(server.notificationQueue)
+    CU_ASSERT_EQUAL(server.notificationQueueCount, 0)
+
+    contextP->serverList = NULL;
+    contextP->objectList = NULL;
+    lwm2m_close(contextP);
+}
+
+static void test_queue_expired(void) {
+    lwm2m_context_t *contextP;
+    lwm2m_server_t server;
+    connection_t connection;
+    lwm2m_object_t object;
+    lwm2m_list_t instance;
+    lwm2m_watcher_t *watcherP;
+    lwm2m_transaction_t *transacP;
+    char location[] = "/rd/1";
+    coap_packet_t message;
+    uint8_t buffer[32];
+    size_t length;
+    int i;
+
+    contextP = lwm2m_init(NULL);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(contextP)
+    memset(&instance, 0, sizeof(instance));
+    instance.id = 1;
+    memset(&object, 0, sizeof(object));
+    object.objID = 3303;
+    object.instanceList = &instance;
+    object.readFunc = queue_read;
+    contextP->objectList = &object;
+    memset(&connection, 0, sizeof(connection));
+    connection.sendFunc = queue_send;
+    memset(&server, 0, sizeof(server));
+    server.sessionH = &connection;
+    server.status = STATE_REGISTERED;
+    server.binding = BINDING_UQ;
+    server.location = location;
+    server.lifetime = 86400;
+    server.registration = lwm2m_gettime();
+    server.confirmNotifications = true;
+    contextP->serverList = &server;
+    contextP->state = STATE_READY;
+    queueValue = 20;
+    queue_observe(contextP, &server);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(contextP->observedList)
+    watcherP = contextP->observedList->watcherList;
+    CU_ASSERT_PTR_NOT_NULL_FATAL(watcherP)
+
+    queueSentCount = 0;
+    queue_idle(contextP);
+    CU_ASSERT_TRUE_FATAL(server.queueSleeping)
+    queue_change(contextP, 21);
+    CU_ASSERT_EQUAL(queueSentCount, 0)
+
+    // the queued notification is confirmable once the registration update woke the server up
+    CU_ASSERT_EQUAL(lwm2m_queue_flush(contextP), COAP_NO_ERROR)
+    CU_ASSERT_EQUAL_FATAL(queueSentCount, 2)
+    CU_ASSERT_EQUAL(queueSent[1].type, COAP_TYPE_CON)
+    CU_ASSERT_EQUAL(queueSent[1].value, 21)
+    CU_ASSERT_EQUAL(server.notificationsInFlight, 1)
+    CU_ASSERT_EQUAL(server.transactionCount, 2)
+
+    coap_init_message(&message, COAP_TYPE_ACK, COAP_204_CHANGED, queueSent[0].mid);
+    coap_set_header_token(&message, queueSent[0].token, queueSent[0].tokenLength);
+    length = coap_serialize_message(&message, buffer);
+    CU_ASSERT_FATAL(length > 0)
+    lwm2m_handle_packet(contextP, buffer, (int)length, &connection);
+    CU_ASSERT_EQUAL(server.status, STATE_REGISTERED)
+    CU_ASSERT_EQUAL(server.transactionCount, 1)
+
+    // never acknowledged: the server is no longer an observer once all retransmissions are lost
+    transacP = contextP->transactionList;
+    CU_ASSERT_PTR_NOT_NULL_FATAL(transacP)
+    CU_ASSERT_EQUAL(transacP->mID, queueSent[1].mid)
+    for (i = 0; i <= COAP_MAX_RETRANSMIT; i++) {
+        transaction_send(contextP, transacP);
+    }
+    CU_ASSERT_PTR_NULL(contextP->transactionList)
+    CU_ASSERT_EQUAL(server.transactionCount, 0)
+    CU_ASSERT_EQUAL(server.notificationsInFlight, 0)
+    CU_ASSERT_FALSE(watcherP->active)
+
+    // nothing left to send, the server can go back to sleep
+    queue_idle(contextP);
+    CU_ASSERT_TRUE(server.queueSleeping)
+    length = queueSentCount;
+    queue_change(contextP, 22);
+    CU_ASSERT_EQUAL(queueSentCount, length)
+    CU_ASSERT_EQUAL(server.notificationQueueCount, 0)
+
+    contextP->serverList = NULL;
+    contextP->objectList = NULL;
+    lwm2m_close(contextP);
+}
+
+static struct TestTable table[] = {
+    {"test of the notifications queued while the server cannot reach the client", test_queue_flush},
+    {"test of a queued confirmable notification never acknowledged", test_queue_expired},
+    {NULL, NULL},
+};
+
+CU_ErrorCode create_queue_suit() {
+    CU_pSuite pSuite = NULL;
+
+    pSuite = CU_add_suite("Suite_queue", NULL, NULL);
+    if (NULL == pSuite) {
+        return CU_get_error();
+    }
+    return add_tests(pSuite, table);
+}
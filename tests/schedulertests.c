@@ -0,0 +1,159 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+#include "tests.h"
+#include "CUnit/Basic.h"
+#include "internals.h"
+#include "liblwm2m.h"
+
+#define SCHEDULER_TEST_TIMERS 500
+
+typedef struct
+{
+    lwm2m_timer_t timer;
+    int fired;
+    time_t firedAt;
+    bool reschedule;
+} scheduler_test_item_t;
+
+static int64_t lastDeadline;
+static bool ordered;
+
+static void timer_callback(lwm2m_context_t * contextP, void * userData, time_t currentTime)
+{
+    scheduler_test_item_t * itemP = (scheduler_test_item_t *)userData;
+
+    if (itemP->timer.deadline < lastDeadline) ordered = false;
+    lastDeadline = itemP->timer.deadline;
+
+    itemP->fired++;
+    itemP->firedAt = currentTime;
+    if (itemP->reschedule)
+    {
+        // scheduling in the past from a callback must not loop
+        scheduler_add(contextP, &itemP->timer, 0);
+    }
+}
+
+static void init_items(scheduler_test_item_t * items, int count)
+{
+    int i;
+
+    memset(items, 0, count * sizeof(scheduler_test_item_t));
+    for (i = 0; i < count; i++) {
+        items[i].timer.callback = timer_callback;
+        items[i].timer.userData = &items[i];
+    }
+}
+
+static void test_scheduler_order(void)
+{
+    lwm2m_context_t context;
+    scheduler_test_item_t items[SCHEDULER_TEST_TIMERS];
+    int64_t timeout;
+    int i;
+
+    memset(&context, 0, sizeof(context));
+    init_items(items, SCHEDULER_TEST_TIMERS);
+
+    // pseudo random deadlines between 1 and 100
+    for (i = 0; i < SCHEDULER_TEST_TIMERS; i++) {
+        scheduler_add(&context, &items[i].timer, 1 + (i * 37) % 100);
+    }
+    // remove every fifth timer (deadlines 1, 6, 11...), some of them being inner nodes of the heap
+    for (i = 0; i < SCHEDULER_TEST_TIMERS; i += 5) {
+        scheduler_remove(&context, &items[i].timer);
+        CU_ASSERT_FALSE(items[i].timer.scheduled)
+    }
+
+    timeout = 1000000;
+    scheduler_step(&context, 0, 0, &timeout);
+    CU_ASSERT_EQUAL(timeout, 2000)
+
+    lastDeadline = 0;
+    ordered = true;
+    timeout = 1000000;
+    scheduler_step(&context, 50, 50000, &timeout);
+    CU_ASSERT_TRUE(ordered)
+    CU_ASSERT_EQUAL(timeout, 2000)
+    for (i = 0; i < SCHEDULER_TEST_TIMERS; i++) {
+        if (i % 5 == 0 || items[i].timer.deadline > 50000) {
+            CU_ASSERT_EQUAL(items[i].fired, 0)
+        } else {
+            CU_ASSERT_EQUAL(items[i].fired, 1)
+        }
+    }
+
+    timeout = 1000000;
+    scheduler_step(&context, 100, 100000, &timeout);
+    CU_ASSERT_TRUE(ordered)
+    CU_ASSERT_PTR_NULL(context.timerHeap)
+    CU_ASSERT_EQUAL(timeout, 1000000)
+    for (i = 0; i < SCHEDULER_TEST_TIMERS; i++) {
+        CU_ASSERT_EQUAL(items[i].fired, i % 5 == 0 ? 0 : 1)
+    }
+}
+
+static void test_scheduler_reschedule(void)
+{
+    lwm2m_context_t context;
+    scheduler_test_item_t items[3];
+    int64_t timeout;
+
+    memset(&context, 0, sizeof(context));
+    init_items(items, 3);
+
+    scheduler_add(&context, &items[0].timer, 10);
+    scheduler_add(&context, &items[1].timer, 20);
+    scheduler_add(&context, &items[2].timer, 30);
+
+    // moving a scheduled timer replaces its previous deadline
+    scheduler_add(&context, &items[2].timer, 5);
+    items[2].reschedule = true;
+
+    timeout = 1000000;
+    scheduler_step(&context, 5, 5000, &timeout);
+    CU_ASSERT_EQUAL(items[2].fired, 1)
+    CU_ASSERT_TRUE(items[2].timer.scheduled)
+    CU_ASSERT_EQUAL(items[2].timer.deadline, 5001)
+    CU_ASSERT_EQUAL(timeout, 1)
+
+    items[2].reschedule = false;
+    timeout = 1000000;
+    scheduler_step(&context, 20, 20000, &timeout);
+    CU_ASSERT_EQUAL(items[0].fired, 1)
+    CU_ASSERT_EQUAL(items[1].fired, 1)
+    CU_ASSERT_EQUAL(items[2].fired, 2)
+    CU_ASSERT_EQUAL(items[2].firedAt, 20)
+    CU_ASSERT_PTR_NULL(context.timerHeap)
+}
+
+static struct TestTable table[] = {
+        { "test of scheduler ordering and removal", test_scheduler_order },
+        { "test of scheduler rescheduling", test_scheduler_reschedule },
+        { NULL, NULL },
+};
+
+CU_ErrorCode create_scheduler_suit() {
+    CU_pSuite pSuite = NULL;
+    pSuite = CU_add_suite("Suite_scheduler", NULL, NULL);
+
+    if (NULL == pSuite) {
+        return CU_get_error();
+    }
+    return add_tests(pSuite, table);
+}
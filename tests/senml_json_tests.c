@@ -41,7 +41,9 @@
 ((M) == LWM2M_CONTENT_TLV ? "TLV" :                \
 ((M) == LWM2M_CONTENT_JSON ? "JSON" :              \
 ((M) == LWM2M_CONTENT_SENML_JSON ? "SenML JSON" :  \
-"Unknown"))))))
+((M) == LWM2M_CONTENT_SENML_CBOR ? "SenML CBOR" :  \
+((M) == LWM2M_CONTENT_LWM2M_CBOR ? "LwM2M CBOR" :  \
+"Unknown"))))))))
 #endif
 
 static void senml_json_test_data(const char * uriStr,
@@ -152,6 +154,106 @@ static void senml_json_test_data_and_compare(const char * uriStr,
     lwm2m_free(buffer);
 }
 
+#if defined(LWM2M_SUPPORT_SENML_CBOR) || defined(LWM2M_SUPPORT_LWM2M_CBOR)
+static bool senml_json_has_objlink(const lwm2m_data_t * tlvP, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        switch (tlvP[i].type)
+        {
+        case LWM2M_TYPE_OBJECT_LINK:
+            return true;
+        case LWM2M_TYPE_OBJECT:
+        case LWM2M_TYPE_OBJECT_INSTANCE:
+        case LWM2M_TYPE_MULTIPLE_RESOURCE:
+            if (senml_json_has_objlink(tlvP[i].value.asChildren.array, tlvP[i].value.asChildren.count)) return true;
+            break;
+        default:
+            break;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Serializes the data to a CBOR format, parses it back and checks the SenML JSON
+ *        serialization of the result is the one of the original data.
+ */
+static void senml_json_test_cbor(const char * uriStr,
+                                 lwm2m_media_type_t cborFormat,
+                                 lwm2m_data_t * tlvP,
+                                 int size,
+                                 const char * id)
+{
+    lwm2m_media_type_t format;
+    lwm2m_data_t * parsedP;
+    lwm2m_uri_t uri;
+    lwm2m_uri_t * uriP = NULL;
+    uint8_t * jsonBuffer;
+    uint8_t * cborBuffer;
+    uint8_t * buffer;
+    int jsonLength;
+    int cborLength;
+    int length;
+    int parsedSize;
+
+    if (uriStr != NULL)
+    {
+        lwm2m_stringToUri(uriStr, strlen(uriStr), &uri);
+        uriP = &uri;
+    }
+
+    format = LWM2M_CONTENT_SENML_JSON;
+    jsonLength = lwm2m_data_serialize(uriP, size, tlvP, &format, &jsonBuffer);
+    CU_ASSERT_TRUE_FATAL(jsonLength > 0)
+    format = cborFormat;
+    cborLength = lwm2m_data_serialize(uriP, size, tlvP, &format, &cborBuffer);
+    if (cborLength <= 0)
+    {
+        printf("(Serialize lwm2m_data_t %s to %s failed.)\t", id, STR_MEDIA_TYPE(cborFormat));
+    }
+    CU_ASSERT_TRUE_FATAL(cborLength > 0)
+    CU_ASSERT_EQUAL(format, cborFormat)
+    CU_ASSERT_TRUE(cborLength < jsonLength)
+
+    parsedSize = lwm2m_data_parse(uriP, cborBuffer, cborLength, cborFormat, &parsedP);
+    if (parsedSize <= 0)
+    {
+        printf("(Parsing %s from %s failed.)\t", id, STR_MEDIA_TYPE(cborFormat));
+    }
+    CU_ASSERT_TRUE_FATAL(parsedSize > 0)
+
+    // LwM2M CBOR encodes object links as text strings, they are parsed back as strings
+    if (cborFormat == LWM2M_CONTENT_LWM2M_CBOR && senml_json_has_objlink(tlvP, size))
+    {
+        lwm2m_data_free(parsedSize, parsedP);
+        lwm2m_free(cborBuffer);
+        lwm2m_free(jsonBuffer);
+        return;
+    }
+
+    format = LWM2M_CONTENT_SENML_JSON;
+    length = lwm2m_data_serialize(uriP, parsedSize, parsedP, &format, &buffer);
+    CU_ASSERT_EQUAL(length, jsonLength)
+    if (length != jsonLength || memcmp(buffer, jsonBuffer, length) != 0)
+    {
+        printf("Comparing SenML JSON after a %s round trip failed for %s:\n", STR_MEDIA_TYPE(cborFormat), id);
+        fprintf(stdout, "%.*s\n", length, buffer);
+        printf("\ninstead of:\n");
+        fprintf(stdout, "%.*s\n", jsonLength, jsonBuffer);
+        CU_FAIL("Comparing SenML JSON after a CBOR round trip failed");
+    }
+
+    lwm2m_free(buffer);
+    lwm2m_data_free(parsedSize, parsedP);
+    lwm2m_free(cborBuffer);
+    lwm2m_free(jsonBuffer);
+}
+#endif
+
 /**
  * @brief Parses the testBuf to an array of lwm2m_data_t objects and serializes the result
  *        to TLV and JSON and if applicable compares it to the original testBuf.
@@ -194,6 +296,12 @@ static void senml_json_test_raw(const char * uriStr,
     else if (format == LWM2M_CONTENT_SENML_JSON)
     {
         senml_json_test_data(uriStr, LWM2M_CONTENT_TLV, tlvP, size, id);
+#ifdef LWM2M_SUPPORT_SENML_CBOR
+        senml_json_test_cbor(uriStr, LWM2M_CONTENT_SENML_CBOR, tlvP, size, id);
+#endif
+#ifdef LWM2M_SUPPORT_LWM2M_CBOR
+        senml_json_test_cbor(uriStr, LWM2M_CONTENT_LWM2M_CBOR, tlvP, size, id);
+#endif
     }
     lwm2m_data_free(size, tlvP);
 }
@@ -227,7 +335,15 @@ static void senml_json_test_raw_expected(const char * uriStr,
     else if (format == LWM2M_CONTENT_JSON)
         senml_json_test_data(uriStr, LWM2M_CONTENT_TLV, tlvP, size, id);
     else if (format == LWM2M_CONTENT_SENML_JSON)
+    {
         senml_json_test_data(uriStr, LWM2M_CONTENT_TLV, tlvP, size, id);
+#ifdef LWM2M_SUPPORT_SENML_CBOR
+        senml_json_test_cbor(uriStr, LWM2M_CONTENT_SENML_CBOR, tlvP, size, id);
+#endif
+#ifdef LWM2M_SUPPORT_LWM2M_CBOR
+        senml_json_test_cbor(uriStr, LWM2M_CONTENT_LWM2M_CBOR, tlvP, size, id);
+#endif
+    }
     lwm2m_data_free(size, tlvP);
 }
 
@@ -655,6 +771,376 @@ static void senml_json_test_26(void)
     senml_json_test_raw("/34/0/2", (uint8_t *)buffer2, strlen(buffer2), LWM2M_CONTENT_SENML_JSON, "26b");
 }
 
+static void senml_json_test_27(void)
+{
+    /* Strings with escaped characters around eight bytes boundaries */
+    const char * buffer = "[ {\"bn\" : \"/34/0/\" ,\n  \"n\" : \"1\" , \"vs\" : \"a\\\\\"} ,\n"
+                          "  {\"n\":\"2\",\"vs\":\"abcdefg\\\"hijklmnopq\\\"rstuvwx\\\\\\\"0\"}\n]";
+    /* Trailing separators and unterminated strings */
+    const char * trailingRecord = "[{\"bn\":\"/34/0/1\",\"vs\":\"a\",}]";
+    const char * trailingArray = "[{\"bn\":\"/34/0/1\",\"vs\":\"a\"},]";
+    const char * unterminated = "[{\"bn\":\"/34/0/1\",\"vs\":\"a\\\"}]";
+    const char * noColon = "[{\"bn\":\"/34/0/1\",\"vs\" \"a\"}]";
+    const char * emptyRecord = "[{}]";
+    lwm2m_data_t * dataP;
+    lwm2m_uri_t uri;
+    int size;
+
+    lwm2m_stringToUri("/34/0", 5, &uri);
+    size = lwm2m_data_parse(&uri, (const uint8_t *)buffer, strlen(buffer), LWM2M_CONTENT_SENML_JSON, &dataP);
+    CU_ASSERT_EQUAL_FATAL(size, 2)
+    CU_ASSERT_EQUAL(dataP[0].type, LWM2M_TYPE_STRING)
+    CU_ASSERT_EQUAL_FATAL(dataP[0].value.asBuffer.length, 2)
+    CU_ASSERT_EQUAL(memcmp(dataP[0].value.asBuffer.buffer, "a\\", 2), 0)
+    CU_ASSERT_EQUAL(dataP[1].type, LWM2M_TYPE_STRING)
+    CU_ASSERT_EQUAL_FATAL(dataP[1].value.asBuffer.length, 29)
+    CU_ASSERT_EQUAL(memcmp(dataP[1].value.asBuffer.buffer, "abcdefg\"hijklmnopq\"rstuvwx\\\"0", 29), 0)
+    lwm2m_data_free(size, dataP);
+
+    senml_json_test_raw_error("/34/0/1", (const uint8_t *)trailingRecord, strlen(trailingRecord), LWM2M_CONTENT_SENML_JSON, "27a");
+    senml_json_test_raw_error("/34/0/1", (const uint8_t *)trailingArray, strlen(trailingArray), LWM2M_CONTENT_SENML_JSON, "27b");
+    senml_json_test_raw_error("/34/0/1", (const uint8_t *)unterminated, strlen(unterminated), LWM2M_CONTENT_SENML_JSON, "27c");
+    senml_json_test_raw_error("/34/0/1", (const uint8_t *)noColon, strlen(noColon), LWM2M_CONTENT_SENML_JSON, "27d");
+    senml_json_test_raw_error("/34/0/1", (const uint8_t *)emptyRecord, strlen(emptyRecord), LWM2M_CONTENT_SENML_JSON, "27e");
+}
+
+static void senml_json_test_28(void)
+{
+    /* A resource instance below a single resource */
+    const char * buffer = "[{\"bn\":\"/3/0/\",\"n\":\"1\",\"v\":1234567890123},{\"n\":\"1/0\",\"v\":7}]";
+    const char * jsonBuffer = "{\"bn\":\"/3/0/\",\"e\":[{\"n\":\"1\",\"v\":1234567890123},{\"n\":\"1/0\",\"v\":7}]}";
+
+    senml_json_test_raw_error(NULL, (const uint8_t *)buffer, strlen(buffer), LWM2M_CONTENT_SENML_JSON, "28a");
+    senml_json_test_raw_error(NULL, (const uint8_t *)jsonBuffer, strlen(jsonBuffer), LWM2M_CONTENT_JSON, "28b");
+}
+
+static void senml_test_large(lwm2m_media_type_t expectedFormat)
+{
+    /* Serialize an instance of about 100 KB and parse it back */
+    const int count = 400;
+    const size_t valueLength = 250;
+    lwm2m_media_type_t format = expectedFormat;
+    lwm2m_data_t * dataP;
+    lwm2m_data_t * parsedP;
+    lwm2m_uri_t uri;
+    uint8_t * value;
+    uint8_t * buffer;
+    int length;
+    int size;
+    int i;
+
+    value = (uint8_t *)lwm2m_malloc(valueLength);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(value)
+    dataP = lwm2m_data_new(count);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(dataP)
+    for (i = 0; i < count; i++)
+    {
+        size_t j;
+
+        for (j = 0; j < valueLength; j++)
+        {
+            value[j] = 'a' + (i + j) % 26;
+        }
+        // a character to escape
+        value[i % valueLength] = '"';
+        dataP[i].id = (uint16_t)i;
+        lwm2m_data_encode_nstring((const char *)value, valueLength, dataP + i);
+    }
+
+    lwm2m_stringToUri("/1024/0", 7, &uri);
+    length = lwm2m_data_serialize(&uri, count, dataP, &format, &buffer);
+    CU_ASSERT_EQUAL(format, expectedFormat)
+    CU_ASSERT_FATAL((size_t)length > count * valueLength)
+    if (format == LWM2M_CONTENT_SENML_JSON)
+    {
+        CU_ASSERT_EQUAL(buffer[0], '[')
+        CU_ASSERT_EQUAL(buffer[length - 1], ']')
+    }
+
+    size = lwm2m_data_parse(&uri, buffer, length, format, &parsedP);
+    CU_ASSERT_EQUAL_FATAL(size, count)
+    for (i = 0; i < count; i++)
+    {
+        CU_ASSERT_EQUAL(parsedP[i].id, dataP[i].id)
+        CU_ASSERT_EQUAL(parsedP[i].type, LWM2M_TYPE_STRING)
+        CU_ASSERT_EQUAL_FATAL(parsedP[i].value.asBuffer.length, valueLength)
+        CU_ASSERT_EQUAL(memcmp(parsedP[i].value.asBuffer.buffer, dataP[i].value.asBuffer.buffer, valueLength), 0)
+    }
+
+    lwm2m_data_free(size, parsedP);
+    lwm2m_free(buffer);
+    lwm2m_data_free(count, dataP);
+    lwm2m_free(value);
+}
+
+static void senml_json_test_large(void)
+{
+    senml_test_large(LWM2M_CONTENT_SENML_JSON);
+}
+
+#ifdef LWM2M_SUPPORT_SENML_CBOR
+static void senml_cbor_test_1(void)
+{
+    /* [{-2: "/3/0/", 0: "0", 3: "Open Mobile Alliance"}, {0: "9", 2: 95}, {0: "13", 2: 1.5}] */
+    const uint8_t buffer[] = {
+        0x83,
+        0xA3, 0x21, 0x65, '/', '3', '/', '0', '/', 0x00, 0x61, '0',
+              0x03, 0x74, 'O', 'p', 'e', 'n', ' ', 'M', 'o', 'b', 'i', 'l', 'e', ' ',
+                          'A', 'l', 'l', 'i', 'a', 'n', 'c', 'e',
+        0xA2, 0x00, 0x61, '9', 0x02, 0x18, 0x5F,
+        0xA2, 0x00, 0x62, '1', '3', 0x02, 0xF9, 0x3E, 0x00
+    };
+    /* [{-2: "/34/0/", 0: "1", 4: true}, {0: "2", 8: h'0102'}, {0: "3", "vlo": "3:0"}, {0: "4", 2: -300}] */
+    const uint8_t buffer2[] = {
+        0x84,
+        0xA3, 0x21, 0x66, '/', '3', '4', '/', '0', '/', 0x00, 0x61, '1', 0x04, 0xF5,
+        0xA2, 0x00, 0x61, '2', 0x08, 0x42, 0x01, 0x02,
+        0xA2, 0x00, 0x61, '3', 0x63, 'v', 'l', 'o', 0x63, '3', ':', '0',
+        0xA2, 0x00, 0x61, '4', 0x02, 0x39, 0x01, 0x2B
+    };
+    lwm2m_data_t * dataP;
+    lwm2m_uri_t uri;
+    int size;
+
+    senml_json_test_raw("/3/0", buffer, sizeof(buffer), LWM2M_CONTENT_SENML_CBOR, "cbor1a");
+    senml_json_test_raw("/34/0", buffer2, sizeof(buffer2), LWM2M_CONTENT_SENML_CBOR, "cbor1b");
+
+    lwm2m_stringToUri("/34/0", 5, &uri);
+    size = lwm2m_data_parse(&uri, buffer2, sizeof(buffer2), LWM2M_CONTENT_SENML_CBOR, &dataP);
+    CU_ASSERT_EQUAL_FATAL(size, 4)
+    CU_ASSERT_EQUAL(dataP[0].type, LWM2M_TYPE_BOOLEAN)
+    CU_ASSERT_TRUE(dataP[0].value.asBoolean)
+    CU_ASSERT_EQUAL(dataP[1].type, LWM2M_TYPE_OPAQUE)
+    CU_ASSERT_EQUAL(dataP[1].value.asBuffer.length, 2)
+    CU_ASSERT_EQUAL(dataP[2].type, LWM2M_TYPE_OBJECT_LINK)
+    CU_ASSERT_EQUAL(dataP[2].value.asObjLink.objectId, 3)
+    CU_ASSERT_EQUAL(dataP[2].value.asObjLink.objectInstanceId, 0)
+    CU_ASSERT_EQUAL(dataP[3].type, LWM2M_TYPE_INTEGER)
+    CU_ASSERT_EQUAL(dataP[3].value.asInteger, -300)
+    lwm2m_data_free(size, dataP);
+}
+
+static void senml_cbor_test_2(void)
+{
+    /* Unknown labels are skipped, whatever their value */
+    /* [{0: "/3/0/0", 2: 1, 100: [1, {1: 2}], "foo": "bar"}] */
+    const uint8_t buffer[] = {
+        0x81, 0xA4, 0x00, 0x66, '/', '3', '/', '0', '/', '0', 0x02, 0x01,
+        0x18, 0x64, 0x82, 0x01, 0xA1, 0x01, 0x02,
+        0x63, 'f', 'o', 'o', 0x63, 'b', 'a', 'r'
+    };
+    /* Indefinite length array */
+    const uint8_t indefinite[] = { 0x9F, 0xA2, 0x00, 0x66, '/', '3', '/', '0', '/', '0', 0x02, 0x01, 0xFF };
+    /* Trailing byte after the array */
+    const uint8_t trailing[] = { 0x81, 0xA2, 0x00, 0x66, '/', '3', '/', '0', '/', '0', 0x02, 0x01, 0x00 };
+    /* Truncated record */
+    const uint8_t truncated[] = { 0x81, 0xA2, 0x00, 0x66, '/', '3', '/', '0', '/', '0', 0x02 };
+    /* Label ending with '_' must be understood */
+    const uint8_t mustUnderstand[] = { 0x81, 0xA3, 0x00, 0x66, '/', '3', '/', '0', '/', '0', 0x02, 0x01, 0x64, 'f', 'o', 'o', '_', 0x01 };
+    /* Duplicated name */
+    const uint8_t duplicate[] = { 0x81, 0xA3, 0x00, 0x66, '/', '3', '/', '0', '/', '0', 0x00, 0x61, '1', 0x02, 0x01 };
+    /* Unsupported version */
+    const uint8_t version[] = { 0x81, 0xA3, 0x20, 0x0B, 0x00, 0x66, '/', '3', '/', '0', '/', '0', 0x02, 0x01 };
+    /* Text value with the numeric label */
+    const uint8_t type[] = { 0x81, 0xA2, 0x00, 0x66, '/', '3', '/', '0', '/', '0', 0x02, 0x61, '1' };
+    /* Empty array */
+    const uint8_t empty[] = { 0x80 };
+    lwm2m_data_t * dataP;
+    lwm2m_uri_t uri;
+    int size;
+
+    lwm2m_stringToUri("/3/0", 4, &uri);
+    size = lwm2m_data_parse(&uri, buffer, sizeof(buffer), LWM2M_CONTENT_SENML_CBOR, &dataP);
+    CU_ASSERT_EQUAL_FATAL(size, 1)
+    CU_ASSERT_EQUAL(dataP->id, 0)
+    CU_ASSERT_EQUAL(dataP->type, LWM2M_TYPE_UNSIGNED_INTEGER)
+    CU_ASSERT_EQUAL(dataP->value.asUnsigned, 1)
+    lwm2m_data_free(size, dataP);
+
+    senml_json_test_raw_error("/3/0", indefinite, sizeof(indefinite), LWM2M_CONTENT_SENML_CBOR, "cbor2a");
+    senml_json_test_raw_error("/3/0", trailing, sizeof(trailing), LWM2M_CONTENT_SENML_CBOR, "cbor2b");
+    senml_json_test_raw_error("/3/0", truncated, sizeof(truncated), LWM2M_CONTENT_SENML_CBOR, "cbor2c");
+    senml_json_test_raw_error("/3/0", mustUnderstand, sizeof(mustUnderstand), LWM2M_CONTENT_SENML_CBOR, "cbor2d");
+    senml_json_test_raw_error("/3/0", duplicate, sizeof(duplicate), LWM2M_CONTENT_SENML_CBOR, "cbor2e");
+    senml_json_test_raw_error("/3/0", version, sizeof(version), LWM2M_CONTENT_SENML_CBOR, "cbor2f");
+    senml_json_test_raw_error("/3/0", type, sizeof(type), LWM2M_CONTENT_SENML_CBOR, "cbor2g");
+    senml_json_test_raw_error("/3/0", empty, sizeof(empty), LWM2M_CONTENT_SENML_CBOR, "cbor2h");
+}
+
+static void senml_cbor_test_float(double value, size_t expectedLength)
+{
+    uint8_t buffer[9];
+    cbor_item_t item;
+    size_t length;
+
+    length = cbor_putFloat(buffer, sizeof(buffer), value);
+    CU_ASSERT_EQUAL(length, expectedLength)
+    CU_ASSERT_EQUAL(cbor_getItem(buffer, length, &item), (int)length)
+    CU_ASSERT_EQUAL(item.type, CBOR_TYPE_FLOAT)
+    CU_ASSERT_EQUAL(memcmp(&item.asFloat, &value, sizeof(value)), 0)
+    // too small buffers are rejected
+    CU_ASSERT_EQUAL(cbor_putFloat(buffer, length - 1, value), 0)
+}
+
+static void senml_cbor_test_3(void)
+{
+    /* Floats use the shortest encoding keeping their exact value */
+    senml_cbor_test_float(0.0, 3);
+    senml_cbor_test_float(-0.0, 3);
+    senml_cbor_test_float(1.5, 3);
+    senml_cbor_test_float(-65504.0, 3);
+    senml_cbor_test_float(5.960464477539063e-8, 3);    // smallest half subnormal
+    senml_cbor_test_float(65505.0, 5);
+    senml_cbor_test_float(100000.0, 5);
+    senml_cbor_test_float(1.401298464324817e-45, 5);   // smallest single subnormal
+    senml_cbor_test_float(0.1, 9);
+    senml_cbor_test_float(1e300, 9);
+    senml_cbor_test_float(1.0 / 0.0, 3);
+    senml_cbor_test_float(-1.0 / 0.0, 3);
+}
+
+static void senml_cbor_test_4(void)
+{
+    /* [{-2: "/3/0/", 0: "1", 2: 5}, {0: "1/0", 2: 7}] */
+    const uint8_t instanceOfSingle[] = {
+        0x82, 0xA3, 0x21, 0x65, '/', '3', '/', '0', '/', 0x00, 0x61, '1', 0x02, 0x05,
+              0xA2, 0x00, 0x63, '1', '/', '0', 0x02, 0x07
+    };
+    /* [{0: "/3/0", 2: 5}, {0: "/3/0/1", 2: 7}] */
+    const uint8_t resourceOfValue[] = {
+        0x82, 0xA2, 0x00, 0x64, '/', '3', '/', '0', 0x02, 0x05,
+              0xA2, 0x00, 0x66, '/', '3', '/', '0', '/', '1', 0x02, 0x07
+    };
+    /* [{0: "/3/0/1/0", 2: 7}, {0: "/3/0/1", 2: 5}] */
+    const uint8_t valueOfMultiple[] = {
+        0x82, 0xA2, 0x00, 0x68, '/', '3', '/', '0', '/', '1', '/', '0', 0x02, 0x07,
+              0xA2, 0x00, 0x66, '/', '3', '/', '0', '/', '1', 0x02, 0x05
+    };
+
+    /* A path below a value is malformed */
+    senml_json_test_raw_error(NULL, instanceOfSingle, sizeof(instanceOfSingle), LWM2M_CONTENT_SENML_CBOR, "cbor4a");
+    senml_json_test_raw_error(NULL, resourceOfValue, sizeof(resourceOfValue), LWM2M_CONTENT_SENML_CBOR, "cbor4b");
+    senml_json_test_raw_error(NULL, valueOfMultiple, sizeof(valueOfMultiple), LWM2M_CONTENT_SENML_CBOR, "cbor4c");
+}
+
+static void senml_cbor_test_large(void)
+{
+    senml_test_large(LWM2M_CONTENT_SENML_CBOR);
+}
+#endif
+
+#ifdef LWM2M_SUPPORT_LWM2M_CBOR
+static void lwm2m_cbor_test_1(void)
+{
+    /* {[3, 0]: {0: "ab", 9: 95, 13: 1.5}} */
+    const uint8_t buffer[] = {
+        0xA1, 0x82, 0x03, 0x00,
+        0xA3, 0x00, 0x62, 'a', 'b', 0x09, 0x18, 0x5F, 0x0D, 0xF9, 0x3E, 0x00
+    };
+    /* {[34, 0]: {1: true, 2: h'0102', [3, 0]: -300, 4: {0: 1, 1: null}}} */
+    const uint8_t buffer2[] = {
+        0xA1, 0x82, 0x18, 0x22, 0x00,
+        0xA4, 0x01, 0xF5, 0x02, 0x42, 0x01, 0x02, 0x82, 0x03, 0x00, 0x39, 0x01, 0x2B,
+              0x04, 0xA2, 0x00, 0x01, 0x01, 0xF6
+    };
+    /* {3: {[0, 0]: 1, [1, 0]: 2}} */
+    const uint8_t buffer3[] = { 0xA1, 0x03, 0xA2, 0x82, 0x00, 0x00, 0x01, 0x82, 0x01, 0x00, 0x02 };
+    lwm2m_data_t * dataP;
+    lwm2m_uri_t uri;
+    int size;
+
+    senml_json_test_raw("/3/0", buffer, sizeof(buffer), LWM2M_CONTENT_LWM2M_CBOR, "lwm2mcbor1a");
+    senml_json_test_raw("/34/0", buffer2, sizeof(buffer2), LWM2M_CONTENT_LWM2M_CBOR, "lwm2mcbor1b");
+    senml_json_test_raw("/3", buffer3, sizeof(buffer3), LWM2M_CONTENT_LWM2M_CBOR, "lwm2mcbor1c");
+
+    lwm2m_stringToUri("/34/0", 5, &uri);
+    size = lwm2m_data_parse(&uri, buffer2, sizeof(buffer2), LWM2M_CONTENT_LWM2M_CBOR, &dataP);
+    CU_ASSERT_EQUAL_FATAL(size, 4)
+    CU_ASSERT_EQUAL(dataP[0].type, LWM2M_TYPE_BOOLEAN)
+    CU_ASSERT_TRUE(dataP[0].value.asBoolean)
+    CU_ASSERT_EQUAL(dataP[1].type, LWM2M_TYPE_OPAQUE)
+    CU_ASSERT_EQUAL(dataP[1].value.asBuffer.length, 2)
+    CU_ASSERT_EQUAL(dataP[2].type, LWM2M_TYPE_MULTIPLE_RESOURCE)
+    CU_ASSERT_EQUAL_FATAL(dataP[2].value.asChildren.count, 1)
+    CU_ASSERT_EQUAL(dataP[2].value.asChildren.array[0].type, LWM2M_TYPE_INTEGER)
+    CU_ASSERT_EQUAL(dataP[2].value.asChildren.array[0].value.asInteger, -300)
+    CU_ASSERT_EQUAL(dataP[3].type, LWM2M_TYPE_MULTIPLE_RESOURCE)
+    CU_ASSERT_EQUAL_FATAL(dataP[3].value.asChildren.count, 2)
+    CU_ASSERT_EQUAL(dataP[3].value.asChildren.array[1].type, LWM2M_TYPE_UNDEFINED)
+    lwm2m_data_free(size, dataP);
+}
+
+static void lwm2m_cbor_test_2(void)
+{
+    /* Paths do not have to be collapsed, epoch time tags are accepted */
+    /* {3: {0: {0: "ab", 13: 1(1700000000)}}} */
+    const uint8_t buffer[] = {
+        0xA1, 0x03, 0xA1, 0x00, 0xA2, 0x00, 0x62, 'a', 'b', 0x0D, 0xC1, 0x1A, 0x65, 0x53, 0xF1, 0x00
+    };
+    /* {[3, 0]: {0: "ab", 13: 1700000000}} */
+    const uint8_t expected[] = {
+        0xA1, 0x82, 0x03, 0x00, 0xA2, 0x00, 0x62, 'a', 'b', 0x0D, 0x1A, 0x65, 0x53, 0xF1, 0x00
+    };
+    /* Path longer than a Resource Instance path */
+    const uint8_t deep[] = { 0xA1, 0x85, 0x03, 0x00, 0x00, 0x00, 0x00, 0x01 };
+    /* Value at the Object level */
+    const uint8_t object[] = { 0xA1, 0x03, 0x01 };
+    /* Indefinite length map */
+    const uint8_t indefinite[] = { 0xBF, 0x83, 0x03, 0x00, 0x00, 0x01, 0xFF };
+    /* Trailing byte after the map */
+    const uint8_t trailing[] = { 0xA1, 0x83, 0x03, 0x00, 0x00, 0x01, 0x00 };
+    /* Truncated map */
+    const uint8_t truncated[] = { 0xA2, 0x83, 0x03, 0x00, 0x00, 0x01 };
+    /* Text key */
+    const uint8_t text[] = { 0xA1, 0x61, '3', 0x01 };
+    /* Reserved ID */
+    const uint8_t reserved[] = { 0xA1, 0x83, 0x03, 0x00, 0x19, 0xFF, 0xFF, 0x01 };
+    /* Unknown tag */
+    const uint8_t tag[] = { 0xA1, 0x83, 0x03, 0x00, 0x00, 0xC2, 0x41, 0x01 };
+    /* Empty map */
+    const uint8_t empty[] = { 0xA0 };
+
+    senml_json_test_raw_expected("/3/0", buffer, sizeof(buffer), (const char *)expected, sizeof(expected), LWM2M_CONTENT_LWM2M_CBOR, "lwm2mcbor2");
+
+    senml_json_test_raw_error("/3/0", deep, sizeof(deep), LWM2M_CONTENT_LWM2M_CBOR, "lwm2mcbor2a");
+    senml_json_test_raw_error("/3", object, sizeof(object), LWM2M_CONTENT_LWM2M_CBOR, "lwm2mcbor2b");
+    senml_json_test_raw_error("/3/0", indefinite, sizeof(indefinite), LWM2M_CONTENT_LWM2M_CBOR, "lwm2mcbor2c");
+    senml_json_test_raw_error("/3/0", trailing, sizeof(trailing), LWM2M_CONTENT_LWM2M_CBOR, "lwm2mcbor2d");
+    senml_json_test_raw_error("/3/0", truncated, sizeof(truncated), LWM2M_CONTENT_LWM2M_CBOR, "lwm2mcbor2e");
+    senml_json_test_raw_error("/3/0", text, sizeof(text), LWM2M_CONTENT_LWM2M_CBOR, "lwm2mcbor2f");
+    senml_json_test_raw_error("/3/0", reserved, sizeof(reserved), LWM2M_CONTENT_LWM2M_CBOR, "lwm2mcbor2g");
+    senml_json_test_raw_error("/3/0", tag, sizeof(tag), LWM2M_CONTENT_LWM2M_CBOR, "lwm2mcbor2h");
+    senml_json_test_raw_error("/3/0", empty, sizeof(empty), LWM2M_CONTENT_LWM2M_CBOR, "lwm2mcbor2i");
+}
+
+static void lwm2m_cbor_test_3(void)
+{
+    /* A Resource is either single or multiple */
+    /* {[3, 0]: {1: 5, [1, 0]: 7}} */
+    const uint8_t belowSingle[] = { 0xA1, 0x82, 0x03, 0x00, 0xA2, 0x01, 0x05, 0x82, 0x01, 0x00, 0x07 };
+    /* {[3, 0, 1]: 5, [3, 0, 1]: {0: 7}} */
+    const uint8_t mapOfSingle[] = { 0xA2, 0x83, 0x03, 0x00, 0x01, 0x05, 0x83, 0x03, 0x00, 0x01, 0xA1, 0x00, 0x07 };
+    /* {[3, 0]: {1: 5}, [3, 0, 1, 0]: 7} */
+    const uint8_t laterInstance[] = {
+        0xA2, 0x82, 0x03, 0x00, 0xA1, 0x01, 0x05, 0x84, 0x03, 0x00, 0x01, 0x00, 0x07
+    };
+    /* {[3, 0, 1, 0]: 7, [3, 0, 1]: 5} */
+    const uint8_t overMultiple[] = {
+        0xA2, 0x84, 0x03, 0x00, 0x01, 0x00, 0x07, 0x83, 0x03, 0x00, 0x01, 0x05
+    };
+
+    senml_json_test_raw_error("/3/0", belowSingle, sizeof(belowSingle), LWM2M_CONTENT_LWM2M_CBOR, "lwm2mcbor3a");
+    senml_json_test_raw_error("/3/0", mapOfSingle, sizeof(mapOfSingle), LWM2M_CONTENT_LWM2M_CBOR, "lwm2mcbor3b");
+    senml_json_test_raw_error("/3/0", laterInstance, sizeof(laterInstance), LWM2M_CONTENT_LWM2M_CBOR, "lwm2mcbor3c");
+    senml_json_test_raw_error("/3/0", overMultiple, sizeof(overMultiple), LWM2M_CONTENT_LWM2M_CBOR, "lwm2mcbor3d");
+}
+
+static void lwm2m_cbor_test_large(void)
+{
+    senml_test_large(LWM2M_CONTENT_LWM2M_CBOR);
+}
+#endif
+
 static struct TestTable table[] = {
         { "test of senml_json_test_1()", senml_json_test_1 },
         { "test of senml_json_test_2()", senml_json_test_2 },
@@ -682,6 +1168,22 @@ static struct TestTable table[] = {
         { "test of senml_json_test_24()", senml_json_test_24 },
         { "test of senml_json_test_25()", senml_json_test_25 },
         { "test of senml_json_test_26()", senml_json_test_26 },
+        { "test of senml_json_test_27()", senml_json_test_27 },
+        { "test of senml_json_test_28()", senml_json_test_28 },
+        { "test of a 100 KB SenML JSON payload", senml_json_test_large },
+#ifdef LWM2M_SUPPORT_SENML_CBOR
+        { "test of senml_cbor_test_1()", senml_cbor_test_1 },
+        { "test of senml_cbor_test_2()", senml_cbor_test_2 },
+        { "test of senml_cbor_test_3()", senml_cbor_test_3 },
+        { "test of senml_cbor_test_4()", senml_cbor_test_4 },
+        { "test of a 100 KB SenML CBOR payload", senml_cbor_test_large },
+#endif
+#ifdef LWM2M_SUPPORT_LWM2M_CBOR
+        { "test of lwm2m_cbor_test_1()", lwm2m_cbor_test_1 },
+        { "test of lwm2m_cbor_test_2()", lwm2m_cbor_test_2 },
+        { "test of lwm2m_cbor_test_3()", lwm2m_cbor_test_3 },
+        { "test of a 100 KB LwM2M CBOR payload", lwm2m_cbor_test_large },
+#endif
         { NULL, NULL },
 };
 
@@ -32,6 +32,16 @@ CU_ErrorCode create_object_read_suit();
 CU_ErrorCode create_convert_numbers_suit();
 CU_ErrorCode create_tlv_json_suit();
 CU_ErrorCode create_block1_suit();
+CU_ErrorCode create_block2_suit();
+CU_ErrorCode create_index_suit();
+CU_ErrorCode create_transaction_suit();
+CU_ErrorCode create_scheduler_suit();
+CU_ErrorCode create_thread_suit();
+CU_ErrorCode create_observe_suit();
+CU_ErrorCode create_queue_suit();
+#ifdef LWM2M_DATA_ARENA
+CU_ErrorCode create_data_arena_suit();
+#endif
 #ifdef LWM2M_SUPPORT_SENML_JSON
 CU_ErrorCode create_senml_json_suit();
 #endif
@@ -0,0 +1,161 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+/*
+ * Contexts share no state: each thread below runs its own context. Build
+ * with -DSANITIZER=thread to check it.
+ */
+
+#include "tests.h"
+#include "CUnit/Basic.h"
+#include "connection.h"
+#include "internals.h"
+#include "liblwm2m.h"
+
+#include <pthread.h>
+
+#define THREAD_COUNT      4
+#define THREAD_ITERATIONS 2000
+
+typedef struct {
+    connection_t connection; // first member, the send callback gets the connection
+    lwm2m_context_t *contextP;
+    uint16_t blockSize;
+    size_t sent;
+    size_t errors;
+    size_t wrongBlockSize;
+    size_t badOptions;
+    size_t wrongErrorMessage;
+} thread_state_t;
+
+static int record_send(uint8_t const *buffer, size_t length, void *userData) {
+    thread_state_t *stateP = (thread_state_t *)userData;
+    coap_packet_t packet;
+
+    stateP->sent++;
+    if (NO_ERROR != coap_parse_message(&packet, (uint8_t *)buffer, (uint16_t)length)) {
+        stateP->errors++;
+        return 0;
+    }
+
+    if (packet.code == COAP_POST) {
+        // a request larger than the block size of the context
+        if (!IS_OPTION(&packet, COAP_OPTION_BLOCK1) || packet.block1_size != stateP->blockSize) {
+            stateP->wrongBlockSize++;
+        }
+    } else if (packet.code == COAP_402_BAD_OPTION) {
+        stateP->badOptions++;
+        if (packet.payload_len != strlen("Unsupported critical option") ||
+            memcmp(packet.payload, "Unsupported critical option", packet.payload_len) != 0) {
+            stateP->wrongErrorMessage++;
+        }
+    }
+    coap_free_header(&packet);
+    return 0;
+}
+
+static void send_large_request(thread_state_t *stateP, uint16_t mid) {
+    lwm2m_transaction_t *transacP;
+    static uint8_t payload[2048];
+
+    transacP = transaction_new(&stateP->connection, COAP_POST, NULL, NULL, mid, 4, NULL);
+    if (transacP == NULL) {
+        stateP->errors++;
+        return;
+    }
+    coap_set_header_uri_path(transacP->message, "/rd");
+    transaction_set_payload(stateP->contextP, transacP, payload, sizeof(payload));
+    transaction_add(stateP->contextP, transacP);
+    if (0 != transaction_send(stateP->contextP, transacP)) {
+        stateP->errors++;
+        return;
+    }
+    transaction_remove(stateP->contextP, transacP);
+}
+
+static void handle_bad_option(thread_state_t *stateP, uint16_t mid) {
+    coap_packet_t message;
+    uint8_t buffer[64];
+    size_t length;
+
+    coap_init_message(&message, COAP_TYPE_CON, COAP_GET, mid);
+    length = coap_serialize_message(&message, buffer);
+    // add an unknown critical option (number 9, empty)
+    buffer[length++] = 0x90;
+
+    lwm2m_handle_packet(stateP->contextP, buffer, (int)length, &stateP->connection);
+}
+
+static void *thread_main(void *arg) {
+    thread_state_t *stateP = (thread_state_t *)arg;
+    uint16_t i;
+
+    for (i = 0; i < THREAD_ITERATIONS; i++) {
+        send_large_request(stateP, i);
+        handle_bad_option(stateP, i);
+    }
+    return NULL;
+}
+
+static void test_contexts_in_threads(void) {
+    static const uint16_t blockSizes[THREAD_COUNT] = {16, 64, 256, 1024};
+    thread_state_t states[THREAD_COUNT];
+    pthread_t threads[THREAD_COUNT];
+    int i;
+
+    memset(states, 0, sizeof(states));
+    for (i = 0; i < THREAD_COUNT; i++) {
+        states[i].connection.sendFunc = record_send;
+        states[i].contextP = lwm2m_init(NULL);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(states[i].contextP)
+        states[i].blockSize = blockSizes[i];
+        CU_ASSERT_TRUE(lwm2m_context_set_coap_block_size(states[i].contextP, blockSizes[i]))
+    }
+    CU_ASSERT_FALSE(lwm2m_context_set_coap_block_size(states[0].contextP, 100))
+    CU_ASSERT_EQUAL(lwm2m_context_get_coap_block_size(states[0].contextP), 16)
+
+    for (i = 0; i < THREAD_COUNT; i++) {
+        CU_ASSERT_EQUAL_FATAL(pthread_create(&threads[i], NULL, thread_main, &states[i]), 0)
+    }
+    for (i = 0; i < THREAD_COUNT; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (i = 0; i < THREAD_COUNT; i++) {
+        CU_ASSERT_EQUAL(states[i].sent, 2 * THREAD_ITERATIONS)
+        CU_ASSERT_EQUAL(states[i].errors, 0)
+        CU_ASSERT_EQUAL(states[i].wrongBlockSize, 0)
+        CU_ASSERT_EQUAL(states[i].badOptions, THREAD_ITERATIONS)
+        CU_ASSERT_EQUAL(states[i].wrongErrorMessage, 0)
+        lwm2m_close(states[i].contextP);
+    }
+}
+
+static struct TestTable table[] = {
+    {"test of contexts running in parallel threads", test_contexts_in_threads},
+    {NULL, NULL},
+};
+
+CU_ErrorCode create_thread_suit() {
+    CU_pSuite pSuite = NULL;
+
+    pSuite = CU_add_suite("Suite_thread", NULL, NULL);
+    if (NULL == pSuite) {
+        return CU_get_error();
+    }
+    return add_tests(pSuite, table);
+}
@@ -432,6 +432,89 @@ static void test_15(void)
     lwm2m_data_free(1, tlvP);
 }
 
+static void test_16(void)
+{
+    /* Whitespace around tokens, escaped characters and trailing separators */
+    lwm2m_data_t *tlvP;
+    int size;
+    const char *buffer = "{ \"bn\" : \"/34/0/\" ,\n \"e\" : [ { \"n\" : \"2\" , \"sv\" : \"a\\\\\" } ,\n { \"n\" : \"3\" , \"v\" : 1 } ]\n}";
+    const char *trailingRecord = "{\"bn\":\"/34/0/\",\"e\":[{\"n\":\"2\",\"v\":1,}]}";
+    const char *trailingArray = "{\"bn\":\"/34/0/\",\"e\":[{\"n\":\"2\",\"v\":1},]}";
+    const char *emptyArray = "{\"bn\":\"/34/0/\",\"e\":[]}";
+
+    size = lwm2m_data_parse(NULL, (const uint8_t *)buffer, strlen(buffer), LWM2M_CONTENT_JSON, &tlvP);
+    CU_ASSERT_EQUAL_FATAL(size, 1)
+    lwm2m_data_free(size, tlvP);
+
+    size = lwm2m_data_parse(NULL, (const uint8_t *)trailingRecord, strlen(trailingRecord), LWM2M_CONTENT_JSON, &tlvP);
+    CU_ASSERT_EQUAL(size, -1)
+    size = lwm2m_data_parse(NULL, (const uint8_t *)trailingArray, strlen(trailingArray), LWM2M_CONTENT_JSON, &tlvP);
+    CU_ASSERT_EQUAL(size, -1)
+    size = lwm2m_data_parse(NULL, (const uint8_t *)emptyArray, strlen(emptyArray), LWM2M_CONTENT_JSON, &tlvP);
+    CU_ASSERT_EQUAL(size, -1)
+}
+
+static void test_serialize_into_format(const char * uriStr,
+                                       lwm2m_media_type_t format,
+                                       lwm2m_data_t * dataP,
+                                       int size)
+{
+    lwm2m_uri_t uri;
+    lwm2m_media_type_t intoFormat = format;
+    uint8_t * expected;
+    uint8_t * buffer;
+    int length;
+
+    lwm2m_stringToUri(uriStr, strlen(uriStr), &uri);
+    length = lwm2m_data_serialize(&uri, size, dataP, &format, &expected);
+    CU_ASSERT_FATAL(length > 0)
+
+    // exact size, allocated to let the sanitizer catch overflows
+    buffer = (uint8_t *)lwm2m_malloc(length);
+    CU_ASSERT_EQUAL(lwm2m_data_serialize_into(&uri, size, dataP, &intoFormat, buffer, length), length)
+    CU_ASSERT_EQUAL(intoFormat, format)
+    CU_ASSERT_EQUAL(memcmp(buffer, expected, length), 0)
+
+    // too small, the required size is returned
+    CU_ASSERT_EQUAL(lwm2m_data_serialize_into(&uri, size, dataP, &intoFormat, buffer, length - 1), length)
+    CU_ASSERT_EQUAL(lwm2m_data_serialize_into(&uri, size, dataP, &intoFormat, buffer, 0), length)
+
+    lwm2m_free(buffer);
+    lwm2m_free(expected);
+}
+
+static void test_serialize_into(void)
+{
+    lwm2m_data_t * dataP;
+    uint8_t opaque[] = {1, 2, 3, 4, 5, 6, 7};
+
+    dataP = lwm2m_data_new(5);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(dataP)
+    dataP[0].id = 0;
+    lwm2m_data_encode_string("Open Mobile Alliance", dataP + 0);
+    dataP[1].id = 1;
+    lwm2m_data_encode_int(-70000, dataP + 1);
+    dataP[2].id = 2;
+    lwm2m_data_encode_float(23.5, dataP + 2);
+    dataP[3].id = 3;
+    lwm2m_data_encode_bool(true, dataP + 3);
+    dataP[4].id = 4;
+    lwm2m_data_encode_opaque(opaque, sizeof(opaque), dataP + 4);
+
+    test_serialize_into_format("/3/0/0", LWM2M_CONTENT_TEXT, dataP + 0, 1);
+    test_serialize_into_format("/3/0/1", LWM2M_CONTENT_TEXT, dataP + 1, 1);
+    test_serialize_into_format("/3/0/2", LWM2M_CONTENT_TEXT, dataP + 2, 1);
+    test_serialize_into_format("/3/0/4", LWM2M_CONTENT_TEXT, dataP + 4, 1);
+    test_serialize_into_format("/3/0/4", LWM2M_CONTENT_OPAQUE, dataP + 4, 1);
+    test_serialize_into_format("/3/0", LWM2M_CONTENT_TLV, dataP, 5);
+    test_serialize_into_format("/3/0", LWM2M_CONTENT_JSON, dataP, 5);
+#ifdef LWM2M_SUPPORT_SENML_JSON
+    test_serialize_into_format("/3/0", LWM2M_CONTENT_SENML_JSON, dataP, 5);
+#endif
+
+    lwm2m_data_free(5, dataP);
+}
+
 static struct TestTable table[] = {
         { "test of test_1()", test_1 },
         { "test of test_2()", test_2 },
@@ -448,6 +531,8 @@ static struct TestTable table[] = {
         { "test of test_13()", test_13 },
         { "test of test_14()", test_14 },
         { "test of test_15()", test_15 },
+        { "test of test_16()", test_16 },
+        { "test of lwm2m_data_serialize_into()", test_serialize_into },
         { NULL, NULL },
 };
 
@@ -229,6 +229,63 @@ static void test_tlv_serialize()
     MEMORY_TRACE_AFTER_EQ;
 }
 
+static void test_tlv_serialize_nested(void)
+{
+    lwm2m_data_t *instancesP;
+    lwm2m_data_t *parsedP;
+    uint8_t data[300] = {9, 8, 7};
+    uint8_t *buffer;
+    uint8_t *buffer2;
+    int length;
+    int length2;
+    int size;
+    int i;
+
+    MEMORY_TRACE_BEFORE;
+
+    instancesP = lwm2m_data_new(3);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(instancesP)
+    for (i = 0; i < 3; i++) {
+        lwm2m_data_t *resourcesP = lwm2m_data_new(2);
+        lwm2m_data_t *multipleP = lwm2m_data_new(2);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(resourcesP)
+        CU_ASSERT_PTR_NOT_NULL_FATAL(multipleP)
+
+        // 16 bit identifiers and lengths give headers of every size
+        resourcesP[0].id = 0x1234;
+        lwm2m_data_encode_int(-70000, resourcesP);
+        multipleP[0].id = 0;
+        lwm2m_data_encode_opaque(data, sizeof(data), multipleP);
+        multipleP[1].id = 300;
+        lwm2m_data_encode_string("x", multipleP + 1);
+        resourcesP[1].id = 5;
+        lwm2m_data_encode_instances(multipleP, 2, resourcesP + 1);
+        instancesP[i].id = (uint16_t)(i * 200);
+        lwm2m_data_include(resourcesP, 2, instancesP + i);
+    }
+
+    length = tlv_serialize(false, 3, instancesP, &buffer);
+    // each instance holds 319 bytes: int 3 + 4, multiple resource 4 + opaque 4 + 300 + string 3 + 1
+    // the header of the instance 400 has a 16 bit identifier
+    CU_ASSERT_EQUAL(length, 4 + 319 + 4 + 319 + 5 + 319)
+    CU_ASSERT_EQUAL(buffer[0], 0x10)
+    CU_ASSERT_EQUAL(buffer[1], 0)
+    CU_ASSERT_EQUAL((buffer[2] << 8) + buffer[3], 319)
+
+    size = tlv_parse(buffer, (size_t)length, &parsedP);
+    CU_ASSERT_EQUAL_FATAL(size, 3)
+    length2 = tlv_serialize(false, size, parsedP, &buffer2);
+    CU_ASSERT_EQUAL_FATAL(length2, length)
+    CU_ASSERT(0 == memcmp(buffer, buffer2, length))
+
+    lwm2m_free(buffer);
+    lwm2m_free(buffer2);
+    lwm2m_data_free(size, parsedP);
+    lwm2m_data_free(3, instancesP);
+
+    MEMORY_TRACE_AFTER_EQ;
+}
+
 static void test_tlv_int(void)
 {
    MEMORY_TRACE_BEFORE;
@@ -500,6 +557,7 @@ static struct TestTable table[] = {
         { "test of lwm2m_decodeTLV()", test_decodeTLV },
         { "test of lwm2m_data_parse()", test_tlv_parse },
         { "test of lwm2m_data_serialize()", test_tlv_serialize },
+        { "test of nested TLV serialization", test_tlv_serialize_nested },
         { "test of lwm2m_data_encode_int() and lwm2m_data_decode_int()", test_tlv_int },
         { "test of lwm2m_data_encode_uint() and lwm2m_data_decode_uint()", test_tlv_uint },
         { "test of lwm2m_data_encode_bool()and lwm2m_data_decode_bool()", test_tlv_bool },
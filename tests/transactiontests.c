@@ -0,0 +1,239 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2026 Wakaama contributors and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v2.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v20.html
+ * The Eclipse Distribution License is available at
+ *    http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Please refer to git log
+ *
+ *******************************************************************************/
+
+#include "tests.h"
+#include "CUnit/Basic.h"
+#include "connection.h"
+#include "internals.h"
+#include "liblwm2m.h"
+
+#define STRESS_TRANSACTIONS 100000
+#define STRESS_PEERS        1000
+
+static size_t finishedCount;
+static size_t timedOutCount;
+static size_t sentCount;
+
+static void *fake_session(size_t peer) { return (void *)(uintptr_t)(0x1000 + peer * 16); }
+
+static void make_token(size_t index, uint8_t token[4]) {
+    token[0] = (uint8_t)index;
+    token[1] = (uint8_t)(index >> 8);
+    token[2] = (uint8_t)(index >> 16);
+    token[3] = (uint8_t)(index >> 24);
+}
+
+static void count_callback(lwm2m_context_t *contextP, lwm2m_transaction_t *transacP, void *message) {
+    (void)contextP;
+    (void)transacP;
+
+    if (message == NULL) {
+        timedOutCount++;
+    } else {
+        finishedCount++;
+    }
+}
+
+static int count_send(uint8_t const *buffer, size_t length, void *userData) {
+    (void)buffer;
+    (void)length;
+    (void)userData;
+
+    sentCount++;
+    return 0;
+}
+
+static lwm2m_transaction_t *add_transaction(lwm2m_context_t *contextP, size_t index) {
+    lwm2m_transaction_t *transacP;
+    uint8_t token[4];
+
+    make_token(index, token);
+    transacP = transaction_new(fake_session(index % STRESS_PEERS), COAP_GET, NULL, NULL, (uint16_t)index, 4, token);
+    if (transacP != NULL) {
+        transacP->callback = count_callback;
+        transaction_add(contextP, transacP);
+    }
+    return transacP;
+}
+
+static bool handle_response_from(lwm2m_context_t *contextP, void *sessionH, size_t index, coap_message_type_t type,
+                                 uint16_t mid, bool withToken) {
+    coap_packet_t message;
+    uint8_t token[4];
+
+    coap_init_message(&message, type, COAP_TYPE_RST == type ? 0 : COAP_205_CONTENT, mid);
+    if (withToken) {
+        make_token(index, token);
+        coap_set_header_token(&message, token, 4);
+    }
+    return transaction_handleResponse(contextP, sessionH, &message, NULL);
+}
+
+static bool handle_response(lwm2m_context_t *contextP, size_t index, coap_message_type_t type, uint16_t mid,
+                            bool withToken) {
+    return handle_response_from(contextP, fake_session(index % STRESS_PEERS), index, type, mid, withToken);
+}
+
+static void test_transaction_stress(void) {
+    lwm2m_context_t *contextP = lwm2m_init(NULL);
+    size_t count;
+    size_t i;
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(contextP)
+    finishedCount = 0;
+    timedOutCount = 0;
+
+    // message IDs wrap around, so several peers have a transaction with the same message ID
+    for (i = 0; i < STRESS_TRANSACTIONS; i++) {
+        CU_ASSERT_PTR_NOT_NULL_FATAL(add_transaction(contextP, i))
+    }
+    CU_ASSERT_EQUAL(contextP->transactionUnindexed, 0)
+
+    for (i = 0; i < STRESS_TRANSACTIONS; i += 997) {
+        lwm2m_transaction_t *transacP = transaction_find(contextP, fake_session(i % STRESS_PEERS), (uint16_t)i);
+
+        CU_ASSERT_PTR_NOT_NULL(transacP)
+        if (transacP != NULL) {
+            CU_ASSERT_PTR_EQUAL(transacP->peerH, fake_session(i % STRESS_PEERS))
+        }
+    }
+
+    // an ACK from the wrong peer matches nothing
+    CU_ASSERT_FALSE(handle_response_from(contextP, fake_session(1), 0, COAP_TYPE_ACK, 0, true))
+
+    // finish in a different order than the creation: piggybacked responses first...
+    for (i = 0; i < STRESS_TRANSACTIONS; i += 2) {
+        CU_ASSERT_TRUE(handle_response(contextP, i, COAP_TYPE_ACK, (uint16_t)i, true))
+    }
+    CU_ASSERT_EQUAL(finishedCount, STRESS_TRANSACTIONS / 2)
+
+    // ...then separate responses: empty ACK followed by a CON with the token
+    for (i = 1; i < STRESS_TRANSACTIONS; i += 2) {
+        CU_ASSERT_TRUE(handle_response(contextP, i, COAP_TYPE_ACK, (uint16_t)i, false))
+    }
+    CU_ASSERT_EQUAL(finishedCount, STRESS_TRANSACTIONS / 2)
+    for (i = 1; i < STRESS_TRANSACTIONS; i += 2) {
+        CU_ASSERT_TRUE(handle_response(contextP, i, COAP_TYPE_CON, (uint16_t)(i + 0x8000), true))
+    }
+    CU_ASSERT_EQUAL(finishedCount, STRESS_TRANSACTIONS)
+    CU_ASSERT_EQUAL(timedOutCount, 0)
+
+    CU_ASSERT_PTR_NULL(contextP->transactionList)
+    CU_ASSERT_EQUAL(contextP->transactionMidIndex.count, 0)
+    CU_ASSERT_EQUAL(contextP->transactionTokenIndex.count, 0)
+
+    // a response for an already finished transaction is not matched
+    CU_ASSERT_FALSE(handle_response(contextP, 0, COAP_TYPE_ACK, 0, true))
+
+    count = 0;
+    for (i = 0; i < 16; i++) {
+        count += add_transaction(contextP, i) != NULL;
+    }
+    CU_ASSERT_EQUAL(count, 16)
+
+    lwm2m_close(contextP);
+}
+
+static void test_transaction_reset(void) {
+    lwm2m_context_t *contextP = lwm2m_init(NULL);
+    lwm2m_transaction_t *first;
+    lwm2m_transaction_t *second;
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(contextP)
+    finishedCount = 0;
+
+    first = add_transaction(contextP, 1);
+    second = add_transaction(contextP, 2);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(first)
+    CU_ASSERT_PTR_NOT_NULL_FATAL(second)
+
+    // removing from the middle or the head of the list keeps it consistent
+    CU_ASSERT_TRUE(handle_response(contextP, 1, COAP_TYPE_RST, 1, false))
+    CU_ASSERT_EQUAL(finishedCount, 1)
+    CU_ASSERT_PTR_EQUAL(contextP->transactionList, second)
+    CU_ASSERT_PTR_NULL(second->next)
+    CU_ASSERT_PTR_NULL(second->prev)
+
+    transaction_remove(contextP, second);
+    CU_ASSERT_PTR_NULL(contextP->transactionList)
+    CU_ASSERT_EQUAL(contextP->transactionMidIndex.count, 0)
+
+    lwm2m_close(contextP);
+}
+
+static void test_transaction_retransmission_jitter(void) {
+    lwm2m_context_t *contextP = lwm2m_init(NULL);
+    lwm2m_transaction_t *transacP[32];
+    connection_t connection;
+    int64_t before;
+    int64_t after;
+    size_t distinct;
+    size_t i;
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(contextP)
+    memset(&connection, 0, sizeof(connection));
+    connection.sendFunc = count_send;
+    sentCount = 0;
+
+    before = scheduler_getTimeMs();
+    for (i = 0; i < 32; i++) {
+        transacP[i] = transaction_new(&connection, COAP_GET, NULL, NULL, (uint16_t)i, 0, NULL);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(transacP[i])
+        transaction_add(contextP, transacP[i]);
+        CU_ASSERT_EQUAL(transaction_send(contextP, transacP[i]), 0)
+    }
+    after = scheduler_getTimeMs();
+    CU_ASSERT_EQUAL(sentCount, 32)
+
+    // the initial timeouts are spread between COAP_RESPONSE_TIMEOUT and COAP_RESPONSE_TIMEOUT * COAP_ACK_RANDOM_FACTOR
+    distinct = 0;
+    for (i = 0; i < 32; i++) {
+        CU_ASSERT(transacP[i]->ack_timeout >= COAP_RESPONSE_TIMEOUT * 1000)
+        CU_ASSERT(transacP[i]->ack_timeout <= COAP_RESPONSE_TIMEOUT * 1000 * COAP_ACK_RANDOM_FACTOR)
+        CU_ASSERT(transacP[i]->retrans_time >= before + transacP[i]->ack_timeout)
+        CU_ASSERT(transacP[i]->retrans_time <= after + transacP[i]->ack_timeout)
+        CU_ASSERT_EQUAL(transacP[i]->timer.deadline, transacP[i]->retrans_time)
+        if (transacP[i]->ack_timeout != transacP[0]->ack_timeout) distinct++;
+    }
+    CU_ASSERT(distinct > 0)
+
+    // each retransmission doubles the timeout
+    before = transacP[0]->retrans_time;
+    CU_ASSERT_EQUAL(transaction_send(contextP, transacP[0]), 0)
+    CU_ASSERT_EQUAL(transacP[0]->retrans_time, before + 2 * transacP[0]->ack_timeout)
+    CU_ASSERT_EQUAL(sentCount, 33)
+
+    lwm2m_close(contextP);
+}
+
+static struct TestTable table[] = {
+    {"test of 100000 concurrent transactions", test_transaction_stress},
+    {"test of transaction reset", test_transaction_reset},
+    {"test of randomized retransmission timeouts", test_transaction_retransmission_jitter},
+    {NULL, NULL},
+};
+
+CU_ErrorCode create_transaction_suit() {
+    CU_pSuite pSuite = NULL;
+
+    pSuite = CU_add_suite("Suite_transaction", NULL, NULL);
+    if (NULL == pSuite) {
+        return CU_get_error();
+    }
+
+    return add_tests(pSuite, table);
+}
@@ -59,6 +59,32 @@ int main()
    if (CUE_SUCCESS != create_block1_suit())
       goto exit;
 
+   if (CUE_SUCCESS != create_block2_suit())
+      goto exit;
+
+   if (CUE_SUCCESS != create_index_suit())
+      goto exit;
+
+   if (CUE_SUCCESS != create_transaction_suit())
+      goto exit;
+
+   if (CUE_SUCCESS != create_scheduler_suit())
+      goto exit;
+
+   if (CUE_SUCCESS != create_thread_suit())
+      goto exit;
+
+   if (CUE_SUCCESS != create_observe_suit())
+      goto exit;
+
+   if (CUE_SUCCESS != create_queue_suit())
+      goto exit;
+
+#ifdef LWM2M_DATA_ARENA
+   if (CUE_SUCCESS != create_data_arena_suit())
+      goto exit;
+#endif
+
    if (CUE_SUCCESS != create_convert_numbers_suit())
       goto exit;
 
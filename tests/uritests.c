@@ -381,8 +381,56 @@ static void test_uri_to_string(void)
     MEMORY_TRACE_AFTER_EQ;
 }
 
+static void test_uri_parsed_options(void)
+{
+    coap_packet_t message;
+    coap_packet_t parsed;
+    uint8_t buffer[256];
+    size_t length;
+    lwm2m_uri_t uri;
+    multi_option_t * optP;
+    char * string;
+    int count;
+
+    MEMORY_TRACE_BEFORE;
+
+    coap_init_message(&message, COAP_TYPE_CON, COAP_PUT, 1);
+    coap_set_header_uri_path(&message, "/3303/0/5700");
+    coap_set_header_uri_query(&message, "?pmin=10&pmax=60&gt=30&lt=10&st=1&epmin=1&epmax=120");
+    length = coap_serialize_message(&message, buffer);
+    coap_free_header(&message);
+
+    CU_ASSERT_EQUAL_FATAL(coap_parse_message(&parsed, buffer, (uint16_t)length), NO_ERROR)
+
+    // the path options point into the datagram, their nodes come from the packet
+    CU_ASSERT_PTR_EQUAL(parsed.uri_path, &parsed.option_pool[0])
+    CU_ASSERT_TRUE(parsed.uri_path->data > buffer && parsed.uri_path->data < buffer + length)
+    CU_ASSERT_EQUAL(uri_decode(NULL, parsed.uri_path, parsed.code, &uri), LWM2M_REQUEST_TYPE_DM)
+    CU_ASSERT_EQUAL(uri.objectId, 3303)
+    CU_ASSERT_EQUAL(uri.instanceId, 0)
+    CU_ASSERT_EQUAL(uri.resourceId, 5700)
+
+    // the query options beyond the pool are allocated
+    count = 0;
+    for (optP = parsed.uri_query; optP != NULL; optP = optP->next)
+    {
+        CU_ASSERT_EQUAL(optP->is_pooled, count < COAP_MAX_PARSED_OPTIONS - 3)
+        count++;
+    }
+    CU_ASSERT_EQUAL(count, 7)
+    string = coap_get_multi_option_as_query_string(parsed.uri_query);
+    CU_ASSERT_STRING_EQUAL(string, "?pmin=10&pmax=60&gt=30&lt=10&st=1&epmin=1&epmax=120")
+    lwm2m_free(string);
+
+    coap_free_header(&parsed);
+    CU_ASSERT_PTR_NULL(parsed.uri_query)
+
+    MEMORY_TRACE_AFTER_EQ;
+}
+
 static struct TestTable table[] = {
         { "test of uri_decode()", test_uri_decode },
+        { "test of parsed Uri-Path and Uri-Query options", test_uri_parsed_options },
         { "test of lwm2m_stringToUri()", test_string_to_uri },
         { "test of uri_toString()", test_uri_to_string },
         { NULL, NULL },